@@ -12,9 +12,11 @@
 
 #include <TString.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
+class NllMinimizer;
 class OptParser;
 class PDF_Abs;
 
@@ -83,6 +85,7 @@ class Combiner {
   void setParametersConstant();  // helper function for combine()
   inline void setTitle(TString title) { this->title = title; };
   inline std::vector<Utils::FixPar> getConstVars() { return constVars; };
+  NllMinimizer* getNllMinimizer();
 
  private:
   std::vector<PDF_Abs*> pdfs;         // holds all pdfs to be combined
@@ -96,6 +99,7 @@ class Combiner {
   std::vector<std::string> pdfNames;  // hold all unique names of the pdfs to be combined
   bool _isCombined = false;           // make sure we'll only combine once - else all PDFs get double counted!
   std::vector<Utils::FixPar> constVars;  // hold variables that will be set constant (filled by fixParameter())
+  std::unique_ptr<NllMinimizer> nllMinimizer;  // minimizer of the combined pdf, see getNllMinimizer()
 };
 
 #endif
@@ -0,0 +1,49 @@
+#ifndef CompiledTheory_h
+#define CompiledTheory_h
+
+#include <RooArgList.h>
+
+#include <string>
+#include <vector>
+
+class RooAbsReal;
+
+///
+/// The theory relations of a combination compiled into one native function.
+///
+/// The expressions of the RooFormulaVar relations are translated into C++
+/// (see FormulaParser), with the subexpressions common to several relations,
+/// e.g. the sines and cosines of the strong phases, computed only once. The
+/// code is compiled by the cling JIT, which makes evaluating all relations a
+/// single function call instead of one TFormula evaluation, with the RooFit
+/// overhead, per relation.
+///
+/// The code only depends on the expressions and names of the relations and
+/// of their parameters, not on their order, so a function is compiled only
+/// once per process and is shared by all copies of the combination, e.g. the
+/// clones made for each scan. Relations that can't be translated, or whose
+/// compiled value doesn't agree with RooFit, are evaluated by RooFit.
+///
+class CompiledTheory {
+ public:
+  explicit CompiledTheory(const RooArgList& theory);
+
+  void evaluate(double* th) const;
+  inline const std::string& getCode() const { return _code; };
+  inline int getNCompiled() const { return _nCompiled; };
+  inline int getNRelations() const { return _theory.size(); };
+
+ private:
+  using Function = void (*)(const double* p, double* th);
+
+  std::vector<RooAbsReal*> _theory;  ///< the theory relations, in the order of evaluate()
+  RooArgList _inputs;                ///< the parameters, arguments p of the compiled function
+  std::vector<int> _slot;            ///< for each relation its output th of the compiled function, -1 for RooFit
+  std::string _code;                 ///< the generated code
+  Function _function = nullptr;      ///< the compiled function, nullptr if nothing could be compiled
+  int _nCompiled = 0;                ///< number of relations evaluated by the compiled function
+  mutable std::vector<double> _p;    ///< the parameter values
+  mutable std::vector<double> _th;   ///< the outputs of the compiled function
+};
+
+#endif
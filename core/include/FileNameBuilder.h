@@ -28,6 +28,7 @@ class FileNameBuilder {
   TString getFileBaseName(const Combiner* c) const;
   TString getFileBaseName(const MethodAbsScan* s) const;
   TString getFileNameScanner(const MethodAbsScan* s) const;
+  TString getFileNameProfile(const MethodAbsScan* s) const;
   TString getFileNameSolution(const MethodAbsScan* s) const;
   TString getFileNamePar(const Combiner* c) const;
   TString getFileNamePar(const MethodAbsScan* s) const;
@@ -0,0 +1,41 @@
+#ifndef FitParameterSchema_h
+#define FitParameterSchema_h
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+///
+/// The parameter layout shared by many RooSlimFitResults: the parameter
+/// names, which of them are angles, and which are floating. All fits of
+/// a scan have the same layout, so it is stored once and the fit results
+/// only keep flat arrays of values and errors, indexed by the parameter ID,
+/// i.e. the position of the parameter in getNames().
+///
+/// Schemas are interned: intern() returns the same object for the same
+/// layout, so two fit results have the same layout if their schemas are
+/// the same pointer. Interned schemas live until the end of the program.
+///
+class FitParameterSchema {
+ public:
+  static const FitParameterSchema* intern(std::vector<std::string> names, std::vector<int> floatIds,
+                                          std::vector<bool> angles);
+
+  int getId(const std::string& name) const;
+  inline int getNPars() const { return _names.size(); };
+  inline const std::vector<std::string>& getNames() const { return _names; };
+  inline const std::string& getName(int id) const { return _names[id]; };
+  inline int getFloatId(int id) const { return _floatIds[id]; };
+  inline bool isAngle(int id) const { return _angles[id]; };
+  inline bool isConst(int id) const { return _floatIds[id] < 0; };
+
+ private:
+  FitParameterSchema(std::vector<std::string> names, std::vector<int> floatIds, std::vector<bool> angles);
+
+  std::vector<std::string> _names;            ///< parameter names, by ID
+  std::vector<int> _floatIds;                 ///< position in the correlation matrix, -1 for constant parameters
+  std::vector<bool> _angles;                  ///< is the parameter an angle?
+  std::unordered_map<std::string, int> _ids;  ///< parameter IDs, by name
+};
+
+#endif
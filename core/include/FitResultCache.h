@@ -8,29 +8,52 @@
 #ifndef FitResultCache_h
 #define FitResultCache_h
 
-#include <RooDataSet.h>
+#include "ParameterBinding.h"
 
-#include <cassert>
 #include <vector>
 
 class OptParser;
 
 class RooArgSet;
 
+///
+/// The values of the parameters of a FitResultCache at one point. It is a
+/// view into the storage of the cache, and stays valid as long as the cache
+/// exists. Its values change when the cache overwrites the point, e.g. a
+/// round robin slot.
+///
+class ParameterSnapshot {
+ public:
+  ParameterSnapshot() = default;
+  ParameterSnapshot(const ParameterBinding* pars, const double* values) : _pars(pars), _values(values) {}
+
+  inline bool isValid() const { return _values != nullptr; };
+  void restore() const;
+  void restoreFloating() const;
+
+ private:
+  const ParameterBinding* _pars = nullptr;  ///< the parameters, owned by the FitResultCache
+  const double* _values = nullptr;          ///< their values, owned by the FitResultCache
+};
+
 ///
 /// Helper class for the scan methods. Store several parameter points
-/// that are needed at various points at the scan. The points are handled
-/// in the format of RooFitResults, hence the name. We need
+/// that are needed at various points at the scan. We need
 /// - the parameters at a function call so they can be restored once the
 ///    function is done
 /// - a round robin database to hold the N last fit results, so that in
 ///    the plugin scans we can refit multiple times with varying start
 ///    parameters
 ///
+/// The cache is bound to the parameter set it is first filled from, usually
+/// the parameter set of the combination in the workspace, and keeps a
+/// ParameterBinding of that set. A point is stored as plain doubles, and restored
+/// by setting the values directly, without copying RooArgSets or looking up
+/// parameters by name. All points have to be stored from the same set.
+///
 class FitResultCache {
  public:
   FitResultCache(const OptParser* arg, int roundrobinsize = 4);
-  ~FitResultCache();
 
   FitResultCache(FitResultCache& other) = delete;
   FitResultCache& operator=(const FitResultCache& other) = delete;
@@ -39,23 +62,22 @@ class FitResultCache {
   void storeParsAtGlobalMin(const RooArgSet* set);
   void storeParsRoundRobin(const RooArgSet* set);
   void initRoundRobinDB(const RooArgSet* set);
-  const RooArgSet* getRoundRobinNminus(int n);
-  const inline RooArgSet* getParsAtFunctionCall() {
-    assert(_parsAtFunctionCall);
-    return _parsAtFunctionCall->get(0);
-  };
-  const inline RooArgSet* getParsAtGlobalMin() {
-    assert(_parsAtGlobalMin);
-    return _parsAtGlobalMin->get(0);
-  };
+  ParameterSnapshot getRoundRobinNminus(int n) const;
+  ParameterSnapshot getParsAtFunctionCall() const;
+  ParameterSnapshot getParsAtGlobalMin() const;
 
  private:
-  const OptParser* _arg = nullptr;  ///< command line arguments
-  int _roundrobinsize = -1;         ///< size of the round robin database
-  int _roundrobinid = 0;            ///< id of currently active round robin cell
-  RooDataSet* _parsAtFunctionCall = nullptr;
-  RooDataSet* _parsAtGlobalMin = nullptr;
-  std::vector<RooDataSet*> _parsRoundRobin;
+  void bind(const RooArgSet* set);
+
+  const OptParser* _arg = nullptr;      ///< command line arguments
+  int _roundrobinsize = -1;             ///< size of the round robin database
+  int _roundrobinid = 0;                ///< id of currently active round robin cell
+  const RooArgSet* _set = nullptr;      ///< the parameter set the cache is bound to
+  ParameterBinding _pars;               ///< the parameters of _set
+  std::vector<double> _parsAtFunctionCall;
+  std::vector<double> _parsAtGlobalMin;
+  std::vector<double> _parsRoundRobin;  ///< _roundrobinsize points of _pars.size() values each
+  std::vector<bool> _roundrobinFilled;  ///< which round robin cells hold a point
 };
 
 #endif
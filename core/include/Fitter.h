@@ -8,17 +8,26 @@
 #ifndef Fitter_h
 #define Fitter_h
 
+#include "FitResultCache.h"
+
 #include <RooArgSet.h>
 #include <RooFitResult.h>
 #include <RooWorkspace.h>
 
 #include <TString.h>
 
+#include <memory>
+
+class NllMinimizer;
 class OptParser;
 
 class Fitter {
  public:
   Fitter(const OptParser* arg, RooWorkspace* w, TString name);
+  ~Fitter();
+
+  Fitter(const Fitter&) = delete;
+  Fitter& operator=(const Fitter&) = delete;
 
   void fit();
   void fitForce();
@@ -26,20 +35,21 @@ class Fitter {
   void fitOnce();
   void fitTwice();
   double getChi2() const;
+  NllMinimizer* getNllMinimizer();
   int getStatus() const;
   void print() const;
-  inline void setStartpars(const RooArgSet* pars) { setStartparsFirstFit(pars); };
-  inline void setStartparsFirstFit(const RooArgSet* pars) { startparsFirstFit = pars; };
-  inline void setStartparsSecondFit(const RooArgSet* pars) { startparsSecondFit = pars; };
+  inline void setStartpars(const ParameterSnapshot& pars) { setStartparsFirstFit(pars); };
+  inline void setStartparsFirstFit(const ParameterSnapshot& pars) { startparsFirstFit = pars; };
+  inline void setStartparsSecondFit(const ParameterSnapshot& pars) { startparsSecondFit = pars; };
 
   const OptParser* arg = nullptr;  ///< command line arguments
   RooWorkspace* w = nullptr;       ///< holds all input pdfs, parameters, and observables, as well as the combination
   TString name;                    ///< Name of the pdf. Call combine() first.
 
   /// Start parameters to be used by all fit routines that run one fit, and by the first fit of fitTwice()
-  RooArgSet const* startparsFirstFit = nullptr;
+  ParameterSnapshot startparsFirstFit;
   /// Start parameters to be used by the second fit of fitTwice()
-  RooArgSet const* startparsSecondFit = nullptr;
+  ParameterSnapshot startparsSecondFit;
 
   int nFit1Best = 0;                  ///< counter, how many times did fit 1 of fitTwice() give smaller chi2
   int nFit2Best = 0;                  ///< counter, how many times did fit 2 of fitTwice() give smaller chi2
@@ -47,6 +57,13 @@ class Fitter {
   TString obsName;                    ///< dataset name of observables
   TString parsName;                   ///< set name of physics parameters
   RooFitResult* theResult = nullptr;  ///< the final result
+
+ private:
+  void setParametersToResult();
+
+  std::unique_ptr<NllMinimizer> nll;        ///< reused by all fits, see getNllMinimizer()
+  ParameterBinding pars;                    ///< the parameters of parsName, bound on first use
+  ParameterBinding::Mapping resultMapping;  ///< positions of the floating parameters of theResult in pars
 };
 
 #endif
@@ -0,0 +1,85 @@
+#ifndef FormulaParser_h
+#define FormulaParser_h
+
+#include <string>
+#include <vector>
+
+class RooArgList;
+
+///
+/// Recursive descent parser of the arithmetic subset of the TFormula syntax
+/// used in RooFormulaVar expressions of theory relations: + - * / ^ **, unary
+/// minus, numbers, pi, the dependents as names, @i or x[i], and the common
+/// functions of one or two arguments, also with TMath:: or std:: prefix.
+/// Fails on everything else, e.g. on conditionals or unknown functions.
+///
+/// The expression is translated into a tape of instructions in postfix order,
+/// which is used by TheoryGradient to differentiate it, and by CompiledTheory
+/// to generate C++ code.
+///
+class FormulaParser {
+ public:
+  /// Operations of the tape. The binary operations are kAdd to kAtan2, the
+  /// unary ones kNeg and kSin to kSq.
+  enum Code {
+    kConst,
+    kVar,
+    kNeg,
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kPow,
+    kAtan2,
+    kSin,
+    kCos,
+    kTan,
+    kAsin,
+    kAcos,
+    kAtan,
+    kSinh,
+    kCosh,
+    kTanh,
+    kExp,
+    kLog,
+    kLog10,
+    kSqrt,
+    kAbs,
+    kSq
+  };
+
+  /// An instruction of the tape.
+  struct Instruction {
+    int code;      ///< the operation
+    double value;  ///< the constant, for kConst
+    int index;     ///< the position of the dependent, for kVar
+  };
+
+  FormulaParser(const char* expr, const RooArgList& deps);
+
+  static int depth(const std::vector<Instruction>& tape);
+  static inline bool isBinary(int code) { return code >= kAdd && code <= kAtan2; };
+  bool parse(std::vector<Instruction>& tape);
+
+ private:
+  bool accept(const std::string& token);
+  void call(std::string name);
+  void emit(int code, double value = 0., int index = -1);
+  void expect(const std::string& token);
+  void expression();
+  int integer();
+  void power();
+  void primary();
+  void skipSpace();
+  void term();
+  void unary();
+  void variable(int i);
+
+  const std::string _s;                       ///< the expression
+  const RooArgList& _deps;                    ///< the dependents
+  std::vector<Instruction>* _tape = nullptr;  ///< the tape being filled
+  size_t _pos = 0;                            ///< the current position in the expression
+  bool _ok = true;                            ///< false once parsing failed
+};
+
+#endif
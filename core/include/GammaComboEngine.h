@@ -24,6 +24,7 @@ class OneMinusClPlotAbs;
 class OptParser;
 class ParameterCache;
 class PDF_Abs;
+class PDF_Datasets;
 
 class TApplication;
 
@@ -132,6 +133,17 @@ class GammaComboEngine {
   void makeLatex(Combiner* c);
   void saveWorkspace(Combiner* c, int i);
   void runToys(Combiner* c);
+  void benchmark(Combiner* c);
+  void benchmarkAdaptiveToys(Combiner* c);
+  void benchmarkDatasets(PDF_Datasets* pdf);
+  void benchmarkFit(Combiner* c);
+  void benchmarkFitResultCache(Combiner* c);
+  void benchmarkGaussianChi2(Combiner* c);
+  void benchmarkParameterBinding(Combiner* c);
+  void benchmarkSlimFitResult(Combiner* c);
+  void benchmarkToyAnalysis(Combiner* c);
+  void benchmarkToyFile(Combiner* c);
+  void benchmarkToyGenerator(Combiner* c);
 
   OptParser* arg = nullptr;
   std::vector<Combiner*> cmb;
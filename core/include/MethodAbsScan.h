@@ -35,6 +35,13 @@ class TH2F;
 
 class MethodAbsScan {
  public:
+  /// A point fitted by an adaptive Prob scan (--adaptivescan).
+  struct AdaptivePoint {
+    double x;               ///< value of the scan parameter
+    double y;               ///< value of the second scan parameter, 2d scans only
+    RooSlimFitResult* sfr;  ///< fit result at (x,y), also kept in allResults
+  };
+
   MethodAbsScan() = default;
   MethodAbsScan(Combiner* c);
   MethodAbsScan(const OptParser* opt);
@@ -51,6 +58,7 @@ class MethodAbsScan {
   std::pair<double, double> getBorders(const TGraph& graph, double confidence_level, bool qubic = false) const;
   std::pair<double, double> getBorders_CLs(const TGraph& graph, double confidence_level, bool qubic = false) const;
   inline const std::vector<RooSlimFitResult*>& getCurveResults() { return curveResults; };
+  inline const std::vector<AdaptivePoint>& getAdaptiveResults() const { return adaptiveResults; };
   inline double getChi2minGlobal() const { return chi2minGlobal; }
   inline double getChi2minBkg() const { return chi2minBkg; }
   double getCL(double val) const;
@@ -163,6 +171,9 @@ class MethodAbsScan {
   std::vector<RooSlimFitResult*> curveResults;
   /// All fit results of the the points that make it into the 1-CL curve. Index is the gobal bin number of hCL2d -1.
   std::vector<std::vector<RooSlimFitResult*>> curveResults2d;
+  /// All points fitted by an adaptive Prob scan, sorted by x (and y). The bins of hCL (hCL2d) between them
+  /// are interpolated and have no curve result. Empty for all other scans.
+  std::vector<AdaptivePoint> adaptiveResults;
   /// Local minima filled by saveSolutions() and saveSolutions2d().
   std::vector<RooSlimFitResult*> solutions;
 
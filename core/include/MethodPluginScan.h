@@ -9,10 +9,14 @@
 #define MethodPluginScan_h
 
 #include "MethodAbsScan.h"
+#include "QuantileSketch.h"
+#include "ToyGenerator.h"
 
 #include <TString.h>
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 
 class Combiner;
@@ -22,8 +26,7 @@ class OptParser;
 class PDF_Datasets;
 class ProgressBar;
 class ToyTree;
-
-class RooDataSet;
+struct ToyFileStats;
 
 class TH1F;
 
@@ -40,15 +43,25 @@ class MethodPluginScan : public MethodAbsScan {
   virtual void readScan1dTrees(int runMin = 1, int runMax = 1, TString fName = "default");
   void readScan2dTrees(int runMin = 1, int runMax = 1);
   int getNtoys() const { return nToys; };
+  bool checkToyAnalysis(int nThreads);
   double getPvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t = 0, int id = 0, bool quiet = false);
-  void makeControlPlotsCLs(std::map<int, std::vector<double>> bVals, std::map<int, std::vector<double>> sbVals);
+  void makeControlPlotsCLs(std::map<int, QuantileSketch> bVals, std::map<int, QuantileSketch> sbVals);
+  short getAdaptiveToyDecision(int nToysRun, Long64_t nAll, Long64_t nBetter, float& pvalue, float& pvalueErr) const;
 
  protected:
   TH1F* analyseToys(ToyTree* t, int id = -1, bool quiet = false);
-  void computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, Fitter* f, ProgressBar* pb);
-  RooDataSet* generateToys(int nToys);
+  TH1F* analyseToys(const std::vector<const ToyFileStats*>& stats, float scanpointMin, float scanpointMax,
+                    int scanpointN, int id = -1, bool quiet = false);
+  std::vector<ToyFileStats> collectToys(ToyTree* t, int id, double bestfitpoint, bool quiet = false,
+                                        int nThreads = 0);
+  void computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, Fitter* f, ProgressBar* pb,
+                       int firstToy = 0, int nToysRun = -1);
+  void generateToys(int nToys, std::vector<double>& toyObs, int point, int firstToy);
   double importance(double pvalue) const;
+  double getBestFitPoint(double fallback);
+  void checkNotAdaptive(const MethodAbsScan* s, const TString& caller) const;
   RooSlimFitResult* getParevolPoint(double scanpoint);
+  void runToyFarm(int nUnits, const std::function<void(int iUnit)>& runUnit, ToyTree& t, const TString& fileName);
 
   int nToys = -1;  ///< number of toys to be generated at each scan point
   /// External scanner holding the profile likelihood: DeltaChi2 of the scan PDF on data
@@ -56,7 +69,9 @@ class MethodPluginScan : public MethodAbsScan {
   /// External scanner defining the parameter evolution: set to profileLH unless for the Hybrid Plugin
   MethodProbScan* parevolPLH = nullptr;
 
-  RooDataSet* BkgToys;
+  std::unique_ptr<ToyGenerator> toyGenerator;      ///< generates the toys, see generateToys()
+  std::vector<double> bkgToys;                     ///< bkg-only toys (for CLs method), see ToyGenerator
+  int nBkgToys = 0;                                ///< number of toys in bkgToys
   std::vector<double> chi2minBkgBkgToysvector;     ///< saving the fits of the bkg-only pdf to the bkg-only toy
   std::vector<double> chi2minGlobalBkgToysvector;  ///< saving the fits of the global pdf to the bkg-only toy
 
@@ -9,11 +9,16 @@
 #define MethodProb_h
 
 #include "MethodAbsScan.h"
+#include "NllMinimizer.h"
+
+#include <functional>
+#include <vector>
 
 class Combiner;
 class OptParser;
 
 class TH1F;
+class TH2F;
 
 class MethodProbScan : public MethodAbsScan {
  public:
@@ -24,6 +29,9 @@ class MethodProbScan : public MethodAbsScan {
   virtual int computeCLvalues();  // compute CL histograms depending on desired test statistic
   double getChi2min(double scanpoint) const;
   inline TH1F* getHChi2min() { return hChi2min; };
+  TString getProfileConfigHash() const;
+  bool loadProfile(TString fName);
+  void saveProfile(TString fName) const;
   void saveSolutions();
   void saveSolutions2d();
   virtual int scan1d(bool fast = false, bool reverse = false, bool quiet = false);
@@ -31,10 +39,24 @@ class MethodProbScan : public MethodAbsScan {
   inline void setScanDisableDragMode(bool f = true) { scanDisableDragMode = f; };
 
  protected:
+  void addAdaptiveResult(double x, double y, RooSlimFitResult* sfr);
   bool computeInnerTurnCoords(const int iStart, const int jStart, const int i, const int j, int& iResult, int& jResult,
                               int nTurn);
   bool deleteIfNotInCurveResults2d(RooSlimFitResult* r);
+  void processScanPoint1d(int i, double scanvalue, double chi2minScan, RooSlimFitResult* sfr,
+                          double& bestMinFoundInScan);
+  void processScanPoint2d(int i, int j, double chi2minScan, RooSlimFitResult* sfr, int ndof,
+                          double& bestMinFoundInScan, TH2F* hDbgChi2min2d);
+  std::vector<RooSlimFitResult*> runScanFarm(
+      int nUnits, int nResults, const std::function<void(int iUnit, std::vector<RooSlimFitResult*>& results)>& runUnit,
+      bool quiet, NllMinimizer::Stats& stats);
   void sanityChecks() const;
+  void scan1dAdaptive(bool quiet, double& bestMinFoundInScan);
+  void scan1dForked(bool fast, bool reverse, bool quiet, double& bestMinFoundInScan);
+  void scan2dAdaptive(int ndof, double& bestMinFoundInScan, TH2F* hDbgChi2min2d, const std::function<void()>& drawDbg);
+  void scan2dForked(int iStart, int jStart, int ndof, std::vector<std::vector<RooSlimFitResult*>>& mycurveResults2d,
+                    double& bestMinFoundInScan, TH2F* hDbgChi2min2d, TH2F* hDbgStart,
+                    const std::function<void()>& drawDbg);
 
   bool scanDisableDragMode = false;
   int nScansDone = 0;  // count the number of times a scan was done
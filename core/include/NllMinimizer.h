@@ -0,0 +1,103 @@
+#ifndef NllMinimizer_h
+#define NllMinimizer_h
+
+#include <RooArgList.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class RooGaussianChi2;
+class TheoryGradient;
+
+class RooAbsPdf;
+class RooAbsReal;
+class RooFitResult;
+class RooMinimizer;
+
+namespace ROOT::Math {
+  class Minimizer;
+}
+
+///
+/// Persistent minimizer of -2*log(L) of a likelihood pdf.
+///
+/// Building the -2*log(L) function and a RooMinimizer for every fit is
+/// pure overhead when thousands of fits of the same pdf are done in a scan.
+/// This class builds both once, and is then reused for all fits. The
+/// minimizer picks up the current parameter values, constant flags and
+/// limits at the start of every fit, so callers set up the parameters
+/// in the workspace as before.
+///
+/// If the pdf is a product of RooMultiVarGaussians only, which is the case
+/// for most combinations of PDF_Abs, the chi2 is computed by a
+/// RooGaussianChi2 instead of taking the log of the pdf. Its gradient is
+/// then computed analytically, by chaining d chi2 / d th with the derivatives
+/// of the theory relations (see TheoryGradient), and handed to Minuit instead
+/// of the numerical derivatives. This can be switched off with setUseGradient(),
+/// e.g. by --numgrad, to compare results and timings.
+///
+/// With setWarmStart(), the covariance of the last converged fit is kept
+/// and handed to Minuit as the starting metric of the next fit, which is then
+/// run with a lower strategy. This pays off in scans, where each fit starts
+/// next to the previous minimum. A warm fit that doesn't converge is redone
+/// from the same start values as a normal fit. getStats() counts the fits and
+/// function calls.
+///
+/// The pdf must outlive this object. Like all RooFit objects, an
+/// NllMinimizer must not be shared between threads.
+///
+class NllMinimizer {
+ public:
+  /// Counters of the fits and their function calls.
+  struct Stats {
+    int nFits = 0;             ///< all fits
+    int nWarm = 0;             ///< warm fits that passed the checks
+    int nEscalated = 0;        ///< warm fits that failed the checks and were redone
+    int nWarmApproxCov = 0;    ///< warm fits that passed the checks with an approximate covariance (covQual < 3)
+    long nCalls = 0;           ///< function calls of all fits
+    long nCallsWarm = 0;       ///< function calls of those
+    long nCallsEscalated = 0;  ///< function calls of the failed warm fits, included in nCalls
+
+    Stats& operator+=(const Stats& other);
+    Stats operator-(const Stats& other) const;
+    void print(const char* caller) const;
+  };
+
+  explicit NllMinimizer(RooAbsPdf* pdf);
+  ~NllMinimizer();
+
+  NllMinimizer(const NllMinimizer&) = delete;
+  NllMinimizer& operator=(const NllMinimizer&) = delete;
+
+  RooFitResult* fit(bool thorough, int printLevel);
+  inline RooGaussianChi2* getGaussianChi2() const { return _chi2; };
+  inline int getNFits() const { return _stats.nFits; };
+  inline RooAbsPdf* getPdf() const { return _pdf; };
+  inline const Stats& getStats() const { return _stats; };
+  double getVal() const;
+  void resetWarmStart();
+  void setWarmStart(bool warm);
+  static void setUseGradient(bool use);
+  static bool useGradient();
+  inline bool warmStart() const { return _warmStart; };
+
+ private:
+  RooFitResult* fitMinuit(bool thorough, bool quiet, bool gradient, const std::vector<double>* cov, long& nCalls);
+  bool getWarmCovariance(std::vector<double>& cov) const;
+  void saveWarmCovariance(const RooFitResult* r);
+
+  RooAbsPdf* _pdf = nullptr;                              ///< the likelihood pdf, not owned
+  std::unique_ptr<RooAbsReal> _nll;                       ///< -2*log(L) of the pdf
+  RooGaussianChi2* _chi2 = nullptr;                       ///< _nll, if it is the Gaussian fast path
+  std::unique_ptr<RooMinimizer> _minimizer;               ///< long-lived minimizer of _nll
+  RooArgList _params;                                     ///< parameters of _nll, for fitMinuit()
+  std::unique_ptr<TheoryGradient> _gradient;              ///< derivatives of the theory relations of _chi2
+  std::unique_ptr<ROOT::Math::Minimizer> _gradMinimizer;  ///< long-lived minimizer of fitMinuit()
+  bool _warmStart = false;                                ///< start fits from the covariance of the last fit
+  std::vector<std::string> _warmNames;                    ///< floating parameters of _warmCov
+  std::vector<double> _warmCov;                           ///< covariance of the last converged fit, n x n
+  Stats _stats;                                           ///< counters of the fits done
+};
+
+#endif
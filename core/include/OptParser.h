@@ -31,8 +31,11 @@ class OptParser {
   bool isAction(TString s) const;
   bool isAsimovCombiner(int id) const;
   bool isQuickhack(int id) const;
+  Utils::ForceConfig getForceConfig() const;
 
   std::vector<TString> action;
+  int adaptivescan = 0;
+  double adaptivetoys = 0.;
   std::vector<int> asimov;
   std::vector<TString> asimovfile;
   bool cacheStartingValues;
@@ -60,6 +63,9 @@ class OptParser {
   std::vector<std::string> hexlinecolor;
   TString filenamechange;
   TString filenameaddition;
+  int forcebudget = 0;
+  int forceconfirm = 0;
+  TString forcedesign = "corners";
   std::vector<std::vector<Utils::FixPar>> fixParameters;
   std::vector<std::vector<Utils::StartPar>> startVals;
   std::vector<std::vector<Utils::RangePar>> physRanges;
@@ -81,6 +87,7 @@ class OptParser {
   bool latex = false;
   std::vector<TString> loadParamsFile;
   bool lightfiles = false;
+  int maxtoys = -99;
   int batchstartn = 1;
   bool batcheos = false;
   bool batchsubmit = false;
@@ -88,15 +95,19 @@ class OptParser {
   TString batchreqs;
   int nbatchjobs = -99;
   int nBBpoints = -99;
+  int ncores = 1;
   int ndiv = 407;
   int ndivy = 407;
   bool nosyst = false;
+  bool notoycache = false;
+  bool numgrad = false;
   int npoints1d = -99;
   int npoints2dx = -99;
   int npoints2dy = -99;
   int npointstoy = -99;
   int ncoveragetoys = -99;
   int nrun = -99;
+  int nthreads = 1;
   int ntoys = -99;
   int nsmooth = 1;
   TString parsavefile;
@@ -161,17 +172,21 @@ class OptParser {
   double scanrangeyMax = -102;
   double scaleerr = -999;
   double scalestaterr = -999;
+  unsigned long long seed = 0;
   bool smooth2d = false;
   bool square = false;
   int teststatistic = 2;
   std::vector<TString> title;
   TString xtitle;
   TString ytitle;
+  TString toycompression;
   TString toyFiles;
+  TString toyprecision = "float";
   int updateFreq = 10;
   bool usage = false;
   std::vector<TString> var;
   bool verbose = false;
+  bool warmstart = false;
 
   TCLAP::CmdLine cmd{"", ' ', ""};
 
@@ -17,6 +17,7 @@
 
 class ParametersAbs;
 class RooMultiPdf;
+class ToyGenerator;
 
 class RooAbsData;
 class RooAbsPdf;
@@ -130,11 +131,13 @@ class PDF_Abs {
   bool m_isCrossCorPdf = false;  // Cross correlation PDFs need some extra treatment in places, e.g. in uniquify()
   std::vector<TString> latexObservables;  // holds latex labels for observables
 
-  // The following three members are to gain performance during
+  // The following members are to gain performance during
   // toy generation - generating 1000 toys is much faster than 1000 times one toy.
   int nToyObs = 1000;                       // Number of toy observables to be pregenerated.
   RooAbsData* toyObservables = nullptr;     // A dataset holding nToyObs pregenerated bkg only toy observables.
   RooAbsData* toyBkgObservables = nullptr;  // A dataset holding nToyObs pregenerated toy observables.
+  ToyGenerator* toyGenerator = nullptr;     // Generates the toys of setObservablesToy().
+  std::vector<double> toyObsValues;         // nToyObs pregenerated toys of setObservablesToy(), see ToyGenerator.
   int iToyObs = 0;                          // Index of next unused set of toy observables.
   int gcId = -1;                            // ID of this PDF inside a GammaCombo object. Used to refer to this PDF.
 
@@ -0,0 +1,69 @@
+#ifndef ParameterBinding_h
+#define ParameterBinding_h
+
+#include <TString.h>
+
+#include <unordered_map>
+#include <vector>
+
+class FitParameterSchema;
+
+class RooAbsCollection;
+class RooAbsReal;
+class RooRealVar;
+class RooSlimFitResult;
+class RooWorkspace;
+
+class TNamed;
+
+///
+/// A set of variables of the workspace, e.g. the parameters, observables or
+/// theory relations of a combination, resolved once into their RooFit
+/// objects. Values are then copied by index, instead of looking up the set
+/// in the workspace, and each variable in it by name, on every copy as done
+/// by Utils::setParameters().
+///
+/// Values held by another collection, e.g. the floating parameters of a fit
+/// result or a row of a RooDataSet, are copied through a Mapping, holding
+/// the index in the binding of each element of the collection. The mapping
+/// is built on first use and only rebuilt when the layout of the collection
+/// changes, which is detected by comparing the interned name pointers of its
+/// elements (RooAbsArg::namePtr()), or the schema of a RooSlimFitResult.
+///
+class ParameterBinding {
+ public:
+  ///
+  /// The positions in a binding of the elements of a source collection.
+  ///
+  struct Mapping {
+    std::vector<const TNamed*> names;            ///< the layout of the source collection
+    const FitParameterSchema* schema = nullptr;  ///< the layout of the source fit result
+    std::vector<int> index;                      ///< index of each source element in the binding, -1 if not bound
+  };
+
+  ParameterBinding() = default;
+  explicit ParameterBinding(const RooAbsCollection& set);
+  ParameterBinding(RooWorkspace* w, const TString& setName);
+
+  int getIndex(const char* name) const;
+  inline const std::vector<RooAbsReal*>& getReals() const { return _reals; };
+  inline RooRealVar* getVar(int i) const { return _vars[i]; };
+  inline bool isValid() const { return _valid; };
+  inline int size() const { return _reals.size(); };
+
+  const std::vector<int>& map(const RooAbsCollection& values, Mapping& mapping) const;
+  void getValues(double* values) const;
+  void getValues(float* values) const;
+  void setValues(const double* values) const;
+  void setValuesFloating(const double* values) const;
+  void setValues(const RooAbsCollection& values, Mapping& mapping, bool floatingOnly = false) const;
+  void setValues(const RooSlimFitResult& values, Mapping& mapping) const;
+
+ private:
+  std::vector<RooAbsReal*> _reals;                ///< the elements of the set, owned by the workspace
+  std::vector<RooRealVar*> _vars;                 ///< the same as RooRealVar, nullptr if they can't be set
+  std::unordered_map<const TNamed*, int> _index;  ///< index of each element, by interned name
+  bool _valid = false;                            ///< was the binding made from an existing set?
+};
+
+#endif
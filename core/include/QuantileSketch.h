@@ -0,0 +1,61 @@
+#ifndef QuantileSketch_h
+#define QuantileSketch_h
+
+#include <RtypesCore.h>
+
+#include <vector>
+
+///
+/// Mergeable sketch of the distribution of many values, e.g. of the test
+/// statistic of the toys at one scan point, from which quantiles and tail
+/// fractions are computed in bounded memory.
+///
+/// This is the KLL sketch (Karnin, Lang, Liberty, arXiv:1603.05346). The values
+/// are kept in levels, where a value at level h stands for 2^h original values.
+/// When the sketch is full, the lowest full level is sorted and every other value
+/// is promoted to the next level. Level capacities shrink by 2/3 per level
+/// below the top one, so that the sketch holds at most about 3k values.
+///
+/// Error bound: up to k values the sketch is exact, and getQuantiles() and
+/// getFracAbove() return the same as Utils::Quantile() and
+/// Utils::getVectorFracAboveValue() on the full list of values. Beyond, the
+/// rank of a query, i.e. the fraction of values below a quantile or a tail
+/// fraction, is off by less than about 2.3/k^0.97 (0.3% for the default
+/// k = 1000) with 99% probability, independent of the number of values, as
+/// measured for the reference implementation of Apache DataSketches. Merging
+/// sketches gives the same error bound as filling a single one.
+///
+class QuantileSketch {
+ public:
+  explicit QuantileSketch(int k = 1000);
+
+  void add(double value, Long64_t weight = 1);
+  void merge(const QuantileSketch& other);
+  inline Long64_t getN() const { return _n; };
+  inline bool isExact() const { return _levels.size() < 2; };
+  double getFracAbove(double value) const;
+  std::vector<double> getQuantiles(const std::vector<double>& probs) const;
+  static std::vector<double> getQuantiles(const std::vector<double>& values, const std::vector<Long64_t>& weights,
+                                          const std::vector<double>& probs);
+  void getWeightedValues(std::vector<double>& values, std::vector<Long64_t>& weights) const;
+  void getState(std::vector<double>& values, std::vector<int>& levelSizes) const;
+  void setState(const std::vector<double>& values, const std::vector<int>& levelSizes);
+
+ private:
+  int capacity(int level) const;
+  void compress();
+  void compact(int level);
+  void sort() const;
+  static std::vector<double> getSortedQuantiles(const std::vector<double>& sorted,
+                                                const std::vector<Long64_t>& cumWeights,
+                                                const std::vector<double>& probs);
+
+  int _k;                                     ///< accuracy parameter, the number of values kept exactly
+  Long64_t _n = 0;                            ///< number of values added
+  std::vector<std::vector<double>> _levels;   ///< values at each level, level h has weight 2^h
+  mutable std::vector<double> _sorted;        ///< all values, sorted
+  mutable std::vector<Long64_t> _cumWeights;  ///< total weight of _sorted up to and including each value
+  mutable bool _isSorted = true;              ///< _sorted is up to date
+};
+
+#endif
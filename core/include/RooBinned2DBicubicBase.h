@@ -78,6 +78,8 @@ class RooBinned2DBicubicBase : public BASE {
 
   /// evaluation of function
   virtual Double_t evaluate() const;
+  /// vectorised evaluation of function, for the batch evaluation backend
+  virtual void doEval(RooFit::EvalContext& ctx) const;
   /// advertise analytical integrals
   virtual Int_t getAnalyticalIntegral(RooArgSet& allVars, RooArgSet& integVars, const char* rangeName = 0) const;
   /// evaluate advertised analytical integral
@@ -118,6 +120,22 @@ class RooBinned2DBicubicBase : public BASE {
     return coeffs[coeff + CoeffRecLen * (binx + nBinsX * biny)];
   }
 
+  /** @brief evaluate the interpolation polynomial of a cell
+   *
+   * @param c   coefficient record of the cell, c[k] multiplies
+   *            hx^(3 - k % 4) * hy^(3 - k / 4)
+   * @param hx  x in unit square coordinates of the cell
+   * @param hy  y in unit square coordinates of the cell
+   *
+   * Horner scheme, first in hx for each power of hy, then in hy.
+   */
+  static inline double evalCell(const double* c, double hx, double hy) {
+    const double r0 = ((c[0] * hx + c[1]) * hx + c[2]) * hx + c[3];
+    const double r1 = ((c[4] * hx + c[5]) * hx + c[6]) * hx + c[7];
+    const double r2 = ((c[8] * hx + c[9]) * hx + c[10]) * hx + c[11];
+    const double r3 = ((c[12] * hx + c[13]) * hx + c[14]) * hx + c[15];
+    return ((r0 * hy + r1) * hy + r2) * hy + r3;
+  }
   /// evaluate at given point
   double eval(double x, double y) const;
   /// evaluate integral over x at given y from (x1, y) to (x2, y)
@@ -23,6 +23,7 @@ class RooCrossCorPdf : public RooAbsPdf {
   TMatrixDSym _invcov;
   int _nObsPdf1;
   Double_t evaluate() const;
+  void doEval(RooFit::EvalContext& ctx) const;
 
  private:
   ClassDef(RooCrossCorPdf, 2)  //  RooCrossCorPdf function PDF
@@ -0,0 +1,64 @@
+#ifndef RooGaussianChi2_h
+#define RooGaussianChi2_h
+
+#include <RooAbsReal.h>
+#include <RooListProxy.h>
+
+#include <memory>
+#include <vector>
+
+class CompiledTheory;
+
+class RooAbsPdf;
+class RooArgList;
+
+class TObject;
+
+///
+/// The function -2*log(L) of a product of multivariate Gaussians, as built by
+/// Combiner::combine() for combinations of PDF_Abs that use RooMultiVarGaussian.
+///
+/// All observables and theory relations are concatenated into flat vectors, and
+/// the inverse covariance matrices are stored as one packed block-diagonal matrix,
+/// so that the chi2 is computed in a single pass without the RooFit overhead of
+/// the individual pdfs and of their product. The value equals -2*log(L) of the
+/// unnormalised product, as computed by RooMinusTwoLogL, but doesn't underflow
+/// far away from the minimum.
+///
+/// After compileTheory(), the theory relations are evaluated by a single
+/// compiled function (see CompiledTheory) instead of one by one by RooFit.
+///
+class RooGaussianChi2 : public RooAbsReal {
+ public:
+  RooGaussianChi2() {};
+  RooGaussianChi2(const char* name, const char* title, const RooArgList& gaussians);
+  RooGaussianChi2(const RooGaussianChi2& other, const char* name = 0);
+  ~RooGaussianChi2() override;
+  TObject* clone(const char* newname) const override { return new RooGaussianChi2(*this, newname); }
+
+  void compileTheory();
+  static bool findGaussians(const RooAbsPdf& pdf, RooArgList& gaussians);
+  double evaluateTheoryGradient(std::vector<double>& dChi2dTh) const;
+  inline int getNobs() const { return _obs.size(); };
+  inline const RooArgList& getObservables() const { return _obs; };
+  inline const CompiledTheory* getCompiledTheory() const { return _compiled.get(); };
+  inline const RooArgList& getTheory() const { return _th; };
+
+ protected:
+  RooListProxy _obs;                          ///< observables of all Gaussians
+  RooListProxy _th;                           ///< theory relations, in the same order
+  std::vector<int> _blockStart;               ///< index of the first observable of each Gaussian, and the total
+  std::vector<int> _weightStart;              ///< index of the first packed weight of each Gaussian
+  std::vector<double> _weights;               ///< lower triangles of the inverse covariances, off-diagonals doubled
+  mutable std::vector<double> _res;           //! residuals, scratch space of evaluate()
+  mutable std::vector<double> _thVal;         //! theory values, scratch space of evaluateTheory()
+  std::unique_ptr<CompiledTheory> _compiled;  //! compiled theory relations, see compileTheory()
+
+  double evaluate() const override;
+  const double* evaluateTheory() const;
+
+ private:
+  ClassDefOverride(RooGaussianChi2, 1);
+};
+
+#endif
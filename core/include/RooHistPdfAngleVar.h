@@ -26,6 +26,7 @@ class RooHistPdfAngleVar : public RooAbsReal {
   RooRealProxy xshift;
 
   Double_t evaluate() const;
+  void doEval(RooFit::EvalContext& ctx) const;
 
  private:
   ClassDef(RooHistPdfAngleVar, 1);
@@ -26,6 +26,7 @@ class RooHistPdfVar : public RooAbsReal {
   RooRealProxy xshift;
 
   Double_t evaluate() const;
+  void doEval(RooFit::EvalContext& ctx) const;
 
  private:
   ClassDef(RooHistPdfVar, 1);
@@ -0,0 +1,32 @@
+#ifndef RooMinusTwoLogL_h
+#define RooMinusTwoLogL_h
+
+#include <RooAbsReal.h>
+#include <RooRealProxy.h>
+
+class RooAbsPdf;
+
+class TObject;
+
+///
+/// The function -2*log(L) that is minimised in all fits, with L the
+/// value of the likelihood pdf. Compiled replacement of the interpreted
+/// RooFormulaVar("-2*log(@0)").
+///
+class RooMinusTwoLogL : public RooAbsReal {
+ public:
+  RooMinusTwoLogL() {};
+  RooMinusTwoLogL(const char* name, const char* title, RooAbsPdf& pdf);
+  RooMinusTwoLogL(const RooMinusTwoLogL& other, const char* name = 0);
+  TObject* clone(const char* newname) const override { return new RooMinusTwoLogL(*this, newname); }
+
+ protected:
+  RooRealProxy pdf;
+
+  double evaluate() const override;
+
+ private:
+  ClassDefOverride(RooMinusTwoLogL, 1);
+};
+
+#endif
@@ -43,6 +43,8 @@ class RooMultiPdf : public RooAbsPdf {
   int getCurrentIndex() const;
   RooAbsPdf* getPdf(int index) const;
   virtual Double_t getValV(const RooArgSet* nset) const;
+  /// the value is the one of the current pdf, which is already normalized
+  virtual bool selfNormalized() const { return true; }
   /// needed since otherwise printValue calls evaluate(), which is taboo
   virtual void printValue(std::ostream& os) const { getCurrentPdf()->printValue(os); }
 
@@ -59,6 +61,7 @@ class RooMultiPdf : public RooAbsPdf {
   mutable Int_t _oldIndex;
 
   Double_t evaluate() const;
+  virtual void doEval(RooFit::EvalContext& ctx) const;
   Double_t getLogVal(const RooArgSet* set = 0) const;
   // std::string createCorrectionString();  // should only do this once really
   double cFactor;
@@ -29,6 +29,7 @@ class RooPoly3Var : public RooAbsReal {
   double p3;
 
   Double_t evaluate() const;
+  void doEval(RooFit::EvalContext& ctx) const;
 
  private:
   ClassDef(RooPoly3Var, 1);
@@ -30,6 +30,7 @@ class RooPoly4Var : public RooAbsReal {
   double p4;
 
   Double_t evaluate() const;
+  void doEval(RooFit::EvalContext& ctx) const;
 
  private:
   ClassDef(RooPoly4Var, 1);
@@ -12,6 +12,8 @@
 #ifndef RooSlimFitResult_h
 #define RooSlimFitResult_h
 
+#include <FitParameterSchema.h>
+
 #include <RooArgList.h>
 #include <RooRealVar.h>
 
@@ -19,8 +21,10 @@
 #include <TObject.h>
 #include <TString.h>
 
+#include <cassert>
 #include <fstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 class RooFitResult;
@@ -30,6 +34,12 @@ class RooFitResult;
 /// but uses less internal memory by not storing the correlation matrix,
 /// if not specifically requested. It also contains a few extra getters.
 ///
+/// The parameter names and flags are kept in a FitParameterSchema shared
+/// by all fit results with the same parameters, the values and errors in
+/// one flat array. getParId() returns the ID of a parameter, which is valid
+/// for all fit results with the same schema and gives direct access to its
+/// value and error.
+///
 class RooSlimFitResult : public TObject {
  public:
   RooSlimFitResult();
@@ -44,10 +54,14 @@ class RooSlimFitResult : public TObject {
   inline Double_t edm() const { return _edm; };
   const RooArgList& constPars() const;
   const RooArgList& floatParsFinal() const;
+  int getParId(TString name) const;
+  inline float getParVal(int id) const { return _values[id]; };
+  inline float getParErr(int id) const { return _values[_schema->getNPars() + id]; };
   float getParVal(TString name) const;
   float getParErr(TString name) const;
   float getConstParVal(TString name) const;
   float getFloatParFinalVal(TString name) const;
+  inline const FitParameterSchema* getSchema() const { return _schema; };
   bool hasParameter(TString name) const;
   inline bool isConfirmed() const { return _isConfirmed; };
   inline Double_t minNll() const { return _minNLL; };
@@ -56,25 +70,31 @@ class RooSlimFitResult : public TObject {
   inline void setConfirmed(bool c) { _isConfirmed = c; };
   inline Int_t status() const { return _status; };
 
-  // private:
-
+ private:
   template <class FitResult>
   void init(const FitResult* r, bool storeCorrelation = false);
+  void init(const RooSlimFitResult* r);
   bool isAngle(RooRealVar* v);
+  void clearStreamerVectors();
 
+  const FitParameterSchema* _schema = nullptr;  //! names and flags of the parameters, shared with other fit results
+  std::vector<float> _values;                   //! values of all parameters by ID, followed by their errors
+
+  // Only used to read and write fit results, see Streamer(). In memory,
+  // parameters are stored in _schema and _values.
   std::vector<std::string> _parsNames;  // variable names
   std::vector<int> _parsFloatId;  // ID of floating parameter - this corresponds to the correlation matrix position
   std::vector<float> _parsVal;    // values of const parameters, index given by position in _variable names
   std::vector<float> _parsErr;
   std::vector<bool> _parsAngle;  // is it an angle?
   std::vector<bool> _parsConst;  // is it constant?
+
   Double_t _edm;
   Double_t _minNLL;
   Int_t _covQual;
   Int_t _status;
   TMatrixDSym _correlationMatrix;
 
- private:
   // Dummy auxiliary variables to speed up constPars() and floatParsFinal()
   mutable RooArgList _constParsDummy;
   mutable RooArgList _floatParsFinalDummy;
@@ -92,28 +112,32 @@ class RooSlimFitResult : public TObject {
 template <class FitResult>
 void RooSlimFitResult::init(const FitResult* r, bool storeCorrelation) {
   assert(r);
+  std::vector<std::string> names;
+  std::vector<int> floatIds;
+  std::vector<bool> angles;
+  std::vector<float> errors;
   // copy over const parameters
   int size = r->constPars().getSize();
   for (int i = 0; i < size; i++) {
     RooRealVar* p = (RooRealVar*)r->constPars().at(i);
-    _parsNames.push_back(p->GetName());
-    _parsVal.push_back(p->getVal());
-    _parsErr.push_back(0.);
-    _parsAngle.push_back(isAngle(p));
-    _parsConst.push_back(true);
-    _parsFloatId.push_back(-1);  // floating ID doesn't exist for constant parameters
+    names.push_back(p->GetName());
+    _values.push_back(p->getVal());
+    errors.push_back(0.);
+    angles.push_back(isAngle(p));
+    floatIds.push_back(-1);  // floating ID doesn't exist for constant parameters
   }
   // copy over floating parameters
   size = r->floatParsFinal().getSize();
   for (int i = 0; i < size; i++) {
     RooRealVar* p = (RooRealVar*)r->floatParsFinal().at(i);
-    _parsNames.push_back(p->GetName());
-    _parsVal.push_back(p->getVal());
-    _parsErr.push_back(p->getError());
-    _parsAngle.push_back(isAngle(p));
-    _parsConst.push_back(false);
-    _parsFloatId.push_back(i);  // needed to store the parameter's position in the COR matrix (matches floatParsFinal())
+    names.push_back(p->GetName());
+    _values.push_back(p->getVal());
+    errors.push_back(p->getError());
+    angles.push_back(isAngle(p));
+    floatIds.push_back(i);  // needed to store the parameter's position in the COR matrix (matches floatParsFinal())
   }
+  _values.insert(_values.end(), errors.begin(), errors.end());
+  _schema = FitParameterSchema::intern(std::move(names), std::move(floatIds), std::move(angles));
   // copy over numeric values
   _covQual = r->covQual();
   _edm = r->edm();
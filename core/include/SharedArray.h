@@ -48,6 +48,8 @@ class SharedArrayImp : public TObject {
   const TYPE& operator[](unsigned idx) const { return arr[idx]; }
   /// read-write access
   TYPE& operator[](unsigned idx) { return arr[idx]; }
+  /// read-only access to the contiguous array
+  const TYPE* data() const { return arr.data(); }
 
  private:
   /// reference count
@@ -91,6 +93,8 @@ class SharedArray : public TObject {
   const RWProxy operator[](unsigned idx) const { return RWProxy(const_cast<SharedArray<TYPE>*>(this), idx); }
   /// read-write access to array elements
   RWProxy operator[](unsigned idx) { return RWProxy(this, idx); }
+  /// read-only access to the contiguous array, for loops which must not go through RWProxy
+  const TYPE* data() const { return pimpl ? pimpl->data() : 0; }
 
  private:
   /// trigger copy-on-write
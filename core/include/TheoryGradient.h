@@ -0,0 +1,54 @@
+#ifndef TheoryGradient_h
+#define TheoryGradient_h
+
+#include "FormulaParser.h"
+
+#include <RooArgList.h>
+
+#include <vector>
+
+class RooAbsReal;
+class RooRealVar;
+
+///
+/// Derivatives of the theory relations of a combination with respect to
+/// its parameters, for the analytic gradient of the chi2 (see NllMinimizer).
+///
+/// The expressions of RooFormulaVar theory relations are compiled into a
+/// small tape, which is evaluated with forward-mode automatic differentiation,
+/// i.e. together with the derivatives with respect to the dependents. Relations
+/// that aren't RooFormulaVars of parameters, whose expressions use functions
+/// not known here, or whose compiled value or derivatives don't agree with
+/// RooFit are differentiated numerically instead, by central differences of
+/// the single relation.
+///
+class TheoryGradient {
+ public:
+  TheoryGradient(const RooArgList& theory, const RooArgList& pars);
+
+  void accumulate(const std::vector<double>& dChi2dTh, std::vector<double>& grad) const;
+  inline int getNAnalytic() const { return _nAnalytic; };
+  inline int getNRelations() const { return _relations.size(); };
+
+ private:
+  /// A theory relation.
+  struct Relation {
+    RooAbsReal* th;
+    std::vector<RooRealVar*> deps;                 ///< the dependents: variables of the tape, or all variables
+    std::vector<int> index;                        ///< the positions of the dependents in the parameter list
+    std::vector<FormulaParser::Instruction> tape;  ///< the compiled expression, empty for numerical derivatives
+    int depth = 0;                                 ///< the maximum stack depth of the tape
+  };
+
+  bool compile(Relation& rel) const;
+  double evaluate(const Relation& rel, double* deriv) const;
+  void numerical(const Relation& rel, double* deriv) const;
+
+  RooArgList _pars;                      ///< the parameters
+  std::vector<Relation> _relations;      ///< the theory relations
+  int _nAnalytic = 0;                    ///< number of relations differentiated analytically
+  mutable std::vector<double> _stack;    ///< evaluation stack of the tapes
+  mutable std::vector<double> _deriv;    ///< derivatives of one relation
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ToyCache_h
+#define ToyCache_h
+
+#include <QuantileSketch.h>
+
+#include <TString.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+///
+/// Everything MethodPluginScan::analyseToys() needs to know about
+/// the toys at one scan point.
+///
+struct ToyPointStats {
+  Long64_t nBetter = 0;       ///< toys with a larger s+b test statistic than the data
+  Long64_t nBetterClb = 0;    ///< toys with a larger b test statistic than the data
+  Long64_t nAll = 0;          ///< toys in the physical region
+  Long64_t nBackground = 0;   ///< toys outside the physical region
+  Long64_t nGof = 0;          ///< toys with a worse global minimum than the data
+  QuantileSketch sbTestStat;  ///< s+b test statistic of the toys in the physical region
+  QuantileSketch bTestStat;   ///< b test statistic of the toys in the physical region
+};
+
+///
+/// Summary of the toys of one toy file, see MethodPluginScan::collectToys().
+/// All scan points found in the file are present in points, also those
+/// whose toys all failed.
+///
+struct ToyFileStats {
+  Long64_t nEntries = 0;   ///< entries in the file
+  Long64_t nSelected = 0;  ///< entries with the requested id
+  Long64_t nFailed = 0;    ///< selected entries with failed fits
+  Long64_t nWrongRun = 0;  ///< selected entries with a different global minimum of the data
+  std::map<float, ToyPointStats> points;
+
+  void add(const ToyFileStats& other);
+};
+
+///
+/// Persistent cache of the ToyFileStats of Plugin toy files, so that
+/// reading a scan only needs to analyse toy files that were added or changed
+/// since the last time. Files are identified by their name, modification
+/// time and size. The cache is only valid for one analysis configuration,
+/// which is passed as a string; if it differs from the one in the cache
+/// file, the cache is discarded.
+///
+class ToyCache {
+ public:
+  ToyCache(const TString& fileName, const TString& config);
+
+  const ToyFileStats* get(const TString& toyFile) const;
+  const ToyFileStats* put(const TString& toyFile, ToyFileStats&& stats);
+  void write() const;
+
+ private:
+  struct Entry {
+    Long64_t mtime = 0;
+    Long64_t size = 0;
+    ToyFileStats stats;
+  };
+  static bool getFileInfo(const TString& file, Long64_t& mtime, Long64_t& size);
+  void read();
+
+  TString fileName;                      ///< name of the cache file
+  TString config;                        ///< configuration the cached statistics are valid for
+  std::map<std::string, Entry> entries;  ///< cached statistics, by toy file name
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ToyGenerator_h
+#define ToyGenerator_h
+
+#include <RooArgList.h>
+#include <RooArgSet.h>
+
+#include <vector>
+
+class RooAbsCollection;
+class RooAbsPdf;
+
+///
+/// Generates toy observables of a likelihood pdf into a flat array, without
+/// going through a RooDataSet.
+///
+/// The pdf is split into the factors of its products. RooMultiVarGaussian
+/// factors are sampled directly, as x = mu + L z, with L the Cholesky
+/// decomposition of the covariance matrix and z standard normal numbers from
+/// RooRandom. As in RooMultiVarGaussian::generateEvent(), vectors outside of
+/// the ranges of the observables are redrawn. Only the other factors, e.g.
+/// the histogram pdfs, are generated by RooFit. If the observables aren't
+/// split cleanly between the factors, the whole pdf is generated by RooFit.
+///
+/// The toys are stored observable by observable, toyObs[iObs*nToys+iToy].
+///
+/// If the first toy is given, each toy of a Gaussian factor is drawn from its
+/// own ToyRandom stream, so it doesn't depend on the other toys generated
+/// with it. The RooFit factors draw all toys from the stream of the first one.
+///
+class ToyGenerator {
+ public:
+  ToyGenerator(RooAbsPdf* pdf, const RooAbsCollection& observables);
+
+  void generate(int nToys, std::vector<double>& toyObs, int firstToy = -1) const;
+  inline int getNobs() const { return _obs.size(); };
+  inline const RooArgList& getObservables() const { return _obs; };
+  inline const RooAbsPdf* getPdf() const { return _pdf; };
+  inline bool isNative() const { return _others.empty(); };
+  void setObservables(const std::vector<double>& toyObs, int nToys, int iToy) const;
+
+ private:
+  /// A factor of the pdf, with the positions of its observables in _obs.
+  struct Factor {
+    RooAbsPdf* pdf;
+    RooArgSet obs;
+    std::vector<int> index;
+  };
+  void addFactor(RooAbsPdf* pdf);
+  void generateGaussian(const Factor& f, int nToys, std::vector<double>& toyObs, int firstToy, int substream) const;
+  void generateRooFit(const Factor& f, int nToys, std::vector<double>& toyObs, int firstToy, int substream) const;
+
+  RooAbsPdf* _pdf;                 ///< the pdf
+  RooArgList _obs;                 ///< the generated observables
+  std::vector<Factor> _gaussians;  ///< RooMultiVarGaussian factors, sampled directly
+  std::vector<Factor> _others;     ///< all other factors, generated by RooFit
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ToyRandom_h
+#define ToyRandom_h
+
+#include <TRandom.h>
+
+///
+/// Counter-based random number generator for the toys, Philox4x32-10
+/// (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11).
+///
+/// Random numbers are obtained by encrypting a counter with a key, so
+/// every random number can be computed directly from its position: the
+/// key is the campaign seed (--seed), and the counter holds the toy run
+/// (--nrun), the scan point, the toy, a substream, and the position in the
+/// stream. A scan selects the stream of a toy with setStream() before drawing
+/// it, so each toy (or work unit) comes out the same no matter which process,
+/// node or order it is run in, and streams never overlap.
+///
+/// It is installed as the RooRandom generator by install(), so the RooFit toy
+/// generation and all other users of RooRandom draw from it.
+///
+class ToyRandom : public TRandom {
+ public:
+  /// Substreams of a toy, for independent random numbers serving different purposes.
+  enum Substream {
+    kToys = 0,       ///< the toy observables
+    kNuisances = 1,  ///< randomized nuisance parameters (--action uniform, gaus)
+    kBkgToys = 2,    ///< background-only toys
+    kCoverage = 3,   ///< the toy observables of the coverage tests
+    kFactors = 16    ///< first substream for the factors of a ToyGenerator
+  };
+
+  ToyRandom(ULong64_t seed, int nrun);
+
+  static void install(ULong64_t seed, int nrun);
+  static void setStream(int point, int toy, int substream = kToys);
+  static void setToy(int toy, int substream = kToys);
+
+  inline ULong64_t getSeed() const { return _seed; };
+  UInt_t GetSeed() const override;
+  Double_t Rndm() override;
+  void RndmArray(Int_t n, Float_t* array) override;
+  void RndmArray(Int_t n, Double_t* array) override;
+  void selectStream(int point, int toy, int substream);
+  void SetSeed(ULong_t seed = 0) override;
+
+ private:
+  static ToyRandom* current();
+  UInt_t nextWord();
+
+  ULong64_t _seed;        ///< the key
+  UInt_t _nrun;           ///< the toy run
+  UInt_t _point = 0;      ///< the scan point
+  UInt_t _toy = 0;        ///< the toy
+  UInt_t _substream = 0;  ///< the substream of the toy
+  UInt_t _block = 0;      ///< the next block of the stream
+  UInt_t _words[4];       ///< the current block
+  int _iWord = 4;         ///< next word of the current block
+};
+
+#endif
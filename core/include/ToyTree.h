@@ -8,12 +8,16 @@
 #ifndef ToyTree_h
 #define ToyTree_h
 
+#include "ParameterBinding.h"
+
 #include <TString.h>
 
 #include <RooArgSet.h>
 
+#include <functional>
 #include <map>
 #include <string>
+#include <vector>
 
 class Combiner;
 class OptParser;
@@ -23,6 +27,7 @@ class RooFitResult;
 class RooWorkspace;
 
 class TChain;
+class TLeaf;
 class TTree;
 
 ///
@@ -59,6 +64,7 @@ class ToyTree {
   void storeParsScan(RooFitResult* values);
   void storeTheory();
   void storeObservables();
+  static int parseCompression(TString setting);
   void writeToFile(TString fName);
   void writeToFile();
   void setStoreObs(bool flag) { this->storeObs = flag; };
@@ -68,50 +74,72 @@ class ToyTree {
 
   float scanpoint = 0.f;         ///< the scanpoint for 1D scans, or the x scanpoint for 2D scans
   float scanpointy = 0.f;        ///< the y scanpoint for 2D scans
-  float chi2min = 0.f;           ///< the chi2 of the fit with var fixed to scan point
-  float chi2minGlobal = 0.f;     ///< the chi2 of the free fit
-  float chi2minBkg = 0.f;        ///< the chi2 of the fit of the bkg hypothesis (for CLs method)
-  float chi2minToy = 0.f;        ///< the chi2 of the fit to the toy with var fixed to scan point
-  float chi2minGlobalToy = 0.f;  ///< the chi2 of the free fit to the toy
+  double chi2min = 0.;           ///< the chi2 of the fit with var fixed to scan point
+  double chi2minGlobal = 0.;     ///< the chi2 of the free fit
+  double chi2minBkg = 0.;        ///< the chi2 of the fit of the bkg hypothesis (for CLs method)
+  double chi2minToy = 0.;        ///< the chi2 of the fit to the toy with var fixed to scan point
+  double chi2minGlobalToy = 0.;  ///< the chi2 of the free fit to the toy
   /// The chi2 of the fit of the hypothesis value to the bkg toy distribution (for CLs method)
-  float chi2minBkgToy = 0.f;
-  float chi2minGlobalBkgToy = 0.f;  ///< the chi2 of the free fit to the bkg only toys
-  float chi2minBkgBkgToy = 0.f;     ///< the chi2 of the bkg fit to the bkg only toys
+  double chi2minBkgToy = 0.;
+  double chi2minGlobalBkgToy = 0.;  ///< the chi2 of the free fit to the bkg only toys
+  double chi2minBkgBkgToy = 0.;     ///< the chi2 of the bkg fit to the bkg only toys
   float scanbest = 0.f;             ///< an alias to the free fit value of the scan variable
   float scanbesty = 0.f;            ///< an alias to the free fit value of the scan y variable in 2D scans
   /// An alias to the free fit value of the scan variable on the bkg only toy (for CLs method)
   float scanbestBkg = 0.f;
   /// An alias to the fit value of the scan variable of the bkg fit on the bkg only toy (for CLs method)
   float scanbestBkgfitBkg = 0.f;
-  float nrun = 0.f;    ///< an ID to distinguish different runs, i.e. batch jobs
-  float ntoy = 0.f;    ///< an ID to distinguish different toys
-  float npoint = 0.f;  ///< an ID to distinguish different scan point
-  float id = 0.f;      ///< an ID to distinguish different conditions, e.g. different toys in a coverage test
-  float statusFree = -5.f;
-  float covQualFree = -2.f;
-  float statusScan = -5.f;
-  float covQualScan = -2.f;
-  float statusFreeBkg = -5.f;
-  float covQualFreeBkg = -2.f;
-  float statusScanBkg = -5.f;
-  float covQualScanBkg = -2.f;
-  float statusBkgBkg = -5.f;
-  float covQualBkgBkg = -2.f;
-  float statusScanData = -5.f;
-  float covQualScanData = -2.f;
+  int nrun = 0;    ///< an ID to distinguish different runs, i.e. batch jobs
+  int ntoy = 0;    ///< an ID to distinguish different toys
+  int npoint = 0;  ///< an ID to distinguish different scan point
+  int id = 0;      ///< an ID to distinguish different conditions, e.g. different toys in a coverage test
+  short statusFree = -5;
+  short covQualFree = -2;
+  short statusScan = -5;
+  short covQualScan = -2;
+  short statusFreeBkg = -5;
+  short covQualFreeBkg = -2;
+  short statusScanBkg = -5;
+  short covQualScanBkg = -2;
+  short statusBkgBkg = -5;
+  short covQualBkgBkg = -2;
+  short statusScanData = -5;
+  short covQualScanData = -2;
   int bestIndexScanData = 0;
-  float nBergerBoos = 0.f;
-  float BergerBoos_id = 0.f;
+  int nBergerBoos = 0;
+  int BergerBoos_id = 0;
   float genericProbPValue = 0.f;
-  float statusFreePDF = -5.f;
-  float statusScanPDF = -5.f;
-  float chi2minToyPDF = 0.f;
-  float chi2minGlobalToyPDF = 0.f;
-  float chi2minBkgToyPDF = 0.f;
-  TTree* t = nullptr;  ///< the tree
+  short statusFreePDF = -5;
+  short statusScanPDF = -5;
+  double chi2minToyPDF = 0.;
+  double chi2minGlobalToyPDF = 0.;
+  double chi2minBkgToyPDF = 0.;
+  /// With --adaptivetoys, the stopping decision taken after the batch of toys ending with this toy: 0 to run another
+  /// batch, 1 if the p-value is precise enough, 2 if the toy budget is used up, -1 for toys not ending a batch.
+  short adaptiveStop = -1;
+  float adaptivePvalue = -1.f;     ///< with --adaptivetoys, estimated p-value after the batch ending with this toy
+  float adaptivePvalueErr = -1.f;  ///< its binomial uncertainty
+  TTree* t = nullptr;              ///< the tree
 
  private:
+  ///
+  /// A branch that is read with a different type than the one of its data member,
+  /// e.g. the float IDs of toy files written by older versions.
+  ///
+  struct ConvertedBranch {
+    TString name;                     ///< branch name
+    std::function<void(double)> set;  ///< stores a value of the branch in the data member
+    TLeaf* leaf = nullptr;            ///< leaf in the current tree of the chain
+  };
+
+  template <typename T>
+  void branch(const char* bName, T* address);
+  template <typename T>
+  void connectBranch(const char* bName, T* address);
+  void bindSets();
   void computeMinMaxN();
+  void setCompression(TTree* tree) const;
+  static void storeValues(const ParameterBinding& vars, std::vector<float>& values);
   Combiner* comb = nullptr;        ///< combination bringing in the arg, workspace, and names
   const OptParser* arg = nullptr;  ///< command line arguments
   RooWorkspace* w = nullptr;       ///< holds all input pdfs, parameters, and observables, as well as the combination
@@ -122,12 +150,21 @@ class ToyTree {
   TString thName;                  ///< set name of theory parameters, derived from name
   TString globName;                ///< set name of explicit set of global observables
 
-  std::map<std::string, float> parametersScan;  ///< fit result of the scan fit
-  std::map<std::string, float> parametersFree;  ///< fit result of the free fit
-  std::map<std::string, float> parametersPll;   ///< parameters of the profile likelihood curve of the data
-  std::map<std::string, float> observables;     ///< values of the observables
-  std::map<std::string, float> theory;          ///< theory parameters (=observables at profile likelihood points)
-  std::map<TString, float> constraintMeans;     ///< values of global observables
+  std::vector<float> parametersScan;               ///< fit result of the scan fit, in the order of the parameter set
+  std::vector<float> parametersFree;               ///< fit result of the free fit
+  std::vector<float> parametersPll;                ///< parameters of the profile likelihood curve of the data
+  std::vector<float> observables;                  ///< values of the observables
+  std::vector<float> theory;                       ///< theory parameters (=observables at profile likelihood points)
+  std::vector<float> constraintMeans;              ///< values of global observables
+  ParameterBinding boundPars;                      ///< the parameters, in the order of the vectors above
+  ParameterBinding boundObs;                       ///< the observables
+  ParameterBinding boundTheory;                    ///< the theory parameters
+  ParameterBinding boundGlobalObs;                 ///< the global observables
+  ParameterBinding::Mapping scanResultMapping;     ///< positions of the parameters of storeParsScan(RooFitResult*)
+  std::map<const double*, float> chi2Floats;       ///< float copies of the chi2 members, if stored as float
+  std::vector<ConvertedBranch> convertedBranches;  ///< branches read with a type conversion, see open()
+  int convertedTreeNumber = -1;                    ///< tree of the chain the leaves in convertedBranches belong to
+  std::vector<TString> extraBranches;              ///< branches of parameters, observables, theory and global obs.
 
   float scanpointMin = 0.f;   ///< minimum of the scanpoint, computed by computeMinMaxN().
   float scanpointMax = 0.f;   ///< maximum of the scanpoint, computed by computeMinMaxN().
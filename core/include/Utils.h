@@ -13,12 +13,15 @@
 #include <TString.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <sys/stat.h>
 #include <vector>
 
+class NllMinimizer;
 class RooSlimFitResult;
 
 class RooAbsCollection;
@@ -39,8 +42,8 @@ class TH1;
 class TTree;
 
 namespace Utils {
-  extern int countFitBringBackAngle;     ///< counts how many times an angle needed to be brought back
-  extern int countAllFitBringBackAngle;  ///< counts how many times fitBringBackAngle() was called
+  extern std::atomic<int> countFitBringBackAngle;     ///< counts how many times an angle needed to be brought back
+  extern std::atomic<int> countAllFitBringBackAngle;  ///< counts how many times fitBringBackAngle() was called
 
   // used to fix parameters in the combination, see e.g. Combiner::fixParameter()
   struct FixPar {
@@ -63,6 +66,32 @@ namespace Utils {
     double max;
   };
 
+  // start points tried by fitToMinForce()
+  enum forceDesign { kCorners, kSobol, kLatinHypercube };
+
+  // used to configure the multistart fits of fitToMinForce(), see OptParser::getForceConfig()
+  struct ForceConfig {
+    forceDesign design = kCorners;   ///< corners of the force ranges (2^n fits), or a sampled design
+    int budget = 0;                  ///< start points of a sampled design, 0 = 4 per varied parameter
+    int nConfirm = 0;                ///< stop once the best minimum was found again this often, 0 = never
+    double confirmTolerance = 0.01;  ///< minima whose chi2 differ by less than this are the same
+    unsigned int seed = 4357;        ///< seed of the Latin hypercube design
+  };
+
+  // memory shared with the worker processes of forkFor()
+  class SharedMemory {
+   public:
+    explicit SharedMemory(size_t size);
+    ~SharedMemory();
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+    void* get() const { return _memory; }  ///< nullptr if the memory couldn't be mapped
+
+   private:
+    void* _memory = nullptr;
+    size_t _size = 0;
+  };
+
   // drawing HFAG label
   void HFAGLabel(const TString& label = "please set label", Double_t xpos = 0, Double_t ypos = 0, Double_t scale = 1);
 
@@ -91,12 +120,23 @@ namespace Utils {
   }  // namespace TColorNS
 
   // Fit functions
-  RooFitResult* fitToMin(RooAbsPdf* pdf, bool thorough, int printLevel);
-  RooFitResult* fitToMinBringBackAngles(RooAbsPdf* pdf, bool thorough, int printLevel);
-  RooFitResult* fitToMinForce(RooWorkspace* w, TString name, TString forceVariables = "", bool debug = true);
+  RooFitResult* fitToMinBringBackAngles(NllMinimizer* nll, bool thorough, int printLevel);
+  RooFitResult* fitToMinForce(RooWorkspace* w, NllMinimizer* nll, TString name, TString forceVariables = "",
+                              bool debug = true, const ForceConfig& config = ForceConfig());
   RooFitResult* fitToMinImprove(RooWorkspace* w, TString name);
   double getChi2(RooAbsPdf* pdf);
 
+  // Start point designs on the unit hypercube, one point per row
+  std::vector<std::vector<double>> sobolSequence(int nDim, int nPoints);
+  std::vector<std::vector<double>> latinHypercube(int nDim, int nPoints, unsigned int seed);
+
+  // Parallel execution
+  void parallelFor(int nWorkers, int nTasks, const std::function<void(int iWorker, int iTask)>& task);
+  bool forkFor(int nWorkers, int nTasks, const std::function<void(int iWorker, int iTask)>& task,
+               const std::function<void(int iWorker)>& finish, const std::function<void()>& progress = nullptr);
+  TString forkPartFileName(const TString& fileName, int iPart);
+  bool mergeForkParts(const TString& fileName, const std::vector<TString>& parts);
+
   // Functions to manage histograms, graphs, and datasets
   TGraph* addPointToGraphAtFirstMatchingX(const TGraph* g, double xNew, double yNew);
   TH1F* histHardCopy(const TH1F* h, bool copyContent = true, bool uniqueName = true, TString specName = "");
@@ -118,6 +158,7 @@ namespace Utils {
   void setParameters(RooWorkspace* w, TString parname, RooSlimFitResult* r, bool constAndFloat = false);
   void setParameters(RooWorkspace* w, TString parname, RooDataSet* d);
   void setParameters(RooWorkspace* w, RooFitResult* values);
+  void resetParameters(RooWorkspace* w, const RooAbsCollection& values);
   void setParametersFloating(const RooAbsCollection* setMe, const RooAbsCollection* values);
   void setParametersFloating(RooWorkspace* w, TString parname, const RooAbsCollection* set);
   void setParametersFloating(RooWorkspace* w, TString parname, RooFitResult* r);
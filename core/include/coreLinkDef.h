@@ -33,11 +33,13 @@
 #pragma link C++ class SharedArray < double> + ;
 #pragma link C++ class RooBinned2DBicubicBase < RooAbsReal> + ;
 #pragma link C++ class RooBinned2DBicubicBase < RooAbsPdf> + ;
+#pragma link C++ class RooGaussianChi2 + ;
 #pragma link C++ class RooHistPdfAngleVar + ;
 #pragma link C++ class RooHistPdfVar + ;
-#pragma link C++ class RooSlimFitResult + ;
+#pragma link C++ class RooSlimFitResult - ;
 #pragma link C++ class RooPoly3Var + ;
 #pragma link C++ class RooPoly4Var + ;
 #pragma link C++ class RooMultiPdf + ;
+#pragma link C++ class RooMinusTwoLogL + ;
 
 #endif
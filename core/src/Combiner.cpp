@@ -1,14 +1,17 @@
 #include <Combiner.h>
 
+#include <CompiledTheory.h>
+#include <NllMinimizer.h>
 #include <OptParser.h>
 #include <PDF_Abs.h>
+#include <RooGaussianChi2.h>
 #include <Utils.h>
 
 #include <RooAbsPdf.h>
+#include <RooArgList.h>
 #include <RooArgSet.h>
 #include <RooMsgService.h>
 #include <RooProdPdf.h>
-#include <RooRandom.h>
 #include <RooRealVar.h>
 #include <RooWorkspace.h>
 
@@ -40,6 +43,7 @@ Combiner::Combiner(const OptParser* arg, TString name, TString title) : name(nam
 }
 
 Combiner::~Combiner() {
+  nllMinimizer.reset();  // references the pdf in the workspace
   if (w) delete w;
 }
 
@@ -174,6 +178,18 @@ void Combiner::combine() {
   Utils::makeNamedSet(w, "obs_" + pdfName, obsStr);
   Utils::makeNamedSet(w, "th_" + pdfName, thStr);
 
+  // Generate and compile the code of the theory relations. The chi2 of the
+  // fits, also of the copies of the workspace, then picks up the compiled function.
+  RooArgList gaussians;
+  if (RooGaussianChi2::findGaussians(*w->pdf("pdf_" + pdfName), gaussians)) {
+    const RooArgList theory(*w->set("th_" + pdfName));
+    const CompiledTheory compiled(theory);
+    if (arg->verbose) {
+      std::cout << "Combiner::combine() : compiled " << compiled.getNCompiled() << " of " << compiled.getNRelations()
+                << " theory relations" << std::endl;
+    }
+  }
+
   // old thing
   // combine
   // pdfName = pdfNames[0];
@@ -233,6 +249,17 @@ RooAbsPdf* Combiner::getPdf() {
   return w->pdf("pdf_" + pdfName);
 }
 
+///
+/// Return the minimizer of the combined PDF. It is built on first use
+/// and then reused by all fits of the combined PDF, which saves building
+/// a new -2*log(L) function and minimizer for every fit.
+/// Call combine() first.
+///
+NllMinimizer* Combiner::getNllMinimizer() {
+  if (!nllMinimizer) nllMinimizer = std::make_unique<NllMinimizer>(getPdf());
+  return nllMinimizer.get();
+}
+
 ///
 /// Return a vector of all parameter names present
 /// in this combination. This works already before
@@ -467,7 +494,8 @@ void Combiner::fixParameters(TString vars) {
 /// that were generated from the current parameter values
 /// in the workspace.
 ///
-/// This can be used to perform a coverage test.
+/// This can be used to perform a coverage test. The toy
+/// is drawn from the current ToyRandom stream, see ToyRandom::setStream().
 ///
 /// Only possible after the combiner was combined.
 ///
@@ -483,7 +511,6 @@ void Combiner::setObservablesToToyValues() {
               << std::endl;
     getParameters()->Print("v");
   }
-  RooRandom::randomGenerator()->SetSeed(0);
   RooMsgService::instance().setStreamStatus(0, kFALSE);
   RooMsgService::instance().setStreamStatus(1, kFALSE);
   RooDataSet* dataset = w->pdf("pdf_" + pdfName)->generate(*w->set("obs_" + pdfName), 1, RooFit::AutoBinned(false));
@@ -0,0 +1,237 @@
+#include <CompiledTheory.h>
+
+#include <FormulaParser.h>
+
+#include <RooAbsReal.h>
+#include <RooFormulaVar.h>
+#include <RooRealVar.h>
+
+#include <TInterpreter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <utility>
+
+using enum FormulaParser::Code;
+
+namespace {
+  /// The functions compiled in this process, by name.
+  std::map<std::string, void (*)(const double*, double*)> compiledFunctions;
+  std::mutex compiledFunctionsMutex;
+
+  ///
+  /// \return A C++ literal of type double with exactly the given value.
+  ///
+  std::string literal(double value) {
+    std::string s = std::format("{:.17g}", value);
+    if (s.find_first_of(".e") == std::string::npos) s += ".";
+    return s;
+  }
+
+  ///
+  /// \return The 64 bit FNV-1a hash of a string, as hex digits.
+  ///
+  std::string hash(const std::string& s) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (const unsigned char c : s) {
+      h ^= c;
+      h *= 0x100000001b3ULL;
+    }
+    return std::format("{:016x}", h);
+  }
+
+  ///
+  /// Writes the statements of the generated function, one operation per
+  /// statement. Operations already computed are reused, which eliminates the
+  /// subexpressions common to several relations.
+  ///
+  class CodeWriter {
+   public:
+    /// \return The name of a temporary holding the value of the expression.
+    std::string value(const std::string& expr) {
+      const auto it = _temps.find(expr);
+      if (it != _temps.end()) return it->second;
+      const std::string name = "t" + std::to_string(_temps.size());
+      _body += "    const double " + name + " = " + expr + ";\n";
+      _temps.emplace(expr, name);
+      return name;
+    }
+
+    /// Write the statements of a tape. The operands of an operation are always
+    /// temporaries, parameters or literals, so no parentheses are needed.
+    std::string write(const std::vector<FormulaParser::Instruction>& tape, const std::vector<int>& input) {
+      static const std::map<int, std::string> functions = {
+          {kSin, "std::sin"},   {kCos, "std::cos"},   {kTan, "std::tan"},   {kAsin, "std::asin"},
+          {kAcos, "std::acos"}, {kAtan, "std::atan"}, {kSinh, "std::sinh"}, {kCosh, "std::cosh"},
+          {kTanh, "std::tanh"}, {kExp, "std::exp"},   {kLog, "std::log"},   {kLog10, "std::log10"},
+          {kSqrt, "std::sqrt"}, {kAbs, "std::abs"}};
+      std::vector<std::string> stack;
+      for (const FormulaParser::Instruction& i : tape) {
+        if (i.code == kConst) {
+          stack.push_back(literal(i.value));
+          continue;
+        }
+        if (i.code == kVar) {
+          stack.push_back("p[" + std::to_string(input[i.index]) + "]");
+          continue;
+        }
+        if (FormulaParser::isBinary(i.code)) {
+          std::string b = std::move(stack.back());
+          stack.pop_back();
+          std::string a = std::move(stack.back());
+          // commutative operations in a fixed order, so that a+b and b+a are shared
+          if ((i.code == kAdd || i.code == kMul) && b < a) std::swap(a, b);
+          switch (i.code) {
+            case kAdd:
+              stack.back() = value(a + " + " + b);
+              break;
+            case kSub:
+              stack.back() = value(a + " - " + b);
+              break;
+            case kMul:
+              stack.back() = value(a + " * " + b);
+              break;
+            case kDiv:
+              stack.back() = value(a + " / " + b);
+              break;
+            case kPow:
+              stack.back() = value("std::pow(" + a + ", " + b + ")");
+              break;
+            case kAtan2:
+              stack.back() = value("std::atan2(" + a + ", " + b + ")");
+              break;
+          }
+          continue;
+        }
+        const std::string a = stack.back();
+        if (i.code == kNeg) {
+          stack.back() = value("-" + a);
+        } else if (i.code == kSq) {
+          stack.back() = value(a + " * " + a);
+        } else {
+          stack.back() = value(functions.at(i.code) + "(" + a + ")");
+        }
+      }
+      return stack.back();
+    }
+
+    void assign(int slot, const std::string& name) {
+      _body += "    th[" + std::to_string(slot) + "] = " + name + ";\n";
+    }
+    inline const std::string& getBody() const { return _body; };
+
+   private:
+    std::map<std::string, std::string> _temps;  ///< the temporaries, by expression
+    std::string _body;                          ///< the statements
+  };
+}  // namespace
+
+///
+/// Generate and compile the code of the theory relations, and check the
+/// compiled values against RooFit at the current parameter values.
+///
+/// \param theory The theory relations, e.g. RooGaussianChi2::getTheory().
+///               A relation may appear more than once.
+///
+CompiledTheory::CompiledTheory(const RooArgList& theory) {
+  for (const auto th : theory) _theory.push_back(static_cast<RooAbsReal*>(th));
+  _slot.assign(_theory.size(), -1);
+
+  // translate the relations, in the order of their names
+  struct Relation {
+    const RooFormulaVar* formula;
+    std::vector<RooRealVar*> deps;
+    std::vector<FormulaParser::Instruction> tape;
+  };
+  std::map<std::string, Relation> relations;
+  std::map<std::string, RooRealVar*> inputs;
+  for (const RooAbsReal* th : _theory) {
+    const auto formula = dynamic_cast<const RooFormulaVar*>(th);
+    if (!formula || relations.count(th->GetName())) continue;
+    Relation rel{formula, {}, {}};
+    bool ok = true;
+    for (const auto dep : formula->dependents()) {
+      const auto var = dynamic_cast<RooRealVar*>(dep);
+      if (var) rel.deps.push_back(var);
+      ok &= var != nullptr;
+    }
+    if (!ok || !FormulaParser(formula->expression(), formula->dependents()).parse(rel.tape)) continue;
+    if (FormulaParser::depth(rel.tape) < 1) continue;
+    for (const auto dep : rel.deps) inputs.emplace(dep->GetName(), dep);
+    relations.emplace(th->GetName(), std::move(rel));
+  }
+  if (relations.empty()) return;
+
+  // the parameters, in the order of their names
+  std::map<const RooRealVar*, int> inputIndex;
+  for (const auto& [name, var] : inputs) {
+    inputIndex[var] = _inputs.size();
+    _inputs.add(*var);
+  }
+
+  // one function computing all relations
+  CodeWriter writer;
+  std::map<std::string, int> slots;
+  for (const auto& [name, rel] : relations) {
+    std::vector<int> input;
+    for (const auto dep : rel.deps) input.push_back(inputIndex.at(dep));
+    const int slot = slots.size();
+    writer.assign(slot, writer.write(rel.tape, input));
+    slots[name] = slot;
+  }
+  const std::string body = writer.getBody();
+  const std::string name = "theory_" + hash(body);
+  _code = "#pragma cling optimize(2)\n#include <cmath>\nnamespace gammacombo_jit {\n  void " + name +
+          "(const double* p, double* th) {\n" + body + "  }\n}  // namespace gammacombo_jit\n";
+  {
+    std::lock_guard<std::mutex> lock(compiledFunctionsMutex);
+    const auto it = compiledFunctions.find(name);
+    if (it != compiledFunctions.end()) {
+      _function = it->second;
+    } else if (gInterpreter->Declare(_code.c_str())) {
+      const std::string address = "(Longptr_t)&gammacombo_jit::" + name;
+      _function = reinterpret_cast<Function>(gInterpreter->Calc(address.c_str()));
+      compiledFunctions[name] = _function;
+    }
+  }
+  if (!_function) {
+    std::cout << "CompiledTheory::CompiledTheory() : WARNING : could not compile the theory relations, "
+                 "evaluating them with RooFit."
+              << std::endl;
+    return;
+  }
+
+  // check the compiled values
+  _p.resize(_inputs.size());
+  _th.resize(slots.size());
+  for (int k = 0; k < _inputs.size(); k++) _p[k] = static_cast<RooAbsReal&>(_inputs[k]).getVal();
+  _function(_p.data(), _th.data());
+  for (size_t i = 0; i < _theory.size(); i++) {
+    const auto it = slots.find(_theory[i]->GetName());
+    if (it == slots.end()) continue;
+    const double value = _theory[i]->getVal();
+    // also false for NaN
+    if (std::abs(_th[it->second] - value) <= 1e-9 * std::max(1., std::abs(value))) {
+      _slot[i] = it->second;
+      _nCompiled++;
+    }
+  }
+}
+
+///
+/// Evaluate all theory relations at the current parameter values.
+///
+/// \param th Filled with the values, in the order of the relations given to the constructor.
+///
+void CompiledTheory::evaluate(double* th) const {
+  if (_function) {
+    for (int k = 0; k < _inputs.size(); k++) _p[k] = static_cast<RooAbsReal&>(_inputs[k]).getVal();
+    _function(_p.data(), _th.data());
+  }
+  for (size_t i = 0; i < _theory.size(); i++) th[i] = _slot[i] >= 0 ? _th[_slot[i]] : _theory[i]->getVal();
+}
@@ -143,6 +143,23 @@ TString FileNameBuilder::getFileNameScanner(const MethodAbsScan* c) const {
   return name;
 }
 
+///
+/// Compute the file name of the file to which the full profile likelihood
+/// of a Prob scanner gets saved, see MethodProbScan::saveProfile().
+/// Format of returned filename:
+///
+/// plots/scanner/basename_profile_scannername_var1[_var2].root
+///
+/// \return - filename
+///
+TString FileNameBuilder::getFileNameProfile(const MethodAbsScan* c) const {
+  TString name = "plots/scanner/" + m_basename + "_profile_" + c->getName();
+  name += "_" + m_arg->var[0];
+  if (m_arg->var.size() == 2) name += "_" + m_arg->var[1];
+  name += ".root";
+  return name;
+}
+
 ///
 /// Compute the file name of the file to which a solution gets saved.
 /// Format of returned filename:
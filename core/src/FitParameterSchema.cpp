@@ -0,0 +1,46 @@
+#include <FitParameterSchema.h>
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+FitParameterSchema::FitParameterSchema(std::vector<std::string> names, std::vector<int> floatIds,
+                                       std::vector<bool> angles)
+    : _names(std::move(names)), _floatIds(std::move(floatIds)), _angles(std::move(angles)) {
+  for (int i = 0; i < _names.size(); i++) _ids.emplace(_names[i], i);
+}
+
+///
+/// Get the schema of a parameter layout, creating it if it wasn't seen before.
+/// Thread safe, so that fit results can be created on several threads.
+///
+/// \param names    Parameter names.
+/// \param floatIds Position of each parameter in the correlation matrix, -1 for constant parameters.
+/// \param angles   Is each parameter an angle?
+/// \return The unique schema of this layout.
+///
+const FitParameterSchema* FitParameterSchema::intern(std::vector<std::string> names, std::vector<int> floatIds,
+                                                     std::vector<bool> angles) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<const FitParameterSchema>> schemas;
+
+  std::string key;
+  for (int i = 0; i < names.size(); i++) {
+    key += names[i];
+    key += '\0';
+    key += std::to_string(floatIds[i]);
+    key += angles[i] ? 'a' : '\0';
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& schema = schemas[key];
+  if (!schema) schema.reset(new FitParameterSchema(std::move(names), std::move(floatIds), std::move(angles)));
+  return schema.get();
+}
+
+///
+/// \return The ID of a parameter, or -1 if there is no such parameter.
+///
+int FitParameterSchema::getId(const std::string& name) const {
+  const auto it = _ids.find(name);
+  return it == _ids.end() ? -1 : it->second;
+}
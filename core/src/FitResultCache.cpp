@@ -2,25 +2,52 @@
 
 #include <OptParser.h>
 
-#include <RooDataSet.h>
+#include <RooArgSet.h>
 
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
 
+///
+/// Set all parameters to the values of the snapshot.
+///
+void ParameterSnapshot::restore() const {
+  if (_values) _pars->setValues(_values);
+}
+
+///
+/// Set the floating parameters to the values of the snapshot,
+/// constant parameters are left untouched.
+///
+void ParameterSnapshot::restoreFloating() const {
+  if (_values) _pars->setValuesFloating(_values);
+}
+
 FitResultCache::FitResultCache(const OptParser* arg, int roundrobinsize) {
   assert(arg);
   _arg = arg;
   _roundrobinsize = roundrobinsize;
-  _parsRoundRobin.resize(_roundrobinsize, 0);
+  _roundrobinFilled.resize(_roundrobinsize, false);
 }
 
-FitResultCache::~FitResultCache() {
-  if (_parsAtFunctionCall) delete _parsAtFunctionCall;
-  if (_parsAtGlobalMin) delete _parsAtGlobalMin;
-  for (int i = 0; i < _parsRoundRobin.size(); i++) {
-    if (_parsRoundRobin[i]) delete _parsRoundRobin[i];
+///
+/// Bind the cache to a parameter set on first use, and check that
+/// all later points are stored from the same set.
+///
+/// \param set - the set of parameters to be saved
+///
+void FitResultCache::bind(const RooArgSet* set) {
+  assert(set);
+  if (_set == set) return;
+  if (_set) {
+    std::cout << "FitResultCache::bind() : ERROR : "
+                 "Trying to store parameters of a different set. Exit."
+              << std::endl;
+    std::exit(1);
   }
+  _set = set;
+  _pars = ParameterBinding(*set);
+  _parsRoundRobin.resize(_roundrobinsize * _pars.size());
 }
 
 ///
@@ -30,28 +57,26 @@ FitResultCache::~FitResultCache() {
 /// \param set - the set of parameters to be saved
 ///
 void FitResultCache::storeParsAtFunctionCall(const RooArgSet* set) {
-  if (_parsAtFunctionCall) {
+  if (!_parsAtFunctionCall.empty()) {
     std::cout << "FitResultCache::storeParsAtFunctionCall() : ERROR : "
                  "Trying to overwrite the parameters at funciton call. Exit."
               << std::endl;
     std::exit(1);
   }
-  assert(set);
-  _parsAtFunctionCall = new RooDataSet("parsAtFunctionCall", "parsAtFunctionCall", *set);
-  _parsAtFunctionCall->add(*set);
+  bind(set);
+  _parsAtFunctionCall.resize(_pars.size());
+  _pars.getValues(_parsAtFunctionCall.data());
 }
 
 ///
-/// Store the parameters held by set. Can only be called once
-/// per instance of FitResultCache.
+/// Store the parameters held by set.
 ///
 /// \param set - the set of parameters to be saved
 ///
 void FitResultCache::storeParsAtGlobalMin(const RooArgSet* set) {
-  assert(set);
-  if (_parsAtGlobalMin) delete _parsAtGlobalMin;
-  _parsAtGlobalMin = new RooDataSet("parsAtGlobalMin", "parsAtGlobalMin", *set);
-  _parsAtGlobalMin->add(*set);
+  bind(set);
+  _parsAtGlobalMin.resize(_pars.size());
+  _pars.getValues(_parsAtGlobalMin.data());
 }
 
 ///
@@ -60,12 +85,11 @@ void FitResultCache::storeParsAtGlobalMin(const RooArgSet* set) {
 /// \param set - the set of parameters to be saved
 ///
 void FitResultCache::storeParsRoundRobin(const RooArgSet* set) {
-  assert(set);
+  bind(set);
   _roundrobinid++;
   if (_roundrobinid >= _roundrobinsize) _roundrobinid = 0;
-  if (_parsRoundRobin[_roundrobinid]) delete _parsRoundRobin[_roundrobinid];
-  _parsRoundRobin[_roundrobinid] = new RooDataSet("parsAtFunctionCall", "parsAtFunctionCall", *set);
-  _parsRoundRobin[_roundrobinid]->add(*set);
+  _pars.getValues(_parsRoundRobin.data() + _roundrobinid * _pars.size());
+  _roundrobinFilled[_roundrobinid] = true;
 }
 
 ///
@@ -75,23 +99,38 @@ void FitResultCache::storeParsRoundRobin(const RooArgSet* set) {
 /// \param set - the set of parameters to be saved
 ///
 void FitResultCache::initRoundRobinDB(const RooArgSet* set) {
-  for (int i = 0; i < _parsRoundRobin.size(); i++) { storeParsRoundRobin(set); }
+  for (int i = 0; i < _roundrobinsize; i++) { storeParsRoundRobin(set); }
 }
 
 ///
 /// Get an entry from the round robin database.
-/// Ownership stays with FitResultCache.
 ///
 /// \param n - the point we want to get, 0 is the most recent one
 ///
-const RooArgSet* FitResultCache::getRoundRobinNminus(int n) {
+ParameterSnapshot FitResultCache::getRoundRobinNminus(int n) const {
   int id = _roundrobinid - n;
-  if (id < 0) id += _parsRoundRobin.size();
-  if (id < 0 || id >= _parsRoundRobin.size() || _parsRoundRobin[id] == 0) {
+  if (id < 0) id += _roundrobinsize;
+  if (id < 0 || id >= _roundrobinsize || !_roundrobinFilled[id]) {
     std::cout << "FitResultCache::getRoundRobinNminus() : ERROR : "
                  "Trying to access a round robin point that doesn't exist: id="
               << id << ". Exit." << std::endl;
     std::exit(1);
   }
-  return _parsRoundRobin[id]->get(0);
+  return ParameterSnapshot(&_pars, _parsRoundRobin.data() + id * _pars.size());
+}
+
+///
+/// \return The parameters stored by storeParsAtFunctionCall().
+///
+ParameterSnapshot FitResultCache::getParsAtFunctionCall() const {
+  assert(!_parsAtFunctionCall.empty());
+  return ParameterSnapshot(&_pars, _parsAtFunctionCall.data());
+}
+
+///
+/// \return The parameters stored by storeParsAtGlobalMin().
+///
+ParameterSnapshot FitResultCache::getParsAtGlobalMin() const {
+  assert(!_parsAtGlobalMin.empty());
+  return ParameterSnapshot(&_pars, _parsAtGlobalMin.data());
 }
@@ -1,5 +1,6 @@
 #include <Fitter.h>
 
+#include <NllMinimizer.h>
 #include <OptParser.h>
 #include <Utils.h>
 
@@ -21,6 +22,17 @@ Fitter::Fitter(const OptParser* arg, RooWorkspace* w, TString name) {
   parsName = "par_" + name;
 }
 
+Fitter::~Fitter() = default;
+
+///
+/// Get the minimizer of the pdf, which is built on first use and then
+/// reused for all fits done by this fitter.
+///
+NllMinimizer* Fitter::getNllMinimizer() {
+  if (!nll) nll = std::make_unique<NllMinimizer>(w->pdf(pdfName));
+  return nll.get();
+}
+
 ///
 /// Perform two fits, each time using different start parameters,
 /// retain the smallest chi2. Note: To debug the start paramter
@@ -30,13 +42,13 @@ Fitter::Fitter(const OptParser* arg, RooWorkspace* w, TString name) {
 ///
 void Fitter::fitTwice() {
   // first fit
-  Utils::setParametersFloating(w, parsName, startparsFirstFit);
-  RooFitResult* r1 = Utils::fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+  startparsFirstFit.restoreFloating();
+  RooFitResult* r1 = Utils::fitToMinBringBackAngles(getNllMinimizer(), false, -1);
   bool f1failed = !(r1->edm() < 1 && r1->covQual() == 3);
 
   // second fit
-  Utils::setParametersFloating(w, parsName, startparsSecondFit);
-  RooFitResult* r2 = Utils::fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
+  startparsSecondFit.restoreFloating();
+  RooFitResult* r2 = Utils::fitToMinBringBackAngles(getNllMinimizer(), false, -1);
   bool f2failed = !(r2->edm() < 1 && r2->covQual() == 3);
 
   if (f1failed && f2failed) {
@@ -60,7 +72,7 @@ void Fitter::fitTwice() {
     delete r1;
   }
 
-  Utils::setParametersFloating(w, parsName, theResult);
+  setParametersToResult();
 }
 
 ///
@@ -68,9 +80,20 @@ void Fitter::fitTwice() {
 /// setStartparsFirstFit().
 ///
 void Fitter::fitForce() {
-  Utils::setParametersFloating(w, parsName, startparsFirstFit);
-  theResult = Utils::fitToMinForce(w, name);
-  Utils::setParametersFloating(w, parsName, theResult);
+  startparsFirstFit.restoreFloating();
+  theResult = Utils::fitToMinForce(w, getNllMinimizer(), name, "", true, arg->getForceConfig());
+  setParametersToResult();
+}
+
+///
+/// Set the floating parameters of the workspace to the values of the
+/// fit result. The parameters are bound once, and the positions of the
+/// fit result parameters are only looked up again when its layout changes,
+/// e.g. when the scan parameter is fixed.
+///
+void Fitter::setParametersToResult() {
+  if (!pars.isValid()) pars = ParameterBinding(w, parsName);
+  pars.setValues(theResult->floatParsFinal(), resultMapping, true);
 }
 
 ///
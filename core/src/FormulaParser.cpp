@@ -0,0 +1,207 @@
+#include <FormulaParser.h>
+
+#include <RooArgList.h>
+
+#include <TMath.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+
+///
+/// \param expr The expression, e.g. RooFormulaVar::expression().
+/// \param deps The dependents, e.g. RooFormulaVar::dependents().
+///
+FormulaParser::FormulaParser(const char* expr, const RooArgList& deps) : _s(expr), _deps(deps) {}
+
+///
+/// Translate the expression.
+///
+/// \param tape Filled with the instructions.
+/// \return false if the expression can't be translated.
+///
+bool FormulaParser::parse(std::vector<Instruction>& tape) {
+  _tape = &tape;
+  expression();
+  skipSpace();
+  return _ok && _pos == _s.size();
+}
+
+///
+/// \return The maximum stack depth needed to evaluate a tape, or -1 if it
+///         doesn't leave exactly one value on the stack.
+///
+int FormulaParser::depth(const std::vector<Instruction>& tape) {
+  int depth = 0;
+  int maxDepth = 0;
+  for (const Instruction& i : tape) {
+    if (i.code == kConst || i.code == kVar) {
+      depth++;
+    } else if (isBinary(i.code)) {
+      depth--;
+    }
+    if (depth < 1) return -1;
+    maxDepth = std::max(maxDepth, depth);
+  }
+  return depth == 1 ? maxDepth : -1;
+}
+
+void FormulaParser::skipSpace() {
+  while (_pos < _s.size() && std::isspace(_s[_pos])) _pos++;
+}
+
+bool FormulaParser::accept(const std::string& token) {
+  skipSpace();
+  if (_s.compare(_pos, token.size(), token) != 0) return false;
+  _pos += token.size();
+  return true;
+}
+
+void FormulaParser::expect(const std::string& token) {
+  if (!accept(token)) _ok = false;
+}
+
+void FormulaParser::emit(int code, double value, int index) { _tape->push_back({code, value, index}); }
+
+void FormulaParser::variable(int i) {
+  if (i < 0 || i >= _deps.size()) _ok = false;
+  emit(kVar, 0., i);
+}
+
+int FormulaParser::integer() {
+  skipSpace();
+  const size_t start = _pos;
+  while (_pos < _s.size() && std::isdigit(_s[_pos])) _pos++;
+  if (_pos == start) {
+    _ok = false;
+    return -1;
+  }
+  return std::stoi(_s.substr(start, _pos - start));
+}
+
+void FormulaParser::expression() {
+  term();
+  while (_ok) {
+    if (accept("+")) {
+      term();
+      emit(kAdd);
+    } else if (accept("-")) {
+      term();
+      emit(kSub);
+    } else {
+      break;
+    }
+  }
+}
+
+void FormulaParser::term() {
+  unary();
+  while (_ok) {
+    if (accept("*")) {
+      unary();
+      emit(kMul);
+    } else if (accept("/")) {
+      unary();
+      emit(kDiv);
+    } else {
+      break;
+    }
+  }
+}
+
+// unary minus binds weaker than the power, -x^2 = -(x^2)
+void FormulaParser::unary() {
+  if (accept("-")) {
+    unary();
+    emit(kNeg);
+  } else if (accept("+")) {
+    unary();
+  } else {
+    power();
+  }
+}
+
+// the power is right associative, a^b^c = a^(b^c)
+void FormulaParser::power() {
+  primary();
+  if (_ok && (accept("^") || accept("**"))) {
+    unary();
+    emit(kPow);
+  }
+}
+
+void FormulaParser::primary() {
+  skipSpace();
+  if (_pos == _s.size()) {
+    _ok = false;
+    return;
+  }
+  const char c = _s[_pos];
+  if (std::isdigit(c) || c == '.') {
+    char* end = nullptr;
+    const double value = std::strtod(_s.c_str() + _pos, &end);
+    if (end == _s.c_str() + _pos) _ok = false;
+    _pos = end - _s.c_str();
+    emit(kConst, value);
+  } else if (accept("(")) {
+    expression();
+    expect(")");
+  } else if (accept("@")) {
+    variable(integer());
+  } else if (std::isalpha(c) || c == '_') {
+    const size_t start = _pos;
+    while (_pos < _s.size() && (std::isalnum(_s[_pos]) || _s[_pos] == '_' || _s.compare(_pos, 2, "::") == 0)) {
+      _pos += _s.compare(_pos, 2, "::") == 0 ? 2 : 1;
+    }
+    const std::string name = _s.substr(start, _pos - start);
+    if (name == "x" && accept("[")) {
+      variable(integer());
+      expect("]");
+    } else if (accept("(")) {
+      call(name);
+    } else if (_deps.find(name.c_str())) {
+      variable(_deps.index(name.c_str()));
+    } else if (name == "pi") {
+      emit(kConst, TMath::Pi());
+    } else {
+      _ok = false;
+    }
+  } else {
+    _ok = false;
+  }
+}
+
+// function call, the opening parenthesis is already read
+void FormulaParser::call(std::string name) {
+  for (const std::string prefix : {"TMath::", "std::"}) {
+    if (name.compare(0, prefix.size(), prefix) == 0) name = name.substr(prefix.size());
+  }
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+  int nArgs = 0;
+  if (!accept(")")) {
+    do {
+      expression();
+      nArgs++;
+    } while (_ok && accept(","));
+    expect(")");
+  }
+  static const std::map<std::string, int> functions1 = {
+      {"sin", kSin},   {"cos", kCos},   {"tan", kTan},   {"asin", kAsin}, {"acos", kAcos}, {"atan", kAtan},
+      {"sinh", kSinh}, {"cosh", kCosh}, {"tanh", kTanh}, {"exp", kExp},   {"log", kLog},   {"log10", kLog10},
+      {"sqrt", kSqrt}, {"abs", kAbs},   {"fabs", kAbs},  {"sq", kSq}};
+  static const std::map<std::string, int> functions2 = {{"pow", kPow}, {"power", kPow}, {"atan2", kAtan2}};
+  if (nArgs == 0 && name == "pi") {
+    emit(kConst, TMath::Pi());
+  } else if (nArgs == 0 && name == "degtorad") {
+    emit(kConst, TMath::DegToRad());
+  } else if (nArgs == 0 && name == "radtodeg") {
+    emit(kConst, TMath::RadToDeg());
+  } else if (nArgs == 1 && functions1.count(name)) {
+    emit(functions1.at(name));
+  } else if (nArgs == 2 && functions2.count(name)) {
+    emit(functions2.at(name));
+  } else {
+    _ok = false;
+  }
+}
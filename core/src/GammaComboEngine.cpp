@@ -2,7 +2,9 @@
 
 #include <BatchScriptWriter.h>
 #include <Combiner.h>
+#include <CompiledTheory.h>
 #include <FileNameBuilder.h>
+#include <FitResultCache.h>
 #include <Graphviz.h>
 #include <LatexMaker.h>
 #include <MethodBergerBoosScan.h>
@@ -11,26 +13,38 @@
 #include <MethodDatasetsProbScan.h>
 #include <MethodPluginScan.h>
 #include <MethodProbScan.h>
+#include <NllMinimizer.h>
 #include <OneMinusClPlot.h>
 #include <OneMinusClPlot2d.h>
 #include <OptParser.h>
 #include <PDF_Abs.h>
 #include <PDF_Datasets.h>
 #include <PValueCorrection.h>
+#include <ParameterBinding.h>
 #include <ParameterCache.h>
 #include <ParameterEvolutionPlotter.h>
+#include <RooGaussianChi2.h>
 #include <RooSlimFitResult.h>
+#include <ToyGenerator.h>
+#include <ToyRandom.h>
+#include <ToyTree.h>
 #include <Utils.h>
 
 // Needed to define GAMMACOMBO_VERSION. Header created during CMake generation
 #include <VersionConfig.h>
 
 #include <RooAbsPdf.h>
+#include <RooDataSet.h>
+#include <RooFitResult.h>
+#include <RooFormulaVar.h>
+#include <RooMinimizer.h>
 #include <RooMsgService.h>
+#include <RooRandom.h>
 #include <RooRealVar.h>
 #include <RooWorkspace.h>
 
 #include <TApplication.h>
+#include <TChain.h>
 #include <TColor.h>
 #include <TF1.h>
 #include <TFile.h>
@@ -39,15 +53,23 @@
 #include <TMath.h>
 #include <TObjString.h>
 #include <TROOT.h>
+#include <TRandom.h>
+#include <TRandom3.h>
+#include <TStopwatch.h>
 #include <TString.h>
+#include <TSystem.h>
 #include <TTree.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <memory>
 #include <string.h>
 #include <string>
 #include <vector>
@@ -67,6 +89,10 @@ GammaComboEngine::GammaComboEngine(TString name, int argc, char* argv[]) {
   arg->bookAllOptions();
   arg->parseArguments(argc, argv);
 
+  // all toys are drawn from streams keyed by --seed and --nrun
+  ToyRandom::install(arg->seed, arg->nrun);
+  NllMinimizer::setUseGradient(!arg->numgrad);
+
   // configure names
   execname = argv[0];
   if (arg->filenameaddition != "") name += "_" + arg->filenameaddition;
@@ -1147,6 +1173,10 @@ void GammaComboEngine::make1dProbScan(MethodProbScan* scanner, int cId) {
   loadStartParameters(scanner, pCache, cId);
 
   scanner->initScan();
+  // plugin batch jobs reuse the profile likelihood saved by the Prob scan
+  if (arg->isAction("pluginbatch") && scanner->getMethodName() == "Prob" &&
+      scanner->loadProfile(m_fnamebuilder->getFileNameProfile(scanner)))
+    return;
   scanStrategy1d(scanner, pCache);
   std::cout << "\nResults:" << std::endl;
   std::cout << "========\n" << std::endl;
@@ -1167,6 +1197,7 @@ void GammaComboEngine::make1dProbScan(MethodProbScan* scanner, int cId) {
     }
     if (!arg->isAction("plugin")) {
       scanner->saveScanner(m_fnamebuilder->getFileNameScanner(scanner));
+      if (scanner->getMethodName() == "Prob") scanner->saveProfile(m_fnamebuilder->getFileNameProfile(scanner));
       pCache->cacheParameters(scanner, m_fnamebuilder->getFileNamePar(scanner));
     }
   }
@@ -1456,11 +1487,16 @@ void GammaComboEngine::make2dProbScan(MethodProbScan* scanner, int cId) {
   loadStartParameters(scanner, pCache, cId);
   // scan
   scanner->initScan();
+  // plugin batch jobs reuse the profile likelihood saved by the Prob scan
+  if (arg->isAction("pluginbatch") && scanner->getMethodName() == "Prob" &&
+      scanner->loadProfile(m_fnamebuilder->getFileNameProfile(scanner)))
+    return;
   scanStrategy2d(scanner, pCache);
   std::cout << std::endl;
   scanner->printLocalMinima();
   // save
   scanner->saveScanner(m_fnamebuilder->getFileNameScanner(scanner));
+  if (scanner->getMethodName() == "Prob") scanner->saveProfile(m_fnamebuilder->getFileNameProfile(scanner));
   pCache->cacheParameters(scanner, m_fnamebuilder->getFileNamePar(scanner));
 }
 
@@ -1911,6 +1947,7 @@ void GammaComboEngine::runToys(Combiner* c) {
 
   for (int i = 0; i < arg->ntoys; i++) {
     std::cout << "RUNNING TOY " << i << " / " << arg->ntoys << std::endl;
+    ToyRandom::setStream(0, i, ToyRandom::kCoverage);
     c->setObservablesToToyValues();
     MethodProbScan* toyscan = new MethodProbScan(c);
     make1dProbScan(toyscan, 0);
@@ -1939,6 +1976,697 @@ void GammaComboEngine::runToys(Combiner* c) {
   delete f;
 }
 
+///
+/// Benchmark the parts of a toy study of the combined PDF that were sped up:
+/// fitting, the Gaussian fast path, toy files, toy generation, and the
+/// bookkeeping of parameters. The fits are repeated --ntoys times, the other
+/// steps a multiple of that. See the benchmark functions of each part.
+///
+void GammaComboEngine::benchmark(Combiner* c) {
+  benchmarkFit(c);
+  benchmarkGaussianChi2(c);
+  benchmarkToyFile(c);
+  benchmarkToyAnalysis(c);
+  benchmarkToyGenerator(c);
+  benchmarkAdaptiveToys(c);
+  benchmarkFitResultCache(c);
+  benchmarkSlimFitResult(c);
+  benchmarkParameterBinding(c);
+  std::cout << std::endl;
+}
+
+///
+/// Benchmark the fit of the combined PDF. The same fit is repeated --ntoys
+/// times from identical starting values, first building a new -2logL function
+/// and minimizer for every fit (as Utils::fitToMin() used to do), then reusing
+/// the persistent minimizer of the combiner. Prints the mean time per fit of
+/// both approaches.
+///
+void GammaComboEngine::benchmarkFit(Combiner* c) {
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  RooAbsPdf* pdf = c->getPdf();
+  const int nFits = std::max(arg->ntoys, 1);
+  double chi2Rebuild = 0.;
+  double chi2Persistent = 0.;
+
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  TStopwatch tRebuild;
+  tRebuild.Stop();
+  for (int i = 0; i < nFits; i++) {
+    Utils::resetParameters(w, *startPars);
+    tRebuild.Start(false);
+    RooFormulaVar nll("nll", "nll", "-2*log(@0)", RooArgSet(*pdf));
+    RooMinimizer m(nll);
+    m.setPrintLevel(-2);
+    m.setErrorLevel(1.0);
+    m.setStrategy(2);
+    m.setProfile(0);
+    m.migrad();
+    std::unique_ptr<RooFitResult> r(m.save());
+    tRebuild.Stop();
+    chi2Rebuild = r->minNll();
+  }
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+
+  TStopwatch tPersistent;
+  tPersistent.Stop();
+  for (int i = 0; i < nFits; i++) {
+    Utils::resetParameters(w, *startPars);
+    tPersistent.Start(false);
+    std::unique_ptr<RooFitResult> r(c->getNllMinimizer()->fit(false, -1));
+    tPersistent.Stop();
+    chi2Persistent = r->minNll();
+  }
+  Utils::resetParameters(w, *startPars);
+
+  const double msRebuild = 1e3 * tRebuild.RealTime() / nFits;
+  const double msPersistent = 1e3 * tPersistent.RealTime() / nFits;
+  std::cout << std::format("\nbenchmark: {} fits of {}\n", nFits, c->getName().Data());
+  std::cout << std::format("  new -2logL and minimizer per fit: {:8.3f} ms/fit (chi2={:.4f})\n", msRebuild,
+                           chi2Rebuild);
+  std::cout << std::format("  persistent NllMinimizer:          {:8.3f} ms/fit (chi2={:.4f})\n", msPersistent,
+                           chi2Persistent);
+  if (msPersistent > 0.) std::cout << std::format("  speedup: {:.2f}\n", msRebuild / msPersistent);
+}
+
+///
+/// Benchmark the Gaussian fast path (RooGaussianChi2), if the combination
+/// uses it: --ntoys fits with its analytic gradient against numerical
+/// derivatives, and the evaluation of all theory relations by the compiled
+/// function (CompiledTheory) against RooFit.
+///
+void GammaComboEngine::benchmarkGaussianChi2(Combiner* c) {
+  RooGaussianChi2* chi2 = c->getNllMinimizer()->getGaussianChi2();
+  if (!chi2) return;
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  const int nFits = std::max(arg->ntoys, 1);
+  const bool useGradient = NllMinimizer::useGradient();
+  double ms[2];
+  std::unique_ptr<RooFitResult> result[2];
+  for (int g = 0; g < 2; g++) {
+    NllMinimizer::setUseGradient(g == 0);
+    TStopwatch t;
+    t.Stop();
+    for (int i = 0; i < nFits; i++) {
+      Utils::resetParameters(w, *startPars);
+      t.Start(false);
+      result[g].reset(c->getNllMinimizer()->fit(false, -1));
+      t.Stop();
+    }
+    ms[g] = 1e3 * t.RealTime() / nFits;
+  }
+  NllMinimizer::setUseGradient(useGradient);
+  Utils::resetParameters(w, *startPars);
+
+  double maxPull = 0.;
+  for (const auto p : result[0]->floatParsFinal()) {
+    const auto par = static_cast<RooRealVar*>(p);
+    const auto other = static_cast<RooRealVar*>(result[1]->floatParsFinal().find(par->GetName()));
+    if (!other || par->getError() <= 0.) continue;
+    maxPull = std::max(maxPull, std::abs(par->getVal() - other->getVal()) / par->getError());
+  }
+  std::cout << std::format("\nbenchmark: {} fits of {} with the Gaussian chi2\n", nFits, c->getName().Data());
+  std::cout << std::format("  analytic gradient:     {:8.3f} ms/fit (chi2={:.6f}, status={}, covQual={})\n", ms[0],
+                           result[0]->minNll(), result[0]->status(), result[0]->covQual());
+  std::cout << std::format("  numerical derivatives: {:8.3f} ms/fit (chi2={:.6f}, status={}, covQual={})\n", ms[1],
+                           result[1]->minNll(), result[1]->status(), result[1]->covQual());
+  std::cout << std::format("  largest parameter difference: {:.2e} sigma\n", maxPull);
+  if (ms[0] > 0.) std::cout << std::format("  speedup: {:.2f}\n", ms[1] / ms[0]);
+
+  // all theory relations at changing parameter values, as in a fit: compiled function vs. RooFit
+  const RooArgList& theory = chi2->getTheory();
+  const CompiledTheory compiled(theory);
+  std::vector<RooRealVar*> floating;
+  std::vector<double> start;
+  for (const auto p : *w->set(parsName)) {
+    const auto var = dynamic_cast<RooRealVar*>(p);
+    if (!var || var->isConstant()) continue;
+    floating.push_back(var);
+    start.push_back(var->getVal());
+  }
+  auto setParameters = [&](int e) {
+    for (size_t k = 0; k < floating.size(); k++) {
+      floating[k]->setVal(start[k] + (e % 2) * 1e-6 * std::max(std::abs(start[k]), 1.));
+    }
+  };
+  const int nEval = 1000 * nFits;
+  std::vector<double> thRooFit(theory.size());
+  std::vector<double> thCompiled(theory.size());
+  TStopwatch tRooFit;
+  for (int e = 0; e < nEval; e++) {
+    setParameters(e);
+    for (int i = 0; i < theory.size(); i++) thRooFit[i] = static_cast<RooAbsReal&>(theory[i]).getVal();
+  }
+  tRooFit.Stop();
+  TStopwatch tCompiled;
+  for (int e = 0; e < nEval; e++) {
+    setParameters(e);
+    compiled.evaluate(thCompiled.data());
+  }
+  tCompiled.Stop();
+  Utils::resetParameters(w, *startPars);
+
+  double maxDiff = 0.;
+  for (int i = 0; i < theory.size(); i++) maxDiff = std::max(maxDiff, std::abs(thCompiled[i] - thRooFit[i]));
+  const double usRooFit = 1e6 * tRooFit.RealTime() / nEval;
+  const double usCompiled = 1e6 * tCompiled.RealTime() / nEval;
+  std::cout << std::format("\nbenchmark: {} evaluations of {} theory relations, {} compiled\n", nEval,
+                           theory.size(), compiled.getNCompiled());
+  std::cout << std::format("  RooFit:            {:8.3f} us/evaluation\n", usRooFit);
+  std::cout << std::format("  compiled function: {:8.3f} us/evaluation\n", usCompiled);
+  std::cout << std::format("  max |difference|: {:.2e}\n", maxDiff);
+  if (usCompiled > 0.) std::cout << std::format("  speedup: {:.2f}\n", usRooFit / usCompiled);
+}
+
+///
+/// Benchmark the write and read throughput of the toy files, with the settings
+/// of --toycompression and --toyprecision, for 1000 times --ntoys toys with
+/// random parameters and observables.
+///
+void GammaComboEngine::benchmarkToyFile(Combiner* c) {
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  const TString obsName = "obs_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startObs(static_cast<RooArgSet*>(w->set(obsName)->snapshot()));
+  const int nFits = std::max(arg->ntoys, 1);
+  const int nEntries = 1000 * nFits;
+  ToyTree toyWriter(c);
+  toyWriter.init();
+  TRandom* rnd = RooRandom::randomGenerator();
+  for (int i = 0; i < nEntries; i++) {
+    for (const auto& pAbs : *w->set(parsName)) {
+      const auto p = static_cast<RooRealVar*>(pAbs);
+      if (!p->isConstant()) p->setVal(rnd->Uniform(p->getMin(), p->getMax()));
+    }
+    for (const auto& pAbs : *startObs) {
+      const auto p = static_cast<RooRealVar*>(pAbs);
+      w->var(p->GetName())->setVal(p->getVal() + p->getError() * rnd->Gaus());
+    }
+    toyWriter.storeParsPll();
+    toyWriter.storeParsScan();
+    toyWriter.storeParsFree();
+    toyWriter.storeObservables();
+    toyWriter.storeTheory();
+    toyWriter.nrun = 1;
+    toyWriter.npoint = i / 100;
+    toyWriter.ntoy = i % 100;
+    toyWriter.scanpoint = toyWriter.npoint;
+    toyWriter.chi2min = rnd->Exp(10.);
+    toyWriter.chi2minGlobal = rnd->Exp(10.);
+    toyWriter.chi2minToy = 1000. + rnd->Exp(10.);
+    toyWriter.chi2minGlobalToy = toyWriter.chi2minToy - rnd->Exp(1.);
+    toyWriter.statusFree = rnd->Rndm() < 0.99 ? 0 : 4;
+    toyWriter.statusScan = rnd->Rndm() < 0.99 ? 0 : 4;
+    toyWriter.fill();
+  }
+  Utils::resetParameters(w, *startPars);
+  Utils::resetParameters(w, *startObs);
+
+  const TString fileName = "/tmp/gammacombo_benchmark_" + Utils::getUniqueRootName() + ".root";
+  TStopwatch tWrite;
+  toyWriter.writeToFile(fileName);
+  tWrite.Stop();
+  const double mbTotal = toyWriter.getTree()->GetTotBytes() / 1e6;
+  delete toyWriter.getTree();
+  Long_t fileId, fileFlags, fileModtime;
+  Long64_t fileSize = 0;
+  gSystem->GetPathInfo(fileName, &fileId, &fileSize, &fileFlags, &fileModtime);
+
+  TChain chain("plugin");
+  chain.Add(fileName);
+  ToyTree toyReader(c, &chain, true);
+  toyReader.open();
+  toyReader.activateCoreBranchesOnly();
+  TStopwatch tReadCore;
+  for (Long64_t i = 0; i < toyReader.GetEntries(); i++) toyReader.GetEntry(i);
+  tReadCore.Stop();
+  toyReader.activateAllBranches();
+  TStopwatch tReadAll;
+  for (Long64_t i = 0; i < toyReader.GetEntries(); i++) toyReader.GetEntry(i);
+  tReadAll.Stop();
+  gSystem->Unlink(fileName);
+
+  const TString compression = arg->toycompression == "" ? TString("ROOT default") : arg->toycompression;
+  std::cout << std::format("\nbenchmark: toy file with {} entries, compression {}, {} chi2\n", nEntries,
+                           compression.Data(), arg->toyprecision.Data());
+  std::cout << std::format("  size: {:.2f} MB on disk, {:.2f} MB uncompressed (ratio {:.2f})\n", fileSize / 1e6,
+                           mbTotal, fileSize > 0 ? 1e6 * mbTotal / fileSize : 0.);
+  std::cout << std::format("  write:             {:8.1f} MB/s uncompressed\n", mbTotal / tWrite.RealTime());
+  std::cout << std::format("  read core columns: {:8.0f} entries/s\n", nEntries / tReadCore.RealTime());
+  std::cout << std::format("  read all columns:  {:8.0f} entries/s\n", nEntries / tReadAll.RealTime());
+}
+
+///
+/// Check that the analysis of the Plugin toys gives the same CL curves with
+/// --nthreads 1 and with --nthreads N, at least 2, and from the toy cache, and
+/// that the quantile sketches are exact below their size. Exits if not. See MethodPluginScan::checkToyAnalysis().
+///
+void GammaComboEngine::benchmarkToyAnalysis(Combiner* c) {
+  const int nThreads = std::max(arg->nthreads, 2);
+  std::cout << std::format("\nbenchmark: analysis of Plugin toys, 1 against {} threads\n", nThreads);
+  MethodPluginScan plugin(c);
+  plugin.initScan();
+  if (!plugin.checkToyAnalysis(nThreads)) {
+    std::cout << "GammaComboEngine::benchmarkToyAnalysis() : ERROR : the toy analysis depends on the number of "
+                 "threads or on the toy cache, or the quantile sketches are not exact."
+              << std::endl;
+    std::exit(1);
+  }
+}
+
+///
+/// Benchmark the generation of 10^6 toys by RooFit, into a RooDataSet, against
+/// the ToyGenerator, into a flat array, and compare the means and widths of the
+/// observables of both samples. Then the same number of toys as the Plugin scan
+/// draws them: 1000 scan points of 1000 toys, each toy from its own ToyRandom
+/// stream, and set as the observables of the workspace one after the other, as
+/// before each fit. Against RooFit generating each point and setting the
+/// observables from the rows of its RooDataSet.
+///
+void GammaComboEngine::benchmarkToyGenerator(Combiner* c) {
+  RooWorkspace* w = c->getWorkspace();
+  RooAbsPdf* pdf = c->getPdf();
+  const TString obsName = "obs_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startObs(static_cast<RooArgSet*>(w->set(obsName)->snapshot()));
+  const int nToysGen = 1000000;
+  ToyGenerator generator(pdf, *w->set(obsName));
+  const RooArgList& obs = generator.getObservables();
+  const int nObs = obs.size();
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  TStopwatch tRooFit;
+  std::unique_ptr<RooDataSet> data(pdf->generate(*w->set(obsName), nToysGen, RooFit::AutoBinned(false)));
+  tRooFit.Stop();
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+  std::vector<double> toyObs;
+  TStopwatch tGenerator;
+  generator.generate(nToysGen, toyObs);
+  tGenerator.Stop();
+
+  // compare the means and widths of the observables of both samples
+  double maxPullMean = 0.;
+  double maxDiffWidth = 0.;
+  for (int i = 0; i < nObs; i++) {
+    const auto x = static_cast<RooRealVar*>(obs.at(i));
+    const double meanRooFit = data->mean(*x);
+    const double sigmaRooFit = data->sigma(*x);
+    double sum = 0.;
+    double sum2 = 0.;
+    for (int t = 0; t < nToysGen; t++) {
+      sum += toyObs[i * nToysGen + t];
+      sum2 += toyObs[i * nToysGen + t] * toyObs[i * nToysGen + t];
+    }
+    const double mean = sum / nToysGen;
+    const double sigma = std::sqrt(std::max(sum2 / nToysGen - mean * mean, 0.));
+    if (sigmaRooFit <= 0.) continue;
+    maxPullMean = std::max(maxPullMean, std::abs(mean - meanRooFit) / (sigmaRooFit * std::sqrt(2. / nToysGen)));
+    maxDiffWidth = std::max(maxDiffWidth, std::abs(sigma / sigmaRooFit - 1.));
+  }
+  Utils::resetParameters(w, *startObs);
+
+  const double usRooFit = 1e6 * tRooFit.RealTime() / nToysGen;
+  const double usGenerator = 1e6 * tGenerator.RealTime() / nToysGen;
+  std::cout << std::format("\nbenchmark: generation of {} toys with {} observables\n", nToysGen, nObs);
+  std::cout << std::format("  RooFit generate(), RooDataSet: {:8.3f} us/toy\n", usRooFit);
+  std::cout << std::format("  ToyGenerator, flat array:      {:8.3f} us/toy ({})\n", usGenerator,
+                           generator.isNative() ? "all Gaussian" : "partly RooFit");
+  if (usGenerator > 0.) std::cout << std::format("  speedup: {:.2f}\n", usRooFit / usGenerator);
+  std::cout << std::format("  max. difference of the means: {:.2f} standard errors, of the widths: {:.2g}\n",
+                           maxPullMean, maxDiffWidth);
+
+  // as in the Plugin scan: a batch of toys per scan point, each toy set before its fit
+  const int nPointsGen = 1000;
+  const int nToysPoint = nToysGen / nPointsGen;
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  TStopwatch tRooFitPoints;
+  for (int point = 0; point < nPointsGen; point++) {
+    data.reset(pdf->generate(*w->set(obsName), nToysPoint, RooFit::AutoBinned(false)));
+    for (int j = 0; j < nToysPoint; j++) Utils::setParameters(w, obsName, data->get(j));
+  }
+  tRooFitPoints.Stop();
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+  TStopwatch tGeneratorPoints;
+  for (int point = 0; point < nPointsGen; point++) {
+    ToyRandom::setStream(point, 0);
+    generator.generate(nToysPoint, toyObs, 0);
+    for (int j = 0; j < nToysPoint; j++) generator.setObservables(toyObs, nToysPoint, j);
+  }
+  tGeneratorPoints.Stop();
+  Utils::resetParameters(w, *startObs);
+
+  const double usRooFitPoints = 1e6 * tRooFitPoints.RealTime() / nToysGen;
+  const double usGeneratorPoints = 1e6 * tGeneratorPoints.RealTime() / nToysGen;
+  std::cout << std::format("  {} scan points of {} toys, generated and set one by one:\n", nPointsGen, nToysPoint);
+  std::cout << std::format("  RooFit generate(), RooDataSet: {:8.3f} us/toy\n", usRooFitPoints);
+  std::cout << std::format("  ToyGenerator, toy streams:     {:8.3f} us/toy\n", usGeneratorPoints);
+  if (usGeneratorPoints > 0.) std::cout << std::format("  speedup: {:.2f}\n", usRooFitPoints / usGeneratorPoints);
+}
+
+///
+/// Benchmark the stopping rule of --adaptivetoys, if given, against --ntoys
+/// toys per scan point. The toys of a 1D Plugin scan over --npointstoy points
+/// are simulated, with true p-values from 0 to 4 sigma, by drawing the number
+/// of toys with a larger test statistic than the data from a binomial
+/// distribution; the rule itself is that of MethodPluginScan. Prints the toys
+/// (i.e. fits) of both, and their uncertainty of the p-value relative to the
+/// nearest CL threshold at the points within 50% of one, from which follow the
+/// fixed toys per point needed for the precision of the adaptive ones.
+///
+void GammaComboEngine::benchmarkAdaptiveToys(Combiner* c) {
+  if (arg->adaptivetoys <= 0.) return;
+  MethodPluginScan plugin(c);
+  const int nBatch = std::max(arg->ntoys, 1);
+  const int nPoints = std::max(arg->npointstoy, 2);
+  const int nRepeat = 100;
+  std::vector<double> thresholds;
+  for (const double cl : arg->CL) thresholds.push_back(1. - cl / 100.);
+  if (thresholds.empty()) thresholds = {TMath::Prob(1, 1), TMath::Prob(4, 1), TMath::Prob(9, 1)};
+
+  TRandom3 rng(4357);
+  long nToysFixed = 0;
+  long nToysAdaptive = 0;
+  int nEdge = 0;
+  double errFixed = 0.;
+  double errAdaptive = 0.;
+  for (int r = 0; r < nRepeat; r++) {
+    for (int i = 0; i < nPoints; i++) {
+      const double p = TMath::Prob(Utils::sq(4. * i / (nPoints - 1)), 1);
+      double nearest = thresholds[0];
+      for (const double threshold : thresholds) {
+        if (fabs(p - threshold) < fabs(p - nearest)) nearest = threshold;
+      }
+      float pvalue, pvalueErr;
+      plugin.getAdaptiveToyDecision(nBatch, nBatch, rng.Binomial(nBatch, p), pvalue, pvalueErr);
+      nToysFixed += nBatch;
+      const double relErrFixed = pvalueErr / nearest;
+      int nRun = 0;
+      Long64_t nBetter = 0;
+      short stop = 0;
+      while (stop == 0) {
+        nBetter += rng.Binomial(nBatch, p);
+        nRun += nBatch;
+        stop = plugin.getAdaptiveToyDecision(nRun, nRun, nBetter, pvalue, pvalueErr);
+      }
+      nToysAdaptive += nRun;
+      if (fabs(p - nearest) < 0.5 * nearest) {
+        nEdge++;
+        errFixed += relErrFixed;
+        errAdaptive += pvalueErr / nearest;
+      }
+    }
+  }
+
+  std::cout << std::format("\nbenchmark: adaptive toys (--adaptivetoys {}), {} times {} scan points\n",
+                           arg->adaptivetoys, nRepeat, nPoints);
+  std::cout << std::format("  {} toys per point: {:10.1f} toys/scan\n", nBatch, double(nToysFixed) / nRepeat);
+  std::cout << std::format("  adaptive:          {:10.1f} toys/scan\n", double(nToysAdaptive) / nRepeat);
+  if (nEdge == 0 || errAdaptive <= 0.) return;
+  errFixed /= nEdge;
+  errAdaptive /= nEdge;
+  // the uncertainty of fixed toy counts scales as 1/sqrt(toys)
+  const double nToysFixedEqual = double(nToysFixed) * Utils::sq(errFixed / errAdaptive);
+  std::cout << std::format("  rel. uncertainty at the {:.1f} points near a threshold: {:.3f} fixed, {:.3f} adaptive\n",
+                           double(nEdge) / nRepeat, errFixed, errAdaptive);
+  std::cout << std::format("  fixed toys for the same precision: {:.1f} toys/scan, {:.2f} times the adaptive ones\n",
+                           nToysFixedEqual / nRepeat, nToysFixedEqual / nToysAdaptive);
+}
+
+///
+/// Benchmark the parameter snapshots of a plugin toy: one point stored, and
+/// the start parameters restored before the first and second fit of the scan,
+/// free and background fits, by RooDataSets against the FitResultCache.
+///
+void GammaComboEngine::benchmarkFitResultCache(Combiner* c) {
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  const int nToysCache = 100000;
+  const int nRestores = 6;
+  const RooArgSet* pars = w->set(parsName);
+  RooDataSet dsGlobalMin("globalMin", "globalMin", *pars);
+  dsGlobalMin.add(*pars);
+  std::vector<std::unique_ptr<RooDataSet>> dsRoundRobin(4);
+  for (auto& ds : dsRoundRobin) {
+    ds = std::make_unique<RooDataSet>("roundrobin", "roundrobin", *pars);
+    ds->add(*pars);
+  }
+  TStopwatch tDataSet;
+  for (int i = 0; i < nToysCache; i++) {
+    const int id = i % dsRoundRobin.size();
+    dsRoundRobin[id] = std::make_unique<RooDataSet>("roundrobin", "roundrobin", *pars);
+    dsRoundRobin[id]->add(*pars);
+    for (int k = 0; k < nRestores / 2; k++) {
+      Utils::setParametersFloating(w, parsName, dsRoundRobin[id]->get(0));
+      Utils::setParametersFloating(w, parsName, dsGlobalMin.get(0));
+    }
+  }
+  tDataSet.Stop();
+  Utils::resetParameters(w, *startPars);
+  FitResultCache cache(arg);
+  cache.storeParsAtGlobalMin(pars);
+  cache.initRoundRobinDB(pars);
+  TStopwatch tCache;
+  for (int i = 0; i < nToysCache; i++) {
+    cache.storeParsRoundRobin(pars);
+    for (int k = 0; k < nRestores / 2; k++) {
+      cache.getRoundRobinNminus(0).restoreFloating();
+      cache.getParsAtGlobalMin().restoreFloating();
+    }
+  }
+  tCache.Stop();
+  Utils::resetParameters(w, *startPars);
+
+  const double usDataSet = 1e6 * tDataSet.RealTime() / nToysCache;
+  const double usCache = 1e6 * tCache.RealTime() / nToysCache;
+  std::cout << std::format("\nbenchmark: FitResultCache, 1 store and {} restores of {} parameters per toy\n",
+                           nRestores, pars->size());
+  std::cout << std::format("  RooDataSet, restore by name: {:8.3f} us/toy\n", usDataSet);
+  std::cout << std::format("  flat array, restore by slot: {:8.3f} us/toy\n", usCache);
+  if (usCache > 0.) std::cout << std::format("  speedup: {:.2f}\n", usDataSet / usCache);
+}
+
+///
+/// Benchmark the fit results kept by a 300x300 2D scan: the memory of 90000
+/// RooSlimFitResults of the same fit, and looking up all their parameters.
+/// Compared to the layout before the FitParameterSchema, which is rebuilt
+/// here: a list of names and flags in every fit result, searched by
+/// comparing TStrings. The memory is the growth of the resident memory.
+///
+void GammaComboEngine::benchmarkSlimFitResult(Combiner* c) {
+  struct LegacyFitResult {
+    std::vector<std::string> names;
+    std::vector<float> values;
+    std::vector<float> errors;
+    std::vector<bool> angles;
+    std::vector<bool> isConst;
+    float getParVal(TString name) const {
+      for (int i = 0; i < names.size(); i++) {
+        if (TString(names[i]) == name) return values[i];
+      }
+      return std::numeric_limits<float>::quiet_NaN();
+    }
+  };
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  std::unique_ptr<RooFitResult> r(c->getNllMinimizer()->fit(false, -1));
+  Utils::resetParameters(w, *startPars);
+  const int nResults = 300 * 300;
+  auto residentMemory = []() {
+    ProcInfo_t info;
+    gSystem->GetProcInfo(&info);
+    return info.fMemResident;  // kB
+  };
+
+  long memBefore = residentMemory();
+  TStopwatch tCreateLegacy;
+  std::vector<LegacyFitResult> legacy(nResults);
+  for (auto& l : legacy) {
+    for (const RooArgList* list : {&r->constPars(), &r->floatParsFinal()}) {
+      for (const auto p : *list) {
+        const auto var = static_cast<RooRealVar*>(p);
+        l.names.push_back(var->GetName());
+        l.values.push_back(var->getVal());
+        l.errors.push_back(list == &r->constPars() ? 0.f : var->getError());
+        l.angles.push_back(Utils::isAngle(var));
+        l.isConst.push_back(list == &r->constPars());
+      }
+    }
+  }
+  tCreateLegacy.Stop();
+  const long memLegacy = residentMemory() - memBefore;
+  memBefore = residentMemory();
+  TStopwatch tCreateSlim;
+  std::vector<std::unique_ptr<RooSlimFitResult>> slim(nResults);
+  for (auto& s : slim) s = std::make_unique<RooSlimFitResult>(r.get());
+  tCreateSlim.Stop();
+  const long memSlim = residentMemory() - memBefore;
+
+  // look up every parameter of every fit result, as the plots of the parameter evolution do
+  std::vector<TString> names;
+  for (const auto& name : slim[0]->getSchema()->getNames()) names.push_back(name);
+  double sumLegacy = 0.;
+  TStopwatch tLookupLegacy;
+  for (const auto& l : legacy) {
+    for (const auto& name : names) sumLegacy += l.getParVal(name);
+  }
+  tLookupLegacy.Stop();
+  double sumByName = 0.;
+  TStopwatch tLookupByName;
+  for (const auto& s : slim) {
+    for (const auto& name : names) sumByName += s->getParVal(name);
+  }
+  tLookupByName.Stop();
+  double sumById = 0.;
+  TStopwatch tLookupById;
+  std::vector<int> ids;
+  for (const auto& name : names) ids.push_back(slim[0]->getParId(name));
+  for (const auto& s : slim) {
+    for (const int id : ids) sumById += s->getParVal(id);
+  }
+  tLookupById.Stop();
+
+  const double nLookups = double(nResults) * names.size();
+  std::cout << std::format("
+benchmark: {} fit results of {} parameters, as in a 300x300 2D scan
+", nResults,
+                           names.size());
+  std::cout << std::format("  names in each result: {:8.1f} MB, {:8.3f} us/result created
+", memLegacy / 1024.,
+                           1e6 * tCreateLegacy.RealTime() / nResults);
+  std::cout << std::format("  shared schema:        {:8.1f} MB, {:8.3f} us/result created
+", memSlim / 1024.,
+                           1e6 * tCreateSlim.RealTime() / nResults);
+  std::cout << std::format("  lookup, TString comparisons: {:8.1f} ns (sum {:.6g})
+",
+                           1e9 * tLookupLegacy.RealTime() / nLookups, sumLegacy);
+  std::cout << std::format("  lookup by name, hashed:      {:8.1f} ns (sum {:.6g})
+",
+                           1e9 * tLookupByName.RealTime() / nLookups, sumByName);
+  std::cout << std::format("  lookup by getParId():        {:8.1f} ns (sum {:.6g})
+",
+                           1e9 * tLookupById.RealTime() / nLookups, sumById);
+}
+
+///
+/// Benchmark the bookkeeping of a toy, besides generating and fitting it: set
+/// the observables from a row of a toy dataset, copy the scan and free fit
+/// results into the workspace, and store the observables, parameters and best
+/// fit value of the scan variable for the ToyTree. By name against
+/// ParameterBinding.
+///
+void GammaComboEngine::benchmarkParameterBinding(Combiner* c) {
+  RooWorkspace* w = c->getWorkspace();
+  const TString parsName = "par_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
+  const TString obsName = "obs_" + c->getPdfName();
+  std::unique_ptr<RooArgSet> startObs(static_cast<RooArgSet*>(w->set(obsName)->snapshot()));
+  const RooArgSet* pars = w->set(parsName);
+  const int nRows = 1000;
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  std::unique_ptr<RooDataSet> data(c->getPdf()->generate(*w->set(obsName), nRows, RooFit::AutoBinned(false)));
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+  const int nToysBook = 100000;
+  const TString scanVar = pars->first()->GetName();
+  std::unique_ptr<RooArgSet> floatPars(static_cast<RooArgSet*>(pars->selectByAttrib("Constant", false)));
+  std::unique_ptr<RooArgSet> floatParsFinal(static_cast<RooArgSet*>(floatPars->snapshot()));
+  std::vector<float> obsValues(w->set(obsName)->size());
+  std::vector<float> parValues(pars->size());
+  float scanbest = 0.f;
+  TStopwatch tByName;
+  for (int i = 0; i < nToysBook; i++) {
+    Utils::setParameters(w, obsName, data->get(i % nRows));
+    int k = 0;
+    for (const auto& p : *w->set(obsName)) obsValues[k++] = static_cast<RooAbsReal*>(p)->getVal();
+    for (int fit = 0; fit < 2; fit++) {
+      Utils::setParametersFloating(w, parsName, floatParsFinal.get());
+      k = 0;
+      for (const auto& p : *w->set(parsName)) parValues[k++] = static_cast<RooAbsReal*>(p)->getVal();
+    }
+    scanbest = static_cast<RooRealVar*>(w->set(parsName)->find(scanVar))->getVal();
+  }
+  tByName.Stop();
+  const ParameterBinding boundObs(w, obsName);
+  const ParameterBinding boundPars(w, parsName);
+  ParameterBinding::Mapping rowMapping;
+  ParameterBinding::Mapping resultMapping;
+  RooRealVar* scanPar = w->var(scanVar);
+  TStopwatch tBound;
+  for (int i = 0; i < nToysBook; i++) {
+    boundObs.setValues(*data->get(i % nRows), rowMapping);
+    boundObs.getValues(obsValues.data());
+    for (int fit = 0; fit < 2; fit++) {
+      boundPars.setValues(*floatParsFinal, resultMapping, true);
+      boundPars.getValues(parValues.data());
+    }
+    scanbest = scanPar->getVal();
+  }
+  tBound.Stop();
+  Utils::resetParameters(w, *startPars);
+  Utils::resetParameters(w, *startObs);
+
+  const double usByName = 1e6 * tByName.RealTime() / nToysBook;
+  const double usBound = 1e6 * tBound.RealTime() / nToysBook;
+  std::cout << std::format("\nbenchmark: bookkeeping of {} toys, {} observables and {} parameters (scanbest {:.3g})\n",
+                           nToysBook, boundObs.size(), boundPars.size(), scanbest);
+  std::cout << std::format("  sets and variables by name: {:8.3f} us/toy\n", usByName);
+  std::cout << std::format("  ParameterBinding, by index: {:8.3f} us/toy\n", usBound);
+  if (usBound > 0.) std::cout << std::format("  speedup: {:.2f}\n", usByName / usBound);
+}
+
+///
+/// Benchmark the evaluation of the NLL of a datasets workspace, once with
+/// the legacy RooFit backend, which evaluates the pdf event by event, and
+/// once with the batch backend, which calls the vectorised doEval() of the
+/// pdfs. Each evaluation moves the floating parameters, so nothing is cached.
+///
+void GammaComboEngine::benchmarkDatasets(PDF_Datasets* pdf) {
+  RooWorkspace* w = pdf->getWorkspace();
+  std::unique_ptr<RooArgSet> params(pdf->getPdf()->getParameters(*pdf->getData()));
+  std::vector<RooRealVar*> vars;
+  for (const auto p : *params) {
+    const auto var = dynamic_cast<RooRealVar*>(p);
+    if (var && !var->isConstant()) vars.push_back(var);
+  }
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(params->snapshot()));
+  const int nEval = 100 * std::max(arg->ntoys, 1);
+
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  double ms[2];
+  double nll[2];
+  for (int b = 0; b < 2; b++) {
+    std::unique_ptr<RooAbsReal> n(pdf->getPdf()->createNLL(
+        *pdf->getData(), RooFit::Extended(kTRUE), RooFit::ExternalConstraints(*w->set(pdf->getConstraintName())),
+        b == 0 ? RooFit::EvalBackend::Legacy() : RooFit::EvalBackend::Cpu()));
+    nll[b] = n->getVal();
+    TStopwatch t;
+    for (int i = 0; i < nEval; i++) {
+      // alternate between two nearby points
+      for (const auto var : vars) {
+        const double step = var->getError() > 0. ? 0.01 * var->getError() : 1e-3;
+        var->setVal(static_cast<RooRealVar*>(startPars->find(var->GetName()))->getVal() + (i % 2 ? step : -step));
+      }
+      n->getVal();
+    }
+    t.Stop();
+    ms[b] = 1e3 * t.RealTime() / nEval;
+    params->assign(*startPars);
+  }
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+
+  std::cout << std::format("\nbenchmark: {} evaluations of the NLL of {} with {} entries\n", nEval,
+                           pdf->getPdf()->GetName(), pdf->getData()->numEntries());
+  std::cout << std::format("  legacy backend, event by event: {:8.3f} ms/eval (nll={:.6f})\n", ms[0], nll[0]);
+  std::cout << std::format("  batch backend, doEval():        {:8.3f} ms/eval (nll={:.6f})\n", ms[1], nll[1]);
+  if (ms[1] > 0.) std::cout << std::format("  speedup: {:.2f}\n", ms[0] / ms[1]);
+  std::cout << std::format("  difference of the NLL: {:.2g}\n", std::abs(nll[0] - nll[1]));
+  std::cout << std::endl;
+}
+
 ///
 /// scan engine
 ///
@@ -2168,6 +2896,10 @@ void GammaComboEngine::scan() {
     if (arg->isAction("runtoys")) runToys(c);
     /////////////////////////////////////////////////////
 
+    // BENCHMARK
+    if (arg->isAction("benchmark")) benchmark(c);
+    /////////////////////////////////////////////////////
+
     // SAVE WORKSPACE
     if (arg->save != "" && arg->saveAtMin) saveWorkspace(c, i);
     /////////////////////////////////////////////////////
@@ -2184,6 +2916,7 @@ void GammaComboEngine::scan() {
 //
 void GammaComboEngine::scanDataSet() {
   if (arg->info || arg->latex) return;
+  if (arg->isAction("benchmark")) benchmarkDatasets((PDF_Datasets*)pdf[0]);
 
   /////////////////////////////////////////////////////
   //
@@ -16,13 +16,13 @@
 #include <OneMinusClPlotAbs.h>
 #include <OptParser.h>
 #include <PullPlotter.h>
+#include <RooMinusTwoLogL.h>
 #include <RooSlimFitResult.h>
 #include <Utils.h>
 
 #include <RooAbsPdf.h>
 #include <RooDataSet.h>
 #include <RooFitResult.h>
-#include <RooFormulaVar.h>
 #include <RooMsgService.h>
 #include <RooRealVar.h>
 #include <RooWorkspace.h>
@@ -171,14 +171,13 @@ void MethodAbsScan::doInitialFit(bool force) {
     p.printPulls(0.);
     std::cout << "MethodAbsScan::doInitialFit() : PDF evaluated at init parameters: ";
     std::cout << w->pdf(pdfName)->getVal() << std::endl;
-    RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*w->pdf(pdfName)));
+    RooMinusTwoLogL ll("ll", "ll", *w->pdf(pdfName));
     std::cout << "MethodAbsScan::doInitialFit() : Chi2 at init parameters: ";
     std::cout << ll.getVal() << std::endl;
   }
 
   int quiet = arg->debug ? 1 : -1;
-  RooFitResult* r = Utils::fitToMinBringBackAngles(w->pdf(pdfName), true, quiet);
-  // RooFitResult* r = Utils::fitToMin(w->pdf(pdfName), true, quiet);
+  RooFitResult* r = Utils::fitToMinBringBackAngles(combiner->getNllMinimizer(), true, quiet);
   if (arg->debug) r->Print("v");
   // globalMin = new RooSlimFitResult(r);
   globalMin = r;
@@ -294,6 +293,7 @@ void MethodAbsScan::initScan() {
     for (int j = 0; j < nPoints2dy; j++) tmp.push_back(0);
     curveResults2d.push_back(tmp);
   }
+  adaptiveResults.clear();
 
   // global minimum
   doInitialFit();
@@ -1321,7 +1321,7 @@ void MethodAbsScan::confirmSolutions() {
 
     // refit the solution
     // true uses thorough fit with HESSE, -1 silences output
-    RooFitResult* r = Utils::fitToMinBringBackAngles(w->pdf(pdfName), true, -1);
+    RooFitResult* r = Utils::fitToMinBringBackAngles(combiner->getNllMinimizer(), true, -1);
 
     // Check scan parameter shift.
     // We'll allow for a shift equivalent to 3 step sizes.
@@ -1410,7 +1410,7 @@ void MethodAbsScan::confirmSolutions() {
   if (arg->debug) printLocalMinima();
   removeDuplicateSolutions();
   // reset parameters
-  Utils::setParameters(w, parsName, frCache.getParsAtFunctionCall());
+  frCache.getParsAtFunctionCall().restore();
 }
 
 ///
@@ -13,11 +13,13 @@
 #include <MethodPluginScan.h>
 #include <MethodProbScan.h>
 #include <OptParser.h>
+#include <ParameterBinding.h>
+#include <ToyRandom.h>
 #include <ToyTree.h>
 #include <Utils.h>
 
 #include <RooAbsPdf.h>
-#include <RooRandom.h>
+#include <RooDataSet.h>
 #include <RooRealVar.h>
 
 #include <TCanvas.h>
@@ -26,10 +28,13 @@
 #include <TH1F.h>
 #include <TH2F.h>
 #include <TLeaf.h>
+#include <TROOT.h>
 #include <TString.h>
 #include <TTree.h>
 
 #include <iostream>
+#include <utility>
+#include <vector>
 
 ///
 /// Initialize from a previous Prob scan, setting the profile
@@ -317,9 +322,17 @@ void MethodBergerBoosScan::readScan1dTrees(int runMin, int runMax) {
 /// Saves chi2 values in a root tree, together with the full fit result for each toy.
 /// If a combined PDF for the toy generation is given by setToyGenCombo(), this
 /// will be used to generate the toys.
+///
+/// Each pair of a scan point and one of its Berger-Boos points is an independent
+/// toy experiment, a work unit with a FitResultCache of its own. With --ncores, the
+/// units run on local worker processes (see runToyFarm()), each with its own copy
+/// of the Fitter, and the toys of all workers are merged into the output file.
+///
 /// \param nRun Part of the root tree file name to facilitate parallel production.
 ///
 int MethodBergerBoosScan::scan1d(int nRun) {
+  checkNotAdaptive(profileLH, "scan1d");
+  checkNotAdaptive(parevolPLH, "scan1d");
   TString fName = "";
   if (this->dir == "XX") {
     // fName = Form("root/scan1dPlugin_"+name+"_"+scanVar1+"_run%i.root", nRun);
@@ -329,10 +342,16 @@ int MethodBergerBoosScan::scan1d(int nRun) {
     fName = this->dir + Form("root/scan1dBergerBoos_" + name + "_" + scanVar1 + "_run%i.root", nRun);
   }
 
-  TFile* f2 = new TFile(fName, "recreate");
+  // with --ncores, the toys are filled in memory and written by the workers
+  const bool farm = arg->ncores > 1;
+  TFile* f2 = nullptr;
+  if (farm) {
+    gROOT->cd();
+  } else {
+    f2 = new TFile(fName, "recreate");
+  }
 
   Fitter* myFit = new Fitter(arg, w, combiner->getPdfName());
-  RooRandom::randomGenerator()->SetSeed(0);
 
   // Set limit to all parameters.
   combiner->loadParameterLimits();
@@ -365,117 +384,153 @@ int MethodBergerBoosScan::scan1d(int nRun) {
   // to the outside.
   FitResultCache frCache(arg);
   frCache.storeParsAtFunctionCall(w->set(parsName));
-  frCache.initRoundRobinDB(w->set(parsName));
 
-  // for the progress bar: if more than 100 steps, show 50 status messages.
-  int allSteps = nPoints1d * nToys * nBBPoints;
-  float printFreq = allSteps > 51 ? 50.f : allSteps;
-  int curStep = 0;
+  // the observables, set from the rows of the toy datasets, and the parameters
+  const ParameterBinding obs(w, obsName);
+  const ParameterBinding pars(w, parsName);
+  ParameterBinding::Mapping toyMapping;
+  ParameterBinding::Mapping plhMapping;
+
+  // The work units: a scan point and one of its Berger-Boos points. The nuisances of
+  // the Berger-Boos points are read from the BBtree now, as the workers share its file.
+  struct Unit {
+    int i;                          ///< the scan point
+    int ii;                         ///< the Berger-Boos point
+    double scanpoint;               ///< value of the scan variable
+    std::vector<double> nuisances;  ///< parameters of the Berger-Boos point, empty for the first one
+  };
+  std::vector<Unit> units;
   int StepCounter = 0;
-  // start scan
-  std::cout << "MethodBergerBoosScan::scan1d() : starting ..." << std::endl;
   for (int i = 0; i < nPoints1d; i++) {
     double scanpoint = min + (max - min) * (double)i / nPoints1d + hCL->GetBinWidth(1) / 2.;
-    t.scanpoint = scanpoint;
-
-    // Tell tree how many BergerBoos points were sampled
-    t.nBergerBoos = nBBPoints;
 
     // don't scan in unphysical region
     if (scanpoint < par->getMin() || scanpoint > par->getMax()) continue;
 
-    for (int ii = 0; ii < nBBPoints; ii++)  // Berger Boos nuisance Loop
-    {
-      // Store BergerBoos_id to tree to be able to separate the Berger Boos
-      // points a posteriori
-      t.BergerBoos_id = ii;
-
-      // Set nuisances. This is the point in parameter space where
-      // the toys need to be generated.
-
-      // The first Berger Boos scanpoint is equal to the best fit values (Plugin scan point)
-      RooSlimFitResult* plhScan = getParevolPoint(scanpoint);
-      Utils::setParameters(w, parsName, plhScan, true);
-
+    for (int ii = 0; ii < nBBPoints; ii++) {
+      Unit unit{i, ii, scanpoint, {}};
       if (ii > 0) {
         // From the second point in the nuisance parameter space onwards, new points are drawn randomly
         // from their Berger Boos ranges
         this->setNewBergerBoosPoint(StepCounter);
-        // continue;
+        unit.nuisances.resize(pars.size());
+        pars.getValues(unit.nuisances.data());
       }
       StepCounter++;
+      units.push_back(std::move(unit));
+    }
+  }
+  frCache.getParsAtFunctionCall().restore();
 
-      // set and fix scan point
-      par->setConstant(true);
-      par->setVal(scanpoint);
+  // for the progress bar: if more than 100 steps, show 50 status messages.
+  int allSteps = units.size() * nToys;
+  float printFreq = allSteps > 51 ? 50.f : allSteps;
+  int curStep = 0;
+
+  auto runUnit = [&](int iUnit) {
+    const Unit& unit = units[iUnit];
+    const double scanpoint = unit.scanpoint;
+    t.scanpoint = scanpoint;
 
-      // save nuisances for start parameters
-      frCache.storeParsAtGlobalMin(w->set(parsName));
+    // Tell tree how many BergerBoos points were sampled
+    t.nBergerBoos = nBBPoints;
 
-      t.storeParsPll();
-      t.storeTheory();
+    // Store BergerBoos_id to tree to be able to separate the Berger Boos
+    // points a posteriori
+    t.BergerBoos_id = unit.ii;
 
-      // get the chi2 of the data
-      t.chi2min = profileLH->getChi2min(scanpoint);
-      t.chi2minGlobal = profileLH->getChi2minGlobal();
+    // start parameters of the fits of this unit
+    FitResultCache unitCache(arg);
+    unitCache.initRoundRobinDB(w->set(parsName));
 
-      // Draw all toy datasets in advance. This is much faster.
-      RooDataSet* toyDataSet = w->pdf(pdfName)->generate(*w->set(obsName), nToys, RooFit::AutoBinned(false));
+    // Set nuisances. This is the point in parameter space where
+    // the toys need to be generated.
 
-      for (int j = 0; j < nToys; j++) {
-        curStep++;
-        if (curStep % (int)(allSteps / printFreq) == 0) {
-          std::cout << (float)curStep / (float)allSteps * 100. << "%" << std::endl;
-        }
+    // The first Berger Boos scanpoint is equal to the best fit values (Plugin scan point)
+    RooSlimFitResult* plhScan = getParevolPoint(scanpoint);
+    pars.setValues(*plhScan, plhMapping);
+    if (!unit.nuisances.empty()) pars.setValues(unit.nuisances.data());
+
+    // set and fix scan point
+    par->setConstant(true);
+    par->setVal(scanpoint);
+
+    // save nuisances for start parameters
+    unitCache.storeParsAtGlobalMin(w->set(parsName));
 
-        //
-        // 1. Generate toys
-        //    (or select the right one)
-        //
-        const RooArgSet* toyData = toyDataSet->get(j);
-        Utils::setParameters(w, obsName, toyData);
-        t.storeObservables();
-
-        //
-        // 2. scan fit
-        //
-        par->setVal(scanpoint);
-        par->setConstant(true);
-        // myFit->setStartparsFirstFit(profileLH->getSolution(0));
-        myFit->setStartparsFirstFit(frCache.getRoundRobinNminus(0));
-        myFit->setStartparsSecondFit(frCache.getParsAtGlobalMin());
-        myFit->fit();
-        t.chi2minToy = myFit->getChi2();
-        t.statusScan = myFit->getStatus();
-        t.storeParsScan();
-
-        //
-        // 3. free fit
-        //
-        par->setConstant(false);
-        myFit->fit();
-        t.chi2minGlobalToy = myFit->getChi2();
-        t.statusFree = myFit->getStatus();
-        t.scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
-        t.storeParsFree();
-
-        //
-        // 4. store
-        //
-        if (t.statusFree == 0) frCache.storeParsRoundRobin(w->set(parsName));
-        t.fill();
+    t.storeParsPll();
+    t.storeTheory();
+
+    // get the chi2 of the data
+    t.chi2min = profileLH->getChi2min(scanpoint);
+    t.chi2minGlobal = profileLH->getChi2minGlobal();
+
+    // Draw all toy datasets in advance. This is much faster.
+    ToyRandom::setStream(unit.i * nBBPoints + unit.ii, 0);
+    RooDataSet* toyDataSet = w->pdf(pdfName)->generate(*w->set(obsName), nToys, RooFit::AutoBinned(false));
+
+    for (int j = 0; j < nToys; j++) {
+      curStep++;
+      if (!farm && curStep % (int)(allSteps / printFreq) == 0) {
+        std::cout << (float)curStep / (float)allSteps * 100. << "%" << std::endl;
       }
 
-      // reset
-      Utils::setParameters(w, parsName, frCache.getParsAtFunctionCall());
-      Utils::setParameters(w, obsName, obsDataset->get(0));
-      delete toyDataSet;
+      //
+      // 1. Generate toys
+      //    (or select the right one)
+      //
+      const RooArgSet* toyData = toyDataSet->get(j);
+      obs.setValues(*toyData, toyMapping);
+      t.storeObservables();
+
+      //
+      // 2. scan fit
+      //
+      par->setVal(scanpoint);
+      par->setConstant(true);
+      // myFit->setStartparsFirstFit(profileLH->getSolution(0));
+      myFit->setStartparsFirstFit(unitCache.getRoundRobinNminus(0));
+      myFit->setStartparsSecondFit(unitCache.getParsAtGlobalMin());
+      myFit->fit();
+      t.chi2minToy = myFit->getChi2();
+      t.statusScan = myFit->getStatus();
+      t.storeParsScan();
+
+      //
+      // 3. free fit
+      //
+      par->setConstant(false);
+      myFit->fit();
+      t.chi2minGlobalToy = myFit->getChi2();
+      t.statusFree = myFit->getStatus();
+      t.scanbest = par->getVal();
+      t.storeParsFree();
+
+      //
+      // 4. store
+      //
+      if (t.statusFree == 0) unitCache.storeParsRoundRobin(w->set(parsName));
+      t.fill();
     }
+
+    // reset
+    frCache.getParsAtFunctionCall().restore();
+    Utils::setParameters(w, obsName, obsDataset->get(0));
+    delete toyDataSet;
+  };
+
+  // start scan
+  std::cout << "MethodBergerBoosScan::scan1d() : starting ..." << std::endl;
+  if (farm) {
+    runToyFarm(units.size(), runUnit, t, fName);
+    delete t.getTree();
+  } else {
+    for (int iUnit = 0; iUnit < units.size(); iUnit++) runUnit(iUnit);
+    myFit->print();
+    t.writeToFile();
+    f2->Close();
+    delete f2;
   }
-  myFit->print();
-  t.writeToFile();
-  f2->Close();
-  delete f2;
   delete myFit;
   readScan1dTrees(nRun, nRun);
   return nBBPoints;
@@ -8,7 +8,9 @@
 #include <MethodProbScan.h>
 #include <OptParser.h>
 #include <ParameterCache.h>
+#include <ProgressBar.h>
 #include <RooSlimFitResult.h>
+#include <ToyRandom.h>
 #include <ToyTree.h>
 #include <Utils.h>
 
@@ -29,6 +31,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 namespace {
@@ -77,6 +80,22 @@ namespace {
 ///
 MethodCoverageScan::MethodCoverageScan(Combiner* comb) : MethodAbsScan(comb) { methodName = "Coverage"; }
 
+///
+/// Run the coverage toys at the point set by the parameter cache. Each toy
+/// draws observables from that point, fits them with the scan variable free
+/// and fixed, computes the p-value of the Plugin method with --ntoys inner
+/// toys, and scans the Prob method for its intervals. One entry per toy is
+/// written to the "coverage" tree.
+///
+/// With --ncores, the coverage toys run on local worker processes, each
+/// starting from its own copy of the workspace, and the trees of the workers
+/// are merged into the output file. Each toy is drawn from the ToyRandom
+/// streams of its index, so the results don't depend on the worker. The
+/// running distributions of the chi2 and p-values are only drawn with
+/// --interactive.
+///
+/// \param nRun Part of the root file name to facilitate parallel production.
+///
 int MethodCoverageScan::scan1d(int nRun) {
   if (!pCache) {
     std::cout << "\nERROR : parameterCache has not been in set for the coverage scanner " << std::endl;
@@ -85,16 +104,21 @@ int MethodCoverageScan::scan1d(int nRun) {
   nToys = arg->ncoveragetoys;
   // TString forceVariables = "dD_k3pi,dD_kpi,d_dk,g,d_dpi,r_dpi,";
   TString forceVariables = "";
-
-  // set up a graph of chi2 of best solution
-  TCanvas* c2 = new TCanvas("c2runToys", "chi2");
-  TH1F* hDeltaChi2 = new TH1F("hDeltaChi2", "Delta Chi2 (PLH) of toys", 50, 0, 25);
-  hDeltaChi2->Draw();
-
-  // set up a graph of p-values
-  TCanvas* c3 = new TCanvas("c3runToys", "p-values");
-  TH1F* hPvalues = new TH1F("hPvalues", "p-values", 60, -0.1, 1.1);
-  hPvalues->Draw();
+  const bool farm = arg->ncores > 1 && nToys > 1;
+
+  // set up a graph of chi2 of best solution and of p-values
+  TCanvas* c2 = nullptr;
+  TCanvas* c3 = nullptr;
+  TH1F* hDeltaChi2 = nullptr;
+  TH1F* hPvalues = nullptr;
+  if (arg->interactive && !farm) {
+    c2 = new TCanvas("c2runToys", "chi2");
+    hDeltaChi2 = new TH1F("hDeltaChi2", "Delta Chi2 (PLH) of toys", 50, 0, 25);
+    hDeltaChi2->Draw();
+    c3 = new TCanvas("c3runToys", "p-values");
+    hPvalues = new TH1F("hPvalues", "p-values", 60, -0.1, 1.1);
+    hPvalues->Draw();
+  }
 
   // set up a root tree to save results
   float tSol = 0.0;
@@ -141,20 +165,13 @@ int MethodCoverageScan::scan1d(int nRun) {
   if (!combiner->isCombined()) combiner->combine();
 
   // set up a ToyTree to save the results from the
-  // plugin toys
-  ToyTree* myTree = new ToyTree(combiner, 0, true);
-  myTree->init();
-
-  // for testing purposes we can fully scan the first 10 toys, set up a plot for this
-  // OneMinusClPlot *plot = 0;
-  // if ( arg->isAction("test") ) plot = new OneMinusClPlot(arg, "coveragetest_plugin_omcl");
-  //
-  // ProgressBar *pb = new ProgressBar(arg, nToys);
+  // plugin toys, it only holds the toys of the current coverage toy
+  ToyTree myTree(combiner, 0, true);
+  myTree.init();
 
-  // toy loop
-  for (int i = 0; i < nToys; i++) {
+  // the coverage toy i
+  auto runToy = [&](int i) {
     std::cout << "ITOY = " << i << std::endl;
-    // pb->progress();
 
     tId = i;
     RooWorkspace* w = combiner->getWorkspace();
@@ -170,6 +187,7 @@ int MethodCoverageScan::scan1d(int nRun) {
     tSolGen = w->var(varName)->getVal();
 
     // generate the toy point
+    ToyRandom::setStream(id, i, ToyRandom::kCoverage);
     combiner->setObservablesToToyValues();
 
     // set limits (--pr)
@@ -180,15 +198,6 @@ int MethodCoverageScan::scan1d(int nRun) {
       combiner->getParameters()->Print("v");
     }
 
-    // for testing, fully scan the first 10 toys
-    // if ( arg->isAction("test") && i<10 ){
-    // scanToy(combiner, plot, i);
-    //}
-    if (arg->debug) {
-      std::cout << "PARAMETERS AFTER TOY SCAN" << std::endl;
-      combiner->getParameters()->Print("v");
-    }
-
     // fix observables, float parameters
     Utils::fixParameters(combiner->getWorkspace(), "obs_" + combiner->getPdfName());
     Utils::floatParameters(combiner->getWorkspace(), "par_" + combiner->getPdfName());
@@ -203,70 +212,74 @@ int MethodCoverageScan::scan1d(int nRun) {
 
     std::cout << "Free Fit" << std::endl;
     w->var(varName)->setConstant(false);
-    RooFitResult* rToyFreeFull = Utils::fitToMinForce(w, pdfName, forceVariables, false);
-    if (!rToyFreeFull) continue;
-    RooSlimFitResult* rToyFree = new RooSlimFitResult(rToyFreeFull);
+    std::unique_ptr<RooFitResult> rToyFreeFull(
+        Utils::fitToMinForce(w, combiner->getNllMinimizer(), pdfName, forceVariables, false, arg->getForceConfig()));
+    if (!rToyFreeFull) return;
+    auto rToyFree = std::make_unique<RooSlimFitResult>(rToyFreeFull.get());
     tChi2free = rToyFree->minNll();  ///< save for tree
     tSol = w->var(varName)->getVal();
     if (arg->verbose) rToyFree->Print();
-    delete rToyFreeFull;
+    rToyFreeFull.reset();
 
     // can fill values of fit parameters here
-    for (int i = 0; i < combiner->getParameterNames().size(); i++) {
-      paramVals[i] = w->var(combiner->getParameterNames()[i].c_str())->getVal();
+    for (int k = 0; k < combiner->getParameterNames().size(); k++) {
+      paramVals[k] = w->var(combiner->getParameterNames()[k].c_str())->getVal();
     }
 
     std::cout << "Scan Point Fit" << std::endl;
-    Utils::setParameters(w, parName, frCache.getParsAtFunctionCall());
+    frCache.getParsAtFunctionCall().restore();
     w->var(varName)->setConstant(true);
-    RooFitResult* rToyScanFull = Utils::fitToMinForce(w, pdfName, forceVariables, false);
-    if (!rToyScanFull) continue;
-    RooSlimFitResult* rToyScan = new RooSlimFitResult(rToyScanFull);
+    std::unique_ptr<RooFitResult> rToyScanFull(
+        Utils::fitToMinForce(w, combiner->getNllMinimizer(), pdfName, forceVariables, false, arg->getForceConfig()));
+    if (!rToyScanFull) return;
+    auto rToyScan = std::make_unique<RooSlimFitResult>(rToyScanFull.get());
     tChi2scan = rToyScan->minNll();  ///< save for tree
     if (arg->verbose) rToyScan->Print();
     w->var(varName)->setConstant(false);
-    delete rToyScanFull;
+    rToyScanFull.reset();
 
-    Utils::setParameters(w, parName, frCache.getParsAtFunctionCall());
+    frCache.getParsAtFunctionCall().restore();
 
     //
     // draw chi2
     //
-    hDeltaChi2->Fill(tChi2scan - tChi2free);
-    c2->cd();
-    hDeltaChi2->Draw();
-    c2->Update();
+    if (hDeltaChi2) {
+      hDeltaChi2->Fill(tChi2scan - tChi2free);
+      c2->cd();
+      hDeltaChi2->Draw();
+      c2->Update();
+    }
 
     //
     // compute p-value of the Plugin method
     //
     std::cout << "PLUGIN...";
-    MethodPluginScan* scanner = new MethodPluginScan(combiner);
-    scanner->initScan();
-    tPvalue = scanner->getPvalue1d(rToyScan, tChi2free, myTree, i, !arg->verbose);
+    {
+      MethodPluginScan scanner(combiner);
+      scanner.initScan();
+      tPvalue = scanner.getPvalue1d(rToyScan.get(), tChi2free, &myTree, i, !arg->verbose);
+    }
+    myTree.getTree()->Reset();
     std::cout << "Done" << std::endl;
     std::cout << "P VALUE IS " << tPvalue << std::endl;
-    hPvalues->Fill(tPvalue);
-    c3->cd();
-    hPvalues->Draw();
-    c3->Update();
+    if (hPvalues) {
+      hPvalues->Fill(tPvalue);
+      c3->cd();
+      hPvalues->Draw();
+      c3->Update();
+    }
 
     // now do the uncertainty scan for the Prob method
     std::cout << "PROB" << std::endl;
-    MethodProbScan* probScanner = new MethodProbScan(combiner);
-    probScanner->initScan();
-    probScanner->loadParameters(rToyFree);  // load parameters from forced fit
-    probScanner->scan1d(false, false, true);
-    // std::vector<RooSlimFitResult*> firstScanSolutions = probScanner->getSolutions();
-    // for ( int i=0; i<firstScanSolutions.size(); i++ ){
-    // probScanner->loadParameters( firstScanSolutions[i] );
-    // probScanner->scan1d(true);
-    //}
-    probScanner->confirmSolutions();
-    if (arg->verbose) probScanner->printLocalMinima();
-    CLInterval probSig1Int = probScanner->getCLintervalCentral(1, true);
-    CLInterval probSig2Int = probScanner->getCLintervalCentral(2, true);
-    CLInterval probSig3Int = probScanner->getCLintervalCentral(3, true);
+    MethodProbScan probScanner(combiner);
+    probScanner.initScan();
+    probScanner.loadParameters(rToyFree.get());  // load parameters from forced fit
+    probScanner.scan1d(false, false, true);
+    probScanner.confirmSolutions();
+    if (arg->verbose) probScanner.printLocalMinima();
+    CLInterval probSig1Int = probScanner.getCLintervalCentral(1, true);
+    CLInterval probSig2Int = probScanner.getCLintervalCentral(2, true);
+    CLInterval probSig3Int = probScanner.getCLintervalCentral(3, true);
     tSolScan = probSig1Int.central;
     tSolProbErr1Low = probSig1Int.min;
     tSolProbErr1Up = probSig1Int.max;
@@ -277,23 +290,47 @@ int MethodCoverageScan::scan1d(int nRun) {
 
     // fill tree
     t->Fill();
-
-    //
-    // cleanup
-    //
-    delete rToyScan;
-    delete rToyFree;
-    if (!arg->isAction("test")) delete scanner;
-  }
+  };
 
   // save trees
   TString idStr = arg->id < 0 ? "0" : Form("%d", arg->id);
   TString dirname = "root/scan1dCoverage_" + name + "_" + scanVar1 + "_id" + idStr;
   system("mkdir -p " + dirname);
-  TFile* f = new TFile(Form(dirname + "/scan1dCoverage_" + name + "_" + scanVar1 + "_id" + idStr + "_run%i.root", nRun),
-                       "recreate");
-  t->Write();
-  f->Close();
+  const TString fileName =
+      Form(dirname + "/scan1dCoverage_" + name + "_" + scanVar1 + "_id" + idStr + "_run%i.root", nRun);
+  auto writeTree = [&](const TString& fName) {
+    TFile f(fName, "recreate");
+    t->Write();
+    f.Close();
+  };
+
+  // toy loop
+  if (farm) {
+    const int nWorkers = std::min(arg->ncores, nToys);
+    std::vector<TString> parts;
+    for (int iWorker = 0; iWorker < nWorkers; iWorker++) parts.push_back(Utils::forkPartFileName(fileName, iWorker));
+    std::cout << "MethodCoverageScan::scan1d() : running " << nToys << " coverage toys on " << nWorkers
+              << " processes ..." << std::endl;
+    ProgressBar pb(arg, nToys);
+    const bool success = Utils::forkFor(
+        nWorkers, nToys, [&](int iWorker, int i) { runToy(i); }, [&](int iWorker) { writeTree(parts[iWorker]); },
+        [&]() { pb.progress(); });
+    if (!success) {
+      std::cout << "MethodCoverageScan::scan1d() : ERROR : a worker process failed. Exit." << std::endl;
+      std::exit(1);
+    }
+    if (!Utils::mergeForkParts(fileName, parts)) {
+      std::cout << "MethodCoverageScan::scan1d() : ERROR : could not merge the worker files into " << fileName
+                << ". Exit." << std::endl;
+      std::exit(1);
+    }
+  } else {
+    for (int i = 0; i < nToys; i++) runToy(i);
+    writeTree(fileName);
+  }
+  std::cout << "MethodCoverageScan::scan1d() : saved coverage toys to: " << fileName << std::endl;
+  delete myTree.getTree();
+  delete t;
   return 0;
 }
 
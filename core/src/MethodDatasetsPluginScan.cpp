@@ -21,13 +21,13 @@
 #include <OptParser.h>
 #include <PDF_Datasets.h>
 #include <ProgressBar.h>
+#include <ToyRandom.h>
 #include <ToyTree.h>
 #include <Utils.h>
 
 #include <RooDataSet.h>
 #include <RooFitResult.h>
 #include <RooMsgService.h>
-#include <RooRandom.h>
 #include <RooRealVar.h>
 #include <RooWorkspace.h>
 
@@ -1202,8 +1202,6 @@ int MethodDatasetsPluginScan::scan1d(int nRun) {
   // boost::filesystem::path full_path( boost::filesystem::initial_path<boost::filesystem::path>() );
   // std::cout<<"initial path according to boost "<<full_path<<std::endl;
 
-  // Necessary for parallelization
-  RooRandom::randomGenerator()->SetSeed(0);
   // Set limit to all parameters.
   this->loadParameterLimits();  /// Default is "free", if not changed by cmd-line parameter
 
@@ -1270,6 +1268,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun) {
       Utils::setParameters(w, dataBkgFitResult);  // set parameters to bkg fit so the generation always starts at the
                                                   // same value
       // pdf->printParameters();
+      ToyRandom::setStream(0, j, ToyRandom::kBkgToys);
       pdf->generateBkgToys(0, arg->var[0]);
       pdf->generateBkgToysGlobalObservables(0, j);
       RooAbsData* bkgOnlyToy = pdf->getBkgToyObservables();
@@ -1507,6 +1506,7 @@ int MethodDatasetsPluginScan::scan1d(int nRun) {
         int index = this->getProfileLH()->probScanTree->bestIndexScanData;
         this->pdf->setBestIndexScan(index);
       }
+      ToyRandom::setStream(i, j);
       this->pdf->generateToys();                   // this is generating the toy dataset
       this->pdf->generateToysGlobalObservables();  // this is generating the toy global observables and saves globalObs
                                                    // in snapshot
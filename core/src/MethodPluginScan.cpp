@@ -13,11 +13,16 @@
 #include <Fitter.h>
 #include <MethodAbsScan.h>
 #include <MethodProbScan.h>
+#include <NllMinimizer.h>
 #include <OptParser.h>
 #include <PDF_Datasets.h>
 #include <PValueCorrection.h>
 #include <ProgressBar.h>
+#include <QuantileSketch.h>
 #include <RooSlimFitResult.h>
+#include <ToyCache.h>
+#include <ToyGenerator.h>
+#include <ToyRandom.h>
 #include <ToyTree.h>
 #include <Utils.h>
 
@@ -30,15 +35,23 @@
 #include <TArrow.h>
 #include <TCanvas.h>
 #include <TChain.h>
+#include <TChainElement.h>
 #include <TH1F.h>
 #include <TH2F.h>
 #include <TLatex.h>
 #include <TLegend.h>
 #include <TMath.h>
+#include <TSystem.h>
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
 #include <vector>
 
 void MethodPluginScan::constructorHelper(MethodProbScan* s) {
@@ -106,6 +119,23 @@ void MethodPluginScan::setParevolPLH(MethodProbScan* s) {
   parevolPLH = s;
 }
 
+///
+/// Exit if the given profile likelihood was scanned adaptively (--adaptivescan).
+/// Most of its bins are interpolated and have no fit result that the toys
+/// could be generated at.
+///
+/// \param s The profile likelihood scanner, profileLH or parevolPLH.
+/// \param caller Name of the calling method, for the error message.
+///
+void MethodPluginScan::checkNotAdaptive(const MethodAbsScan* s, const TString& caller) const {
+  if (!s || s->getAdaptiveResults().empty()) return;
+  std::cout << "MethodPluginScan::" << caller << "() : ERROR : the profile likelihood '" << s->getTitle()
+            << "' was scanned with --adaptivescan, so it has no fit results at the interpolated scan points "
+               "to generate the toys at. Run the Plugin scan without --adaptivescan."
+            << std::endl;
+  std::exit(1);
+}
+
 ///
 /// Helper function for scan1d(). Gets point in parameter space (in form
 /// of a RooFitResult) at which the plugin toy should be generated.
@@ -152,15 +182,24 @@ RooSlimFitResult* MethodPluginScan::getParevolPoint(double scanpoint) {
 }
 
 ///
-/// Generate toys.
+/// Generate toys. The RooMultiVarGaussian factors of the pdf are sampled
+/// directly by the ToyGenerator, the others are generated by RooFit.
+/// The toys are drawn from the ToyRandom streams of the scan point and
+/// toy indices, so they can be reproduced independently of each other.
 ///
 /// \param nToys - generate this many toys
+/// \param toyObs - filled with the toys, toyObs[iObs*nToys+iToy], see ToyGenerator
+/// \param point - index of the scan point
+/// \param firstToy - index of the first toy at this scan point
 ///
-RooDataSet* MethodPluginScan::generateToys(int nToys) {
-  RooRandom::randomGenerator()->SetSeed(0);
+void MethodPluginScan::generateToys(int nToys, std::vector<double>& toyObs, int point, int firstToy) {
+  if (!toyGenerator) toyGenerator = std::make_unique<ToyGenerator>(w->pdf(pdfName), *w->set(obsName));
+  const RooArgList& obs = toyGenerator->getObservables();
+
+  ToyRandom::setStream(point, firstToy);
   RooMsgService::instance().setStreamStatus(0, kFALSE);
   RooMsgService::instance().setStreamStatus(1, kFALSE);
-  RooDataSet* dataset = w->pdf(pdfName)->generate(*w->set(obsName), nToys, RooFit::AutoBinned(false));
+  toyGenerator->generate(nToys, toyObs, firstToy);
   RooMsgService::instance().setStreamStatus(0, kTRUE);
   RooMsgService::instance().setStreamStatus(1, kTRUE);
 
@@ -172,8 +211,9 @@ RooDataSet* MethodPluginScan::generateToys(int nToys) {
     if (w->var("kD_kskpi")) std::cout << "kD_kskpi=" << w->var("kD_kskpi")->getVal() << std::endl;
     if (w->var("dD_kskpi")) std::cout << "dD_kskpi=" << w->var("dD_kskpi")->getVal() << std::endl;
     for (int j = 0; j < 10 && j < nToys; j++) {
-      const RooArgSet* toyData = dataset->get(j);
-      toyData->Print("v");
+      std::cout << "toy " << j << ":";
+      for (int i = 0; i < obs.size(); i++) std::cout << " " << obs.at(i)->GetName() << "=" << toyObs[i * nToys + j];
+      std::cout << std::endl;
     }
   }
 
@@ -186,8 +226,10 @@ RooDataSet* MethodPluginScan::generateToys(int nToys) {
   // This happens only for kD_k3pi_obs and kD_kskpi_obs
   // Workaround: If it happens, flucutate the parameters of the histogram
   // ever so slightly and regenerate.
+  // Only the factors generated by RooFit can be affected.
+  if (toyGenerator->isNative() || nToys < 2) return;
 
-  // read the generated values for one variable from the
+  // compare the generated values for one variable in the
   // first two toys
   //
   std::vector<TString> affected_var;
@@ -199,23 +241,13 @@ RooDataSet* MethodPluginScan::generateToys(int nToys) {
 
     TString aff_obs = *aff_var_it + "_obs";
 
-    bool hasAffObs = false;
-    double generatedValues[2];
-    for (int i = 0; i < 2; i++) {
-      const RooArgSet* toyData = dataset->get(i);
-      for (const auto& varAbs : *toyData) {
-        const auto var = static_cast<RooRealVar*>(varAbs);
-        if (TString(var->GetName()).Contains(aff_obs)) {
-          hasAffObs = true;
-          generatedValues[i] = var->getVal();
-          continue;
-        }
-      }
+    int iAffObs = -1;
+    for (int i = 0; i < obs.size(); i++) {
+      if (TString(obs.at(i)->GetName()).Contains(aff_obs)) iAffObs = i;
     }
 
     // check if they are the same, if so, fluctuate and regenerate
-    if (hasAffObs && generatedValues[0] == generatedValues[1]) {
-      delete dataset;
+    if (iAffObs >= 0 && toyObs[iAffObs * nToys] == toyObs[iAffObs * nToys + 1]) {
       TString dD_aff_var = *aff_var_it;
       dD_aff_var.ReplaceAll("kD", "dD");
 
@@ -229,25 +261,13 @@ RooDataSet* MethodPluginScan::generateToys(int nToys) {
 
       RooMsgService::instance().setStreamStatus(0, kFALSE);
       RooMsgService::instance().setStreamStatus(1, kFALSE);
-      dataset = w->pdf(pdfName)->generate(*w->set(obsName), nToys, RooFit::AutoBinned(false));
+      toyGenerator->generate(nToys, toyObs);
       RooMsgService::instance().setStreamStatus(0, kTRUE);
       RooMsgService::instance().setStreamStatus(1, kTRUE);
-      for (int i = 0; i < 2; i++) {
-        const RooArgSet* toyData = dataset->get(i);
-        for (const auto& varAbs : *toyData) {
-          const auto var = static_cast<RooRealVar*>(varAbs);
-          if (TString(var->GetName()).Contains(aff_obs)) {
-            generatedValues[i] = var->getVal();
-            continue;
-          }
-        }
-      }
-      std::cout << aff_obs << " NEW VALUES : toy 0: " << generatedValues[0] << " toy 1: " << generatedValues[1]
-                << std::endl;
+      std::cout << aff_obs << " NEW VALUES : toy 0: " << toyObs[iAffObs * nToys]
+                << " toy 1: " << toyObs[iAffObs * nToys + 1] << std::endl;
     }
   }
-
-  return dataset;
 }
 
 ///
@@ -278,10 +298,14 @@ RooDataSet* MethodPluginScan::generateToys(int nToys) {
 ///                 fitter object can compute some fit statistics for an entire
 ///                 1-CL scan.
 /// \param pb       A progress bar object used to print nice progress output.
+/// \param firstToy Index of the first toy, used to pick the matching background-only
+///                 toy of the CLs method when the toys of a scan point are split up.
+/// \param nToysRun Number of toys to run. Default (-1) is nToys. With --adaptivetoys,
+///                 this is the size of the batches of toys.
 /// \return         the p-value.
 ///
 void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, Fitter* f,
-                                       ProgressBar* pb) {
+                                       ProgressBar* pb, int firstToy, int nToysRun) {
   // Check inputs.
   assert(plhScan);
   assert(t);
@@ -302,6 +326,7 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
   // Set nuisances. This is the point in parameter space where
   // the toys need to be generated.
   Utils::setParameters(w, parsName, plhScan, true);
+  ToyRandom::setStream(id, firstToy, ToyRandom::kNuisances);
 
   // Kenzie-Cousins-Highland (randomize nuisance parameters within a uniform range)
   if (arg->isAction("uniform")) {
@@ -351,27 +376,42 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
   t->chi2minBkg = chi2minBkg;
 
   // Importance sampling
-  int nActualToys = nToys;
+  if (nToysRun < 0) nToysRun = nToys;
+  int nActualToys = nToysRun;
   if (arg->importance) {
     double plhPvalue = TMath::Prob(t->chi2min - t->chi2minGlobal, 1);
-    nActualToys = nToys * importance(plhPvalue);
-    if (pb) pb->skipSteps(nToys - nActualToys);
+    nActualToys = nToysRun * importance(plhPvalue);
+    if (pb) pb->skipSteps(nToysRun - nActualToys);
   }
 
-  // Draw all toy datasets in advance. This is much faster.
-  RooDataSet* toyDataSet = generateToys(nActualToys);
-  if (id == 0) BkgToys = new RooDataSet(*toyDataSet, "BkgToys");
+  // Adaptive toy counts: run further batches of toys until the p-value
+  // is known well enough, see getAdaptiveToyDecision(). The background-only
+  // toys of the CLs method are reused once the batches exceed them.
+  const bool adaptive = arg->adaptivetoys > 0;
+  const int nBatch = nActualToys;
+  const double bestfitpoint = adaptive && arg->teststatistic == 1 ? getBestFitPoint(scanpoint) : 0.;
+  Long64_t nAll = 0;
+  Long64_t nBetter = 0;
+
+  // Draw all toys of a batch in advance. This is much faster.
+  std::vector<double> toyObs;
+  generateToys(nBatch, toyObs, id, firstToy);
+  if (id == 0) {
+    bkgToys = toyObs;
+    nBkgToys = nBatch;
+  }
 
   for (int j = 0; j < nActualToys; j++) {
     // status bar
-    if (pb) pb->progress();
+    if (pb && j < nBatch) pb->progress();
 
     //
     // 1. Generate toys
     //    (or select the right one)
     //
-    const RooArgSet* toyData = toyDataSet->get(j);
-    Utils::setParameters(w, obsName, toyData);
+    if (j > 0 && j % nBatch == 0) generateToys(nBatch, toyObs, id, firstToy + j);
+    const int iBkgToy = adaptive && nBkgToys > 0 ? (firstToy + j) % nBkgToys : firstToy + j;
+    toyGenerator->setObservables(toyObs, nBatch, j % nBatch);
     t->storeObservables();
 
     //
@@ -395,7 +435,7 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
       t->chi2minBkgBkgToy = f->getChi2();
       chi2minBkgBkgToysvector.push_back(f->getChi2());
     } else {
-      t->chi2minBkgBkgToy = chi2minBkgBkgToysvector.size() <= j ? 0 : chi2minBkgBkgToysvector[j];
+      t->chi2minBkgBkgToy = chi2minBkgBkgToysvector.size() <= iBkgToy ? 0 : chi2minBkgBkgToysvector[iBkgToy];
     }
     // std::cout << id << "\t" << t->chi2minBkgBkgToy << std::endl;
 
@@ -407,14 +447,14 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
     if (f->getStatus() == 1) { f->fit(); }
     t->chi2minGlobalToy = f->getChi2();
     t->statusFree = f->getStatus();
-    t->scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
+    t->scanbest = par->getVal();
     t->storeParsFree();
     if (id == 0) {
       t->chi2minGlobalBkgToy = f->getChi2();
       chi2minGlobalBkgToysvector.push_back(f->getChi2());
       // std::cout << id << "\t" << t->chi2minGlobalBkgToy << std::endl;
     } else {
-      t->chi2minBkgBkgToy = chi2minBkgBkgToysvector.size() <= j ? 0 : chi2minBkgBkgToysvector[j];
+      t->chi2minBkgBkgToy = chi2minBkgBkgToysvector.size() <= iBkgToy ? 0 : chi2minBkgBkgToysvector[iBkgToy];
     }
     // std::cout << id << "\t" << t->chi2minGlobalBkgToy << std::endl;
 
@@ -422,9 +462,8 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
     // Bkg.1 generate bkg-only toys (for CLs method)
     //          (or select the right one)
     //
-    if (BkgToys) {
-      const RooArgSet* toyDataBkg = BkgToys->get(j);
-      Utils::setParameters(w, obsName, toyDataBkg);
+    if (iBkgToy < nBkgToys) {
+      toyGenerator->setObservables(bkgToys, nBkgToys, iBkgToy);
       // t->storeObservables();
     }
 
@@ -449,13 +488,31 @@ void MethodPluginScan::computePvalue1d(RooSlimFitResult* plhScan, double chi2min
     // 4. store
     //
     if (t->statusFree == 0) frCache.storeParsRoundRobin(w->set(parsName));
+    if (adaptive) {
+      // the same selection and test statistic as in collectToys()
+      double teststatMeasured = t->chi2min - t->chi2minGlobal;
+      double teststatToy = t->chi2minToy - t->chi2minGlobalToy;
+      if (arg->teststatistic == 1) {
+        teststatMeasured = bestfitpoint <= scanpoint ? teststatMeasured : 0.;
+        teststatToy = t->scanbest <= scanpoint ? teststatToy : 0.;
+      }
+      if (fabs(t->chi2minToy) < 500 && fabs(t->chi2minGlobalToy) < 500 && t->statusFree == 0 && t->statusScan == 0 &&
+          t->chi2minToy - t->chi2minGlobalToy >= 0) {
+        nAll++;
+        if (teststatToy > teststatMeasured) nBetter++;
+      }
+      t->adaptiveStop = -1;
+      if (j + 1 == nActualToys) {
+        t->adaptiveStop = getAdaptiveToyDecision(nActualToys, nAll, nBetter, t->adaptivePvalue, t->adaptivePvalueErr);
+        if (t->adaptiveStop == 0) nActualToys += nBatch;
+      }
+    }
     t->fill();
   }
 
   // clean up
-  Utils::setParameters(w, parsName, frCache.getParsAtFunctionCall());
+  frCache.getParsAtFunctionCall().restore();
   Utils::setParameters(w, obsName, obsDataset->get(0));
-  delete toyDataSet;
 }
 
 double MethodPluginScan::getPvalue1d(RooSlimFitResult* plhScan, double chi2minGlobal, ToyTree* t, int id, bool quiet) {
@@ -518,8 +575,9 @@ double MethodPluginScan::getPvalue1d(RooSlimFitResult* plhScan, double chi2minGl
 /// \param nRun Part of the root tree file name to facilitate parallel production.
 ///
 int MethodPluginScan::scan1d(int nRun) {
+  checkNotAdaptive(profileLH, "scan1d");
+  checkNotAdaptive(parevolPLH, "scan1d");
   Fitter* myFit = new Fitter(arg, w, combiner->getPdfName());
-  RooRandom::randomGenerator()->SetSeed(0);
 
   // Set limit to all parameters.
   combiner->loadParameterLimits();
@@ -554,33 +612,41 @@ int MethodPluginScan::scan1d(int nRun) {
   FitResultCache frCache(arg);
   frCache.storeParsAtFunctionCall(w->set(parsName));
 
+  // With --ncores, only the first scan point is done in this process. It provides
+  // the background-only toys of the CLs method to all others (see computePvalue1d()),
+  // which are then run by the toy farm.
+  const bool farm = arg->ncores > 1;
+  const int nPointsHere = farm ? 1 : nPoints1d;
+
   // for the progress bar: if more than 100 steps, show 50 status messages.
-  int allSteps = nPoints1d * nToys;
+  int allSteps = nPointsHere * nToys;
   ProgressBar* pb = new ProgressBar(arg, allSteps);
 
-  // start scan
-  if (arg->debug) std::cout << "MethodPluginScan::scan1d() : ";
-  std::cout << "PLUGIN scan starting ..." << std::endl;
-  for (int i = 0; i < nPoints1d; i++) {
+  // Run nToysRun toys at scan point i, starting with toy firstToy.
+  auto scanPoint = [&](int i, ProgressBar* pbPoint, int firstToy, int nToysRun) {
     double scanpoint = min + (max - min) * (double)i / nPoints1d + hCL->GetBinWidth(1) / 2.;
     t.scanpoint = scanpoint;
 
     // don't scan in unphysical region
-    if (scanpoint < par->getMin() || scanpoint > par->getMax()) continue;
+    if (scanpoint < par->getMin() || scanpoint > par->getMax()) return;
 
     // Get nuisances. This is the point in parameter space where
     // the toys need to be generated.
     RooSlimFitResult* plhScan = getParevolPoint(scanpoint);
 
     // do the work
-    computePvalue1d(plhScan, profileLH->getChi2minGlobal(), &t, i, myFit, pb);
+    computePvalue1d(plhScan, profileLH->getChi2minGlobal(), &t, i, myFit, pbPoint, firstToy, nToysRun);
 
     // reset
-    Utils::setParameters(w, parsName, frCache.getParsAtFunctionCall());
+    frCache.getParsAtFunctionCall().restore();
     Utils::setParameters(w, obsName, obsDataset->get(0));
-  }
+  };
+
+  // start scan
+  if (arg->debug) std::cout << "MethodPluginScan::scan1d() : ";
+  std::cout << "PLUGIN scan starting ..." << std::endl;
+  for (int i = 0; i < nPointsHere; i++) scanPoint(i, pb, 0, nToys);
 
-  if (arg->debug) myFit->print();
   TString dirname = "root/scan1dPlugin";
   if (arg->isAction("bb")) dirname += "BergerBoos";
   if (arg->isAction("uniform")) dirname += "Uniform";
@@ -592,19 +658,94 @@ int MethodPluginScan::scan1d(int nRun) {
   if (arg->isAction("uniform")) fname += "Uniform";
   if (arg->isAction("gaus")) fname += "Gaus";
   fname += Form("_" + name + "_" + scanVar1 + "_run%i.root", nRun);
-  t.writeToFile((dirname + fname).Data());
+
+  if (farm) {
+    // split the toys of each point such that there are a few units per worker
+    struct Unit {
+      int i;
+      int firstToy;
+      int nToys;
+    };
+    std::vector<Unit> units;
+    // adaptive toy counts need all toys of a point in one unit
+    const int nChunks = arg->adaptivetoys > 0 ? 1 : std::clamp(4 * arg->ncores / std::max(nPoints1d - 1, 1), 1, nToys);
+    for (int i = 1; i < nPoints1d; i++) {
+      for (int k = 0; k < nChunks; k++) {
+        const int firstToy = k * nToys / nChunks;
+        units.push_back({i, firstToy, (k + 1) * nToys / nChunks - firstToy});
+      }
+    }
+    runToyFarm(
+        units.size(),
+        [&](int iUnit) { scanPoint(units[iUnit].i, nullptr, units[iUnit].firstToy, units[iUnit].nToys); }, t,
+        dirname + fname);
+  } else {
+    if (arg->debug) myFit->print();
+    t.writeToFile((dirname + fname).Data());
+  }
   delete myFit;
   delete pb;
   return 0;
 }
 
+///
+/// Run the toys of a Plugin scan on --ncores local worker processes. The work is
+/// split into units, typically a scan point and a range of its toys. Workers take
+/// the next unit whenever they become free, so that slowly converging scan points
+/// don't hold up the others. Each worker writes its toys to a file of its own,
+/// and these are merged into a single file in the end, together with the toys
+/// already in t.
+///
+/// The toys of a work unit are drawn from the ToyRandom streams of its scan point
+/// and toys, so they don't depend on which worker runs them.
+///
+/// \param nUnits   Number of work units.
+/// \param runUnit  Function running the work unit iUnit, filling t.
+/// \param t        The ToyTree filled by runUnit.
+/// \param fileName Name of the merged output file.
+///
+void MethodPluginScan::runToyFarm(int nUnits, const std::function<void(int iUnit)>& runUnit, ToyTree& t,
+                                  const TString& fileName) {
+  const int nWorkers = std::max(1, std::min(arg->ncores, nUnits));
+  auto partName = [&](int iPart) { return Utils::forkPartFileName(fileName, iPart); };
+
+  // toys run before the farm started go into a part of their own,
+  // so that the workers don't write them again
+  std::vector<TString> parts;
+  if (t.GetEntries() > 0) {
+    parts.push_back(partName(nWorkers));
+    t.writeToFile(parts.back());
+    t.getTree()->Reset();
+  }
+
+  std::cout << "MethodPluginScan::runToyFarm() : running " << nUnits << " work units on " << nWorkers
+            << " processes ..." << std::endl;
+  ProgressBar pb(arg, nUnits);
+  const bool success = Utils::forkFor(
+      nWorkers, nUnits, [&](int iWorker, int iUnit) { runUnit(iUnit); },
+      [&](int iWorker) { t.writeToFile(partName(iWorker)); }, [&]() { pb.progress(); });
+  if (!success) {
+    std::cout << "MethodPluginScan::runToyFarm() : ERROR : a worker process failed. Exit." << std::endl;
+    std::exit(1);
+  }
+
+  // merge the parts into one file
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) parts.push_back(partName(iWorker));
+  if (!Utils::mergeForkParts(fileName, parts)) {
+    std::cout << "MethodPluginScan::runToyFarm() : ERROR : could not merge the worker files into " << fileName
+              << ". Exit." << std::endl;
+    std::exit(1);
+  }
+  std::cout << "MethodPluginScan::runToyFarm() : saved toys to: " << fileName << std::endl;
+}
+
 ///
 /// Perform the 2d Plugin scan.
 /// Saves chi2 values in a root tree, together with the full fit result for each toy.
 /// \param nRun Part of the root tree file name to facilitate parallel production.
 ///
 void MethodPluginScan::scan2d(int nRun) {
-  RooRandom::randomGenerator()->SetSeed(0);
+  checkNotAdaptive(profileLH, "scan2d");
 
   // Set limit to all parameters.
   combiner->loadParameterLimits();
@@ -646,9 +787,23 @@ void MethodPluginScan::scan2d(int nRun) {
   FitResultCache frCache(arg);
   frCache.storeParsAtFunctionCall(w->set(parsName));
 
-  // for the status bar
+  // for the status bar (the toy farm has its own)
   int allSteps = nPoints2dx * nPoints2dy * nToys;
-  ProgressBar* pb = new ProgressBar(arg, allSteps);
+  ProgressBar* pb = arg->ncores > 1 ? nullptr : new ProgressBar(arg, allSteps);
+
+  // output file
+  TString dirname = "root/scan2dPlugin";
+  if (arg->isAction("bb")) dirname += "BergerBoos";
+  if (arg->isAction("uniform")) dirname += "Uniform";
+  if (arg->isAction("gaus")) dirname += "Gaus";
+  dirname += "_" + name + "_" + scanVar1 + "_" + scanVar2;
+  system("mkdir -p " + dirname);
+  TString fname = "/scan2dPlugin";
+  if (arg->isAction("bb")) fname += "BergerBoos";
+  if (arg->isAction("uniform")) fname += "Uniform";
+  if (arg->isAction("gaus")) fname += "Gaus";
+  fname += Form("_" + name + "_" + scanVar1 + "_" + scanVar2 + "_run%i.root", nRun);
+  const TString fileName = dirname + fname;
 
   // limit number of warnings
   int nWarnExtPointDiffer = 0;
@@ -658,211 +813,391 @@ void MethodPluginScan::scan2d(int nRun) {
   // 1. assume we have already the global minimum
   //
 
-  // start scan
-  std::cout << "MethodPluginScan::scan2d() : starting ..." << std::endl;
-  for (int i1 = 0; i1 < nPoints2dx; i1++) {
-    for (int i2 = 0; i2 < nPoints2dy; i2++) {
-      double scanpoint1 = min1 + (max1 - min1) * (double)i1 / nPoints2dx + hCL2d->GetXaxis()->GetBinWidth(1) / 2.;
-      double scanpoint2 = min2 + (max2 - min2) * (double)i2 / nPoints2dy + hCL2d->GetYaxis()->GetBinWidth(1) / 2.;
-      t.scanpoint = scanpoint1;
-      t.scanpointy = scanpoint2;
-
-      // don't scan in unphysical region
-      if (scanpoint1 < par1->getMin() || scanpoint1 > par1->getMax()) continue;
-      if (scanpoint2 < par2->getMin() || scanpoint2 > par2->getMax()) continue;
-
-      // Get the global chi2 minimum from the fit to data.
-      t.chi2minGlobal = profileLH->getChi2minGlobal();
-
-      // Get nuisances. This is the point in parameter space where
-      // the toys need to be generated.
-      RooArgList* extCurveResult = 0;
-      {
-        int iCurveRes1 = profileLH->getHCL2d()->GetXaxis()->FindBin(scanpoint1) - 1;
-        int iCurveRes2 = profileLH->getHCL2d()->GetYaxis()->FindBin(scanpoint2) - 1;
-        if (!profileLH->curveResults2d[iCurveRes1][iCurveRes2]) {
-          printf("MethodPluginScan::scan2d() : WARNING : curve result not found, "
+  // Run nToysPoint toys at scan point (i1, i2), starting with toy firstToy.
+  auto scanPoint = [&](int i1, int i2, int firstToy, int nToysPoint) {
+    const int point = i1 * nPoints2dy + i2;
+    double scanpoint1 = min1 + (max1 - min1) * (double)i1 / nPoints2dx + hCL2d->GetXaxis()->GetBinWidth(1) / 2.;
+    double scanpoint2 = min2 + (max2 - min2) * (double)i2 / nPoints2dy + hCL2d->GetYaxis()->GetBinWidth(1) / 2.;
+    t.scanpoint = scanpoint1;
+    t.scanpointy = scanpoint2;
+
+    // don't scan in unphysical region
+    if (scanpoint1 < par1->getMin() || scanpoint1 > par1->getMax()) return;
+    if (scanpoint2 < par2->getMin() || scanpoint2 > par2->getMax()) return;
+
+    // Get the global chi2 minimum from the fit to data.
+    t.chi2minGlobal = profileLH->getChi2minGlobal();
+
+    // Get nuisances. This is the point in parameter space where
+    // the toys need to be generated.
+    RooArgList* extCurveResult = 0;
+    {
+      int iCurveRes1 = profileLH->getHCL2d()->GetXaxis()->FindBin(scanpoint1) - 1;
+      int iCurveRes2 = profileLH->getHCL2d()->GetYaxis()->FindBin(scanpoint2) - 1;
+      if (!profileLH->curveResults2d[iCurveRes1][iCurveRes2]) {
+        printf("MethodPluginScan::scan2d() : WARNING : curve result not found, "
+               "id=[%i,%i], val=[%f,%f]\n",
+               iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
+      } else {
+        if (arg->debug) {
+          printf("MethodPluginScan::scan2d() : loading start parameters from external 1-CL curve: "
                  "id=[%i,%i], val=[%f,%f]\n",
                  iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
-        } else {
-          if (arg->debug) {
-            printf("MethodPluginScan::scan2d() : loading start parameters from external 1-CL curve: "
-                   "id=[%i,%i], val=[%f,%f]\n",
-                   iCurveRes1, iCurveRes2, scanpoint1, scanpoint2);
+        }
+        extCurveResult = new RooArgList(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal());
+
+        // Set nuisances. This is the point in parameter space where
+        // the toys need to be generated.
+        Utils::setParameters(w, parsName, extCurveResult);
+        ToyRandom::setStream(point, firstToy, ToyRandom::kNuisances);
+
+        // Kenzie-Cousins-Highland (randomize nuisance parameters within a uniform range)
+        if (arg->isAction("uniform")) {
+          // set parameter ranges to their bb range (should be something wide 95, 99% CL)
+          const RooArgSet* pars = w->set(toysName) ? w->set(toysName) : w->set(parsName);
+          for (const auto& par : *pars) { Utils::setLimit(static_cast<RooRealVar*>(par), "bboos"); }
+          if (verbose) {
+            std::cout << "Uniform generating from:" << std::endl;
+            pars->Print("v");
           }
-          extCurveResult = new RooArgList(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal());
-
-          // Set nuisances. This is the point in parameter space where
-          // the toys need to be generated.
-          Utils::setParameters(w, parsName, extCurveResult);
-
-          // Kenzie-Cousins-Highland (randomize nuisance parameters within a uniform range)
-          if (arg->isAction("uniform")) {
-            // set parameter ranges to their bb range (should be something wide 95, 99% CL)
-            const RooArgSet* pars = w->set(toysName) ? w->set(toysName) : w->set(parsName);
-            for (const auto& par : *pars) { Utils::setLimit(static_cast<RooRealVar*>(par), "bboos"); }
-            if (verbose) {
-              std::cout << "Uniform generating from:" << std::endl;
-              pars->Print("v");
-            }
-            Utils::randomizeParameters(w, parsName);
-            if (verbose) {
-              std::cout << "Set:" << std::endl;
-              w->set(parsName)->Print("v");
-            }
+          Utils::randomizeParameters(w, parsName);
+          if (verbose) {
+            std::cout << "Set:" << std::endl;
+            w->set(parsName)->Print("v");
           }
+        }
 
-          // Cousins-Highland (randomize nuisance parameters according to a Gaussian with their
-          // best fit value and uncertainty from the PLH scan)
-          if (arg->isAction("gaus")) {
-            if (verbose) {
-              std::cout << "Gaussian generating from:" << std::endl;
-              profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal().Print("v");
-            }
-            Utils::randomizeParametersGaussian(w, toysName, profileLH->curveResults2d[iCurveRes1][iCurveRes2]);
-            if (verbose) {
-              std::cout << "Set:" << std::endl;
-              w->set(parsName)->Print("v");
-            }
+        // Cousins-Highland (randomize nuisance parameters according to a Gaussian with their
+        // best fit value and uncertainty from the PLH scan)
+        if (arg->isAction("gaus")) {
+          if (verbose) {
+            std::cout << "Gaussian generating from:" << std::endl;
+            profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal().Print("v");
+          }
+          Utils::randomizeParametersGaussian(w, toysName, profileLH->curveResults2d[iCurveRes1][iCurveRes2]);
+          if (verbose) {
+            std::cout << "Set:" << std::endl;
+            w->set(parsName)->Print("v");
           }
+        }
 
-          t.chi2min = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->minNll();
-
-          // check if the scan variable here differs from that of
-          // the external curve
-          RooArgList list = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal();
-          list.add(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->constPars());
-          RooRealVar* var1 = (RooRealVar*)list.find(scanVar1);
-          RooRealVar* var2 = (RooRealVar*)list.find(scanVar2);
-          if (var1 && var2) {
-            // print warnings
-            if (fabs((scanpoint1 - var1->getVal()) / scanpoint1) > 0.01 ||
-                fabs((scanpoint2 - var2->getVal()) / scanpoint2) > 0.01) {
-              if (nWarnExtPointDiffer < nWarnExtPointDifferMax || arg->debug) {
-                if (fabs((scanpoint1 - var1->getVal()) / scanpoint1) > 0.01)
-                  std::cout
-                      << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: "
-                      << "scanpoint1=" << scanpoint1 << " var1=" << var1->getVal() << std::endl;
-                if (fabs((scanpoint2 - var2->getVal()) / scanpoint2) > 0.01)
-                  std::cout
-                      << "MethodPluginScan::scan2d() : WARNING : scanpoint2 and external point differ by more than 1%: "
-                      << "scanpoint2=" << scanpoint2 << " var2=" << var2->getVal() << std::endl;
-              }
-              if (nWarnExtPointDiffer == 0) {
-                std::cout << std::endl;
-                std::cout << "                                       Try using the same number of scan points for both "
-                             "Plugin and Prob."
-                          << std::endl;
-                std::cout
-                    << "                                       See --npoints, --npoints2dx, --npoints2dy, --npointstoy"
-                    << std::endl;
-                std::cout << std::endl;
-              }
-              if (nWarnExtPointDiffer == nWarnExtPointDifferMax) {
+        t.chi2min = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->minNll();
+
+        // check if the scan variable here differs from that of
+        // the external curve
+        RooArgList list = profileLH->curveResults2d[iCurveRes1][iCurveRes2]->floatParsFinal();
+        list.add(profileLH->curveResults2d[iCurveRes1][iCurveRes2]->constPars());
+        RooRealVar* var1 = (RooRealVar*)list.find(scanVar1);
+        RooRealVar* var2 = (RooRealVar*)list.find(scanVar2);
+        if (var1 && var2) {
+          // print warnings
+          if (fabs((scanpoint1 - var1->getVal()) / scanpoint1) > 0.01 ||
+              fabs((scanpoint2 - var2->getVal()) / scanpoint2) > 0.01) {
+            if (nWarnExtPointDiffer < nWarnExtPointDifferMax || arg->debug) {
+              if (fabs((scanpoint1 - var1->getVal()) / scanpoint1) > 0.01)
                 std::cout
                     << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: "
-                       "[further warnings suppressed.]"
-                    << std::endl;
-              }
-              nWarnExtPointDiffer++;
+                    << "scanpoint1=" << scanpoint1 << " var1=" << var1->getVal() << std::endl;
+              if (fabs((scanpoint2 - var2->getVal()) / scanpoint2) > 0.01)
+                std::cout
+                    << "MethodPluginScan::scan2d() : WARNING : scanpoint2 and external point differ by more than 1%: "
+                    << "scanpoint2=" << scanpoint2 << " var2=" << var2->getVal() << std::endl;
+            }
+            if (nWarnExtPointDiffer == 0) {
+              std::cout << std::endl;
+              std::cout << "                                       Try using the same number of scan points for both "
+                           "Plugin and Prob."
+                        << std::endl;
+              std::cout
+                  << "                                       See --npoints, --npoints2dx, --npoints2dy, --npointstoy"
+                  << std::endl;
+              std::cout << std::endl;
             }
-          } else {
-            std::cout << "MethodPluginScan::scan2d() : WARNING : variable 1 or 2 not found"
-                         ", var1="
-                      << scanVar1 << ", var2=" << scanVar1 << std::endl;
-            std::cout << "MethodPluginScan::scan2d() : Printout follows:" << std::endl;
-            profileLH->curveResults2d[iCurveRes1][iCurveRes2]->Print();
-            std::exit(1);
+            if (nWarnExtPointDiffer == nWarnExtPointDifferMax) {
+              std::cout
+                  << "MethodPluginScan::scan2d() : WARNING : scanpoint1 and external point differ by more than 1%: "
+                     "[further warnings suppressed.]"
+                  << std::endl;
+            }
+            nWarnExtPointDiffer++;
           }
+        } else {
+          std::cout << "MethodPluginScan::scan2d() : WARNING : variable 1 or 2 not found"
+                       ", var1="
+                    << scanVar1 << ", var2=" << scanVar1 << std::endl;
+          std::cout << "MethodPluginScan::scan2d() : Printout follows:" << std::endl;
+          profileLH->curveResults2d[iCurveRes1][iCurveRes2]->Print();
+          std::exit(1);
         }
       }
+    }
+
+    // set and fix scan point
+    par1->setVal(scanpoint1);
+    par2->setVal(scanpoint2);
+    par1->setConstant(true);
+    par2->setConstant(true);
+
+    // save nuisances to ToyTree tree
+    t.storeParsPll();
+    t.storeTheory();
+
+    // Draw toys in advance. This is much faster.
+    std::vector<double> toyObs;
+    generateToys(nToysPoint, toyObs, point, firstToy);
+
+    // the -2logL and minimizer of the combination serve all toy fits
+    NllMinimizer* nll = combiner->getNllMinimizer();
+
+    for (int j = 0; j < nToysPoint; j++) {
+      // status bar
+      if (pb) pb->progress();
+
+      //
+      // 1. Load toy dataset
+      //
+      toyGenerator->setObservables(toyObs, nToysPoint, j);
+      t.storeObservables();
 
-      // set and fix scan point
+      //
+      // 2. scan fit
+      //
       par1->setVal(scanpoint1);
       par2->setVal(scanpoint2);
       par1->setConstant(true);
       par2->setConstant(true);
+      RooFitResult* r;
+      if (!arg->scanforce)
+        r = Utils::fitToMinBringBackAngles(nll, false, -1);
+      else
+        r = Utils::fitToMinForce(w, nll, name, "", true, arg->getForceConfig());
+      t.chi2minToy = r->minNll();
+      t.statusScan = 0;
+      t.storeParsScan();
+      delete r;
+
+      //
+      // 3. free fit
+      //
+      par1->setVal(scanpoint1);
+      par2->setVal(scanpoint2);
+      par1->setConstant(false);
+      par2->setConstant(false);
+      if (!arg->scanforce)
+        r = Utils::fitToMinBringBackAngles(nll, false, -1);
+      else
+        r = Utils::fitToMinForce(w, nll, name, "", true, arg->getForceConfig());
+      t.chi2minGlobalToy = r->minNll();
+      t.statusFree = 0;
+      t.scanbest = par1->getVal();
+      t.scanbesty = par2->getVal();
+      t.storeParsFree();
+      delete r;
+
+      //
+      // 4. store
+      //
+      t.fill();
+    }
 
-      // save nuisances to ToyTree tree
-      t.storeParsPll();
-      t.storeTheory();
-
-      // Draw toy datasets in advance. This is much faster.
-      RooDataSet* toyDataSet = generateToys(nToys);
-
-      for (int j = 0; j < nToys; j++) {
-        // status bar
-        pb->progress();
-
-        //
-        // 1. Load toy dataset
-        //
-        const RooArgSet* toyData = toyDataSet->get(j);
-        Utils::setParameters(w, obsName, toyData);
-        t.storeObservables();
-
-        //
-        // 2. scan fit
-        //
-        par1->setVal(scanpoint1);
-        par2->setVal(scanpoint2);
-        par1->setConstant(true);
-        par2->setConstant(true);
-        RooFitResult* r;
-        if (!arg->scanforce)
-          r = Utils::fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
-        else
-          r = Utils::fitToMinForce(w, name);
-        t.chi2minToy = r->minNll();
-        t.statusScan = 0;
-        t.storeParsScan();
-        delete r;
-
-        //
-        // 3. free fit
-        //
-        par1->setVal(scanpoint1);
-        par2->setVal(scanpoint2);
-        par1->setConstant(false);
-        par2->setConstant(false);
-        if (!arg->scanforce)
-          r = Utils::fitToMinBringBackAngles(w->pdf(pdfName), false, -1);
-        else
-          r = Utils::fitToMinForce(w, name);
-        t.chi2minGlobalToy = r->minNll();
-        t.statusFree = 0;
-        t.scanbest = ((RooRealVar*)w->set(parsName)->find(scanVar1))->getVal();
-        t.scanbesty = ((RooRealVar*)w->set(parsName)->find(scanVar2))->getVal();
-        t.storeParsFree();
-        delete r;
-
-        //
-        // 4. store
-        //
-        t.fill();
+    // reset
+    frCache.getParsAtFunctionCall().restore();
+    Utils::setParameters(w, obsName, obsDataset->get(0));
+  };
+
+  // start scan
+  std::cout << "MethodPluginScan::scan2d() : starting ..." << std::endl;
+  if (arg->ncores > 1) {
+    struct Unit {
+      int i1;
+      int i2;
+      int firstToy;
+      int nToys;
+    };
+    std::vector<Unit> units;
+    const int nChunks = std::clamp(4 * arg->ncores / (nPoints2dx * nPoints2dy), 1, nToys);
+    for (int i1 = 0; i1 < nPoints2dx; i1++) {
+      for (int i2 = 0; i2 < nPoints2dy; i2++) {
+        for (int k = 0; k < nChunks; k++) {
+          const int firstToy = k * nToys / nChunks;
+          units.push_back({i1, i2, firstToy, (k + 1) * nToys / nChunks - firstToy});
+        }
       }
+    }
+    runToyFarm(
+        units.size(),
+        [&](int iUnit) { scanPoint(units[iUnit].i1, units[iUnit].i2, units[iUnit].firstToy, units[iUnit].nToys); }, t,
+        fileName);
+  } else {
+    for (int i1 = 0; i1 < nPoints2dx; i1++) {
+      for (int i2 = 0; i2 < nPoints2dy; i2++) scanPoint(i1, i2, 0, nToys);
+    }
+    t.writeToFile(fileName);
+  }
+
+  delete pb;
+}
+
+///
+/// Get the best fit value of the scan parameter, which is used by the
+/// one-sided test statistic.
+///
+/// \param fallback Value to use if there is no solution.
+///
+double MethodPluginScan::getBestFitPoint(double fallback) {
+  if (!getSolution()) {
+    std::cout << "WARNING: No solution found, will approximate to the best scan point" << std::endl;
+    return fallback;
+  }
+  double bestfitpoint = getSolution()->getFloatParFinalVal(scanVar1);
+  if (std::isnan(bestfitpoint)) bestfitpoint = getSolution()->getConstParVal(scanVar1);
+  if (std::isnan(bestfitpoint)) bestfitpoint = fallback;
+  return bestfitpoint;
+}
+
+///
+/// Collect the statistics of toys that were written either by a scan
+/// or a by getPvalue(), which are then analysed by analyseToys().
+///
+/// The toys of a chain are read on --nthreads threads, in ranges of entries that
+/// don't cross file boundaries. Each thread reads its own copy of the chain, and
+/// the statistics of the ranges are added up for each file in the order of the
+/// entries. The ranges have a fixed size, so that the result, including the
+/// sketches of the test statistics, doesn't depend on the number of threads.
+///
+/// \param t            A ToyTree set up for reading (open() was called).
+/// \param id           Only consider entries that have the id branch set to this value.
+///                     Use -1 to consider all entries regardless of their id.
+/// \param bestfitpoint Best fit value of the scan parameter, see getBestFitPoint().
+/// \param quiet        Don't print the progress.
+/// \param nThreads     Number of threads, 0 for --nthreads.
+/// \return             The statistics of each file of the chain, or a single one if t
+///                     doesn't hold a chain.
+///
+std::vector<ToyFileStats> MethodPluginScan::collectToys(ToyTree* t, int id, double bestfitpoint, bool quiet,
+                                                        int nThreads) {
+  Long64_t nentries = t->GetEntries();
+  t->activateCoreBranchesOnly();  // speeds up the event loop
+  ProgressBar* pb = nullptr;
+  if (!quiet) pb = new ProgressBar(arg, nentries);
+  if (arg->debug) std::cout << "MethodPluginScan::collectToys() : ";
+  if (!quiet) std::cout << "building p-value histogram ..." << std::endl;
 
-      // reset
-      Utils::setParameters(w, parsName, frCache.getParsAtFunctionCall());
-      Utils::setParameters(w, obsName, obsDataset->get(0));
-      delete toyDataSet;
+  struct Range {
+    Long64_t begin;
+    Long64_t end;
+    int iFile;
+  };
+  const auto chain = dynamic_cast<TChain*>(t->getTree());
+  const int nFiles = chain ? chain->GetNtrees() : 1;
+  if (nThreads <= 0) nThreads = arg->nthreads;
+  const int nWorkers = chain && combiner && nentries > 0 ? std::max(nThreads, 1) : 1;
+  const Long64_t maxRange = 10000;
+  std::vector<Range> ranges;
+  for (int iFile = 0; iFile < nFiles; iFile++) {
+    const Long64_t first = chain ? chain->GetTreeOffset()[iFile] : 0;
+    const Long64_t last = chain ? chain->GetTreeOffset()[iFile + 1] : nentries;
+    for (Long64_t begin = first; begin < last; begin += maxRange) {
+      ranges.push_back({begin, std::min(begin + maxRange, last), iFile});
     }
   }
 
-  // save tree
-  TString dirname = "root/scan2dPlugin";
-  if (arg->isAction("bb")) dirname += "BergerBoos";
-  if (arg->isAction("uniform")) dirname += "Uniform";
-  if (arg->isAction("gaus")) dirname += "Gaus";
-  dirname += "_" + name + "_" + scanVar1 + "_" + scanVar2;
-  system("mkdir -p " + dirname);
-  TString fname = "/scan2dPlugin";
-  if (arg->isAction("bb")) fname += "BergerBoos";
-  if (arg->isAction("uniform")) fname += "Uniform";
-  if (arg->isAction("gaus")) fname += "Gaus";
-  fname += Form("_" + name + "_" + scanVar1 + "_" + scanVar2 + "_run%i.root", nRun);
-  t.writeToFile((dirname + fname).Data());
+  std::vector<ToyTree*> readers = {t};
+  std::vector<std::unique_ptr<TChain>> chains;
+  std::vector<std::unique_ptr<ToyTree>> toyTrees;
+  for (int iWorker = 1; iWorker < nWorkers; iWorker++) {
+    chains.push_back(std::make_unique<TChain>(chain->GetName()));
+    for (const auto element : *chain->GetListOfFiles()) {
+      chains.back()->Add(element->GetTitle(), static_cast<TChainElement*>(element)->GetEntries());
+    }
+    toyTrees.push_back(std::make_unique<ToyTree>(combiner, chains.back().get(), true));
+    toyTrees.back()->open();
+    toyTrees.back()->activateCoreBranchesOnly();
+    readers.push_back(toyTrees.back().get());
+  }
+  std::vector<ToyFileStats> rangeStats(ranges.size());
+  std::mutex progressMutex;
+
+  Utils::parallelFor(nWorkers, ranges.size(), [&](int iWorker, int iRange) {
+    ToyTree* tt = readers[iWorker];
+    ToyFileStats& stats = rangeStats[iRange];
+    const Range& range = ranges[iRange];
+    stats.nEntries = range.end - range.begin;
+    for (Long64_t i = range.begin; i < range.end; i++) {
+      if (pb && nWorkers == 1) pb->progress();
+      tt->GetEntry(i);
+
+      if (arg->debug && i % 1000 == 0) {
+        std::cout << tt->chi2minGlobalToy << "\t" << tt->chi2minToy << "\t" << tt->chi2min << "\t" << tt->scanpoint
+                  << std::endl;
+        std::cout << tt->chi2minGlobalBkgToy << "\t" << tt->chi2minBkgBkgToy << "\t" << tt->chi2minBkg << "\t"
+                  << tt->scanpoint << std::endl;
+      }
+      // every scan point enters the binning, see ToyTree::computeMinMaxN()
+      ToyPointStats& point = stats.points[tt->scanpoint];
+      if (id != -1 && fabs(tt->id - id) > 0.001) continue;  ///< only select entries with given id (unless id==-1)
+      stats.nSelected++;
+
+      // apply cuts
+      if (!(fabs(tt->chi2minToy) < 500 && fabs(tt->chi2minGlobalToy) < 500 && tt->statusFree == 0. &&
+            tt->statusScan == 0.)) {
+        stats.nFailed++;
+        continue;
+      }
+
+      // toys from a wrong run
+      if (id != -1 && !(fabs(tt->chi2minGlobal - chi2minGlobal) < 0.2)) { stats.nWrongRun++; }
+
+      // use profile likelihood from internal scan, not the one found in the root files
+      if (arg->intprob) { tt->chi2min = profileLH->getChi2min(tt->scanpoint); }
+
+      // Check if toys are in physical region.
+      // Don't enforce t.chi2min-t.chi2minGlobal>0, else it can be hard because due
+      // to little fluctuaions the best fit point can be missing from the plugin plot...
+      bool inPhysicalRegion = tt->chi2minToy - tt->chi2minGlobalToy >= 0;  //&& t.chi2min-t.chi2minGlobal>0
+
+      // use the unphysical events to estimate background (be careful with this,
+      // at least inspect the control plots to judge if this can be at all reasonable)
+      if (!inPhysicalRegion) {
+        point.nBackground++;
+        continue;
+      }
+
+      // build test statistics
+      // chi2minBkgBkgToy is the best fit of the bkg pdf of bkg-only toy, chi2minGlobalBkgToy is the best global fit of
+      // the bkg-only toy chi2minBkgToy is the best fit at scanpoint of bkg-only toy
+      double teststat_measured = tt->chi2min - tt->chi2minGlobal;
+      double sb_teststat_toy = tt->chi2minToy - tt->chi2minGlobalToy;
+      double b_teststat_toy = tt->chi2minBkgToy - tt->chi2minGlobalBkgToy;
+      if (arg->teststatistic == 1) {                                                 // use one-sided test statistic
+        teststat_measured = bestfitpoint <= tt->scanpoint ? teststat_measured : 0.;  // if mu < muhat then q_mu = 0
+        sb_teststat_toy = tt->scanbest <= tt->scanpoint ? sb_teststat_toy : 0.;      // if mu < muhat then q_mu = 0
+        b_teststat_toy = tt->scanbestBkg <= tt->scanpoint ? b_teststat_toy : 0.;     // if mu < muhat then q_mu = 0
+      }
+      // the usage of the two-sided test statistic is default
+
+      if (sb_teststat_toy > teststat_measured) point.nBetter++;
+      if (b_teststat_toy > teststat_measured) point.nBetterClb++;
+      // goodness-of-fit
+      if (tt->chi2minGlobalToy > tt->chi2minGlobal) point.nGof++;
+      point.nAll++;
+      point.sbTestStat.add(sb_teststat_toy);
+      point.bTestStat.add(b_teststat_toy);
+    }
+    if (pb && nWorkers > 1) {
+      std::lock_guard<std::mutex> lock(progressMutex);
+      for (Long64_t i = range.begin; i < range.end; i++) pb->progress();
+    }
+  });
+
+  std::vector<ToyFileStats> stats(nFiles);
+  for (size_t iRange = 0; iRange < ranges.size(); iRange++) {
+    stats[ranges[iRange].iFile].add(rangeStats[iRange]);
+    rangeStats[iRange] = ToyFileStats();  // free the memory early
+  }
+  t->activateAllBranches();
   delete pb;
+  return stats;
 }
 
 ///
@@ -879,15 +1214,37 @@ void MethodPluginScan::scan2d(int nRun) {
 /// \return     A new histogram that contains the p-values vs the scanpoint.
 ///
 TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
+  // if there is no solution, the first scan point is used as best fit point
+  const double bestfitpoint = getBestFitPoint(t->getScanpointMin());
+  const std::vector<ToyFileStats> stats = collectToys(t, id, bestfitpoint, quiet);
+  std::vector<const ToyFileStats*> statsPtrs;
+  for (const auto& s : stats) statsPtrs.push_back(&s);
+  return analyseToys(statsPtrs, t->getScanpointMin(), t->getScanpointMax(), t->getScanpointN(), id, quiet);
+}
+
+///
+/// Analyse the statistics of toys collected by collectToys(). Create a
+/// histogram of p-values vs scanpoints with one bin per scanpoint, and
+/// fill the CLs histograms.
+///
+/// \param stats        Statistics of the toys, e.g. of each toy file.
+/// \param scanpointMin Smallest scanpoint.
+/// \param scanpointMax Largest scanpoint.
+/// \param scanpointN   Number of scanpoints.
+/// \param id           The id the statistics were collected for, -1 for all toys.
+/// \return             A new histogram that contains the p-values vs the scanpoint.
+///
+TH1F* MethodPluginScan::analyseToys(const std::vector<const ToyFileStats*>& stats, float scanpointMin,
+                                    float scanpointMax, int scanpointN, int id, bool quiet) {
   /// \todo replace this such that there's always one bin per scan point, but still the range is the scan range.
   /// \todo Also, if we use the min/max from the tree, we have the problem that they are not exactly
   /// the scan range, so that the axis won't show the lowest and highest number.
   /// \todo If the scan range was changed after the toys were generate, we absolutely have
   /// to derive the range from the root files - else we'll have bining effects.
-  double halfBinWidth = (t->getScanpointMax() - t->getScanpointMin()) / (float)t->getScanpointN() / 2.;
-  if (t->getScanpointN() == 1) halfBinWidth = 1.;
-  TH1F* hCL = new TH1F(Utils::getUniqueRootName(), "hCL", t->getScanpointN(), t->getScanpointMin() - halfBinWidth,
-                       t->getScanpointMax() + halfBinWidth);
+  double halfBinWidth = (scanpointMax - scanpointMin) / (float)scanpointN / 2.;
+  if (scanpointN == 1) halfBinWidth = 1.;
+  TH1F* hCL = new TH1F(Utils::getUniqueRootName(), "hCL", scanpointN, scanpointMin - halfBinWidth,
+                       scanpointMax + halfBinWidth);
   TH1F* h_better = (TH1F*)hCL->Clone("h_better");
   // histogram to store number of toys which enter CLb p Value calculation
   TH1F* h_better_clb = (TH1F*)hCL->Clone("h_better_clb");
@@ -897,120 +1254,40 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
   TH1F* h_background = (TH1F*)hCL->Clone("h_background");
   TH1F* h_gof = (TH1F*)hCL->Clone("h_gof");
 
-  // map of vectors for CLb quantiles
-  std::map<int, std::vector<double>> sampledSchi2Values;
-  std::map<int, std::vector<double>> sampledBValues;
-  std::map<int, std::vector<double>> sampledSBValues;
+  // distributions of the test statistics for CLb quantiles
+  std::map<int, QuantileSketch> sampledSchi2Values;
+  std::map<int, QuantileSketch> sampledBValues;
 
-  Long64_t nentries = t->GetEntries();
+  Long64_t nentries = 0;
   Long64_t nfailed = 0;
   Long64_t nwrongrun = 0;
   Long64_t ntoysid = 0;  // if id is not -1, this will count the number of toys with that id
-
-  t->activateCoreBranchesOnly();  // speeds up the event loop
-  ProgressBar* pb = nullptr;
-  if (!quiet) pb = new ProgressBar(arg, nentries);
-  if (arg->debug) std::cout << "MethodPluginScan::analyseToys() : ";
-  if (!quiet) std::cout << "building p-value histogram ..." << std::endl;
-
-  for (Long64_t i = 0; i < nentries; i++) {
-    if (!quiet) pb->progress();
-    t->GetEntry(i);
-
-    if (arg->debug && i % 1000 == 0) {
-      std::cout << t->chi2minGlobalToy << "\t" << t->chi2minToy << "\t" << t->chi2min << "\t" << t->scanpoint
-                << std::endl;
-      std::cout << t->chi2minGlobalBkgToy << "\t" << t->chi2minBkgBkgToy << "\t" << t->chi2minBkg << "\t"
-                << t->scanpoint << std::endl;
-    }
-    if (id != -1 && fabs(t->id - id) > 0.001) continue;  ///< only select entries with given id (unless id==-1)
-    ntoysid++;
-
-    // apply cuts
-    if (!(fabs(t->chi2minToy) < 500 && fabs(t->chi2minGlobalToy) < 500 && t->statusFree == 0. && t->statusScan == 0.)) {
-      nfailed++;
-      continue;
-    }
-
-    // toys from a wrong run
-    if (id != -1 && !(fabs(t->chi2minGlobal - chi2minGlobal) < 0.2)) { nwrongrun++; }
-
-    // Cut away toys outside a certain range. This is needed to remove
-    // low statistics spikes to get publication quality log plots.
-    // Also check line 272 in ToyTree.cpp.
-    if (arg->pluginPlotRangeMin != arg->pluginPlotRangeMax &&
-        !(arg->pluginPlotRangeMin < t->scanpoint && t->scanpoint < arg->pluginPlotRangeMax))
-      continue;
-
-    // use profile likelihood from internal scan, not the one found in the root files
-    if (arg->intprob) { t->chi2min = profileLH->getChi2min(t->scanpoint); }
-
-    // Check if toys are in physical region.
-    // Don't enforce t.chi2min-t.chi2minGlobal>0, else it can be hard because due
-    // to little fluctuaions the best fit point can be missing from the plugin plot...
-    bool inPhysicalRegion = t->chi2minToy - t->chi2minGlobalToy >= 0;  //&& t.chi2min-t.chi2minGlobal>0
-    int iBinBestFit = hCL->GetMaximumBin();
-    double bestfitpoint = hCL->GetBinCenter(iBinBestFit);
-    if (getSolution()) {
-      bestfitpoint = getSolution()->getFloatParFinalVal(scanVar1);
-      if (std::isnan(bestfitpoint)) {
-        bestfitpoint = getSolution()->getConstParVal(scanVar1);
-        if (std::isnan(bestfitpoint)) { bestfitpoint = hCL->GetBinCenter(iBinBestFit); }
-      }
-    } else
-      std::cout << "WARNING: No solution found, will approximate to the best scan point" << std::endl;
-
-    // build test statistics
-    // chi2minBkgBkgToy is the best fit of the bkg pdf of bkg-only toy, chi2minGlobalBkgToy is the best global fit of
-    // the bkg-only toy chi2minBkgToy is the best fit at scanpoint of bkg-only toy
-    double teststat_measured = t->chi2min - t->chi2minGlobal;
-    double sb_teststat_toy = t->chi2minToy - t->chi2minGlobalToy;
-    double b_teststat_toy = t->chi2minBkgToy - t->chi2minGlobalBkgToy;
-    if (arg->teststatistic == 1) {                                                // use one-sided test statistic
-      teststat_measured = bestfitpoint <= t->scanpoint ? teststat_measured : 0.;  // if mu < muhat then q_mu = 0
-      sb_teststat_toy = t->scanbest <= t->scanpoint ? sb_teststat_toy : 0.;       // if mu < muhat then q_mu = 0
-      b_teststat_toy = t->scanbestBkg <= t->scanpoint ? b_teststat_toy : 0.;      // if mu < muhat then q_mu = 0
-    }
-    // the usage of the two-sided test statistic is default
-
-    if (inPhysicalRegion && sb_teststat_toy > teststat_measured) { h_better->Fill(t->scanpoint); }
-
-    if (inPhysicalRegion && b_teststat_toy > teststat_measured) { h_better_clb->Fill(t->scanpoint); }
-
-    // goodness-of-fit
-    if (inPhysicalRegion && t->chi2minGlobalToy > t->chi2minGlobal) { h_gof->Fill(t->scanpoint); }
-
-    // all toys
-    if (inPhysicalRegion) { h_all->Fill(t->scanpoint); }
-
-    // all bkg toys
-    if (inPhysicalRegion) { h_all_bkg->Fill(t->scanpoint); }
-
-    // use the unphysical events to estimate background (be careful with this,
-    // at least inspect the control plots to judge if this can be at all reasonable)
-    if (!inPhysicalRegion) { h_background->Fill(t->scanpoint); }
-
-    int hBin = h_all->FindBin(t->scanpoint);
-    if (sampledBValues.find(hBin) == sampledBValues.end()) sampledBValues[hBin] = std::vector<double>();
-    if (sampledSBValues.find(hBin) == sampledSBValues.end()) sampledSBValues[hBin] = std::vector<double>();
-    if (sampledSchi2Values.find(hBin) == sampledSchi2Values.end()) sampledSchi2Values[hBin] = std::vector<double>();
-
-    if (inPhysicalRegion) { sampledSchi2Values[hBin].push_back(sb_teststat_toy); }
-
-    // if(b_teststat_toy<0&&b_teststat_toy>-1.e-4) b_teststat_toy=0.0;
-
-    if (inPhysicalRegion) {
-      // bkgTestStatVal = t->scanbestBkgfitBkg <= 0. ? bkgTestStatVal : 0.;  // if muhat < mu then q_mu = 0
-      // if(hBin==2){
-      //     // std::cout << bkgTestStatVal << std::endl;
-      //     bkg_pvals->Fill(TMath::Prob(bkgTestStatVal,1));
-      // }
-      // bkgTestStatVal = t->scanbestBkgfitBkg <= t->scanpoint ? bkgTestStatVal : 0.;  // if muhat < mu then q_mu = 0
-      sampledBValues[hBin].push_back(b_teststat_toy);
-      // chi2minBkgToy is the best fit at scanpoint of bkg-only toy, chi2minGlobalBkgToy is the best global fit of the
-      // bkg-only toy sbTestStatVal = t->scanbestBkg <= t->scanpoint ? sbTestStatVal : 0.; // if muhat < mu then q_mu =
-      // 0
-      sampledSBValues[hBin].push_back(b_teststat_toy);
+  Long64_t nunphysical = 0;
+  for (const auto s : stats) {
+    nentries += s->nEntries;
+    nfailed += s->nFailed;
+    nwrongrun += s->nWrongRun;
+    ntoysid += s->nSelected;
+    for (const auto& [scanpoint, point] : s->points) {
+      // Cut away toys outside a certain range. This is needed to remove
+      // low statistics spikes to get publication quality log plots.
+      // Also check ToyTree::computeMinMaxN().
+      if (arg->pluginPlotRangeMin != arg->pluginPlotRangeMax &&
+          !(arg->pluginPlotRangeMin < scanpoint && scanpoint < arg->pluginPlotRangeMax))
+        continue;
+
+      int hBin = h_all->FindBin(scanpoint);
+      h_better->AddBinContent(hBin, point.nBetter);
+      h_better_clb->AddBinContent(hBin, point.nBetterClb);
+      h_gof->AddBinContent(hBin, point.nGof);
+      h_all->AddBinContent(hBin, point.nAll);
+      h_all_bkg->AddBinContent(hBin, point.nAll);
+      h_background->AddBinContent(hBin, point.nBackground);
+      nunphysical += point.nBackground;
+      if (point.nAll + point.nBackground == 0) continue;
+
+      sampledSchi2Values[hBin].merge(point.sbTestStat);
+      sampledBValues[hBin].merge(point.bTestStat);
     }
   }
 
@@ -1029,8 +1306,7 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
     std::cout << "fraction of failed toys: " << (double)nfailed / (double)nentries * 100. << "%." << std::endl;
   if (arg->debug) std::cout << "MethodPluginScan::analyseToys() : ";
   if (!quiet)
-    std::cout << "fraction of negative test stat toys: " << h_background->GetEntries() / (double)nentries * 100. << "%."
-              << std::endl;
+    std::cout << "fraction of negative test stat toys: " << nunphysical / (double)nentries * 100. << "%." << std::endl;
   if (id == -1 && nwrongrun > 0) {
     std::cout << "\nMethodPluginScan::analyseToys() : WARNING : Read toys that differ in global chi2min (wrong run) : "
               << (double)nwrongrun / (double)(nentries - nfailed) * 100. << "%.\n"
@@ -1061,14 +1337,10 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
 
     // determine CLs value
     // CLs values in data
-    int nDataAboveBkgExp = 0;
     double dataTestStat = p > 0 ? TMath::ChisquareQuantile(1. - p, 1) : 1.e10;
-    for (int j = 0; j < sampledBValues[i].size(); j++) {
-      if (sampledBValues[i][j] >= dataTestStat) nDataAboveBkgExp += 1;
-    }
 
     double dataCLb = p_clb;
-    double dataCLbErr = sqrt(dataCLb * (1. - dataCLb) / sampledBValues[i].size());
+    double dataCLbErr = sqrt(dataCLb * (1. - dataCLb) / sampledBValues[i].getN());
     if (p / dataCLb >= 1.) {
       hCLsFreq->SetBinContent(i, 1.);
       hCLsFreq->SetBinError(i, 0.);
@@ -1135,24 +1407,18 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
     // hCLsErr2Dn->SetBinContent( i, TMath::Min( clsb_vals[4] / clb_vals[4] , 1.) );
 
     /// approach via quantiles of p-value distribution
+    // The p-values are computed at the values held by the sketch of the bkg-only test
+    // statistic, each weighted by the number of bkg-only toys it stands for.
+    std::vector<double> bValues;
+    std::vector<Long64_t> bWeights;
+    sampledBValues[i].getWeightedValues(bValues, bWeights);
     std::vector<double> clsb_vals;
     std::vector<double> clb_vals;
     std::vector<double> cls_vals;
 
-    if (sampledBValues[i].size() != sampledSBValues[i].size()) {
-      std::cout
-          << "MethodPluginScan::analyseToys(): Not the same number of entries in sampledBValues and sampledSBValues!"
-          << std::endl;
-      std::exit(EXIT_FAILURE);
-    }
-
-    for (int j = 0; j < sampledBValues[i].size(); j++) {
-      double clsb_val = Utils::getVectorFracAboveValue(sampledSchi2Values[i],
-                                                       sampledSBValues[i][j]);  // p_cls+b value for each bkg-only toy
-      double clb_val =
-          Utils::getVectorFracAboveValue(sampledBValues[i],
-                                         sampledSBValues[i][j]);  // p_clb value for each bkg-only toy CAUTION:
-                                                                  // duplicate use of sampledBValues
+    for (int j = 0; j < bValues.size(); j++) {
+      double clsb_val = sampledSchi2Values[i].getFracAbove(bValues[j]);  // p_cls+b value for each bkg-only toy
+      double clb_val = sampledBValues[i].getFracAbove(bValues[j]);       // p_clb value for each bkg-only toy
       double cls_val = clsb_val / clb_val;
 
       clsb_vals.push_back(clsb_val);
@@ -1171,10 +1437,10 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
       TH1F* bkg_pvals_clb = new TH1F(Form("bkg_clbvals_bin%d", i), "bkg clb p values", 50, -0.1, 1.1);
       bkg_pvals_clb->SetLineColor(3);
       bkg_pvals_clb->SetLineWidth(3);
-      for (int j = 0; j < sampledBValues[i].size(); j++) {
-        bkg_pvals_cls->Fill(TMath::Min(cls_vals[j], 1.));
-        bkg_pvals_clsb->Fill(TMath::Min(clsb_vals[j], 1.));
-        bkg_pvals_clb->Fill(TMath::Min(clb_vals[j], 1.));
+      for (int j = 0; j < bValues.size(); j++) {
+        bkg_pvals_cls->Fill(TMath::Min(cls_vals[j], 1.), bWeights[j]);
+        bkg_pvals_clsb->Fill(TMath::Min(clsb_vals[j], 1.), bWeights[j]);
+        bkg_pvals_clb->Fill(TMath::Min(clb_vals[j], 1.), bWeights[j]);
       }
 
       TCanvas* canvasdebug = Utils::newNoWarnTCanvas("canvasdebug", "canvas1", 1200, 1000);
@@ -1195,9 +1461,9 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
                                  1. - (TMath::Prob(4, 1) / 2.)};
     // std::vector<double> probs  = {TMath::Prob(4,1), TMath::Prob(1,1),
     // 0.5, 1.-(TMath::Prob(1,1)), 1.-(TMath::Prob(4,1)) };
-    std::vector<double> quantiles_clsb = Utils::Quantile<double>(clsb_vals, probs);
-    std::vector<double> quantiles_clb = Utils::Quantile<double>(clb_vals, probs);
-    std::vector<double> quantiles_cls = Utils::Quantile<double>(cls_vals, probs);
+    std::vector<double> quantiles_clsb = QuantileSketch::getQuantiles(clsb_vals, bWeights, probs);
+    std::vector<double> quantiles_clb = QuantileSketch::getQuantiles(clb_vals, bWeights, probs);
+    std::vector<double> quantiles_cls = QuantileSketch::getQuantiles(cls_vals, bWeights, probs);
 
     // check
     if (arg->debug) {
@@ -1228,7 +1494,7 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
     // //ideal method, but prone to fluctuations
     hCLsExp->SetBinContent(i, TMath::Min(quantiles_cls[2], 1.));
     hCLsExp->SetBinError(
-        i, sqrt((1. - TMath::Min(quantiles_cls[2], 1.)) * TMath::Min(quantiles_cls[2], 1.) / sampledBValues[i].size()));
+        i, sqrt((1. - TMath::Min(quantiles_cls[2], 1.)) * TMath::Min(quantiles_cls[2], 1.) / sampledBValues[i].getN()));
     hCLsErr1Up->SetBinContent(i, TMath::Min(quantiles_cls[3], 1.));
     hCLsErr1Dn->SetBinContent(i, TMath::Min(quantiles_cls[1], 1.));
     hCLsErr2Up->SetBinContent(i, TMath::Min(quantiles_cls[4], 1.));
@@ -1264,13 +1530,170 @@ TH1F* MethodPluginScan::analyseToys(ToyTree* t, int id, bool quiet) {
               << "): " << Form("(%.1f+/-%.1f)%%", fitprobabilityVal * 100., fitprobabilityErr * 100.) << std::endl;
   }
 
-  t->activateAllBranches();
   delete h_better;
+  delete h_better_clb;
   delete h_all;
+  delete h_all_bkg;
   delete h_background;
+  delete h_gof;
   return hCL;
 }
 
+///
+/// Check that the analysis of the toys doesn't depend on the number of threads
+/// reading them, nor on whether their statistics were read back from a
+/// ToyCache. Toy files with random test statistics are written at the scan
+/// points of hCL, and analysed by analyseToys() on one thread, on nThreads
+/// threads, and from a ToyCache written and read back. The p-values and the
+/// CLs histograms are compared bin by bin, and have to be identical. With 800
+/// toys per scan point, the quantile sketches are exact, so last, a
+/// QuantileSketch of 1000 values, filled directly and merged from two halves,
+/// has to give the quantiles and tail fractions of Utils::Quantile() and
+/// Utils::getVectorFracAboveValue(). The rank error of a sketch of 10^5 values
+/// is printed. Requires initScan().
+///
+/// \param nThreads Number of threads of the parallel analysis.
+/// \return True if all histograms agree.
+///
+bool MethodPluginScan::checkToyAnalysis(int nThreads) {
+  const int nFiles = 4;
+  const int nToysFile = 200;
+  const TString fileNameBase = Form("%s/gammacombo_toycheck%i_run", gSystem->TempDirectory(), gSystem->GetPid());
+  std::vector<TString> files;
+  TRandom* rnd = RooRandom::randomGenerator();
+  for (int iFile = 0; iFile < nFiles; iFile++) {
+    ToyTree t(combiner, nullptr, true);
+    t.init();
+    for (int i = 0; i < nPoints1d; i++) {
+      // the test statistic of the data grows from 0 to 9, the p-value falls from 1 to 3 sigma
+      const double teststat = Utils::sq(3. * i / std::max(nPoints1d - 1, 1));
+      for (int j = 0; j < nToysFile; j++) {
+        t.nrun = iFile + 1;
+        t.npoint = i;
+        t.ntoy = j;
+        t.scanpoint = hCL->GetBinCenter(i + 1);
+        t.chi2minGlobal = 100.;
+        t.chi2min = t.chi2minGlobal + teststat;
+        t.chi2minGlobalToy = 100. + rnd->Exp(10.);
+        t.chi2minToy = t.chi2minGlobalToy + Utils::sq(rnd->Gaus());
+        t.chi2minGlobalBkgToy = 100. + rnd->Exp(10.);
+        t.chi2minBkgToy = t.chi2minGlobalBkgToy + Utils::sq(rnd->Gaus() + sqrt(teststat));
+        t.statusFree = rnd->Rndm() < 0.99 ? 0 : 4;
+        t.statusScan = 0;
+        t.fill();
+      }
+    }
+    files.push_back(Form(fileNameBase + "%i.root", iFile + 1));
+    t.writeToFile(files.back());
+    delete t.getTree();
+  }
+
+  // the p-values and CLs histograms of one analysis of the toy files
+  const TString cacheName = fileNameBase + "_toyCache.root";
+  auto analyse = [&](int nThreadsRead, bool viaCache) {
+    TChain chain("plugin");
+    for (const auto& file : files) chain.Add(file);
+    ToyTree t(combiner, &chain, true);
+    t.open();
+    std::vector<ToyFileStats> stats = collectToys(&t, -1, 0., true, nThreadsRead);
+    std::vector<const ToyFileStats*> statsPtrs;
+    std::unique_ptr<ToyCache> cache;
+    if (viaCache) {
+      {
+        ToyCache writer(cacheName, "check");
+        for (size_t i = 0; i < files.size(); i++) writer.put(files[i], std::move(stats[i]));
+        writer.write();
+      }
+      cache = std::make_unique<ToyCache>(cacheName, "check");
+      for (const auto& file : files) {
+        statsPtrs.push_back(cache->get(file));
+        if (!statsPtrs.back()) {
+          std::cout << "MethodPluginScan::checkToyAnalysis() : ERROR : " << file << " not found in the toy cache."
+                    << std::endl;
+          std::exit(1);
+        }
+      }
+    } else {
+      for (const auto& s : stats) statsPtrs.push_back(&s);
+    }
+    std::vector<std::unique_ptr<TH1F>> hists;
+    hists.emplace_back(analyseToys(statsPtrs, t.getScanpointMin(), t.getScanpointMax(), t.getScanpointN(), -1, true));
+    for (TH1F* h : {hCLsFreq, hCLsExp, hCLsErr1Up, hCLsErr1Dn, hCLsErr2Up, hCLsErr2Dn}) {
+      hists.emplace_back(static_cast<TH1F*>(h->Clone(Utils::getUniqueRootName())));
+    }
+    return hists;
+  };
+  // compare bin contents and errors, which must be identical
+  auto compare = [](const std::vector<std::unique_ptr<TH1F>>& a, const std::vector<std::unique_ptr<TH1F>>& b,
+                    const TString& what) {
+    int nDiffer = 0;
+    double maxDiff = 0.;
+    for (size_t k = 0; k < a.size(); k++) {
+      for (int i = 0; i <= a[k]->GetNbinsX() + 1; i++) {
+        const double diff = std::max(fabs(a[k]->GetBinContent(i) - b[k]->GetBinContent(i)),
+                                     fabs(a[k]->GetBinError(i) - b[k]->GetBinError(i)));
+        if (diff != 0.) nDiffer++;
+        maxDiff = std::max(maxDiff, diff);
+      }
+    }
+    std::cout << "MethodPluginScan::checkToyAnalysis() : " << what << ": "
+              << (nDiffer == 0 ? "identical" : Form("%i bins differ, by up to %g", nDiffer, maxDiff)) << std::endl;
+    return nDiffer == 0;
+  };
+
+  const auto serial = analyse(1, false);
+  bool success = compare(serial, analyse(nThreads, false), Form("1 against %i threads", nThreads));
+  success = compare(serial, analyse(1, true), "toy files against toy cache") && success;
+
+  // exact sketches, up to rounding
+  const std::vector<double> probs = {TMath::Prob(4, 1) / 2., TMath::Prob(1, 1) / 2., 0.5,
+                                     1. - TMath::Prob(1, 1) / 2., 1. - TMath::Prob(4, 1) / 2.};
+  std::vector<double> values;
+  QuantileSketch sketch;
+  QuantileSketch half1;
+  QuantileSketch half2;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(Utils::sq(rnd->Gaus()));
+    sketch.add(values.back());
+    (i % 2 ? half1 : half2).add(values.back());
+  }
+  half1.merge(half2);
+  double maxDiff = 0.;
+  const std::vector<double> quantiles = Utils::Quantile(values, probs);
+  for (const QuantileSketch* s : {&sketch, &half1}) {
+    const std::vector<double> sketchQuantiles = s->getQuantiles(probs);
+    for (size_t k = 0; k < probs.size(); k++) maxDiff = std::max(maxDiff, fabs(sketchQuantiles[k] - quantiles[k]));
+    for (const double q : quantiles) {
+      maxDiff = std::max(maxDiff, fabs(s->getFracAbove(q) - Utils::getVectorFracAboveValue(values, q)));
+    }
+  }
+  const bool exact = sketch.isExact() && half1.isExact() && maxDiff < 1e-12;
+  std::cout << "MethodPluginScan::checkToyAnalysis() : quantile sketch of 1000 values: "
+            << (exact ? "exact" : Form("differs by up to %g", maxDiff)) << std::endl;
+  success = exact && success;
+
+  // rank error beyond the exact size
+  values.clear();
+  QuantileSketch large;
+  for (int i = 0; i < 100000; i++) {
+    values.push_back(Utils::sq(rnd->Gaus()));
+    large.add(values.back());
+  }
+  std::sort(values.begin(), values.end());
+  double maxRankError = 0.;
+  const std::vector<double> largeQuantiles = large.getQuantiles(probs);
+  for (size_t k = 0; k < probs.size(); k++) {
+    const double rank =
+        double(std::lower_bound(values.begin(), values.end(), largeQuantiles[k]) - values.begin()) / values.size();
+    maxRankError = std::max(maxRankError, fabs(rank - probs[k]));
+  }
+  std::cout << "MethodPluginScan::checkToyAnalysis() : quantile sketch of 100000 values: rank error up to "
+            << maxRankError << std::endl;
+  for (const auto& file : files) gSystem->Unlink(file);
+  gSystem->Unlink(cacheName);
+  return success;
+}
+
 ///
 /// Read in the TTrees that were produced by scan1d().
 /// Fills the 1-CL histogram.
@@ -1283,6 +1706,7 @@ void MethodPluginScan::readScan1dTrees(int runMin, int runMax, TString fName) {
   TChain* c = new TChain("plugin");
   int nFilesMissing = 0;
   int nFilesRead = 0;
+  std::vector<TString> files;
   // configure file name
   TString dirname = "root/scan1dPlugin";
   if (arg->isAction("bb")) dirname += "BergerBoos";
@@ -1307,6 +1731,7 @@ void MethodPluginScan::readScan1dTrees(int runMin, int runMax, TString fName) {
     }
     if (arg->verbose) std::cout << "reading " + file << std::endl;
     c->Add(file);
+    files.push_back(file);
     nFilesRead += 1;
   }
   if (arg->debug) std::cout << "MethodPluginScan::readScan1dTrees() : ";
@@ -1333,7 +1758,62 @@ void MethodPluginScan::readScan1dTrees(int runMin, int runMax, TString fName) {
   }
 
   if (hCL) delete hCL;
-  hCL = analyseToys(&t, -1);
+  // The toy statistics depend on the data only through the toy files, unless the
+  // internal profile likelihood is used, or the one-sided test statistic without
+  // a known best fit point.
+  if (arg->notoycache || arg->intprob || (arg->teststatistic == 1 && !getSolution())) {
+    hCL = analyseToys(&t, -1);
+    return;
+  }
+
+  // Only analyse the toy files that are not in the cache yet, or that have changed.
+  TString config = Form("version=2 teststatistic=%i", arg->teststatistic);
+  double bestfitpoint = 0.;
+  if (arg->teststatistic == 1) {
+    bestfitpoint = getBestFitPoint(bestfitpoint);
+    config += Form(" bestfitpoint=%.17g", bestfitpoint);
+  }
+  // not named like the toy files, so that it doesn't get merged with them
+  ToyCache cache(TString(gSystem->DirName(fileNameBase)) + "/toyCache_" + gSystem->BaseName(fileNameBase) + ".root",
+                 config);
+  std::vector<const ToyFileStats*> stats;
+  std::vector<TString> newFiles;
+  TChain* cNew = new TChain("plugin");
+  for (const auto& file : files) {
+    stats.push_back(cache.get(file));
+    if (stats.back()) continue;
+    newFiles.push_back(file);
+    cNew->Add(file);
+  }
+  if (arg->debug) std::cout << "MethodPluginScan::readScan1dTrees() : ";
+  std::cout << "toy files found in cache: " << files.size() - newFiles.size() << ", new or changed toy files: "
+            << newFiles.size() << std::endl;
+  if (!newFiles.empty()) {
+    ToyTree tNew(combiner, cNew);
+    tNew.open();
+    std::vector<ToyFileStats> newStats = collectToys(&tNew, -1, bestfitpoint);
+    for (size_t i = 0, iNew = 0; i < files.size(); i++) {
+      if (!stats[i]) stats[i] = cache.put(files[i], std::move(newStats[iNew++]));
+    }
+    cache.write();
+  }
+  delete cNew;
+
+  // one bin per scan point, as in ToyTree::computeMinMaxN()
+  std::set<float> scanpoints;
+  for (const auto s : stats) {
+    for (const auto& [scanpoint, point] : s->points) {
+      if (arg->pluginPlotRangeMin != arg->pluginPlotRangeMax &&
+          !(arg->pluginPlotRangeMin < scanpoint && scanpoint < arg->pluginPlotRangeMax))
+        continue;
+      scanpoints.insert(scanpoint);
+    }
+  }
+  if (scanpoints.empty()) {
+    std::cout << "MethodPluginScan::readScan1dTrees() : ERROR : no toys found in the plot range." << std::endl;
+    std::exit(1);
+  }
+  hCL = analyseToys(stats, *scanpoints.begin(), *scanpoints.rbegin(), scanpoints.size(), -1);
 }
 
 ///
@@ -1504,13 +1984,49 @@ double MethodPluginScan::importance(double pvalue) const {
   return f;
 }
 
+///
+/// Stopping rule of the adaptive toy counts, see --adaptivetoys. The toys of a
+/// scan point are run in batches. After each batch, the p-value is compared to
+/// the nearest CL threshold, i.e. the p-values of --CL, or of 1, 2 and 3 sigma.
+/// No more toys are needed if the binomial uncertainty of the p-value is below
+/// the --adaptivetoys fraction of the threshold, or if the p-value is more than
+/// three uncertainties away from it, so that it is clearly on one side.
+///
+/// \param nToysRun  Number of toys run so far at this point.
+/// \param nAll      Number of toys passing the selection of collectToys().
+/// \param nBetter   Number of those with a larger test statistic than the data.
+/// \param pvalue    Set to the estimated p-value.
+/// \param pvalueErr Set to its binomial uncertainty.
+/// \return          0 to run another batch, 1 if the p-value is precise enough,
+///                  2 if --maxtoys toys were run.
+///
+short MethodPluginScan::getAdaptiveToyDecision(int nToysRun, Long64_t nAll, Long64_t nBetter, float& pvalue,
+                                               float& pvalueErr) const {
+  std::vector<double> thresholds;
+  for (const double cl : arg->CL) thresholds.push_back(1. - cl / 100.);
+  if (thresholds.empty()) thresholds = {TMath::Prob(1, 1), TMath::Prob(4, 1), TMath::Prob(9, 1)};
+
+  pvalue = nAll > 0 ? double(nBetter) / nAll : 0.;
+  // regularized, such that the uncertainty doesn't vanish for p-values of 0 or 1
+  const double pReg = (nBetter + 0.5) / (nAll + 1.);
+  pvalueErr = std::sqrt(pReg * (1. - pReg) / (nAll + 1.));
+
+  double nearest = thresholds[0];
+  for (const double threshold : thresholds) {
+    if (fabs(pvalue - threshold) < fabs(pvalue - nearest)) nearest = threshold;
+  }
+  if (pvalueErr < arg->adaptivetoys * nearest || fabs(pvalue - nearest) > 3. * pvalueErr) return 1;
+  const int maxToys = arg->maxtoys > 0 ? arg->maxtoys : 10 * nToys;
+  if (nToysRun >= maxToys) return 2;
+  return 0;
+}
+
 ///
 /// make control plots for the CLs method. ToDo: this does not really belong here, but in the ControlPlots class,
 /// but for the moment I don't see a way how to put it there.
 /// The Chisquare quantile plots have to be updated as well.
 ///
-void MethodPluginScan::makeControlPlotsCLs(std::map<int, std::vector<double>> bVals,
-                                           std::map<int, std::vector<double>> sbVals) {
+void MethodPluginScan::makeControlPlotsCLs(std::map<int, QuantileSketch> bVals, std::map<int, QuantileSketch> sbVals) {
   // the quantiles of the CLb distribution (for expected CLs)
   std::vector<double> probs = {TMath::Prob(4, 1), TMath::Prob(1, 1), 0.5, 1. - TMath::Prob(1, 1),
                                1. - TMath::Prob(4, 1)};
@@ -1519,18 +2035,20 @@ void MethodPluginScan::makeControlPlotsCLs(std::map<int, std::vector<double>> bV
 
   for (int i = 1; i <= hCLs->GetNbinsX(); i++) {
 
-    std::vector<double> quantiles = Utils::Quantile<double>(bVals[i], probs);
+    std::vector<double> quantiles = bVals[i].getQuantiles(probs);
     std::vector<double> clsb_vals;
-    for (int k = 0; k < quantiles.size(); k++) {
-      clsb_vals.push_back(Utils::getVectorFracAboveValue(sbVals[i], quantiles[k]));
-    }
+    for (int k = 0; k < quantiles.size(); k++) { clsb_vals.push_back(sbVals[i].getFracAbove(quantiles[k])); }
+    std::vector<double> values;
+    std::vector<Long64_t> weights;
     TCanvas* c = Utils::newNoWarnTCanvas(Form("q%d", i), Form("q%d", i));
-    double max = *(std::max_element(bVals[i].begin(), bVals[i].end()));
+    bVals[i].getWeightedValues(values, weights);
+    double max = values.back();
     TH1F* hb = new TH1F(Form("hb%d", i), "hbq", 50, 0, max);
     TH1F* hsb = new TH1F(Form("hsb%d", i), "hsbq", 50, 0, max);
 
-    for (int j = 0; j < bVals[i].size(); j++) hb->Fill(bVals[i][j]);
-    for (int j = 0; j < sbVals[i].size(); j++) hsb->Fill(sbVals[i][j]);
+    for (int j = 0; j < values.size(); j++) hb->Fill(values[j], weights[j]);
+    sbVals[i].getWeightedValues(values, weights);
+    for (int j = 0; j < values.size(); j++) hsb->Fill(values[j], weights[j]);
 
     double dataVal = TMath::ChisquareQuantile(1. - hCL->GetBinContent(i), 1);
     TArrow* lD = new TArrow(dataVal, 0.6 * hsb->GetMaximum(), dataVal, 0., 0.15, "|>");
@@ -8,8 +8,11 @@
 #include <MethodProbScan.h>
 
 #include <Combiner.h>
+#include <NllMinimizer.h>
 #include <OptParser.h>
+#include <PDF_Abs.h>
 #include <PValueCorrection.h>
+#include <ProgressBar.h>
 #include <RooSlimFitResult.h>
 #include <Utils.h>
 
@@ -22,21 +25,35 @@
 #include <RooWorkspace.h>
 
 #include <TCanvas.h>
+#include <TFile.h>
 #include <TH1F.h>
 #include <TH2F.h>
+#include <TMD5.h>
 #include <TMarker.h>
 #include <TMath.h>
+#include <TNamed.h>
+#include <TObjArray.h>
+#include <TParameter.h>
 #include <TStopwatch.h>
 #include <TStyle.h>
 #include <TSystem.h>
+#include <TVectorD.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <format>
+#include <functional>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace {
   // TODO this may stay here, or go to Utils
@@ -120,7 +137,14 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
     std::cout << "MethodProbScan::scan1d() : INFO : There are no free parameters. I will scan without fitting"
               << std::endl;
 
-  RooFormulaVar nll("nll", "nll", "-2*log(@0)", RooArgSet(*likelihood));
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  // with --warmstart, each fit starts from the covariance of the previous one
+  nll->setWarmStart(arg->warmstart);
+  const NllMinimizer::Stats statsBefore = nll->getStats();
+
+  // Each chain of fits starts from the values and errors of the start parameters,
+  // so that it doesn't depend on the chains fitted before (see scan1dForked()).
+  auto startValues = std::unique_ptr<RooArgSet>(static_cast<RooArgSet*>(startPars->get(0)->snapshot()));
 
   // j =
   // 0 : start value -> upper limit
@@ -142,7 +166,15 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
   double bestMinOld = chi2minGlobal;
   auto bestMinFoundInScan = std::numeric_limits<double>::max();
 
-  for (int jj = 0; jj < 4; jj++) {
+  // Fit only a coarse grid and refine it where needed, or fit the scan
+  // points on several worker processes. This is only worth it if there is
+  // something to fit. The serial loop below is then skipped.
+  const bool adaptive = arg->adaptivescan > 0 && hasFreePars;
+  const bool forked = !adaptive && arg->ncores > 1 && hasFreePars;
+  if (adaptive) scan1dAdaptive(quiet, bestMinFoundInScan);
+  if (forked) scan1dForked(fast, reverse, quiet, bestMinFoundInScan);
+
+  for (int jj = 0; jj < 4 && !forked && !adaptive; jj++) {
     int j = jj;
     if (reverse) switch (jj) {
       case 0:
@@ -163,7 +195,8 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
     switch (j) {
     case 0:
       // UP
-      Utils::setParameters(w, parsName, startPars->get(0));
+      Utils::resetParameters(w, *startValues);
+      nll->resetWarmStart();
       scanStart = startValue;
       scanStop = par->getMax();
       scanUp = true;
@@ -176,7 +209,8 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
       break;
     case 2:
       // DOWN
-      Utils::setParameters(w, parsName, startPars->get(0));
+      Utils::resetParameters(w, *startValues);
+      nll->resetWarmStart();
       scanStart = startValue;
       scanStop = par->getMin();
       scanUp = false;
@@ -206,7 +240,10 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
       // disable drag mode
       // (the improve method doesn't work with drag mode as parameter run
       // at their limits)
-      if (scanDisableDragMode) Utils::setParameters(w, parsName, startPars->get(0));
+      if (scanDisableDragMode) {
+        Utils::resetParameters(w, *startValues);
+        nll->resetWarmStart();
+      }
 
       // set the parameter of interest to the scan point
       par->setVal(scanvalue);
@@ -225,7 +262,7 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
       bool performFit = hasFreePars;
       if (!hasFreePars) {
         // There are no parameters to fit, just calculate NLL
-        chi2minScan = nll.getVal();
+        chi2minScan = nll->getVal();
         // But if we found indications of a new global minimum, perform the fit to find it!
         if (chi2minScan < chi2minGlobal) performFit = true;
       }
@@ -233,11 +270,12 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
         if (!hasFreePars) par->setConstant(false);
         std::unique_ptr<RooFitResult> fr;
         if (arg->probforce)
-          fr = std::unique_ptr<RooFitResult>(Utils::fitToMinForce(w, combiner->getPdfName()));
+          fr = std::unique_ptr<RooFitResult>(
+              Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
         else if (arg->probimprove)
           fr = std::unique_ptr<RooFitResult>(Utils::fitToMinImprove(w, combiner->getPdfName()));
         else
-          fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(likelihood, false, -1));
+          fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
         chi2minScan = fr->minNll();
         if (std::isinf(chi2minScan))
           chi2minScan = std::numeric_limits<double>::max();    // else the toys in PDF_testConstraint don't work
@@ -245,51 +283,13 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
         sfr = allResults.back();
         if (!hasFreePars) par->setConstant(true);
       }
-      if (chi2minScan < 0) {
-        TString warningChi2Neg;
-        double newChi2minScan = chi2minGlobal + 25.;  // 5sigma more than best point
-        warningChi2Neg = "MethodProbScan::scan1d() : WARNING : " + title;
-        warningChi2Neg += TString(Form(" chi2 negative for scan point %i: %f", i, chi2minScan));
-        warningChi2Neg += " setting to: " + TString(Form("%f", newChi2minScan));
-        std::cout << warningChi2Neg << std::endl;
-        chi2minScan = newChi2minScan;
-      }
-      bestMinFoundInScan = std::min(chi2minScan, bestMinFoundInScan);
-
-      // If we find a minimum smaller than the old "global" minimum, this means that all
-      // previous 1-CL values are too high.
-      if (chi2minScan < chi2minGlobal) {
-        if (arg->verbose)
-          std::cout << "MethodProbScan::scan1d() : WARNING : '" << title << "' new global minimum found! "
-                    << " chi2minScan=" << chi2minScan << std::endl;
-        chi2minGlobal = chi2minScan;
-        // recompute previous 1-CL values
-        for (int k = 1; k <= hCL->GetNbinsX(); k++) {
-          hCL->SetBinContent(k, TMath::Prob(hChi2min->GetBinContent(k) - chi2minGlobal, 1));
-        }
-      }
-
-      double deltaChi2 = chi2minScan - chi2minGlobal;
-      double oneMinusCL = TMath::Prob(deltaChi2, 1);
-      double deltaChi2Bkg = TMath::Max(chi2minScan - hChi2min->GetBinContent(1), 0.0);
-      if (i == 0) deltaChi2Bkg = 0.0;
-      double oneMinusCLBkg = TMath::Prob(deltaChi2Bkg, 1);
-      hCLs->SetBinContent(hCLs->FindBin(scanvalue), oneMinusCLBkg);
-
-      if (i == 0) chi2minBkg = chi2minScan;
-
-      // Save the 1-CL value and the corresponding fit result.
-      // But only if better than before!
-      if (hCL->GetBinContent(hCL->FindBin(scanvalue)) <= oneMinusCL) {
-        hCL->SetBinContent(hCL->FindBin(scanvalue), oneMinusCL);
-        hChi2min->SetBinContent(hCL->FindBin(scanvalue), chi2minScan);
-        int iRes = hCL->FindBin(scanvalue) - 1;
-        if (sfr) curveResults[iRes] = sfr;
-      }
+      processScanPoint1d(i, scanvalue, chi2minScan, sfr, bestMinFoundInScan);
       nStep++;
     }
   }
   std::cout << "MethodProbScan::scan1d() : scan done.           " << std::endl;
+  if (arg->warmstart && !forked) (nll->getStats() - statsBefore).print("MethodProbScan::scan1d()");
+  nll->setWarmStart(false);
 
   if (bestMinFoundInScan - bestMinOld > 0.01) {
     std::cout << "MethodProbScan::scan1d() : WARNING: Scan didn't find similar minimum to what was found before!"
@@ -318,6 +318,639 @@ int MethodProbScan::scan1d(bool fast, bool reverse, bool quiet) {
   return 0;
 }
 
+///
+/// Book-keeping of a single 1d scan point: update the global minimum,
+/// the 1-CL histograms, and the curve results with the result of the
+/// fit at this scan point. Points have to be processed in scan order,
+/// as the result depends on the points that came before.
+///
+/// \param i Index of the scan point, counted from the lower end of the scan range.
+/// \param scanvalue Value of the scan parameter.
+/// \param chi2minScan Minimum chi2 found at this scan point.
+/// \param sfr Corresponding fit result, nullptr if no fit was performed.
+/// \param bestMinFoundInScan Smallest chi2 found so far in this scan, will be updated.
+///
+void MethodProbScan::processScanPoint1d(int i, double scanvalue, double chi2minScan, RooSlimFitResult* sfr,
+                                        double& bestMinFoundInScan) {
+  if (chi2minScan < 0) {
+    TString warningChi2Neg;
+    double newChi2minScan = chi2minGlobal + 25.;  // 5sigma more than best point
+    warningChi2Neg = "MethodProbScan::scan1d() : WARNING : " + title;
+    warningChi2Neg += TString(Form(" chi2 negative for scan point %i: %f", i, chi2minScan));
+    warningChi2Neg += " setting to: " + TString(Form("%f", newChi2minScan));
+    std::cout << warningChi2Neg << std::endl;
+    chi2minScan = newChi2minScan;
+  }
+  bestMinFoundInScan = std::min(chi2minScan, bestMinFoundInScan);
+
+  // If we find a minimum smaller than the old "global" minimum, this means that all
+  // previous 1-CL values are too high.
+  if (chi2minScan < chi2minGlobal) {
+    if (arg->verbose)
+      std::cout << "MethodProbScan::scan1d() : WARNING : '" << title << "' new global minimum found! "
+                << " chi2minScan=" << chi2minScan << std::endl;
+    chi2minGlobal = chi2minScan;
+    // recompute previous 1-CL values
+    for (int k = 1; k <= hCL->GetNbinsX(); k++) {
+      hCL->SetBinContent(k, TMath::Prob(hChi2min->GetBinContent(k) - chi2minGlobal, 1));
+    }
+  }
+
+  double deltaChi2 = chi2minScan - chi2minGlobal;
+  double oneMinusCL = TMath::Prob(deltaChi2, 1);
+  double deltaChi2Bkg = TMath::Max(chi2minScan - hChi2min->GetBinContent(1), 0.0);
+  if (i == 0) deltaChi2Bkg = 0.0;
+  double oneMinusCLBkg = TMath::Prob(deltaChi2Bkg, 1);
+  hCLs->SetBinContent(hCLs->FindBin(scanvalue), oneMinusCLBkg);
+
+  if (i == 0) chi2minBkg = chi2minScan;
+
+  // Save the 1-CL value and the corresponding fit result.
+  // But only if better than before!
+  if (hCL->GetBinContent(hCL->FindBin(scanvalue)) <= oneMinusCL) {
+    hCL->SetBinContent(hCL->FindBin(scanvalue), oneMinusCL);
+    hChi2min->SetBinContent(hCL->FindBin(scanvalue), chi2minScan);
+    int iRes = hCL->FindBin(scanvalue) - 1;
+    if (sfr) curveResults[iRes] = sfr;
+  }
+}
+
+///
+/// Version of the scan loop of scan1d() running on --ncores local worker
+/// processes, see runScanFarm(). The scan points are grouped into chains
+/// that have to be fitted in order, because in drag mode each fit starts
+/// from the parameters found at the previous, neighbouring scan point.
+/// The scan towards the upper limit (and back) and the scan towards the lower
+/// limit (and back) both start from the start parameters, so they form two
+/// independent chains, and at most two workers are busy. If the drag mode is
+/// disabled, every scan point starts from the start parameters and is a chain
+/// of its own.
+///
+/// Like in the serial loop, each chain starts from the values and errors of
+/// the start parameters and without a warm start covariance, and its points
+/// are fitted in the same order. Once all points are fitted, the fit results
+/// are processed in the order of the serial scan, so the results are
+/// identical to the serial scan, whatever the number of workers.
+///
+/// Expects the same preparation of the workspace as the serial loop in scan1d():
+/// parameter limits loaded, the scan parameter set constant.
+///
+/// \param fast Scan each point only once.
+/// \param reverse Scan in reverse direction.
+/// \param quiet Don't print the progress.
+/// \param bestMinFoundInScan Smallest chi2 found in this scan, will be updated.
+///
+void MethodProbScan::scan1dForked(bool fast, bool reverse, bool quiet, double& bestMinFoundInScan) {
+  RooRealVar* par = w->var(scanVar1);
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  const double min = hCL->GetXaxis()->GetXmin();
+  const double max = hCL->GetXaxis()->GetXmax();
+  const double startValue = par->getVal();
+
+  struct ScanPoint {
+    int id;  // position in the order of the serial scan
+    int i;
+    double scanvalue;
+  };
+
+  // Collect the scan points of the four passes in the same order as the serial loop.
+  std::vector<std::vector<ScanPoint>> passes(4);
+  int nScanPoints = 0;
+  for (int jj = 0; jj < 4; jj++) {
+    // with reverse, the passes 2,3,0,1 are run instead of 0,1,2,3
+    const int j = reverse ? (jj + 2) % 4 : jj;
+    if (fast && (j == 1 || j == 3)) continue;
+    const bool scanUp = j == 0 || j == 3;
+    const double scanStart = j == 0 || j == 2 ? startValue : (j == 1 ? par->getMax() : par->getMin());
+    const double scanStop = j == 0 ? par->getMax() : (j == 2 ? par->getMin() : startValue);
+    for (int i = 0; i < nPoints1d; i++) {
+      double scanvalue;
+      if (scanUp) {
+        scanvalue = min + (max - min) * (double)i / (double)nPoints1d + hCL->GetBinWidth(1) / 2.;
+        if (scanvalue < scanStart) continue;
+        if (scanvalue > scanStop) break;
+      } else {
+        scanvalue = max - (max - min) * (double)(i + 1) / (double)nPoints1d + hCL->GetBinWidth(1) / 2.;
+        if (scanvalue > scanStart) continue;
+        if (scanvalue < scanStop) break;
+      }
+      // don't scan in unphysical region
+      if (scanvalue < par->getMin() || scanvalue > par->getMax()) continue;
+      passes[jj].push_back({nScanPoints++, i, scanvalue});
+    }
+  }
+
+  // Each pass returning to the start value continues the chain of the one before.
+  std::vector<std::vector<const ScanPoint*>> chains;
+  if (scanDisableDragMode) {
+    for (const auto& pass : passes)
+      for (const auto& p : pass) chains.push_back({&p});
+  } else {
+    for (int jj = 0; jj < 4; jj += 2) {
+      chains.emplace_back();
+      for (const auto& p : passes[jj]) chains.back().push_back(&p);
+      for (const auto& p : passes[jj + 1]) chains.back().push_back(&p);
+    }
+  }
+  if (arg->verbose)
+    std::cout << "MethodProbScan::scan1d() : fitting " << chains.size() << " independent chains of scan points on "
+              << std::min<int>(arg->ncores, chains.size()) << " processes" << std::endl;
+
+  auto startValues = std::unique_ptr<RooArgSet>(static_cast<RooArgSet*>(startPars->get(0)->snapshot()));
+  NllMinimizer::Stats stats;
+  const std::vector<RooSlimFitResult*> fitted = runScanFarm(
+      chains.size(), nScanPoints,
+      [&](int iChain, std::vector<RooSlimFitResult*>& results) {
+        Utils::resetParameters(w, *startValues);
+        nll->resetWarmStart();
+        for (const ScanPoint* p : chains[iChain]) {
+          par->setVal(p->scanvalue);
+          std::unique_ptr<RooFitResult> fr;
+          if (arg->probforce)
+            fr = std::unique_ptr<RooFitResult>(
+                Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
+          else if (arg->probimprove)
+            fr = std::unique_ptr<RooFitResult>(Utils::fitToMinImprove(w, combiner->getPdfName()));
+          else
+            fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
+          results[p->id] = new RooSlimFitResult(fr.get());  // save memory by using the slim fit result
+        }
+      },
+      quiet, stats);
+
+  // Merge in the order of the serial scan.
+  for (const auto& pass : passes) {
+    for (const auto& p : pass) {
+      RooSlimFitResult* sfr = fitted[p.id];
+      double chi2minScan = sfr->minNll();
+      if (std::isinf(chi2minScan))
+        chi2minScan = std::numeric_limits<double>::max();  // else the toys in PDF_testConstraint don't work
+      allResults.push_back(sfr);
+      processScanPoint1d(p.i, p.scanvalue, chi2minScan, sfr, bestMinFoundInScan);
+    }
+  }
+  if (arg->warmstart) stats.print("MethodProbScan::scan1d()");
+}
+
+///
+/// Fit independent units of scan points, e.g. the chains of scan1dForked(),
+/// on --ncores local worker processes, see Utils::forkFor(). Each worker is a
+/// copy of this process, and fits on its own copy of the workspace and of the
+/// minimizer of the combiner, so that no RooFit object or global state is
+/// shared. Units are handed out to whichever worker becomes free first. After
+/// its last unit, each worker writes its fit results to a file of its own,
+/// which is read back here.
+///
+/// \param nUnits   Number of units.
+/// \param nResults Number of scan points, i.e. of fit results.
+/// \param runUnit  Function run in the workers, fitting the unit iUnit and storing
+///                 the fit result of scan point k in results[k].
+/// \param quiet    Don't print the progress.
+/// \param stats    The counters of the fits of the workers are added to this.
+/// \return         The fit result of each scan point, nullptr where runUnit didn't store one.
+///
+std::vector<RooSlimFitResult*> MethodProbScan::runScanFarm(
+    int nUnits, int nResults, const std::function<void(int iUnit, std::vector<RooSlimFitResult*>& results)>& runUnit,
+    bool quiet, NllMinimizer::Stats& stats) {
+  const int nWorkers = std::max(1, std::min(arg->ncores, nUnits));
+  const TString fileName = Form("%s/gammacombo_scan%i.root", gSystem->TempDirectory(), gSystem->GetPid());
+  auto partName = [&](int iWorker) { return Utils::forkPartFileName(fileName, iWorker); };
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  const NllMinimizer::Stats statsBefore = nll->getStats();
+  std::vector<RooSlimFitResult*> results(nResults, nullptr);
+
+  std::unique_ptr<ProgressBar> pb(quiet ? nullptr : new ProgressBar(arg, nUnits));
+  const bool success = Utils::forkFor(
+      nWorkers, nUnits, [&](int iWorker, int iUnit) { runUnit(iUnit, results); },
+      [&](int iWorker) {
+        TFile f(partName(iWorker), "recreate");
+        TObjArray fitted(nResults);
+        for (int k = 0; k < nResults; k++) {
+          if (results[k]) fitted.AddAt(results[k], k);
+        }
+        fitted.Write("results", TObject::kSingleKey);
+        const NllMinimizer::Stats s = nll->getStats() - statsBefore;
+        TVectorD counters(7);
+        counters[0] = s.nFits;
+        counters[1] = s.nWarm;
+        counters[2] = s.nEscalated;
+        counters[3] = s.nCalls;
+        counters[4] = s.nCallsWarm;
+        counters[5] = s.nCallsEscalated;
+        counters[6] = s.nWarmApproxCov;
+        counters.Write("stats");
+        f.Close();
+      },
+      [&]() {
+        if (pb) pb->progress();
+      });
+  if (!success) {
+    std::cout << "MethodProbScan::runScanFarm() : ERROR : a worker process failed. Exit." << std::endl;
+    std::exit(1);
+  }
+
+  // collect the fit results of the workers
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+    std::unique_ptr<TFile> f(TFile::Open(partName(iWorker)));
+    const auto fitted = std::unique_ptr<TObjArray>(f ? f->Get<TObjArray>("results") : nullptr);
+    const auto counters = std::unique_ptr<TVectorD>(f ? f->Get<TVectorD>("stats") : nullptr);
+    if (!fitted || !counters) {
+      std::cout << "MethodProbScan::runScanFarm() : ERROR : could not read the fit results of worker " << iWorker
+                << " from " << partName(iWorker) << ". Exit." << std::endl;
+      std::exit(1);
+    }
+    fitted->SetOwner(false);  // the fit results are handed to the caller
+    for (int k = 0; k <= fitted->GetLast(); k++) {
+      if (fitted->At(k)) results[k] = static_cast<RooSlimFitResult*>(fitted->At(k));
+    }
+    NllMinimizer::Stats s;
+    s.nFits = (*counters)[0];
+    s.nWarm = (*counters)[1];
+    s.nEscalated = (*counters)[2];
+    s.nCalls = (*counters)[3];
+    s.nCallsWarm = (*counters)[4];
+    s.nCallsEscalated = (*counters)[5];
+    s.nWarmApproxCov = (*counters)[6];
+    stats += s;
+    f.reset();
+    gSystem->Unlink(partName(iWorker));
+  }
+  return results;
+}
+
+///
+/// Adaptive version of the scan loop of scan1d(), used with --adaptivescan.
+/// Instead of fitting all nPoints1d points, it fits a coarse grid of
+/// --adaptivescan points, and then recursively bisects those intervals between
+/// fitted points that
+/// - contain a crossing of 1-CL with one of the thresholds (1, 2, 3 sigma and --CL),
+/// - border on the smallest chi2 found, i.e. the central value, or
+/// - where the chi2 is not well described by a parabola: the parabolas through
+///   the interval and its left and right neighbouring points disagree in the
+///   middle of the interval by more than 0.05.
+/// All fitted points are bin centers of hCL, so the bisection stops at the
+/// resolution of --npoints. Each fit starts from the parameters of the nearest
+/// fitted point (drag mode), or from the start parameters.
+///
+/// The fitted points are kept in a map sorted by bin. The chi2 of the bins in
+/// between is interpolated by the mean of the two neighbouring parabolas, so
+/// hCL and hChi2min are filled on the full grid, as by the serial scan. Only
+/// the fitted bins get a curve result, as there is no fit at the others. All
+/// fitted points are listed in adaptiveResults.
+///
+/// \param quiet Don't print the progress.
+/// \param bestMinFoundInScan Smallest chi2 found in this scan, will be updated.
+///
+void MethodProbScan::scan1dAdaptive(bool quiet, double& bestMinFoundInScan) {
+  RooRealVar* par = w->var(scanVar1);
+  NllMinimizer* nll = combiner->getNllMinimizer();
+
+  struct ScanPoint {
+    double scanvalue;
+    double chi2minScan;
+    RooSlimFitResult* sfr;
+  };
+  std::map<int, ScanPoint> points;  // the fitted scan points, by bin index
+
+  // Fit bin i, starting from the parameters of the given fit result.
+  auto fitPoint = [&](int i, RooSlimFitResult* startFrom) {
+    if (startFrom && !scanDisableDragMode) {
+      Utils::setParameters(w, parsName, startFrom);
+    } else {
+      Utils::setParameters(w, parsName, startPars->get(0));
+      nll->resetWarmStart();
+    }
+    const double scanvalue = hCL->GetBinCenter(i + 1);
+    par->setVal(scanvalue);
+    std::unique_ptr<RooFitResult> fr;
+    if (arg->probforce)
+      fr = std::unique_ptr<RooFitResult>(
+          Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
+    else if (arg->probimprove)
+      fr = std::unique_ptr<RooFitResult>(Utils::fitToMinImprove(w, combiner->getPdfName()));
+    else
+      fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
+    double chi2minScan = fr->minNll();
+    if (std::isinf(chi2minScan))
+      chi2minScan = std::numeric_limits<double>::max();  // else the toys in PDF_testConstraint don't work
+    allResults.push_back(new RooSlimFitResult(fr.get()));
+    points[i] = {scanvalue, chi2minScan, allResults.back()};
+  };
+
+  // The coarse grid, fitted from the start value up and then down, like the fast serial scan.
+  const int nCoarse = std::clamp(arg->adaptivescan, 2, nPoints1d);
+  const int iStartBin = std::clamp(hCL->FindBin(par->getVal()) - 1, 0, nPoints1d - 1);
+  std::vector<int> coarse;
+  for (int k = 0; k < nCoarse; k++) coarse.push_back(std::lround((double)k * (nPoints1d - 1) / (nCoarse - 1)));
+  RooSlimFitResult* previous = nullptr;
+  for (int i : coarse) {
+    if (i < iStartBin) continue;
+    fitPoint(i, previous);
+    previous = points[i].sfr;
+  }
+  previous = nullptr;
+  for (auto it = coarse.rbegin(); it != coarse.rend(); ++it) {
+    if (*it >= iStartBin) continue;
+    fitPoint(*it, previous);
+    previous = points[*it].sfr;
+  }
+
+  // thresholds of the refinement, in units of delta chi2
+  std::vector<double> thresholds = {1., 4., 9.};
+  for (const double cl : arg->CL) thresholds.push_back(TMath::ChisquareQuantile(cl / 100., 1));
+  constexpr double kChi2Tolerance = 0.05;
+  const double failed = std::numeric_limits<double>::max();
+
+  // Parabola through the fitted points a, b, c, evaluated at bin i.
+  auto parabola = [&](std::map<int, ScanPoint>::const_iterator a, std::map<int, ScanPoint>::const_iterator b,
+                      std::map<int, ScanPoint>::const_iterator c, double i) {
+    const double xa = a->first, xb = b->first, xc = c->first;
+    return a->second.chi2minScan * (i - xb) * (i - xc) / ((xa - xb) * (xa - xc)) +
+           b->second.chi2minScan * (i - xa) * (i - xc) / ((xb - xa) * (xb - xc)) +
+           c->second.chi2minScan * (i - xa) * (i - xb) / ((xc - xa) * (xc - xb));
+  };
+
+  // Interpolate the chi2 at bin i between the fitted points a and b = a+1.
+  auto interpolate = [&](std::map<int, ScanPoint>::const_iterator a, double i) {
+    const auto b = std::next(a);
+    const bool hasLeft = a != points.cbegin() && std::prev(a)->second.chi2minScan != failed;
+    const bool hasRight = std::next(b) != points.cend() && std::next(b)->second.chi2minScan != failed;
+    if (hasLeft && hasRight) return (parabola(std::prev(a), a, b, i) + parabola(a, b, std::next(b), i)) / 2.;
+    if (hasLeft) return parabola(std::prev(a), a, b, i);
+    if (hasRight) return parabola(a, b, std::next(b), i);
+    const double slope = (b->second.chi2minScan - a->second.chi2minScan) / (b->first - a->first);
+    return a->second.chi2minScan + slope * (i - a->first);
+  };
+
+  for (int nRound = 1;; nRound++) {
+    auto best = points.cbegin();
+    for (auto it = points.cbegin(); it != points.cend(); ++it) {
+      if (it->second.chi2minScan < best->second.chi2minScan) best = it;
+    }
+    const double chi2min = std::min(chi2minGlobal, best->second.chi2minScan);
+
+    // the new points and the fit results to start them from
+    std::vector<std::pair<int, RooSlimFitResult*>> newPoints;
+    for (auto a = points.cbegin(); std::next(a) != points.cend(); ++a) {
+      const auto b = std::next(a);
+      if (b->first - a->first < 2) continue;
+      bool refine = a == best || b == best || a->second.chi2minScan == failed || b->second.chi2minScan == failed;
+      const double dA = a->second.chi2minScan - chi2min;
+      const double dB = b->second.chi2minScan - chi2min;
+      for (const double t : thresholds) refine |= (dA - t) * (dB - t) <= 0;
+      if (!refine && a != points.cbegin() && std::next(b) != points.cend() &&
+          std::prev(a)->second.chi2minScan != failed && std::next(b)->second.chi2minScan != failed) {
+        const double mid = (a->first + b->first) / 2.;
+        refine = fabs(parabola(std::prev(a), a, b, mid) - parabola(a, b, std::next(b), mid)) > kChi2Tolerance;
+      }
+      if (refine) newPoints.push_back({(a->first + b->first) / 2, a->second.sfr});
+    }
+    if (newPoints.empty()) break;
+    if (!quiet)
+      std::cout << "MethodProbScan::scan1d() : refinement " << nRound << ": fitting " << newPoints.size()
+                << " points   \r" << std::flush;
+    for (const auto& [i, startFrom] : newPoints) fitPoint(i, startFrom);
+  }
+  if (!quiet)
+    std::cout << "MethodProbScan::scan1d() : adaptive scan fitted " << points.size() << " of " << nPoints1d
+              << " points" << std::endl;
+
+  // Fill the full grid in the order of the scan range, as processScanPoint1d() expects.
+  // The interpolation must not go below the smallest chi2 that was fitted.
+  double chi2minFitted = failed;
+  for (const auto& [i, p] : points) chi2minFitted = std::min(chi2minFitted, p.chi2minScan);
+  for (auto a = points.cbegin(); a != points.cend(); ++a) {
+    processScanPoint1d(a->first, a->second.scanvalue, a->second.chi2minScan, a->second.sfr, bestMinFoundInScan);
+    const auto b = std::next(a);
+    if (b == points.cend()) break;
+    for (int i = a->first + 1; i < b->first; i++) {
+      const bool failedFit = a->second.chi2minScan == failed || b->second.chi2minScan == failed;
+      const auto nearest = i - a->first <= b->first - i ? a : b;
+      const double chi2minScan =
+          std::max(failedFit ? nearest->second.chi2minScan : interpolate(a, i), chi2minFitted);
+      const double oneMinusCL = TMath::Prob(chi2minScan - chi2minGlobal, 1);
+      hCLs->SetBinContent(i + 1, TMath::Prob(std::max(chi2minScan - hChi2min->GetBinContent(1), 0.0), 1));
+      if (hCL->GetBinContent(i + 1) <= oneMinusCL) {
+        hCL->SetBinContent(i + 1, oneMinusCL);
+        hChi2min->SetBinContent(i + 1, chi2minScan);
+        curveResults[i] = nullptr;
+      }
+    }
+  }
+  for (const auto& [i, p] : points) addAdaptiveResult(p.scanvalue, 0., p.sfr);
+}
+
+///
+/// Add a point fitted by an adaptive scan to adaptiveResults, keeping them sorted
+/// by x and y. If a scan from another start value fitted the same point before,
+/// the fit result with the smaller chi2 is kept, like in hCL and hCL2d.
+///
+void MethodProbScan::addAdaptiveResult(double x, double y, RooSlimFitResult* sfr) {
+  auto less = [](const AdaptivePoint& a, const AdaptivePoint& b) { return a.x < b.x || (a.x == b.x && a.y < b.y); };
+  const AdaptivePoint p = {x, y, sfr};
+  auto it = std::lower_bound(adaptiveResults.begin(), adaptiveResults.end(), p, less);
+  if (it == adaptiveResults.end() || less(p, *it))
+    adaptiveResults.insert(it, p);
+  else if (sfr->minNll() < it->sfr->minNll())
+    it->sfr = sfr;
+}
+
+///
+/// Book-keeping of a single 2d scan point: update the global minimum,
+/// the 1-CL histograms, and the curve results with the result of the
+/// fit at this scan point. Points have to be processed in scan order,
+/// as the result depends on the points that came before.
+///
+/// \param i Bin index of the scan point in x.
+/// \param j Bin index of the scan point in y.
+/// \param chi2minScan Minimum chi2 found at this scan point.
+/// \param sfr Corresponding fit result, nullptr if no fit was performed.
+/// \param ndof Number of degrees of freedom used to convert chi2 into 1-CL.
+/// \param bestMinFoundInScan Smallest chi2 found so far in this scan, will be updated.
+/// \param hDbgChi2min2d Debug histogram of the chi2 of this scan, will be updated.
+///
+void MethodProbScan::processScanPoint2d(int i, int j, double chi2minScan, RooSlimFitResult* sfr, int ndof,
+                                        double& bestMinFoundInScan, TH2F* hDbgChi2min2d) {
+  bestMinFoundInScan = std::min(chi2minScan, bestMinFoundInScan);
+
+  // If we find a new global minumum, this means that all
+  // previous 1-CL values are too high. We'll save the new possible solution, adjust the global
+  // minimum, return a status code, and stop.
+  if (chi2minScan > -500 && chi2minScan < chi2minGlobal) {
+    // warn only if there was a significant improvement
+    if (arg->debug || chi2minScan < chi2minGlobal - 1e-2) {
+      if (arg->verbose)
+        std::cout << "MethodProbScan::scan2d() : WARNING : '" << title
+                  << "' new global minimum found! chi2minGlobal=" << chi2minGlobal << " chi2minScan=" << chi2minScan
+                  << std::endl;
+    }
+    chi2minGlobal = chi2minScan;
+    // recompute previous 1-CL values
+    for (int k = 1; k <= hCL2d->GetNbinsX(); k++)
+      for (int l = 1; l <= hCL2d->GetNbinsY(); l++) {
+        hCL2d->SetBinContent(k, l, TMath::Prob(hChi2min2d->GetBinContent(k, l) - chi2minGlobal, ndof));
+      }
+  }
+
+  double deltaChi2 = chi2minScan - chi2minGlobal;
+  double oneMinusCL = TMath::Prob(deltaChi2, ndof);
+
+  // Save the 1-CL value. But only if better than before!
+  if (hCL2d->GetBinContent(i, j) < oneMinusCL) {
+    hCL2d->SetBinContent(i, j, oneMinusCL);
+    hChi2min2d->SetBinContent(i, j, chi2minScan);
+    hDbgChi2min2d->SetBinContent(i, j, chi2minScan);
+    curveResults2d[i - 1][j - 1] = sfr;
+  }
+}
+
+///
+/// Version of the scan spiral of scan2d() running on --ncores local worker
+/// processes, see runScanFarm(). In drag mode, the start parameters of
+/// each scan point are taken from the next-inner turn of the spiral
+/// (see computeInnerTurnCoords()), so each point only depends on one point
+/// fitted before it in the order of the spiral.
+///
+/// The workers are started once for the whole scan, and take the points in
+/// the order of the spiral. A worker waits for the fit of the start point of
+/// its point, if that is still running on another worker, and reads the fitted
+/// parameter values from memory shared by all workers. Hence the same start
+/// parameter values are used as in the serial scan, and the workers are only
+/// idle while waiting at the inner turns. The center of the spiral starts
+/// from the start parameters of the scan.
+///
+/// Every point starts from the errors of the start parameters of the scan and
+/// without a warm start covariance, so the results don't depend on the number
+/// of workers. They can differ from the serial scan within the precision of the
+/// fits, as the serial scan carries the step sizes and the warm start covariance
+/// over from the previous fit. Once all points are fitted, the results are
+/// processed, and the results of the second-inner turns released, in the order
+/// of the serial spiral.
+///
+/// \param iStart Center of the spiral, x bin.
+/// \param jStart Center of the spiral, y bin.
+/// \param ndof Number of degrees of freedom used to convert chi2 into 1-CL.
+/// \param mycurveResults2d Fit results of this scan used as start parameters, will be updated.
+/// \param bestMinFoundInScan Smallest chi2 found in this scan, will be updated.
+/// \param hDbgChi2min2d Debug histogram of the chi2 of this scan, will be updated.
+/// \param hDbgStart Debug histogram of the scanned points, will be updated.
+/// \param drawDbg Draws the debug histograms.
+///
+void MethodProbScan::scan2dForked(int iStart, int jStart, int ndof,
+                                  std::vector<std::vector<RooSlimFitResult*>>& mycurveResults2d,
+                                  double& bestMinFoundInScan, TH2F* hDbgChi2min2d, TH2F* hDbgStart,
+                                  const std::function<void()>& drawDbg) {
+  // Walk the same spiral as scan2d() and sort the points by turn,
+  // which is the distance to the center in the maximum norm.
+  std::vector<std::vector<std::pair<int, int>>> turns;
+  const int X = 2 * nPoints2dx;
+  const int Y = 2 * nPoints2dy;
+  int x = 0, y = 0, dx = 0, dy = -1;
+  const int maxI = std::max(X, Y) * std::max(X, Y);
+  for (int spiralstep = 0; spiralstep < maxI; spiralstep++) {
+    if ((-X / 2 <= x) && (x <= X / 2) && (-Y / 2 <= y) && (y <= Y / 2)) {
+      const int i = x + iStart;
+      const int j = y + jStart;
+      if (i > 0 && i <= nPoints2dx && j > 0 && j <= nPoints2dy) {
+        const int turn = std::max(std::abs(x), std::abs(y));
+        if (static_cast<int>(turns.size()) <= turn) turns.resize(turn + 1);
+        turns[turn].emplace_back(i, j);
+      }
+    }
+    if ((x == y) || ((x < 0) && (x == -y)) || ((x > 0) && (x == 1 - y))) {
+      const int t = dx;
+      dx = -dy;
+      dy = t;
+    }
+    x += dx;
+    y += dy;
+  }
+  std::vector<std::pair<int, int>> points;
+  for (const auto& turn : turns) points.insert(points.end(), turn.begin(), turn.end());
+  const int nPoints = points.size();
+
+  // the point each point takes its start parameters from, -1 for none
+  std::vector<std::vector<int>> spiralIndex(nPoints2dx, std::vector<int>(nPoints2dy, -1));
+  for (int k = 0; k < nPoints; k++) spiralIndex[points[k].first - 1][points[k].second - 1] = k;
+  std::vector<int> startPoint(nPoints, -1);
+  for (int k = 0; k < nPoints; k++) {
+    int xStartPars, yStartPars;
+    computeInnerTurnCoords(iStart, jStart, points[k].first, points[k].second, xStartPars, yStartPars, 1);
+    const int kStart = spiralIndex[xStartPars - 1][yStartPars - 1];
+    if (kStart < k) startPoint[k] = kStart;
+  }
+
+  // The fitted values of the floating parameters at each point, and whether the
+  // fit is done, shared by all workers.
+  std::vector<RooRealVar*> floating;
+  for (const auto pAbs : *w->set(parsName)) {
+    const auto p = static_cast<RooRealVar*>(pAbs);
+    if (!p->isConstant()) floating.push_back(p);
+  }
+  const int nFloating = floating.size();
+  Utils::SharedMemory shared(nPoints * (nFloating * sizeof(double) + sizeof(std::atomic<int>)));
+  if (!shared.get()) {
+    std::cout << "MethodProbScan::scan2d() : ERROR : could not share the fit results between the workers. Exit."
+              << std::endl;
+    std::exit(1);
+  }
+  double* fittedValues = static_cast<double*>(shared.get());
+  auto fitted = reinterpret_cast<std::atomic<int>*>(fittedValues + nPoints * nFloating);
+  for (int k = 0; k < nPoints; k++) new (&fitted[k]) std::atomic<int>(0);
+
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  auto startValues = std::unique_ptr<RooArgSet>(static_cast<RooArgSet*>(startPars->get(0)->snapshot()));
+  NllMinimizer::Stats stats;
+  const std::vector<RooSlimFitResult*> results = runScanFarm(
+      nPoints, nPoints,
+      [&](int k, std::vector<RooSlimFitResult*>& fitResults) {
+        Utils::resetParameters(w, *startValues);
+        nll->resetWarmStart();
+        if (const int kStart = startPoint[k]; kStart >= 0) {
+          // the start point was handed out before, to this or another worker
+          while (fitted[kStart].load(std::memory_order_acquire) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          for (int p = 0; p < nFloating; p++) floating[p]->setVal(fittedValues[kStart * nFloating + p]);
+        }
+        w->var(scanVar1)->setVal(hCL2d->GetXaxis()->GetBinCenter(points[k].first));
+        w->var(scanVar2)->setVal(hCL2d->GetYaxis()->GetBinCenter(points[k].second));
+        std::unique_ptr<RooFitResult> fr;
+        if (arg->probforce)
+          fr = std::unique_ptr<RooFitResult>(
+              Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
+        else
+          fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
+        fitResults[k] = new RooSlimFitResult(fr.get());  // save memory by using the slim fit result
+
+        // pass the fitted values on to the points starting from this one
+        Utils::setParameters(w, parsName, fitResults[k]);
+        for (int p = 0; p < nFloating; p++) fittedValues[k * nFloating + p] = floating[p]->getVal();
+        fitted[k].store(1, std::memory_order_release);
+      },
+      false, stats);
+
+  // process the results in spiral order
+  for (int k = 0; k < nPoints; k++) {
+    const auto [i, j] = points[k];
+    // delete old, inner fit results, that we don't need for start parameters anymore
+    int iOld, jOld;
+    if (computeInnerTurnCoords(iStart, jStart, i, j, iOld, jOld, 2)) {
+      deleteIfNotInCurveResults2d(mycurveResults2d[iOld - 1][jOld - 1]);
+      mycurveResults2d[iOld - 1][jOld - 1] = 0;
+    }
+    double chi2minScan = results[k]->minNll();
+    if (std::isinf(chi2minScan))
+      chi2minScan = std::numeric_limits<double>::max();  // else the toys in PDF_testConstraint don't work
+    if (k > 0) hDbgStart->SetBinContent(i, j, 500.);
+    allResults.push_back(results[k]);
+    mycurveResults2d[i - 1][j - 1] = results[k];
+    processScanPoint2d(i, j, chi2minScan, results[k], ndof, bestMinFoundInScan, hDbgChi2min2d);
+  }
+  drawDbg();
+  if (arg->warmstart) stats.print("MethodProbScan::scan2d()");
+}
+
 ///
 /// Modify the CL histograms according to the defined test statistics
 ///\return status 0 ->potentially can encode debug information here
@@ -433,6 +1066,217 @@ bool MethodProbScan::computeInnerTurnCoords(const int iStart, const int jStart,
   return true;
 }
 
+///
+/// Adaptive version of the scan spiral of scan2d(), used with --adaptivescan.
+/// Instead of fitting all nPoints2dx x nPoints2dy points, it fits a coarse
+/// grid of --adaptivescan points per axis, and then refines the cells of the
+/// grid like a quadtree: a cell is split into four, fitting the centers of its
+/// edges and its center, if
+/// - the chi2 at its corners straddles one of the contour levels, that is 1 to
+///   --ncontours sigma for one or two degrees of freedom (see ConfidenceContours),
+///   and --CL,
+/// - one of its corners has the smallest chi2 found, or
+/// - a fit at one of its corners failed.
+/// The four new cells are only refined further if the new points differ by more
+/// than 0.1 from the bilinear interpolation of the corners, or if the cell
+/// contains the smallest chi2 or a failed fit. All fitted points are bin centers
+/// of hCL2d, so the refinement stops at the resolution of the --npoints2dx/y
+/// grid. Each fit starts from the parameters of the corner of its cell with the
+/// smallest chi2.
+///
+/// The bins in between are interpolated bilinearly from the corners of the
+/// smallest cell containing them, so hCL2d and hChi2min2d are filled on the
+/// full grid, as expected by the plots and contours. Only the fitted bins get a
+/// curve result, as there is no fit at the others. All fitted points are listed
+/// in adaptiveResults. Structures smaller than the coarse
+/// grid that don't touch a refined cell, e.g. a small separate island above
+/// the 5 sigma level, may be missed.
+///
+/// \param ndof Number of degrees of freedom used to convert chi2 into 1-CL.
+/// \param bestMinFoundInScan Smallest chi2 found in this scan, will be updated.
+/// \param hDbgChi2min2d Debug histogram of the chi2 of this scan, will be updated.
+/// \param drawDbg Draws the debug histograms.
+///
+void MethodProbScan::scan2dAdaptive(int ndof, double& bestMinFoundInScan, TH2F* hDbgChi2min2d,
+                                    const std::function<void()>& drawDbg) {
+  RooRealVar* par1 = w->var(scanVar1);
+  RooRealVar* par2 = w->var(scanVar2);
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  const double failed = std::numeric_limits<double>::max();
+
+  struct ScanPoint {
+    double chi2minScan;
+    RooSlimFitResult* sfr;
+  };
+  std::map<std::pair<int, int>, ScanPoint> points;  // the fitted scan points, by bin index in x and y
+
+  // Fit bin (i, j), unless done before, starting from the parameters of the given fit result.
+  auto fitPoint = [&](int i, int j, RooSlimFitResult* startFrom) {
+    if (points.count({i, j})) return;
+    if (startFrom && !scanDisableDragMode) {
+      Utils::setParameters(w, parsName, startFrom);
+    } else {
+      Utils::setParameters(w, parsName, startPars->get(0));
+      nll->resetWarmStart();
+    }
+    par1->setVal(hCL2d->GetXaxis()->GetBinCenter(i + 1));
+    par2->setVal(hCL2d->GetYaxis()->GetBinCenter(j + 1));
+    std::unique_ptr<RooFitResult> fr;
+    if (arg->probforce)
+      fr = std::unique_ptr<RooFitResult>(
+          Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
+    else
+      fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
+    double chi2minScan = fr->minNll();
+    if (std::isinf(chi2minScan))
+      chi2minScan = std::numeric_limits<double>::max();  // else the toys in PDF_testConstraint don't work
+    allResults.push_back(new RooSlimFitResult(fr.get()));
+    points[{i, j}] = {chi2minScan, allResults.back()};
+  };
+
+  // The coarse grid, fitted row by row in a serpentine, so that each fit is next to the previous one.
+  auto coarseGrid = [&](int nPoints) {
+    const int nCoarse = std::clamp(arg->adaptivescan, 2, nPoints);
+    std::vector<int> grid;
+    for (int k = 0; k < nCoarse; k++) grid.push_back(std::lround((double)k * (nPoints - 1) / (nCoarse - 1)));
+    return grid;
+  };
+  const std::vector<int> xs = coarseGrid(nPoints2dx);
+  const std::vector<int> ys = coarseGrid(nPoints2dy);
+  RooSlimFitResult* previous = nullptr;
+  for (int l = 0; l < ys.size(); l++) {
+    for (int k = 0; k < xs.size(); k++) {
+      const int i = l % 2 == 0 ? xs[k] : xs[xs.size() - 1 - k];
+      fitPoint(i, ys[l], previous);
+      previous = points.at({i, ys[l]}).sfr;
+    }
+  }
+
+  struct Cell {
+    int x0, x1, y0, y1;
+  };
+  std::vector<Cell> cells;
+  for (int k = 0; k + 1 < xs.size(); k++) {
+    for (int l = 0; l + 1 < ys.size(); l++) cells.push_back({xs[k], xs[k + 1], ys[l], ys[l + 1]});
+  }
+
+  // contour levels, in units of delta chi2
+  std::vector<double> thresholds;
+  for (int n = 1; n <= std::clamp(arg->plotnsigmacont, 1, 5); n++) {
+    thresholds.push_back(n * n);
+    thresholds.push_back(TMath::ChisquareQuantile(1. - TMath::Prob(n * n, 1), 2));
+    thresholds.push_back(TMath::ChisquareQuantile(1. - TMath::Prob(n * n, 2), 1));
+  }
+  for (const double cl : arg->CL) {
+    thresholds.push_back(TMath::ChisquareQuantile(cl / 100., 1));
+    thresholds.push_back(TMath::ChisquareQuantile(cl / 100., 2));
+  }
+
+  constexpr double kChi2Tolerance = 0.1;
+  std::vector<Cell> leaves;  // cells that are not refined any further
+  for (int nRound = 1; !cells.empty(); nRound++) {
+    double chi2minFitted = failed;
+    for (const auto& [ij, p] : points) chi2minFitted = std::min(chi2minFitted, p.chi2minScan);
+    const double chi2min = std::min(chi2minGlobal, chi2minFitted);
+
+    const int nFitsBefore = points.size();
+    std::vector<Cell> children;
+    for (const Cell& c : cells) {
+      const ScanPoint* best = nullptr;
+      double dMin = failed;
+      double dMax = -failed;
+      bool special = false;  // contains the smallest chi2 or a failed fit
+      const std::pair<int, int> corners[] = {{c.x0, c.y0}, {c.x1, c.y0}, {c.x0, c.y1}, {c.x1, c.y1}};
+      for (const auto& ij : corners) {
+        const ScanPoint& p = points.at(ij);
+        if (!best || p.chi2minScan < best->chi2minScan) best = &p;
+        special |= p.chi2minScan == failed || p.chi2minScan == chi2minFitted;
+        dMin = std::min(dMin, p.chi2minScan - chi2min);
+        dMax = std::max(dMax, p.chi2minScan - chi2min);
+      }
+      bool refine = special;
+      for (const double t : thresholds) refine |= dMin <= t && t <= dMax;
+      const bool splitX = c.x1 - c.x0 > 1;
+      const bool splitY = c.y1 - c.y0 > 1;
+      if (!refine || (!splitX && !splitY)) {
+        leaves.push_back(c);
+        continue;
+      }
+      std::vector<int> cx = {c.x0, c.x1};
+      std::vector<int> cy = {c.y0, c.y1};
+      if (splitX) cx.insert(cx.begin() + 1, (c.x0 + c.x1) / 2);
+      if (splitY) cy.insert(cy.begin() + 1, (c.y0 + c.y1) / 2);
+      // fit the new points and compare them to the bilinear interpolation of the corners
+      double maxDeviation = 0.;
+      for (int i : cx) {
+        for (int j : cy) {
+          fitPoint(i, j, best->sfr);
+          const double u = double(i - c.x0) / (c.x1 - c.x0);
+          const double v = double(j - c.y0) / (c.y1 - c.y0);
+          const double interpolated =
+              (1 - u) * (1 - v) * points.at(corners[0]).chi2minScan + u * (1 - v) * points.at(corners[1]).chi2minScan +
+              (1 - u) * v * points.at(corners[2]).chi2minScan + u * v * points.at(corners[3]).chi2minScan;
+          maxDeviation = std::max(maxDeviation, fabs(points.at({i, j}).chi2minScan - interpolated));
+        }
+      }
+      // smooth cells are interpolated well enough, and not refined further
+      std::vector<Cell>& next = !special && maxDeviation < kChi2Tolerance ? leaves : children;
+      for (int k = 0; k + 1 < cx.size(); k++) {
+        for (int l = 0; l + 1 < cy.size(); l++) next.push_back({cx[k], cx[k + 1], cy[l], cy[l + 1]});
+      }
+    }
+    cells = std::move(children);
+    std::cout << "MethodProbScan::scan2d() : refinement " << nRound << ": fitted " << points.size() - nFitsBefore
+              << " points   \r" << std::flush;
+  }
+  std::cout << "MethodProbScan::scan2d() : adaptive scan fitted " << points.size() << " of "
+            << nPoints2dx * nPoints2dy << " points" << std::endl;
+
+  // Fill the full grid: first the fitted points, then the bins in between, taken from
+  // the smallest cells first, as those interpolate between the closest points.
+  for (const auto& [ij, p] : points) {
+    processScanPoint2d(ij.first + 1, ij.second + 1, p.chi2minScan, p.sfr, ndof, bestMinFoundInScan, hDbgChi2min2d);
+  }
+  std::sort(leaves.begin(), leaves.end(), [](const Cell& a, const Cell& b) {
+    return (a.x1 - a.x0) * (a.y1 - a.y0) < (b.x1 - b.x0) * (b.y1 - b.y0);
+  });
+  std::vector<std::vector<bool>> filled(nPoints2dx, std::vector<bool>(nPoints2dy, false));
+  for (const auto& [ij, p] : points) filled[ij.first][ij.second] = true;
+  for (const Cell& c : leaves) {
+    const ScanPoint& p00 = points.at({c.x0, c.y0});
+    const ScanPoint& p10 = points.at({c.x1, c.y0});
+    const ScanPoint& p01 = points.at({c.x0, c.y1});
+    const ScanPoint& p11 = points.at({c.x1, c.y1});
+    const bool failedFit = p00.chi2minScan == failed || p10.chi2minScan == failed || p01.chi2minScan == failed ||
+                           p11.chi2minScan == failed;
+    for (int i = c.x0; i <= c.x1; i++) {
+      for (int j = c.y0; j <= c.y1; j++) {
+        if (filled[i][j]) continue;
+        filled[i][j] = true;
+        const double u = double(i - c.x0) / (c.x1 - c.x0);
+        const double v = double(j - c.y0) / (c.y1 - c.y0);
+        const ScanPoint& nearest = u < 0.5 ? (v < 0.5 ? p00 : p01) : (v < 0.5 ? p10 : p11);
+        const double chi2minScan =
+            failedFit ? nearest.chi2minScan
+                      : (1 - u) * (1 - v) * p00.chi2minScan + u * (1 - v) * p10.chi2minScan +
+                            (1 - u) * v * p01.chi2minScan + u * v * p11.chi2minScan;
+        const double oneMinusCL = TMath::Prob(chi2minScan - chi2minGlobal, ndof);
+        if (hCL2d->GetBinContent(i + 1, j + 1) < oneMinusCL) {
+          hCL2d->SetBinContent(i + 1, j + 1, oneMinusCL);
+          hChi2min2d->SetBinContent(i + 1, j + 1, chi2minScan);
+          hDbgChi2min2d->SetBinContent(i + 1, j + 1, chi2minScan);
+          curveResults2d[i][j] = nullptr;
+        }
+      }
+    }
+  }
+  for (const auto& [ij, p] : points) {
+    addAdaptiveResult(hCL2d->GetXaxis()->GetBinCenter(ij.first + 1), hCL2d->GetYaxis()->GetBinCenter(ij.second + 1),
+                      p.sfr);
+  }
+  drawDbg();
+}
+
 void MethodProbScan::sanityChecks() const {
   auto error = [](const std::string& msg) { Utils::errBase("MethodProbScan::sanityChecks() : ERROR : ", msg); };
 
@@ -495,7 +1339,10 @@ int MethodProbScan::scan2d() {
     std::cout << "MethodProbScan::scan2d() : INFO : There are not free parameters. I will scan without fitting"
               << std::endl;
 
-  RooFormulaVar nll("nll", "nll", "-2*log(@0)", RooArgSet(*likelihood));
+  NllMinimizer* nll = combiner->getNllMinimizer();
+  // with --warmstart, each fit starts from the covariance of the previous one
+  nll->setWarmStart(arg->warmstart);
+  const NllMinimizer::Stats statsBefore = nll->getStats();
 
   // Report on the smallest new minimum we come across while scanning.
   // Sometimes the scan doesn't find the minimum
@@ -538,6 +1385,31 @@ int MethodProbScan::scan2d() {
   TStopwatch tScan;
   TStopwatch tMemory;
 
+  auto drawDbg = [&]() {
+    hDbgChi2min2d->Draw("colz");
+    hDbgStart->Draw("boxsame");
+    startpointmark->Draw();
+    cDbg->Update();
+    cDbg->Modified();
+    gSystem->ProcessEvents();
+  };
+
+  // Fit only a coarse grid and refine it near the contours, or fit the points of
+  // the spiral on several worker processes. This is only worth it
+  // if there is something to fit. The serial spiral below is then skipped.
+  const bool adaptive = arg->adaptivescan > 0 && hasFreePars;
+  const bool forked = !adaptive && arg->ncores > 1 && hasFreePars;
+  if (adaptive) {
+    tScan.Start(false);
+    scan2dAdaptive(ndof, bestMinFoundInScan, hDbgChi2min2d, drawDbg);
+    tScan.Stop();
+  }
+  if (forked) {
+    tScan.Start(false);
+    scan2dForked(iStart, jStart, ndof, mycurveResults2d, bestMinFoundInScan, hDbgChi2min2d, hDbgStart, drawDbg);
+    tScan.Stop();
+  }
+
   // set up the scan spiral
   int X = 2 * nPoints2dx;
   int Y = 2 * nPoints2dy;
@@ -545,7 +1417,7 @@ int MethodProbScan::scan2d() {
   x = y = dx = 0;
   dy = -1;
   int t = std::max(X, Y);
-  int maxI = t * t;
+  int maxI = forked || adaptive ? 0 : t * t;
   for (int spiralstep = 0; spiralstep < maxI; spiralstep++) {
     if ((-X / 2 <= x) && (x <= X / 2) && (-Y / 2 <= y) && (y <= Y / 2)) {
       int i = x + iStart;
@@ -595,7 +1467,7 @@ int MethodProbScan::scan2d() {
         bool performFit = hasFreePars;
         if (!hasFreePars) {
           // There are no parameters to fit, just calculate NLL
-          chi2minScan = nll.getVal();
+          chi2minScan = nll->getVal();
           // But if we found another minimum, perform the fit!
           if (chi2minScan < bestMinFoundInScan) performFit = true;
         }
@@ -607,9 +1479,10 @@ int MethodProbScan::scan2d() {
           tFit.Start(false);
           std::unique_ptr<RooFitResult> fr;
           if (arg->probforce)
-            fr = std::unique_ptr<RooFitResult>(Utils::fitToMinForce(w, combiner->getPdfName()));
+            fr = std::unique_ptr<RooFitResult>(
+                Utils::fitToMinForce(w, nll, combiner->getPdfName(), "", true, arg->getForceConfig()));
           else
-            fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(likelihood, false, -1));
+            fr = std::unique_ptr<RooFitResult>(Utils::fitToMinBringBackAngles(nll, false, -1));
           chi2minScan = fr->minNll();
           if (std::isinf(chi2minScan))
             chi2minScan = std::numeric_limits<double>::max();  // else the toys in PDF_testConstraint don't work
@@ -624,49 +1497,12 @@ int MethodProbScan::scan2d() {
             par2->setConstant(true);
           }
         }
-        bestMinFoundInScan = std::min(chi2minScan, bestMinFoundInScan);
-
-        // If we find a new global minumum, this means that all
-        // previous 1-CL values are too high. We'll save the new possible solution, adjust the global
-        // minimum, return a status code, and stop.
-        if (chi2minScan > -500 && chi2minScan < chi2minGlobal) {
-          // warn only if there was a significant improvement
-          if (arg->debug || chi2minScan < chi2minGlobal - 1e-2) {
-            if (arg->verbose)
-              std::cout << "MethodProbScan::scan2d() : WARNING : '" << title
-                        << "' new global minimum found! chi2minGlobal=" << chi2minGlobal
-                        << " chi2minScan=" << chi2minScan << std::endl;
-          }
-          chi2minGlobal = chi2minScan;
-          // recompute previous 1-CL values
-          for (int k = 1; k <= hCL2d->GetNbinsX(); k++)
-            for (int l = 1; l <= hCL2d->GetNbinsY(); l++) {
-              hCL2d->SetBinContent(k, l, TMath::Prob(hChi2min2d->GetBinContent(k, l) - chi2minGlobal, ndof));
-            }
-        }
-
-        double deltaChi2 = chi2minScan - chi2minGlobal;
-        double oneMinusCL = TMath::Prob(deltaChi2, ndof);
-
-        // Save the 1-CL value. But only if better than before!
-        if (hCL2d->GetBinContent(i, j) < oneMinusCL) {
-          hCL2d->SetBinContent(i, j, oneMinusCL);
-          hChi2min2d->SetBinContent(i, j, chi2minScan);
-          hDbgChi2min2d->SetBinContent(i, j, chi2minScan);
-          curveResults2d[i - 1][j - 1] = sfr;
-        }
+        processScanPoint2d(i, j, chi2minScan, sfr, ndof, bestMinFoundInScan, hDbgChi2min2d);
 
         // draw/update histograms - doing only every nth update
         // depending on value of updateFreq
         // saves a lot of time for small combinations
-        if ((arg->interactive && ((int)nSteps % arg->updateFreq == 0)) || nSteps == nTotalSteps) {
-          hDbgChi2min2d->Draw("colz");
-          hDbgStart->Draw("boxsame");
-          startpointmark->Draw();
-          cDbg->Update();
-          cDbg->Modified();
-          gSystem->ProcessEvents();
-        }
+        if ((arg->interactive && ((int)nSteps % arg->updateFreq == 0)) || nSteps == nTotalSteps) drawDbg();
         tScan.Stop();
       }
     }
@@ -680,6 +1516,8 @@ int MethodProbScan::scan2d() {
     y += dy;
   }
   std::cout << "MethodProbScan::scan2d() : scan done.            " << std::endl;
+  if (arg->warmstart && !forked) (nll->getStats() - statsBefore).print("MethodProbScan::scan2d()");
+  nll->setWarmStart(false);
   if (arg->debug) {
     std::cout << "MethodProbScan::scan2d() : full scan time:             ";
     tScan.Print();
@@ -755,6 +1593,12 @@ void MethodProbScan::saveSolutions() {
         solutions.push_back(curveResults[j]);
       }
     }
+    // the bins of an adaptive scan between its fitted points have no curve result
+    for (const auto& p : adaptiveResults) {
+      if (hChi2min->FindBin(p.x) == i && std::ranges::find(solutions, p.sfr) == solutions.end()) {
+        solutions.push_back(p.sfr);
+      }
+    }
   }
 
   if (solutions.empty())
@@ -808,12 +1652,16 @@ void MethodProbScan::saveSolutions2d() {
         continue;
 
       RooSlimFitResult* r = curveResults2d[i - 1][j - 1];  // -1 because it starts counting at 0, but histograms at 1
+      // the bins of an adaptive scan between its fitted points have no curve result
+      for (const auto& p : adaptiveResults) {
+        if (!r && hChi2min2d->FindBin(p.x, p.y) == hChi2min2d->GetBin(i, j)) r = p.sfr;
+      }
       if (!r) {
         error(std::format("No corresponding RooFitResult found! Skipping (i,j)=({:d},{:d})", i, j), false);
         continue;
       }
       if (arg->debug) info(std::format("Saving solution of bin ({:d},{:d})...", i, j));
-      solutions.push_back((RooSlimFitResult*)curveResults2d[i - 1][j - 1]->Clone());
+      solutions.push_back((RooSlimFitResult*)r->Clone());
     }
   }
 
@@ -839,3 +1687,161 @@ double MethodProbScan::getChi2min(double scanpoint) const {
   int iBin = hChi2min->FindBin(scanpoint);
   return hChi2min->GetBinContent(iBin);
 }
+
+///
+/// Compute a hash of everything the profile likelihood depends on: the
+/// measurements, theory relations and parameters of the combination, the
+/// scan range and binning, and the options steering the scan. Requires
+/// initScan().
+///
+/// \return MD5 hash of the configuration
+///
+TString MethodProbScan::getProfileConfigHash() const {
+  TString config = "version=3 combiner=" + combiner->getName();
+  for (PDF_Abs* pdf : combiner->getPdfs()) {
+    config += " pdf=" + pdf->getName();
+    for (const auto obs : *pdf->getObservables()) {
+      config += Form(" %s=%.17g", obs->GetName(), pdf->getObservableValue(obs->GetName()));
+    }
+    for (int i = 0; i < pdf->covMatrix.GetNrows(); i++) {
+      for (int j = 0; j <= i; j++) config += Form(" %.17g", pdf->covMatrix[i][j]);
+    }
+  }
+  if (const RooArgSet* theory = w->set(thName)) {
+    for (const auto th : *theory) {
+      const auto formula = dynamic_cast<RooFormulaVar*>(th);
+      config += Form(" th=%s:%s", th->GetName(), formula ? formula->expression() : th->ClassName());
+    }
+  }
+  for (const auto& p : combiner->getConstVars()) {
+    config += Form(" const=%s:%i:%.17g", p.name.Data(), p.useValue, p.value);
+  }
+  for (const auto p : *combiner->getParameters()) {
+    const auto var = static_cast<RooRealVar*>(p);
+    config += Form(" par=%s", var->GetName());
+    for (const TString range : {"phys", "free"}) {
+      if (var->hasRange(range)) config += Form(":%.17g:%.17g", var->getMin(range), var->getMax(range));
+    }
+  }
+  if (scanVar2 != "") {
+    const TAxis* x = hCL2d->GetXaxis();
+    const TAxis* y = hCL2d->GetYaxis();
+    config += Form(" scan=%s:%.17g:%.17g:%i", scanVar1.Data(), x->GetXmin(), x->GetXmax(), x->GetNbins());
+    config += Form(" scan=%s:%.17g:%.17g:%i", scanVar2.Data(), y->GetXmin(), y->GetXmax(), y->GetNbins());
+    if (arg->adaptivescan > 0) config += Form(" ncontours=%i", arg->plotnsigmacont);
+  } else {
+    const TAxis* x = hCL->GetXaxis();
+    config += Form(" scan=%s:%.17g:%.17g:%i", scanVar1.Data(), x->GetXmin(), x->GetXmax(), x->GetNbins());
+  }
+  config += Form(" adaptivescan=%i confirmsols=%i probforce=%i probimprove=%i teststatistic=%i", arg->adaptivescan,
+                 arg->confirmsols, arg->probforce, arg->probimprove, arg->teststatistic);
+  for (const auto& file : arg->loadParamsFile) config += " parfile=" + file;
+
+  TMD5 md5;
+  md5.Update(reinterpret_cast<const UChar_t*>(config.Data()), config.Length());
+  md5.Final();
+  return md5.AsString();
+}
+
+///
+/// Save the full profile likelihood to a root file: everything saveScanner()
+/// saves, plus the fit results at all scan points, the global minimum and the
+/// hash of the configuration. Plugin batch jobs load it with loadProfile()
+/// instead of repeating the scan. The fit results are stored in a single
+/// TObjArray, those of 2d scans row by row, as one key per result makes
+/// writing and reading large 2d scans slow. The points of adaptive scans are
+/// stored in a second TObjArray, with their coordinates in a TVectorD.
+/// The file is written under a
+/// temporary name first, so that jobs reading it never see a partial file.
+///
+void MethodProbScan::saveProfile(TString fName) const {
+  if (arg->debug) std::cout << "MethodProbScan::saveProfile() : saving profile: " << fName << std::endl;
+  const TString tmpName = fName + Form(".tmp%i", gSystem->GetPid());
+  saveScanner(tmpName);
+  TFile f(tmpName, "update");
+  TNamed("configHash", getProfileConfigHash().Data()).Write();
+  TParameter<double>("chi2minGlobal", chi2minGlobal).Write();
+  TParameter<double>("chi2minBkg", chi2minBkg).Write();
+  TObjArray curves;
+  if (scanVar2 != "") {
+    for (int i = 0; i < curveResults2d.size(); i++) {
+      for (int j = 0; j < curveResults2d[i].size(); j++) {
+        if (curveResults2d[i][j]) curves.AddAtAndExpand(curveResults2d[i][j], i * nPoints2dy + j);
+      }
+    }
+  } else {
+    for (int i = 0; i < curveResults.size(); i++) {
+      if (curveResults[i]) curves.AddAtAndExpand(curveResults[i], i);
+    }
+  }
+  curves.Write("curveResults", TObject::kSingleKey);
+  // the points of an adaptive scan, most of which are not in the curve results
+  TObjArray adaptive;
+  TVectorD adaptiveXY(2 * adaptiveResults.size());
+  for (int k = 0; k < adaptiveResults.size(); k++) {
+    adaptive.AddAtAndExpand(adaptiveResults[k].sfr, k);
+    adaptiveXY[2 * k] = adaptiveResults[k].x;
+    adaptiveXY[2 * k + 1] = adaptiveResults[k].y;
+  }
+  adaptive.Write("adaptiveResults", TObject::kSingleKey);
+  adaptiveXY.Write("adaptiveXY");
+  f.Close();
+  gSystem->Rename(tmpName, fName);
+}
+
+///
+/// Load a profile likelihood saved by saveProfile(). Requires initScan(),
+/// as the configuration of this scanner is compared to the saved one.
+///
+/// \param fName - the file name
+/// \return false if the file doesn't exist or the configuration has changed
+///
+bool MethodProbScan::loadProfile(TString fName) {
+  if (!Utils::FileExists(fName)) return false;
+  {
+    std::unique_ptr<TFile> f(TFile::Open(fName));
+    const auto configHash = f ? f->Get<TNamed>("configHash") : nullptr;
+    if (!configHash || getProfileConfigHash() != configHash->GetTitle()) {
+      std::cout << "MethodProbScan::loadProfile() : combination or configuration has changed, ignoring " << fName
+                << std::endl;
+      return false;
+    }
+    const auto chi2minGlobalSaved = f->Get<TParameter<double>>("chi2minGlobal");
+    const auto chi2minBkgSaved = f->Get<TParameter<double>>("chi2minBkg");
+    const auto curves = std::unique_ptr<TObjArray>(f->Get<TObjArray>("curveResults"));
+    const auto adaptive = std::unique_ptr<TObjArray>(f->Get<TObjArray>("adaptiveResults"));
+    const auto adaptiveXY = std::unique_ptr<TVectorD>(f->Get<TVectorD>("adaptiveXY"));
+    if (!chi2minGlobalSaved || !chi2minBkgSaved || !curves || !adaptive || !adaptiveXY ||
+        adaptiveXY->GetNrows() != 2 * (adaptive->GetLast() + 1)) {
+      std::cout << "MethodProbScan::loadProfile() : WARNING : " << fName << " is incomplete, ignoring it." << std::endl;
+      return false;
+    }
+    setChi2minGlobal(chi2minGlobalSaved->GetVal());
+    chi2minBkg = chi2minBkgSaved->GetVal();
+    curves->SetOwner(false);  // the fit results are kept in allResults
+    auto curve = [&](int k) {
+      return k <= curves->GetLast() ? static_cast<RooSlimFitResult*>(curves->At(k)) : nullptr;
+    };
+    if (scanVar2 != "") {
+      for (int i = 0; i < curveResults2d.size(); i++) {
+        for (int j = 0; j < curveResults2d[i].size(); j++) {
+          curveResults2d[i][j] = curve(i * nPoints2dy + j);
+          if (curveResults2d[i][j]) allResults.push_back(curveResults2d[i][j]);
+        }
+      }
+    } else {
+      for (int i = 0; i < curveResults.size(); i++) {
+        curveResults[i] = curve(i);
+        if (curveResults[i]) allResults.push_back(curveResults[i]);
+      }
+    }
+    adaptive->SetOwner(false);
+    adaptiveResults.clear();
+    for (int k = 0; k <= adaptive->GetLast(); k++) {
+      const auto sfr = static_cast<RooSlimFitResult*>(adaptive->At(k));
+      adaptiveResults.push_back({(*adaptiveXY)[2 * k], (*adaptiveXY)[2 * k + 1], sfr});
+      allResults.push_back(sfr);
+    }
+  }
+  return loadScanner(fName);
+}
@@ -0,0 +1,481 @@
+#include <NllMinimizer.h>
+
+#include <RooGaussianChi2.h>
+#include <RooMinusTwoLogL.h>
+#include <TheoryGradient.h>
+#include <rdtsc.h>
+
+#include <RooAbsPdf.h>
+#include <RooArgList.h>
+#include <RooArgSet.h>
+#include <RooFitResult.h>
+#include <RooMinimizer.h>
+#include <RooMsgService.h>
+#include <RooRealVar.h>
+
+#include <Math/Factory.h>
+#include <Math/IFunction.h>
+#include <Math/Minimizer.h>
+#include <Math/MinimizerOptions.h>
+#include <TMatrixDSym.h>
+#include <TString.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace {
+  bool analyticGradient = true;
+
+  /// Minuit strategy of the warm fits. Migrad then only runs Hesse by itself
+  /// if the covariance changed noticeably during the minimization.
+  constexpr int warmStrategy = 1;
+  /// Largest EDM accepted for a warm fit.
+  constexpr double warmMaxEdm = 1e-3;
+
+  ///
+  /// -2*log(L) as a function of its floating parameters, for ROOT::Math::Minimizer.
+  ///
+  class NllFunction : public ROOT::Math::IMultiGenFunction {
+   public:
+    NllFunction(const RooAbsReal* nll, std::vector<RooRealVar*> vars, long* nCalls)
+        : _nll(nll), _vars(std::move(vars)), _nCalls(nCalls) {}
+
+    unsigned int NDim() const override { return _vars.size(); }
+    ROOT::Math::IMultiGenFunction* Clone() const override { return new NllFunction(*this); }
+
+   private:
+    double DoEval(const double* x) const override {
+      (*_nCalls)++;
+      for (size_t i = 0; i < _vars.size(); i++) {
+        if (_vars[i]->getVal() != x[i]) _vars[i]->setVal(x[i]);
+      }
+      return _nll->getVal();
+    }
+
+    const RooAbsReal* _nll;
+    std::vector<RooRealVar*> _vars;  ///< the floating parameters
+    long* _nCalls;                   ///< counter of the function calls, shared by all clones
+  };
+
+  ///
+  /// The chi2 of a RooGaussianChi2 as a function of its floating parameters,
+  /// with the analytic gradient, for ROOT::Math::Minimizer.
+  ///
+  class GradientFunction : public ROOT::Math::IMultiGradFunction {
+   public:
+    GradientFunction(const RooGaussianChi2* chi2, const TheoryGradient* gradient, std::vector<RooRealVar*> vars,
+                     std::vector<int> index, long* nCalls)
+        : _chi2(chi2), _gradient(gradient), _vars(std::move(vars)), _index(std::move(index)), _nCalls(nCalls),
+          _all(_vars.size()) {}
+
+    unsigned int NDim() const override { return _vars.size(); }
+    ROOT::Math::IMultiGradFunction* Clone() const override { return new GradientFunction(*this); }
+
+    void Gradient(const double* x, double* grad) const override {
+      (*_nCalls)++;
+      setParameters(x);
+      _chi2->evaluateTheoryGradient(_dChi2dTh);
+      _gradient->accumulate(_dChi2dTh, _grad);
+      for (size_t i = 0; i < _vars.size(); i++) grad[i] = _grad[_index[i]];
+    }
+
+   private:
+    double DoEval(const double* x) const override {
+      (*_nCalls)++;
+      setParameters(x);
+      return _chi2->getVal();
+    }
+
+    double DoDerivative(const double* x, unsigned int icoord) const override {
+      Gradient(x, _all.data());
+      return _all[icoord];
+    }
+
+    void setParameters(const double* x) const {
+      for (size_t i = 0; i < _vars.size(); i++) {
+        if (_vars[i]->getVal() != x[i]) _vars[i]->setVal(x[i]);
+      }
+    }
+
+    const RooGaussianChi2* _chi2;
+    const TheoryGradient* _gradient;
+    std::vector<RooRealVar*> _vars;  ///< the floating parameters
+    std::vector<int> _index;         ///< their positions in the parameters of the TheoryGradient
+    long* _nCalls;                   ///< counter of the function and gradient calls, shared by all clones
+    mutable std::vector<double> _dChi2dTh;
+    mutable std::vector<double> _grad;
+    mutable std::vector<double> _all;
+  };
+
+  ///
+  /// A RooFitResult filled from a ROOT::Math::Minimizer, the way RooMinimizer::save() does.
+  ///
+  class GradientFitResult : public RooFitResult {
+   public:
+    explicit GradientFitResult(const char* name) : RooFitResult(name, name) {}
+
+    void fill(const RooArgList& constPars, const RooArgList& initPars, const RooArgList& finalPars,
+              const ROOT::Math::Minimizer& m) {
+      setConstParList(constPars);
+      setInitParList(initPars);
+      setFinalParList(finalPars);
+      setMinNLL(m.MinValue());
+      setEDM(m.Edm());
+      setStatus(m.Status());
+      setCovQual(m.CovMatrixStatus());
+      setNumInvalidNLL(0);
+      const int n = finalPars.size();
+      TMatrixDSym cov(n);
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) cov(i, j) = m.CovMatrix(i, j);
+      }
+      setCovarianceMatrix(cov);
+    }
+  };
+}  // namespace
+
+///
+/// Build -2*log(L) of the given pdf and a minimizer for it.
+/// The minimizer is configured like the fits of the package have
+/// always been: error level 1, strategy 2. A product of
+/// RooMultiVarGaussians gets the RooGaussianChi2 fast path, with
+/// compiled theory relations.
+///
+/// \param pdf The likelihood pdf. Not owned, must outlive this object.
+///
+NllMinimizer::NllMinimizer(RooAbsPdf* pdf) : _pdf(pdf) {
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  const TString name = TString("nll_") + pdf->GetName();
+  RooArgList gaussians;
+  if (RooGaussianChi2::findGaussians(*pdf, gaussians)) {
+    auto chi2 = std::make_unique<RooGaussianChi2>(name, name, gaussians);
+    chi2->compileTheory();
+    _chi2 = chi2.get();
+    _nll = std::move(chi2);
+  } else {
+    _nll = std::make_unique<RooMinusTwoLogL>(name, name, *pdf);
+  }
+  _minimizer = std::make_unique<RooMinimizer>(*_nll);
+  _minimizer->setErrorLevel(1.0);
+  _minimizer->setStrategy(2);
+  _minimizer->setProfile(0);  // 1 enables migrad timer
+  std::unique_ptr<RooArgSet> params(_nll->getParameters(RooArgSet()));
+  for (const auto p : *params) {
+    if (dynamic_cast<RooRealVar*>(p)) _params.add(*p);
+  }
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+}
+
+NllMinimizer::~NllMinimizer() = default;
+
+///
+/// Use the analytic gradient for the fits of the Gaussian fast path (default),
+/// or let Minuit compute numerical derivatives as for all other pdfs.
+/// Applies to all NllMinimizers.
+///
+void NllMinimizer::setUseGradient(bool use) { analyticGradient = use; }
+
+///
+/// \return True if the fits of the Gaussian fast path use the analytic gradient.
+///
+bool NllMinimizer::useGradient() { return analyticGradient; }
+
+///
+/// Start the following fits from the covariance of the last converged fit
+/// (warm start), or switch this off. Either way, the kept covariance is
+/// dropped, so the next fit is a normal one.
+///
+void NllMinimizer::setWarmStart(bool warm) {
+  _warmStart = warm;
+  resetWarmStart();
+}
+
+///
+/// Drop the covariance kept for the warm start, e.g. when the parameters
+/// are reset to values far from the last fit. The next fit is a normal one.
+///
+void NllMinimizer::resetWarmStart() {
+  _warmNames.clear();
+  _warmCov.clear();
+}
+
+///
+/// Fit the pdf to the minimum, starting from the current parameter values.
+///
+/// With the warm start, and if the last fit had the same floating parameters,
+/// Minuit starts from its covariance with strategy 1 instead of 2. The warm fit
+/// is accepted if it converged with an EDM below 1e-3. Strategy 1 doesn't always
+/// end with a full Hesse, so the covariance may only be approximate; this is
+/// counted in the stats, and the covariance is still used for the next warm fit
+/// if it is positive definite. Otherwise the parameters are reset to the start
+/// values and the fit is redone as without the warm start.
+///
+/// \param thorough Run Hesse after Migrad.
+/// \param printLevel -1 = no output, 1 verbose output
+/// \return The fit result. The caller takes ownership.
+///
+RooFitResult* NllMinimizer::fit(bool thorough, int printLevel) {
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  const bool quiet = printLevel < 0;
+  bool gradient = _chi2 && analyticGradient;
+  if (gradient) {
+    // the analytic gradient is with respect to the parameters of the theory only
+    for (const auto obs : _chi2->getObservables()) {
+      if (!obs->isConstant()) gradient = false;
+    }
+  }
+  unsigned long long start = rdtsc();
+  RooFitResult* r = nullptr;
+  long nCalls = 0;
+  std::vector<double> cov;
+  if (_warmStart && getWarmCovariance(cov)) {
+    std::unique_ptr<RooArgList> startValues(static_cast<RooArgList*>(_params.snapshot()));
+    r = fitMinuit(thorough, quiet, gradient, &cov, nCalls);
+    if (r->status() == 0 && r->edm() < warmMaxEdm) {
+      _stats.nWarm++;
+      _stats.nCallsWarm += nCalls;
+      if (r->covQual() < 3) _stats.nWarmApproxCov++;
+    } else {
+      if (!quiet) {
+        std::cout << "NllMinimizer::fit() : warm start failed (status=" << r->status() << ", covQual=" << r->covQual()
+                  << ", edm=" << r->edm() << "), fitting again" << std::endl;
+      }
+      _stats.nEscalated++;
+      _stats.nCallsEscalated += nCalls;
+      _stats.nCalls += nCalls;
+      nCalls = 0;
+      delete r;
+      r = nullptr;
+      for (int i = 0; i < _params.size(); i++) {
+        const auto var = static_cast<RooRealVar*>(_params.at(i));
+        const auto startVar = static_cast<const RooRealVar*>(startValues->at(i));
+        var->setVal(startVar->getVal());
+        var->setError(startVar->getError());
+      }
+    }
+  }
+  if (!r && gradient) {
+    r = fitMinuit(thorough, quiet, true, nullptr, nCalls);
+  } else if (!r) {
+    const int nCallsBefore = _minimizer->evalCounter();
+    _minimizer->setPrintLevel(quiet ? -2 : 1);
+    _minimizer->migrad();
+    // MINOS seems to fail in more complicated scenarios, and IMPROVE doesn't really improve much
+    if (thorough) _minimizer->hesse();
+    r = _minimizer->save();
+    nCalls = _minimizer->evalCounter() - nCallsBefore;
+  }
+  if (_warmStart) saveWarmCovariance(r);
+  unsigned long long stop = rdtsc();
+  if (!quiet) std::printf("Fit took %llu clock cycles.\n", stop - start);
+  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
+  _stats.nFits++;
+  _stats.nCalls += nCalls;
+  return r;
+}
+
+///
+/// Fit with a ROOT::Math::Minimizer, which, unlike RooMinimizer, takes the
+/// analytic gradient and a starting covariance. Like RooMinimizer, the
+/// parameters are set up from their current values, errors, limits and
+/// constant flags, and are left at the minimum with the Hesse errors.
+///
+/// \param thorough Run Hesse after Migrad.
+/// \param quiet Suppress the Minuit output.
+/// \param gradient Use the analytic gradient of the RooGaussianChi2.
+/// \param cov Starting covariance of the floating parameters, packed upper triangle
+///            by rows (see getWarmCovariance()). nullptr for a normal fit with strategy 2.
+/// \param nCalls Set to the number of function and gradient calls.
+/// \return The fit result. The caller takes ownership.
+///
+RooFitResult* NllMinimizer::fitMinuit(bool thorough, bool quiet, bool gradient, const std::vector<double>* cov,
+                                      long& nCalls) {
+  if (gradient && !_gradient) {
+    _gradient = std::make_unique<TheoryGradient>(_chi2->getTheory(), _params);
+    if (!quiet) {
+      std::cout << "NllMinimizer::fitMinuit() : " << _gradient->getNAnalytic() << " of "
+                << _gradient->getNRelations() << " theory relations differentiated analytically" << std::endl;
+    }
+  }
+  if (!_gradMinimizer) {
+    _gradMinimizer.reset(
+        ROOT::Math::Factory::CreateMinimizer(ROOT::Math::MinimizerOptions::DefaultMinimizerType(), "Migrad"));
+    if (!_gradMinimizer) {
+      std::cout << "NllMinimizer::fitMinuit() : ERROR : could not create the minimizer "
+                << ROOT::Math::MinimizerOptions::DefaultMinimizerType() << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // the floating parameters, at the start of this fit
+  std::vector<RooRealVar*> vars;
+  std::vector<int> index;
+  RooArgList constPars;
+  RooArgList floatPars;
+  for (int i = 0; i < _params.size(); i++) {
+    const auto var = static_cast<RooRealVar*>(_params.at(i));
+    if (var->isConstant()) {
+      constPars.add(*var);
+      continue;
+    }
+    vars.push_back(var);
+    index.push_back(i);
+    floatPars.add(*var);
+  }
+
+  ROOT::Math::Minimizer* m = _gradMinimizer.get();
+  m->Clear();
+  m->SetPrintLevel(quiet ? -1 : 1);
+  m->SetErrorDef(1.0);
+  m->SetStrategy(cov ? warmStrategy : 2);
+  m->SetMaxFunctionCalls(500 * vars.size());
+  m->SetMaxIterations(500 * vars.size());
+  for (size_t i = 0; i < vars.size(); i++) {
+    const RooRealVar* var = vars[i];
+    const bool hasMin = var->hasMin();
+    const bool hasMax = var->hasMax();
+    double step = var->getError();
+    if (step <= 0.) step = (hasMin && hasMax) ? 0.1 * (var->getMax() - var->getMin()) : 1.;
+    if (hasMin && hasMax) {
+      m->SetLimitedVariable(i, var->GetName(), var->getVal(), step, var->getMin(), var->getMax());
+    } else if (hasMin) {
+      m->SetLowerLimitedVariable(i, var->GetName(), var->getVal(), step, var->getMin());
+    } else if (hasMax) {
+      m->SetUpperLimitedVariable(i, var->GetName(), var->getVal(), step, var->getMax());
+    } else {
+      m->SetVariable(i, var->GetName(), var->getVal(), step);
+    }
+  }
+  // minimizers other than Minuit2 ignore the covariance, then the warm start only lowers the strategy
+  if (cov) m->SetCovariance(*cov, vars.size());
+  nCalls = 0;
+  std::unique_ptr<ROOT::Math::IMultiGenFunction> function;
+  if (gradient) {
+    function = std::make_unique<GradientFunction>(_chi2, _gradient.get(), vars, index, &nCalls);
+  } else {
+    function = std::make_unique<NllFunction>(_nll.get(), vars, &nCalls);
+  }
+  m->SetFunction(*function);
+
+  auto r = std::make_unique<GradientFitResult>(TString("fitresult_") + _nll->GetName());
+  std::unique_ptr<RooArgList> initPars(static_cast<RooArgList*>(floatPars.snapshot()));
+  m->Minimize();
+  // MINOS seems to fail in more complicated scenarios, and IMPROVE doesn't really improve much
+  if (thorough) m->Hesse();
+
+  const double* x = m->X();
+  const double* errors = m->Errors();
+  for (size_t i = 0; i < vars.size(); i++) {
+    vars[i]->setVal(x[i]);
+    if (errors) vars[i]->setError(errors[i]);
+  }
+  r->fill(constPars, *initPars, floatPars, *m);
+  // return a plain RooFitResult, which can be copied and written as usual
+  return new RooFitResult(*r);
+}
+
+///
+/// The covariance kept for the warm start, for the current floating parameters.
+///
+/// \param cov Filled with the packed upper triangle by rows, in the order of the floating parameters.
+/// \return False if there is no covariance, or the floating parameters have changed since.
+///
+bool NllMinimizer::getWarmCovariance(std::vector<double>& cov) const {
+  if (_warmNames.empty()) return false;
+  std::map<std::string, int> position;
+  for (size_t i = 0; i < _warmNames.size(); i++) position[_warmNames[i]] = i;
+  std::vector<int> index;
+  for (const auto p : _params) {
+    if (p->isConstant()) continue;
+    const auto it = position.find(p->GetName());
+    if (it == position.end()) return false;
+    index.push_back(it->second);
+  }
+  const int n = _warmNames.size();
+  if (static_cast<int>(index.size()) != n) return false;
+  cov.clear();
+  for (int i = 0; i < n; i++) {
+    for (int j = i; j < n; j++) cov.push_back(_warmCov[index[i] * n + index[j]]);
+  }
+  return true;
+}
+
+///
+/// Keep the covariance of a fit for the warm start of the next one, if the fit
+/// converged and the covariance is positive definite, if need be forced to
+/// (covQual 2). Otherwise the next fit is a normal one.
+///
+void NllMinimizer::saveWarmCovariance(const RooFitResult* r) {
+  resetWarmStart();
+  if (r->status() != 0 || r->covQual() < 2) return;
+  const TMatrixDSym& c = r->covarianceMatrix();
+  const int n = r->floatParsFinal().size();
+  if (n == 0 || c.GetNrows() != n) return;
+  for (const auto p : r->floatParsFinal()) _warmNames.push_back(p->GetName());
+  _warmCov.resize(n * n);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) _warmCov[i * n + j] = c(i, j);
+  }
+}
+
+///
+/// Add the counters of another NllMinimizer, e.g. of a worker process of a scan.
+///
+NllMinimizer::Stats& NllMinimizer::Stats::operator+=(const Stats& other) {
+  nFits += other.nFits;
+  nWarm += other.nWarm;
+  nEscalated += other.nEscalated;
+  nWarmApproxCov += other.nWarmApproxCov;
+  nCalls += other.nCalls;
+  nCallsWarm += other.nCallsWarm;
+  nCallsEscalated += other.nCallsEscalated;
+  return *this;
+}
+
+///
+/// \return The counters since an earlier state, e.g. of one scan.
+///
+NllMinimizer::Stats NllMinimizer::Stats::operator-(const Stats& other) const {
+  Stats d;
+  d.nFits = nFits - other.nFits;
+  d.nWarm = nWarm - other.nWarm;
+  d.nEscalated = nEscalated - other.nEscalated;
+  d.nWarmApproxCov = nWarmApproxCov - other.nWarmApproxCov;
+  d.nCalls = nCalls - other.nCalls;
+  d.nCallsWarm = nCallsWarm - other.nCallsWarm;
+  d.nCallsEscalated = nCallsEscalated - other.nCallsEscalated;
+  return d;
+}
+
+///
+/// Print how many fits were warm started, and the function calls saved. The
+/// calls a warm fit would have needed as a normal fit are estimated by the mean
+/// of the other fits, the failed warm starts are counted as a loss.
+///
+/// \param caller Prefix of the printout, e.g. "MethodProbScan::scan1d()".
+///
+void NllMinimizer::Stats::print(const char* caller) const {
+  if (nFits == 0) return;
+  const int nCold = nFits - nWarm;
+  std::cout << std::format("{} : warm start: {} of {} fits ({} with approximate covariance), {} refitted, "
+                           "{} function calls",
+                           caller, nWarm, nFits, nWarmApproxCov, nEscalated, nCalls)
+            << std::endl;
+  if (nWarm == 0 || nCold == 0) return;
+  const double perWarm = double(nCallsWarm) / nWarm;
+  const double perCold = double(nCalls - nCallsWarm - nCallsEscalated) / nCold;
+  const double saved = nWarm * perCold - nCallsWarm - nCallsEscalated;
+  std::cout << std::format("{} : {:.1f} calls per warm fit, {:.1f} per normal fit, {:.0f} calls ({:.1f}%) saved",
+                           caller, perWarm, perCold, saved, 100. * saved / (nFits * perCold))
+            << std::endl;
+}
+
+///
+/// \return -2*log(L) at the current parameter values.
+///
+double NllMinimizer::getVal() const { return _nll->getVal(); }
@@ -278,6 +278,8 @@ OptParser::OptParser() {
 ///
 void OptParser::defineOptions() {
   availableOptions.push_back("action");
+  availableOptions.push_back("adaptivescan");
+  availableOptions.push_back("adaptivetoys");
   availableOptions.push_back("asimov");
   availableOptions.push_back("asimovfile");
   availableOptions.push_back("batchstartn");
@@ -304,6 +306,9 @@ void OptParser::defineOptions() {
   availableOptions.push_back("filltransparency");
   availableOptions.push_back("fillcolor");
   availableOptions.push_back("fix");
+  availableOptions.push_back("forcebudget");
+  availableOptions.push_back("forceconfirm");
+  availableOptions.push_back("forcedesign");
   availableOptions.push_back("ext");
   availableOptions.push_back("hfagLabel");
   availableOptions.push_back("hfagLabelPos");
@@ -330,18 +335,23 @@ void OptParser::defineOptions() {
   availableOptions.push_back("loadParamsFile");
   availableOptions.push_back("log");
   availableOptions.push_back("magnetic");
+  availableOptions.push_back("maxtoys");
   availableOptions.push_back("nbatchjobs");
   // availableOptions.push_back("nBBpoints");
   availableOptions.push_back("noconfsols");
   availableOptions.push_back("nosyst");
+  availableOptions.push_back("notoycache");
   availableOptions.push_back("npoints");
   availableOptions.push_back("npoints2dx");
   availableOptions.push_back("npoints2dy");
   availableOptions.push_back("npointstoy");
+  availableOptions.push_back("ncores");
   availableOptions.push_back("ncoveragetoys");
   availableOptions.push_back("nrun");
+  availableOptions.push_back("nthreads");
   availableOptions.push_back("ntoys");
   availableOptions.push_back("nsmooth");
+  availableOptions.push_back("numgrad");
   availableOptions.push_back("origin");
   // availableOptions.push_back("pevid");
   availableOptions.push_back("pr");
@@ -374,11 +384,14 @@ void OptParser::defineOptions() {
   availableOptions.push_back("scanrangey");
   availableOptions.push_back("scaleerr");
   availableOptions.push_back("scalestaterr");
+  availableOptions.push_back("seed");
   availableOptions.push_back("smooth2d");
   availableOptions.push_back("square");
   availableOptions.push_back("start");
   availableOptions.push_back("teststat");
+  availableOptions.push_back("toycompression");
   availableOptions.push_back("toyFiles");
+  availableOptions.push_back("toyprecision");
   availableOptions.push_back("title");
   availableOptions.push_back("xtitle");
   availableOptions.push_back("ytitle");
@@ -387,6 +400,7 @@ void OptParser::defineOptions() {
   availableOptions.push_back("unoff");
   availableOptions.push_back("var");
   availableOptions.push_back("verbose");
+  availableOptions.push_back("warmstart");
   // availableOptions.push_back("relation");
   availableOptions.push_back("pluginplotrange");
   availableOptions.push_back("plotnsigmacont");
@@ -438,6 +452,7 @@ void OptParser::bookPlottingOptions() {
 /// control plots).
 ///
 void OptParser::bookPluginOptions() {
+  bookedOptions.push_back("adaptivetoys");
   bookedOptions.push_back("batchstartn");
   bookedOptions.push_back("batcheos");
   bookedOptions.push_back("batchout");
@@ -448,11 +463,16 @@ void OptParser::bookPluginOptions() {
   bookedOptions.push_back("importance");
   bookedOptions.push_back("jobs");
   bookedOptions.push_back("lightfiles");
+  bookedOptions.push_back("maxtoys");
   bookedOptions.push_back("nbatchjobs");
+  bookedOptions.push_back("ncores");
+  bookedOptions.push_back("notoycache");
+  bookedOptions.push_back("nthreads");
   // bookedOptions.push_back("nBBpoints");
   bookedOptions.push_back("npointstoy");
   bookedOptions.push_back("nrun");
   bookedOptions.push_back("ntoys");
+  bookedOptions.push_back("numgrad");
   bookedOptions.push_back("nsmooth");
   // bookedOptions.push_back("pevid");
   bookedOptions.push_back("pr");
@@ -460,18 +480,27 @@ void OptParser::bookPluginOptions() {
   bookedOptions.push_back("intprob");
   bookedOptions.push_back("po");
   bookedOptions.push_back("pluginplotrange");
+  bookedOptions.push_back("seed");
+  bookedOptions.push_back("toycompression");
+  bookedOptions.push_back("toyprecision");
 }
 
 ///
 /// Book options associated to the Prob method.
 ///
 void OptParser::bookProbOptions() {
+  bookedOptions.push_back("adaptivescan");
   bookedOptions.push_back("asimov");
   bookedOptions.push_back("asimovfile");
   bookedOptions.push_back("evol");
+  bookedOptions.push_back("forcebudget");
+  bookedOptions.push_back("forceconfirm");
+  bookedOptions.push_back("forcedesign");
+  bookedOptions.push_back("ncores");
   bookedOptions.push_back("npoints");
   bookedOptions.push_back("npoints2dx");
   bookedOptions.push_back("npoints2dy");
+  bookedOptions.push_back("numgrad");
   bookedOptions.push_back("pr");
   bookedOptions.push_back("physrange");
   bookedOptions.push_back("sn");
@@ -481,6 +510,7 @@ void OptParser::bookProbOptions() {
   bookedOptions.push_back("pulls");
   bookedOptions.push_back("scanforce");
   bookedOptions.push_back("scanforce");
+  bookedOptions.push_back("warmstart");
 }
 
 ///
@@ -517,6 +547,19 @@ bool OptParser::isAction(TString s) const { return Utils::isIn<TString>(action,
 ///
 bool OptParser::isQuickhack(int id) const { return Utils::isIn<int>(qh, id); }
 
+///
+/// Collect the settings of the minimum finding of --probforce and --scanforce,
+/// see Utils::fitToMinForce().
+///
+Utils::ForceConfig OptParser::getForceConfig() const {
+  Utils::ForceConfig config;
+  if (forcedesign == "sobol") config.design = Utils::kSobol;
+  if (forcedesign == "lhs") config.design = Utils::kLatinHypercube;
+  config.budget = forcebudget;
+  config.nConfirm = forceconfirm;
+  return config;
+}
+
 ///
 /// Parse the command line for booked options. Then apply some
 /// post-processing and checks, where necessary. Save the parsed
@@ -653,6 +696,12 @@ void OptParser::parseArguments(int argc, char* argv[]) {
       false, 1, "int");
   TCLAP::ValueArg<int> nbatchjobsArg("", "nbatchjobs", "number of jobs to write scripts for and submit to batch system",
                                      false, 0, "int");
+  TCLAP::ValueArg<int> ncoresArg("", "ncores",
+                                 "Number of local worker processes running the toys of the Plugin and "
+                                 "Berger-Boos scans and of the coverage test, and fitting the scan points of the "
+                                 "Prob scans. The toys of all workers are merged into the output file of --nrun. "
+                                 "Default: 1",
+                                 false, 1, "int");
   TCLAP::ValueArg<std::string> batchoutArg("", "batchout", "location of batch output files", false, "", "string");
   TCLAP::ValueArg<std::string> batchreqsArg("", "batchreqs",
                                             "file which provides condor submission file options and requirements, e.g. "
@@ -667,6 +716,42 @@ void OptParser::parseArguments(int argc, char* argv[]) {
                                   1, "int");
   TCLAP::ValueArg<int> ntoysArg("", "ntoys", "number of toy experiments per job. Default: 25", false, 25, "int");
   TCLAP::ValueArg<int> nrunArg("", "nrun", "Number of toy run. To be used with --action pluginbatch.", false, 1, "int");
+  TCLAP::ValueArg<int> nthreadsArg("", "nthreads",
+                                   "Number of threads reading the toy files of the Plugin scans. Default: 1",
+                                   false, 1, "int");
+  TCLAP::ValueArg<int> adaptivescanArg(
+      "", "adaptivescan",
+      "Adaptive Prob scans: fit a coarse grid of this many points (per axis in 2D), then refine it down to the "
+      "resolution of --npoints (--npoints2dx/y) only where needed: in 1D, bisect the intervals where 1-CL crosses "
+      "1, 2, 3 sigma or --CL, around the minimum, and where the chi2 is not parabolic; in 2D, split the cells "
+      "crossed by the --ncontours contours or containing the minimum. The other points are interpolated. "
+      "Default: 0 (off, fit all points).",
+      false, 0, "int");
+  TCLAP::ValueArg<double> adaptivetoysArg(
+      "", "adaptivetoys",
+      "Adaptive toy counts for the 1D Plugin scan: run the toys of each scan point in batches of --ntoys until "
+      "the binomial uncertainty of the p-value is below this fraction of the nearest CL threshold (see --CL, "
+      "default 1, 2 and 3 sigma), or the p-value is more than three uncertainties away from it. "
+      "Default: 0 (off, run --ntoys toys).",
+      false, 0., "double");
+  TCLAP::ValueArg<int> maxtoysArg("", "maxtoys",
+                                  "Maximum number of toys per scan point with --adaptivetoys. "
+                                  "Default: 10 times --ntoys.",
+                                  false, -99, "int");
+  TCLAP::ValueArg<unsigned long long> seedArg(
+      "", "seed",
+      "Seed of the random numbers of the toys. Each toy is drawn from its own stream of random numbers, given by "
+      "the seed, --nrun, the scan point and the toy, so any toy can be reproduced. "
+      "Default: 0 (draw a seed, which is printed).",
+      false, 0, "int");
+  TCLAP::ValueArg<int> forcebudgetArg("", "forcebudget",
+                                      "Number of start points of the sampled designs of --forcedesign. "
+                                      "Default: 4 per varied parameter.",
+                                      false, 0, "int");
+  TCLAP::ValueArg<int> forceconfirmArg("", "forceconfirm",
+                                       "Stop the fits of --probforce and --scanforce once the best minimum "
+                                       "was found again this many times. Default: 0 (fit all start points).",
+                                       false, 0, "int");
   TCLAP::ValueArg<int> npointsArg("", "npoints",
                                   "Number of scan points used by the Prob method. \n"
                                   "1D plots: Default 100 points. \n"
@@ -701,6 +786,12 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   TCLAP::ValueArg<std::string> toyFilesArg(
       "", "toyFiles", "Pass some different toy files, for example if you want 1D projection of 2D FC.", false,
       "default", "string");
+  TCLAP::ValueArg<std::string> toycompressionArg(
+      "", "toycompression",
+      "Compression of the toy files. Format: ALG[:LEVEL], with ALG one of zlib, lzma, lz4, zstd. "
+      "A second setting, separated by a comma, is used for the branches of the parameters, observables and "
+      "theory, which aren't read when analysing the toys, e.g. lz4:4,lzma:8. Default: ROOT default",
+      false, "", "string");
   TCLAP::ValueArg<std::string> xtitleArg("", "xtitle", "Set x axis title.", false, "", "string");
   TCLAP::ValueArg<std::string> ytitleArg("", "ytitle", "Set y axis title.", false, "", "string");
   TCLAP::ValueArg<std::string> saveArg("", "save", "Save the workspace this file name", false, "", "string");
@@ -764,17 +855,31 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   TCLAP::SwitchArg importanceArg("", "importance", "Enable importance sampling for plugin toys.", false);
   TCLAP::SwitchArg nosystArg("", "nosyst", "Sets all systematic errors to zero.", false);
   TCLAP::SwitchArg noconfsolsArg("", "noconfsols", "Do not confirm solutions.", false);
+  TCLAP::SwitchArg notoycacheArg("", "notoycache",
+                                 "Don't use the cache of the toy statistics when reading the toys of the 1D Plugin "
+                                 "scan, but analyse all toy files again.",
+                                 false);
+  TCLAP::SwitchArg numgradArg("", "numgrad",
+                              "Let Minuit compute numerical derivatives instead of using the analytic gradient "
+                              "of Gaussian combinations, e.g. to compare results and timings.",
+                              false);
   TCLAP::SwitchArg printcorArg("", "printcor", "Print the correlation matrix of each solution found.", false);
   TCLAP::SwitchArg smooth2dArg(
       "", "smooth2d", "Smooth 2D p-value or cl histograms for nicer contour (particularly useful for 2D plugin)",
       false);
   TCLAP::SwitchArg squareArg("", "square", "Make a square canvas", false);
   TCLAP::SwitchArg saveAtMinArg("", "saveAtMin", "Save workspace after minimization", false);
+  TCLAP::SwitchArg warmstartArg("", "warmstart",
+                                "Start each fit of the Prob scans from the covariance of the fit at the previous "
+                                "scan point, with a lower Minuit strategy, and refit normally if it doesn't "
+                                "converge. Prints the function calls saved per scan.",
+                                false);
 
   // --------------- aruments that can be given multiple times
   std::vector<std::string> vAction;
   // vAction.push_back("bb");
   // vAction.push_back("bbbatch");
+  vAction.push_back("benchmark");
   vAction.push_back("coverage");
   vAction.push_back("coveragebatch");
   vAction.push_back("plot");
@@ -788,6 +893,21 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   vAction.push_back("uniform");
   vAction.push_back("gaus");
   TCLAP::ValuesConstraint<std::string> cAction(vAction);
+  std::vector<std::string> vForcedesign = {"corners", "sobol", "lhs"};
+  TCLAP::ValuesConstraint<std::string> cForcedesign(vForcedesign);
+  TCLAP::ValueArg<std::string> forcedesignArg(
+      "", "forcedesign",
+      "Start points of --probforce and --scanforce. corners: all corners of the force ranges (2^n fits "
+      "for n varied parameters). sobol: Sobol sequence, lhs: Latin hypercube, both with --forcebudget "
+      "points inside the force ranges. Default: corners",
+      false, "corners", &cForcedesign);
+  std::vector<std::string> vToyprecision = {"float", "double"};
+  TCLAP::ValuesConstraint<std::string> cToyprecision(vToyprecision);
+  TCLAP::ValueArg<std::string> toyprecisionArg(
+      "", "toyprecision",
+      "Precision of the chi2 values stored in the toy files. Use double if the chi2 differences of the toys are "
+      "small compared to the chi2 values themselves. Default: float",
+      false, "float", &cToyprecision);
   TCLAP::MultiArg<std::string> actionArg("a", "action", "Perform action", false, &cAction);
   TCLAP::MultiArg<std::string> varArg("", "var",
                                       "Scan variable (default: g). Can be given twice, in which case "
@@ -1049,6 +1169,7 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   // are ordered on the command line, unfortunately in reverse.
   //
   using Utils::isIn;
+  if (isIn<TString>(bookedOptions, "warmstart")) cmd.add(warmstartArg);
   if (isIn<TString>(bookedOptions, "verbose")) cmd.add(verboseArg);
   if (isIn<TString>(bookedOptions, "var")) cmd.add(varArg);
   if (isIn<TString>(bookedOptions, "usage")) cmd.add(usageArg);
@@ -1057,6 +1178,8 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   if (isIn<TString>(bookedOptions, "xtitle")) cmd.add(xtitleArg);
   if (isIn<TString>(bookedOptions, "ytitle")) cmd.add(ytitleArg);
   if (isIn<TString>(bookedOptions, "title")) cmd.add(titleArg);
+  if (isIn<TString>(bookedOptions, "toyprecision")) cmd.add(toyprecisionArg);
+  if (isIn<TString>(bookedOptions, "toycompression")) cmd.add(toycompressionArg);
   if (isIn<TString>(bookedOptions, "toyFiles")) cmd.add(toyFilesArg);
   if (isIn<TString>(bookedOptions, "teststat")) cmd.add(teststatArg);
   if (isIn<TString>(bookedOptions, "sn2d")) cmd.add(sn2dArg);
@@ -1064,6 +1187,7 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   if (isIn<TString>(bookedOptions, "start")) cmd.add(startArg);
   if (isIn<TString>(bookedOptions, "smooth2d")) cmd.add(smooth2dArg);
   if (isIn<TString>(bookedOptions, "square")) cmd.add(squareArg);
+  if (isIn<TString>(bookedOptions, "seed")) cmd.add(seedArg);
   if (isIn<TString>(bookedOptions, "scanrangey")) cmd.add(scanrangeyArg);
   if (isIn<TString>(bookedOptions, "scanrange")) cmd.add(scanrangeArg);
   if (isIn<TString>(bookedOptions, "scanforce")) cmd.add(scanforceArg);
@@ -1102,18 +1226,23 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   if (isIn<TString>(bookedOptions, "origin")) cmd.add(plotoriginArg);
   if (isIn<TString>(bookedOptions, "nsmooth")) cmd.add(nsmoothArg);
   if (isIn<TString>(bookedOptions, "ntoys")) cmd.add(ntoysArg);
+  if (isIn<TString>(bookedOptions, "nthreads")) cmd.add(nthreadsArg);
+  if (isIn<TString>(bookedOptions, "numgrad")) cmd.add(numgradArg);
   if (isIn<TString>(bookedOptions, "nrun")) cmd.add(nrunArg);
   if (isIn<TString>(bookedOptions, "npointstoy")) cmd.add(npointstoyArg);
   if (isIn<TString>(bookedOptions, "ncoveragetoys")) cmd.add(ncoveragetoysArg);
+  if (isIn<TString>(bookedOptions, "ncores")) cmd.add(ncoresArg);
   if (isIn<TString>(bookedOptions, "npoints2dy")) cmd.add(npoints2dyArg);
   if (isIn<TString>(bookedOptions, "npoints2dx")) cmd.add(npoints2dxArg);
   if (isIn<TString>(bookedOptions, "npoints")) cmd.add(npointsArg);
+  if (isIn<TString>(bookedOptions, "notoycache")) cmd.add(notoycacheArg);
   if (isIn<TString>(bookedOptions, "nosyst")) cmd.add(nosystArg);
   if (isIn<TString>(bookedOptions, "noconfsols")) cmd.add(noconfsolsArg);
   if (isIn<TString>(bookedOptions, "ndivy")) cmd.add(ndivyArg);
   if (isIn<TString>(bookedOptions, "ndiv")) cmd.add(ndivArg);
   if (isIn<TString>(bookedOptions, "nBBpoints")) cmd.add(nBBpointsArg);
   if (isIn<TString>(bookedOptions, "nbatchjobs")) cmd.add(nbatchjobsArg);
+  if (isIn<TString>(bookedOptions, "maxtoys")) cmd.add(maxtoysArg);
   if (isIn<TString>(bookedOptions, "magnetic")) cmd.add(plotmagneticArg);
   if (isIn<TString>(bookedOptions, "log")) cmd.add(plotlogArg);
   if (isIn<TString>(bookedOptions, "loadParamsFile")) cmd.add(loadParamsFileArg);
@@ -1139,6 +1268,9 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   if (isIn<TString>(bookedOptions, "group")) cmd.add(plotgroupArg);
   if (isIn<TString>(bookedOptions, "grouppos")) cmd.add(plotgroupposArg);
   if (isIn<TString>(bookedOptions, "grid")) cmd.add(gridArg);
+  if (isIn<TString>(bookedOptions, "forcedesign")) cmd.add(forcedesignArg);
+  if (isIn<TString>(bookedOptions, "forceconfirm")) cmd.add(forceconfirmArg);
+  if (isIn<TString>(bookedOptions, "forcebudget")) cmd.add(forcebudgetArg);
   if (isIn<TString>(bookedOptions, "fix")) cmd.add(fixArg);
   if (isIn<TString>(bookedOptions, "filltransparency")) cmd.add(filltransparencyArg);
   if (isIn<TString>(bookedOptions, "fillstyle")) cmd.add(fillstyleArg);
@@ -1166,6 +1298,8 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   if (isIn<TString>(bookedOptions, "batchsubmit")) cmd.add(batchsubmitArg);
   if (isIn<TString>(bookedOptions, "asimovfile")) cmd.add(asimovFileArg);
   if (isIn<TString>(bookedOptions, "asimov")) cmd.add(asimovArg);
+  if (isIn<TString>(bookedOptions, "adaptivetoys")) cmd.add(adaptivetoysArg);
+  if (isIn<TString>(bookedOptions, "adaptivescan")) cmd.add(adaptivescanArg);
   if (isIn<TString>(bookedOptions, "action")) cmd.add(actionArg);
 
   // check if the first argument is an integer. This will be discarded as a jobnumber.
@@ -1190,6 +1324,8 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   //
   // copy over parsed values into data members
   //
+  adaptivescan = adaptivescanArg.getValue();
+  adaptivetoys = adaptivetoysArg.getValue();
   asimov = asimovArg.getValue();
   cls = clsArg.getValue();
   CL = CLArg.getValue();
@@ -1201,6 +1337,9 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   enforcePhysRange = prArg.getValue();
   filenameaddition = filenameadditionArg.getValue();
   filenamechange = filenamechangeArg.getValue();
+  forcebudget = forcebudgetArg.getValue();
+  forceconfirm = forceconfirmArg.getValue();
+  forcedesign = forcedesignArg.getValue();
   filltransparency = filltransparencyArg.getValue();
   hexfillcolor = hexfillcolorArg.getValue();
   hexlinecolor = hexlinecolorArg.getValue();
@@ -1221,6 +1360,7 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   largest = largestArg.getValue();
   latex = latexArg.getValue();
   lightfiles = lightfilesArg.getValue();
+  maxtoys = maxtoysArg.getValue();
   batchstartn = batchstartnArg.getValue();
   batcheos = batcheosArg.getValue();
   batchout = batchoutArg.getValue();
@@ -1231,6 +1371,8 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   ndiv = ndivArg.getValue();
   ndivy = ndivyArg.getValue();
   nosyst = nosystArg.getValue();
+  notoycache = notoycacheArg.getValue();
+  numgrad = numgradArg.getValue();
   npoints1d = npointsArg.getValue() == -1 ? 100 : npointsArg.getValue();
   npoints2dx = npoints2dxArg.getValue() == -1 ? (npointsArg.getValue() == -1 ? 50 : npointsArg.getValue())
                                               : npoints2dxArg.getValue();
@@ -1238,7 +1380,9 @@ void OptParser::parseArguments(int argc, char* argv[]) {
                                               : npoints2dyArg.getValue();
   npointstoy = npointstoyArg.getValue();
   ncoveragetoys = ncoveragetoysArg.getValue();
+  ncores = ncoresArg.getValue();
   nrun = nrunArg.getValue();
+  nthreads = nthreadsArg.getValue();
   ntoys = ntoysArg.getValue();
   nsmooth = nsmoothArg.getValue();
   parevol = parevolArg.getValue();
@@ -1265,19 +1409,23 @@ void OptParser::parseArguments(int argc, char* argv[]) {
   /// queue             = TString(queueArg.getValue());
   scaleerr = scaleerrArg.getValue();
   scalestaterr = scalestaterrArg.getValue();
+  seed = seedArg.getValue();
   save = saveArg.getValue();
   saveAtMin = saveAtMinArg.getValue();
   savenuisances1d = snArg.getValue();
   scanforce = scanforceArg.getValue();
   smooth2d = smooth2dArg.getValue();
   square = squareArg.getValue();
+  toycompression = toycompressionArg.getValue();
   toyFiles = toyFilesArg.getValue();
+  toyprecision = toyprecisionArg.getValue();
   teststatistic = teststatArg.getValue();
   xtitle = xtitleArg.getValue();
   ytitle = ytitleArg.getValue();
   usage = usageArg.getValue();
   updateFreq = updateFreqArg.getValue();
   verbose = verboseArg.getValue();
+  warmstart = warmstartArg.getValue();
 
   //
   // The following options need some post-processing to
@@ -7,13 +7,13 @@
 
 #include <PDF_Abs.h>
 
+#include <ToyGenerator.h>
 #include <Utils.h>
 
 #include <RooFitResult.h>
 #include <RooFormulaVar.h>
 #include <RooMinimizer.h>
 #include <RooMsgService.h>
-#include <RooRandom.h>
 #include <RooRealVar.h>
 
 #include <cassert>
@@ -54,6 +54,7 @@ PDF_Abs::~PDF_Abs() {
 
   // clean pregenerated toys
   if (toyObservables) delete toyObservables;
+  if (toyGenerator) delete toyGenerator;
 
   // clean pdf
   if (pdf) delete pdf;
@@ -104,6 +105,7 @@ void PDF_Abs::setObservablesTruth() {
 /// Set all observables to 'toy' values drawn from the
 /// PDF using the current parameter values. A certain number
 /// of toys is pregenerated to speed up when doing mulitple toy fits.
+/// Gaussian PDFs are sampled directly, see ToyGenerator.
 ///
 void PDF_Abs::setObservablesToy() {
   obsValSource = "toy";
@@ -111,16 +113,17 @@ void PDF_Abs::setObservablesToy() {
     std::cout << "PDF_Abs::setObservables(): ERROR: pdf not initialized." << std::endl;
     std::exit(1);
   }
-  if (toyObservables == 0 || iToyObs == nToyObs) {
-    RooRandom::randomGenerator()->SetSeed(0);
-    if (iToyObs == nToyObs) delete toyObservables;
-    toyObservables = pdf->generate(*(RooArgSet*)observables, nToyObs);
-    iToyObs = 0;
+  // the pdf is replaced when it is rebuilt
+  if (!toyGenerator || toyGenerator->getPdf() != pdf) {
+    if (toyGenerator) delete toyGenerator;
+    toyGenerator = new ToyGenerator(pdf, *observables);
+    toyObsValues.clear();
   }
-  for (int i = 0; i < nObs; i++) {
-    RooRealVar* pObs = (RooRealVar*)((RooArgList*)observables)->at(i);
-    pObs->setVal(((RooRealVar*)toyObservables->get(iToyObs)->find(pObs->GetName()))->getVal());
+  if (toyObsValues.empty() || iToyObs == nToyObs) {
+    toyGenerator->generate(nToyObs, toyObsValues);
+    iToyObs = 0;
   }
+  toyGenerator->setObservables(toyObsValues, nToyObs, iToyObs);
   iToyObs += 1;
 }
 
@@ -648,19 +648,14 @@ void PDF_Datasets::generateBkgToys(int SeedShift, TString signalvar) {
 
 /*! \brief Initializes the random generator
  *
- *  If seedShift is set to zero, the machine environment is used to generate
- *  a hopefully unique random seed.
+ *  If seedShift is set to zero, the random generator is left alone: the toys
+ *  are drawn from the ToyRandom stream selected by the scan, keyed by --seed.
  *  If seedShift is nonzero, a deterministic seed is calculated from the seedShift
  *  several command line call parameters.
  */
 void PDF_Datasets::initializeRandomGenerator(int seedShift) {
 
-  if (seedShift == 0) {
-    // From the ROOT documentation:
-    // if seed is 0 [...] a TUUID is generated and used to fill the first 8 integers of the seed array.
-    // In this case the seed is guaranteed to be unique in space and time.
-    RooRandom::randomGenerator()->SetSeed(0);
-  } else {
+  if (seedShift != 0) {
     // calculate unique seed for deterministic random generation
     if (arg == nullptr) {
       std::cerr << "Error in PDF_Datasets::initializeRandomGenerator." << std::endl;
@@ -0,0 +1,158 @@
+#include <ParameterBinding.h>
+
+#include <FitParameterSchema.h>
+#include <RooSlimFitResult.h>
+
+#include <RooAbsCollection.h>
+#include <RooAbsReal.h>
+#include <RooArgSet.h>
+#include <RooNameReg.h>
+#include <RooRealVar.h>
+#include <RooWorkspace.h>
+
+///
+/// Bind the elements of a set. Elements that are not real valued are skipped.
+///
+/// \param set The set, its elements must outlive the binding.
+///
+ParameterBinding::ParameterBinding(const RooAbsCollection& set) {
+  _valid = true;
+  for (const auto& pAbs : set) {
+    const auto p = dynamic_cast<RooAbsReal*>(pAbs);
+    if (!p) continue;
+    _index.emplace(p->namePtr(), _reals.size());
+    _reals.push_back(p);
+    _vars.push_back(dynamic_cast<RooRealVar*>(p));
+  }
+}
+
+///
+/// Bind the elements of a named set of the workspace. The binding is empty,
+/// and not valid, if the workspace has no such set.
+///
+/// \param w The workspace.
+/// \param setName The name of the set.
+///
+ParameterBinding::ParameterBinding(RooWorkspace* w, const TString& setName) {
+  const RooArgSet* set = w ? w->set(setName) : nullptr;
+  if (set) *this = ParameterBinding(*set);
+}
+
+///
+/// \param name The name of an element.
+/// \return Its index in the binding, -1 if it isn't bound.
+///
+int ParameterBinding::getIndex(const char* name) const {
+  const auto it = _index.find(RooNameReg::known(name));
+  return it == _index.end() ? -1 : it->second;
+}
+
+///
+/// Copy the current values of all elements.
+///
+/// \param values Filled with the values, must hold size() of them.
+///
+void ParameterBinding::getValues(double* values) const {
+  for (size_t i = 0; i < _reals.size(); i++) values[i] = _reals[i]->getVal();
+}
+
+///
+/// Copy the current values of all elements.
+///
+/// \param values Filled with the values, must hold size() of them.
+///
+void ParameterBinding::getValues(float* values) const {
+  for (size_t i = 0; i < _reals.size(); i++) values[i] = _reals[i]->getVal();
+}
+
+///
+/// Set all variables to the given values.
+///
+/// \param values The values, in the order of the binding.
+///
+void ParameterBinding::setValues(const double* values) const {
+  for (size_t i = 0; i < _vars.size(); i++) {
+    if (_vars[i]) _vars[i]->setVal(values[i]);
+  }
+}
+
+///
+/// Set the floating variables to the given values,
+/// constant variables are left untouched.
+///
+/// \param values The values, in the order of the binding.
+///
+void ParameterBinding::setValuesFloating(const double* values) const {
+  for (size_t i = 0; i < _vars.size(); i++) {
+    if (_vars[i] && !_vars[i]->isConstant()) _vars[i]->setVal(values[i]);
+  }
+}
+
+///
+/// Build the mapping of a collection, unless it was built
+/// for a collection of the same layout before.
+///
+/// \param values The collection.
+/// \param mapping The mapping of the collection, kept by the caller between calls.
+/// \return For each element of the collection its index in the binding, -1 if it isn't bound.
+///
+const std::vector<int>& ParameterBinding::map(const RooAbsCollection& values, Mapping& mapping) const {
+  bool same = mapping.names.size() == values.size();
+  int i = 0;
+  for (const auto& pAbs : values) {
+    if (!same) break;
+    same = mapping.names[i++] == pAbs->namePtr();
+  }
+  if (same) return mapping.index;
+  mapping.schema = nullptr;
+  mapping.names.clear();
+  mapping.index.clear();
+  for (const auto& pAbs : values) {
+    mapping.names.push_back(pAbs->namePtr());
+    const auto it = _index.find(pAbs->namePtr());
+    mapping.index.push_back(it == _index.end() ? -1 : it->second);
+  }
+  return mapping.index;
+}
+
+///
+/// Set each variable to the value of the element of the same name in a
+/// collection, like Utils::setParameters(). Variables not found in the
+/// collection are left untouched.
+///
+/// \param values The collection, e.g. the floating parameters of a fit result.
+/// \param mapping The mapping of the collection, kept by the caller between calls.
+/// \param floatingOnly If true, constant variables are left untouched.
+///
+void ParameterBinding::setValues(const RooAbsCollection& values, Mapping& mapping, bool floatingOnly) const {
+  const std::vector<int>& index = map(values, mapping);
+  int i = 0;
+  for (const auto& pAbs : values) {
+    const int k = index[i++];
+    if (k < 0 || !_vars[k]) continue;
+    if (floatingOnly && _vars[k]->isConstant()) continue;
+    _vars[k]->setVal(static_cast<RooAbsReal*>(pAbs)->getVal());
+  }
+}
+
+///
+/// Set each variable to the value of the parameter of the same name in a
+/// fit result, constant and floating ones. Variables not found in the fit
+/// result are left untouched.
+///
+/// \param values The fit result.
+/// \param mapping The mapping of its schema, kept by the caller between calls.
+///
+void ParameterBinding::setValues(const RooSlimFitResult& values, Mapping& mapping) const {
+  const FitParameterSchema* schema = values.getSchema();
+  if (mapping.schema != schema) {
+    mapping.names.clear();
+    mapping.index.clear();
+    for (const std::string& name : schema->getNames()) mapping.index.push_back(getIndex(name.c_str()));
+    mapping.schema = schema;
+  }
+  for (int id = 0; id < schema->getNPars(); id++) {
+    const int k = mapping.index[id];
+    if (k >= 0 && _vars[k]) _vars[k]->setVal(values.getParVal(id));
+  }
+}
@@ -0,0 +1,248 @@
+#include <QuantileSketch.h>
+
+#include <Utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <utility>
+
+///
+/// \param k Accuracy parameter. The sketch is exact up to k values, and the
+///          rank error shrinks roughly as 1/k.
+///
+QuantileSketch::QuantileSketch(int k) : _k(k) {
+  if (_k < 8) {
+    std::cout << "QuantileSketch::QuantileSketch() : ERROR : k=" << _k << " is too small." << std::endl;
+    std::exit(1);
+  }
+}
+
+///
+/// \return The maximum number of values at a level before it is compacted.
+///
+int QuantileSketch::capacity(int level) const {
+  const int depth = _levels.size() - 1 - level;
+  return std::max(8, int(std::ceil(_k * std::pow(2. / 3., depth))));
+}
+
+///
+/// Add a value.
+///
+/// \param value  The value.
+/// \param weight Number of values it stands for, must be a power of two.
+///               This is used to fill a sketch from the weighted values of
+///               another one, see getWeightedValues().
+///
+void QuantileSketch::add(double value, Long64_t weight) {
+  int level = 0;
+  while ((Long64_t(1) << level) < weight) level++;
+  if ((Long64_t(1) << level) != weight) {
+    std::cout << "QuantileSketch::add() : ERROR : weight " << weight << " is not a power of two." << std::endl;
+    std::exit(1);
+  }
+  if (int(_levels.size()) <= level) _levels.resize(level + 1);
+  _levels[level].push_back(value);
+  _n += weight;
+  _isSorted = false;
+  compress();
+}
+
+///
+/// Add all values of another sketch. The other sketch must have the same k.
+///
+void QuantileSketch::merge(const QuantileSketch& other) {
+  if (other._k != _k) {
+    std::cout << "QuantileSketch::merge() : ERROR : can't merge sketches with k=" << _k << " and k=" << other._k
+              << std::endl;
+    std::exit(1);
+  }
+  if (_levels.size() < other._levels.size()) _levels.resize(other._levels.size());
+  for (size_t h = 0; h < other._levels.size(); h++) {
+    _levels[h].insert(_levels[h].end(), other._levels[h].begin(), other._levels[h].end());
+  }
+  _n += other._n;
+  _isSorted = false;
+  compress();
+}
+
+///
+/// Compact levels until the sketch holds no more values than its capacity.
+///
+void QuantileSketch::compress() {
+  while (true) {
+    size_t nValues = 0;
+    size_t nCapacity = 0;
+    for (size_t h = 0; h < _levels.size(); h++) {
+      nValues += _levels[h].size();
+      nCapacity += capacity(h);
+    }
+    if (nValues <= nCapacity) return;
+    for (size_t h = 0; h < _levels.size(); h++) {
+      if (int(_levels[h].size()) >= capacity(h)) {
+        compact(h);
+        break;
+      }
+    }
+  }
+}
+
+///
+/// Sort a level and promote every other value to the next level. Whether
+/// the values at even or odd positions are promoted is decided by a hash
+/// of the sketch state, so that the result is reproducible.
+///
+void QuantileSketch::compact(int level) {
+  if (level + 1 == int(_levels.size())) _levels.emplace_back();
+  std::vector<double>& values = _levels[level];
+  std::sort(values.begin(), values.end());
+  // splitmix64
+  uint64_t z = uint64_t(_n) + 0x9e3779b97f4a7c15ULL * (level + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z = z ^ (z >> 31);
+  const size_t nPairs = values.size() / 2;
+  for (size_t i = 0; i < nPairs; i++) _levels[level + 1].push_back(values[2 * i + (z & 1)]);
+  // an odd value out stays at this level
+  if (values.size() % 2 == 1) {
+    values.front() = values.back();
+    values.resize(1);
+  } else {
+    values.clear();
+  }
+}
+
+///
+/// Sort all values and compute their cumulative weights.
+///
+void QuantileSketch::sort() const {
+  if (_isSorted) return;
+  std::vector<std::pair<double, Long64_t>> weighted;
+  for (size_t h = 0; h < _levels.size(); h++) {
+    for (const double value : _levels[h]) weighted.emplace_back(value, Long64_t(1) << h);
+  }
+  std::sort(weighted.begin(), weighted.end());
+  _sorted.resize(weighted.size());
+  _cumWeights.resize(weighted.size());
+  Long64_t cumWeight = 0;
+  for (size_t i = 0; i < weighted.size(); i++) {
+    _sorted[i] = weighted[i].first;
+    cumWeight += weighted[i].second;
+    _cumWeights[i] = cumWeight;
+  }
+  _isSorted = true;
+}
+
+///
+/// \return The fraction of values that are larger than or equal to value.
+///
+double QuantileSketch::getFracAbove(double value) const {
+  sort();
+  const auto it = std::lower_bound(_sorted.begin(), _sorted.end(), value);
+  const Long64_t nBelow = it == _sorted.begin() ? 0 : _cumWeights[it - _sorted.begin() - 1];
+  return double(_n - nBelow) / _n;
+}
+
+///
+/// Compute quantiles, interpolating between values like Utils::Quantile().
+///
+/// \param probs Probabilities of the quantiles.
+/// \return The quantiles, or an empty vector if the sketch is empty.
+///
+std::vector<double> QuantileSketch::getQuantiles(const std::vector<double>& probs) const {
+  sort();
+  return getSortedQuantiles(_sorted, _cumWeights, probs);
+}
+
+///
+/// Compute quantiles of weighted values, e.g. of a function of the values of
+/// a sketch as returned by getWeightedValues(). With all weights one, this is
+/// the same as Utils::Quantile().
+///
+/// \param values  The values.
+/// \param weights Number of values each of them stands for.
+/// \param probs   Probabilities of the quantiles.
+/// \return The quantiles, or an empty vector if there are no values.
+///
+std::vector<double> QuantileSketch::getQuantiles(const std::vector<double>& values, const std::vector<Long64_t>& weights,
+                                                 const std::vector<double>& probs) {
+  std::vector<std::pair<double, Long64_t>> weighted;
+  for (size_t i = 0; i < values.size(); i++) weighted.emplace_back(values[i], weights[i]);
+  std::sort(weighted.begin(), weighted.end());
+  std::vector<double> sorted;
+  std::vector<Long64_t> cumWeights;
+  Long64_t cumWeight = 0;
+  for (const auto& [value, weight] : weighted) {
+    sorted.push_back(value);
+    cumWeight += weight;
+    cumWeights.push_back(cumWeight);
+  }
+  return getSortedQuantiles(sorted, cumWeights, probs);
+}
+
+///
+/// Compute quantiles of sorted values with cumulative weights.
+///
+std::vector<double> QuantileSketch::getSortedQuantiles(const std::vector<double>& sorted,
+                                                       const std::vector<Long64_t>& cumWeights,
+                                                       const std::vector<double>& probs) {
+  const Long64_t n = cumWeights.empty() ? 0 : cumWeights.back();
+  if (n == 0) return std::vector<double>();
+  if (n == 1) return std::vector<double>(1, sorted[0]);
+  // the i-th smallest of the values the weighted values stand for
+  auto valueAtIndex = [&](Long64_t i) {
+    return sorted[std::upper_bound(cumWeights.begin(), cumWeights.end(), i) - cumWeights.begin()];
+  };
+  std::vector<double> quantiles;
+  for (const double prob : probs) {
+    const double poi = Utils::Lerp<double>(-0.5, n - 0.5, prob);
+    const Long64_t left = std::max(Long64_t(std::floor(poi)), Long64_t(0));
+    const Long64_t right = std::min(Long64_t(std::ceil(poi)), n - 1);
+    quantiles.push_back(Utils::Lerp<double>(valueAtIndex(left), valueAtIndex(right), poi - left));
+  }
+  return quantiles;
+}
+
+///
+/// Get the values held by the sketch, sorted, and the number of values each
+/// of them stands for.
+///
+void QuantileSketch::getWeightedValues(std::vector<double>& values, std::vector<Long64_t>& weights) const {
+  sort();
+  values = _sorted;
+  weights.resize(_cumWeights.size());
+  std::adjacent_difference(_cumWeights.begin(), _cumWeights.end(), weights.begin());
+}
+
+///
+/// Get the content of the sketch, e.g. to store it in a TTree.
+///
+/// \param values     Filled with the values of all levels.
+/// \param levelSizes Filled with the number of values at each level.
+///
+void QuantileSketch::getState(std::vector<double>& values, std::vector<int>& levelSizes) const {
+  values.clear();
+  levelSizes.clear();
+  for (const auto& level : _levels) {
+    values.insert(values.end(), level.begin(), level.end());
+    levelSizes.push_back(level.size());
+  }
+}
+
+///
+/// Restore the content of a sketch saved by getState(), with the same k.
+///
+void QuantileSketch::setState(const std::vector<double>& values, const std::vector<int>& levelSizes) {
+  _levels.assign(levelSizes.size(), std::vector<double>());
+  _n = 0;
+  size_t i = 0;
+  for (size_t h = 0; h < levelSizes.size(); h++) {
+    _levels[h].assign(values.begin() + i, values.begin() + i + levelSizes[h]);
+    i += levelSizes[h];
+    _n += Long64_t(levelSizes[h]) << h;
+  }
+  _isSorted = false;
+}
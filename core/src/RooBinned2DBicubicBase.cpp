@@ -6,10 +6,13 @@
 #include <RooBinned2DBicubicBase.h>
 
 #include <RooArgSet.h>
+#include <RooFit/EvalContext.h>
 
 #include <TH2.h>
 
 #include <cmath>
+#include <span>
+#include <vector>
 
 template <class BASE>
 RooBinned2DBicubicBase<BASE>::BinSizeException::~BinSizeException() throw() {}
@@ -196,14 +199,39 @@ double RooBinned2DBicubicBase<BASE>::eval(double x, double y) const {
   // normalise to coordinates in unit sqare
   const double hx = (x - xlo) / binSizeX;
   const double hy = (y - ylo) / binSizeY;
-  // monomials
-  const double hxton[4] = {hx * hx * hx, hx * hx, hx, 1.};
-  const double hyton[4] = {hy * hy * hy, hy * hy, hy, 1.};
-  // sum up
-  double retVal = 0.;
-  for (int k = 0; k < NCoeff; ++k) retVal += coeff(binx, biny, k) * hxton[k % 4] * hyton[k / 4];
+  // read the coefficients directly, not through the copy-on-write proxy
+  return evalCell(coeffs.data() + CoeffRecLen * (binx + nBinsX * biny), hx, hy);
+}
 
-  return retVal;
+template <class BASE>
+void RooBinned2DBicubicBase<BASE>::doEval(RooFit::EvalContext& ctx) const {
+  const std::span<const double> xs = ctx.at(x);
+  const std::span<const double> ys = ctx.at(y);
+  const std::span<double> out = ctx.output();
+  const std::size_t n = out.size();
+  const std::size_t sx = xs.size() > 1;
+  const std::size_t sy = ys.size() > 1;
+  // first pass: cell and unit square coordinates of each point, with the
+  // same arithmetic as eval(), free of table lookups so it vectorises;
+  // points outside the histogram (or NaN) get cell -1
+  std::vector<int> cell(n);
+  std::vector<double> hx(n), hy(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double xi = xs[i * sx], yi = ys[i * sy];
+    const bool inside = xi > xmin && xi < xmax && yi > ymin && yi < ymax;
+    const int binx = inside ? int(double(nBinsX) * (xi - xmin) / (xmax - xmin)) : 0;
+    const int biny = inside ? int(double(nBinsY) * (yi - ymin) / (ymax - ymin)) : 0;
+    const double xlo = double(nBinsX - binx) / double(nBinsX) * xmin + double(binx) / double(nBinsX) * xmax;
+    const double ylo = double(nBinsY - biny) / double(nBinsY) * ymin + double(biny) / double(nBinsY) * ymax;
+    cell[i] = inside ? binx + nBinsX * biny : -1;
+    hx[i] = (xi - xlo) / binSizeX;
+    hy[i] = (yi - ylo) / binSizeY;
+  }
+  // second pass: gather the coefficient records and evaluate
+  const double* c = coeffs.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = cell[i] < 0 ? 0. : evalCell(c + CoeffRecLen * cell[i], hx[i], hy[i]);
+  }
 }
 
 template <class BASE>
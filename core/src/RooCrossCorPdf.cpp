@@ -1,9 +1,13 @@
 #include <RooCrossCorPdf.h>
 
 #include <RooAbsReal.h>
+#include <RooFit/EvalContext.h>
 
 #include <TVectorD.h>
 
+#include <span>
+#include <vector>
+
 RooCrossCorPdf::RooCrossCorPdf(const char* name, const char* title, const RooArgList& th, const RooArgList& obs,
                                const TMatrixDSym& invcov, int nObsPdf1)
     :
@@ -39,3 +43,43 @@ Double_t RooCrossCorPdf::evaluate() const {
   }
   return exp(-ret);
 }
+
+///
+/// Vectorised evaluation, for the batch evaluation backend of RooFit.
+/// The nonzero elements of the off-diagonal blocks of the inverse covariance
+/// are collected once, then the sum over them is done event by event.
+///
+void RooCrossCorPdf::doEval(RooFit::EvalContext& ctx) const {
+  struct Term {
+    int i;
+    int j;
+    double w;
+  };
+  std::vector<Term> terms;
+  for (int i = 0; i < _obs.getSize(); i++) {
+    for (int j = i; j < _obs.getSize(); j++) {
+      if (i < _nObsPdf1 && j < _nObsPdf1) continue;
+      if (i >= _nObsPdf1 && j >= _nObsPdf1) continue;
+      if (_invcov[i][j] == 0) continue;
+      terms.push_back({i, j, _invcov[i][j]});
+    }
+  }
+
+  const std::span<double> out = ctx.output();
+  std::vector<std::span<const double>> obs;
+  std::vector<std::span<const double>> th;
+  for (int i = 0; i < _obs.getSize(); i++) {
+    obs.push_back(ctx.at(_obs.at(i)));
+    th.push_back(ctx.at(_th.at(i)));
+  }
+  // residuals of one event, each input is either one value per event or a single scalar
+  std::vector<double> res(_obs.getSize());
+  for (size_t k = 0; k < out.size(); k++) {
+    for (int i = 0; i < _obs.getSize(); i++) {
+      res[i] = obs[i][obs[i].size() > 1 ? k : 0] - th[i][th[i].size() > 1 ? k : 0];
+    }
+    double ret = 0.;
+    for (const Term& t : terms) ret += t.w * res[t.i] * res[t.j];
+    out[k] = exp(-ret);
+  }
+}
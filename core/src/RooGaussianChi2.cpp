@@ -0,0 +1,151 @@
+#include <RooGaussianChi2.h>
+
+#include <CompiledTheory.h>
+
+#include <RooAbsPdf.h>
+#include <RooArgList.h>
+#include <RooMultiVarGaussian.h>
+#include <RooProdPdf.h>
+
+#include <TMatrixDSym.h>
+
+#include <cstdlib>
+#include <iostream>
+
+///
+/// Build the chi2 of a list of multivariate Gaussians.
+///
+/// \param gaussians The RooMultiVarGaussian pdfs, e.g. as found by findGaussians().
+///
+RooGaussianChi2::RooGaussianChi2(const char* name, const char* title, const RooArgList& gaussians)
+    : RooAbsReal(name, title), _obs("obs", "obs", this), _th("th", "th", this) {
+  _blockStart.push_back(0);
+  for (const auto arg : gaussians) {
+    const auto g = dynamic_cast<const RooMultiVarGaussian*>(arg);
+    if (!g) {
+      std::cout << "RooGaussianChi2::RooGaussianChi2() : ERROR : " << arg->GetName()
+                << " is not a RooMultiVarGaussian." << std::endl;
+      std::exit(1);
+    }
+    TMatrixDSym weight(g->covarianceMatrix());
+    weight.Invert();
+    const int n = g->xVec().size();
+    _weightStart.push_back(_weights.size());
+    for (int i = 0; i < n; i++) {
+      _obs.add(*g->xVec().at(i));
+      _th.add(*g->muVec().at(i));
+      for (int j = 0; j < i; j++) _weights.push_back(2. * weight(i, j));
+      _weights.push_back(weight(i, i));
+    }
+    _blockStart.push_back(_blockStart.back() + n);
+  }
+}
+
+RooGaussianChi2::RooGaussianChi2(const RooGaussianChi2& other, const char* name)
+    : RooAbsReal(other, name),
+      _obs("obs", this, other._obs),
+      _th("th", this, other._th),
+      _blockStart(other._blockStart),
+      _weightStart(other._weightStart),
+      _weights(other._weights) {
+  if (other._compiled) compileTheory();
+}
+
+RooGaussianChi2::~RooGaussianChi2() = default;
+
+///
+/// Compile the theory relations into one native function, which is then used
+/// by all evaluations of the chi2. The function is only compiled once per
+/// process for the same relations, see CompiledTheory.
+///
+void RooGaussianChi2::compileTheory() {
+  _compiled = std::make_unique<CompiledTheory>(_th);
+  if (_compiled->getNCompiled() == 0) _compiled.reset();
+}
+
+///
+/// Collect the Gaussians of a likelihood pdf, descending into products.
+///
+/// \param pdf The likelihood pdf, e.g. the one of a Combiner.
+/// \param gaussians Filled with all RooMultiVarGaussian factors of pdf.
+/// \return true if pdf is a product of RooMultiVarGaussians only.
+///
+bool RooGaussianChi2::findGaussians(const RooAbsPdf& pdf, RooArgList& gaussians) {
+  if (const auto prod = dynamic_cast<const RooProdPdf*>(&pdf)) {
+    for (const auto arg : prod->pdfList()) {
+      if (!findGaussians(static_cast<const RooAbsPdf&>(*arg), gaussians)) return false;
+    }
+    return true;
+  }
+  // a derived class could change evaluate(), so require the exact type
+  if (pdf.IsA() != RooMultiVarGaussian::Class()) return false;
+  gaussians.add(pdf);
+  return true;
+}
+
+///
+/// \return sum over all Gaussians of r^T V^-1 r, with r = obs - th.
+///
+double RooGaussianChi2::evaluate() const {
+  const int nObs = _obs.size();
+  const double* th = evaluateTheory();
+  _res.resize(nObs);
+  for (int i = 0; i < nObs; i++) _res[i] = static_cast<const RooAbsReal&>(_obs[i]).getVal() - th[i];
+  double chi2 = 0.;
+  for (size_t b = 0; b + 1 < _blockStart.size(); b++) {
+    const double* r = _res.data() + _blockStart[b];
+    const double* w = _weights.data() + _weightStart[b];
+    const int n = _blockStart[b + 1] - _blockStart[b];
+    for (int i = 0; i < n; i++) {
+      double sum = 0.;
+      for (int j = 0; j <= i; j++) sum += w[j] * r[j];
+      chi2 += r[i] * sum;
+      w += i + 1;
+    }
+  }
+  return chi2;
+}
+
+///
+/// \return The values of the theory relations, in the order of getTheory(),
+///         computed by the compiled function if there is one.
+///
+const double* RooGaussianChi2::evaluateTheory() const {
+  _thVal.resize(_th.size());
+  if (_compiled) {
+    _compiled->evaluate(_thVal.data());
+  } else {
+    for (int i = 0; i < _th.size(); i++) _thVal[i] = static_cast<const RooAbsReal&>(_th[i]).getVal();
+  }
+  return _thVal.data();
+}
+
+///
+/// Evaluate the chi2 and its derivatives with respect to the theory relations,
+/// d chi2 / d th = -2 V^-1 r, for the analytic gradient (see TheoryGradient).
+///
+/// \param dChi2dTh Filled with the derivatives, theory relations in the order of getTheory().
+/// \return The chi2.
+///
+double RooGaussianChi2::evaluateTheoryGradient(std::vector<double>& dChi2dTh) const {
+  const double chi2 = evaluate();
+  dChi2dTh.assign(_res.size(), 0.);
+  for (size_t b = 0; b + 1 < _blockStart.size(); b++) {
+    const double* r = _res.data() + _blockStart[b];
+    const double* w = _weights.data() + _weightStart[b];
+    double* d = dChi2dTh.data() + _blockStart[b];
+    const int n = _blockStart[b + 1] - _blockStart[b];
+    for (int i = 0; i < n; i++) {
+      // the off-diagonal weights are doubled already
+      for (int j = 0; j < i; j++) {
+        d[i] -= w[j] * r[j];
+        d[j] -= w[j] * r[i];
+      }
+      d[i] -= 2. * w[i] * r[i];
+      w += i + 1;
+    }
+  }
+  return chi2;
+}
+
+ClassImp(RooGaussianChi2)
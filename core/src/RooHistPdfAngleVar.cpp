@@ -9,6 +9,7 @@
 #include <RooHistPdfAngleVar.h>
 
 #include <RooAbsReal.h>
+#include <RooFit/EvalContext.h>
 
 #include <TMath.h>
 
@@ -29,4 +30,23 @@ Double_t RooHistPdfAngleVar::evaluate() const {
   return val;
 }
 
+///
+/// Vectorised evaluation, for the batch evaluation backend of RooFit.
+/// Each input is either one value per event or a single scalar.
+///
+void RooHistPdfAngleVar::doEval(RooFit::EvalContext& ctx) const {
+  const std::span<const double> obs = ctx.at(xobs);
+  const std::span<const double> th = ctx.at(xth);
+  const std::span<const double> shift = ctx.at(xshift);
+  const std::span<double> out = ctx.output();
+  const size_t sObs = obs.size() > 1;
+  const size_t sTh = th.size() > 1;
+  const size_t sShift = shift.size() > 1;
+  const double twoPi = 2. * TMath::Pi();
+  for (size_t i = 0; i < out.size(); i++) {
+    const double val = fmod(th[i * sTh] - obs[i * sObs] + shift[i * sShift], twoPi);
+    out[i] = val < 0.0 ? val + twoPi : val;
+  }
+}
+
 ClassImp(RooHistPdfAngleVar)
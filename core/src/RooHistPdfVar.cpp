@@ -9,6 +9,7 @@
 #include <RooHistPdfVar.h>
 
 #include <RooAbsReal.h>
+#include <RooFit/EvalContext.h>
 
 RooHistPdfVar::RooHistPdfVar(const char* name, const char* title, RooAbsReal& _xobs, RooAbsReal& _xth,
                              RooAbsReal& _xshift)
@@ -26,4 +27,19 @@ Double_t RooHistPdfVar::evaluate() const {
   // return -double(xth) + double(xobs) + double(xshift);
 }
 
+///
+/// Vectorised evaluation, for the batch evaluation backend of RooFit.
+/// Each input is either one value per event or a single scalar.
+///
+void RooHistPdfVar::doEval(RooFit::EvalContext& ctx) const {
+  const std::span<const double> obs = ctx.at(xobs);
+  const std::span<const double> th = ctx.at(xth);
+  const std::span<const double> shift = ctx.at(xshift);
+  const std::span<double> out = ctx.output();
+  const size_t sObs = obs.size() > 1;
+  const size_t sTh = th.size() > 1;
+  const size_t sShift = shift.size() > 1;
+  for (size_t i = 0; i < out.size(); i++) out[i] = th[i * sTh] - obs[i * sObs] + shift[i * sShift];
+}
+
 ClassImp(RooHistPdfVar)
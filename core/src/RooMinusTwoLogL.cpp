@@ -0,0 +1,15 @@
+#include <RooMinusTwoLogL.h>
+
+#include <RooAbsPdf.h>
+
+#include <cmath>
+
+RooMinusTwoLogL::RooMinusTwoLogL(const char* name, const char* title, RooAbsPdf& _pdf)
+    : RooAbsReal(name, title), pdf("pdf", "pdf", this, _pdf) {}
+
+RooMinusTwoLogL::RooMinusTwoLogL(const RooMinusTwoLogL& other, const char* name)
+    : RooAbsReal(other, name), pdf("pdf", this, other.pdf) {}
+
+double RooMinusTwoLogL::evaluate() const { return -2. * std::log(pdf); }
+
+ClassImp(RooMinusTwoLogL)
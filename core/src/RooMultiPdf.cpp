@@ -8,7 +8,10 @@
 
 #include <RooCategory.h>
 #include <RooConstVar.h>
+#include <RooFit/EvalContext.h>
 
+#include <algorithm>
+#include <span>
 #include <stdexcept>
 
 ClassImp(RooMultiPdf)
@@ -101,6 +104,21 @@ Double_t RooMultiPdf::evaluate() const {
   throw std::invalid_argument("RooMultiPdf::evaluate() called\n");
 }
 
+//_____________________________________________________________________________
+void RooMultiPdf::doEval(RooFit::EvalContext& ctx) const {
+  // Batch evaluation: forward the values of the current pdf, as getValV() does.
+  // The index is a parameter, so it is the same for all events.
+  const int index = static_cast<int>(ctx.at(&x.arg())[0]);
+  const std::span<const double> val = ctx.at(c.at(index));
+  const std::span<double> out = ctx.output();
+  if (val.size() == 1) {
+    std::fill(out.begin(), out.end(), val[0]);
+  } else {
+    std::copy(val.begin(), val.begin() + out.size(), out.begin());
+  }
+  _oldIndex = index;
+}
+
 //_____________________________________________________________________________
 Double_t RooMultiPdf::getLogVal(const RooArgSet* nset) const {
   RooAbsPdf* cPdf = ((RooAbsPdf*)c.at(x));
@@ -9,6 +9,7 @@
 #include <RooPoly3Var.h>
 
 #include <RooAbsReal.h>
+#include <RooFit/EvalContext.h>
 
 RooPoly3Var::RooPoly3Var(const char* name, const char* title, RooAbsReal& _xobs, double& _p0, double& _p1, double& _p2,
                          double& _p3)
@@ -21,7 +22,20 @@ RooPoly3Var::~RooPoly3Var() {}
 
 Double_t RooPoly3Var::evaluate() const {
   double x = double(xobs);
-  return p0 + p1 * x + p2 * x * x + p3 * x * x * x;
+  return p0 + x * (p1 + x * (p2 + x * p3));
+}
+
+///
+/// Vectorised evaluation, for the batch evaluation backend of RooFit.
+///
+void RooPoly3Var::doEval(RooFit::EvalContext& ctx) const {
+  const std::span<const double> xs = ctx.at(xobs);
+  const std::span<double> out = ctx.output();
+  const size_t sx = xs.size() > 1;
+  for (size_t i = 0; i < out.size(); i++) {
+    const double x = xs[i * sx];
+    out[i] = p0 + x * (p1 + x * (p2 + x * p3));
+  }
 }
 
 ClassImp(RooPoly3Var)
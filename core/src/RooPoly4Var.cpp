@@ -9,6 +9,7 @@
 #include <RooPoly4Var.h>
 
 #include <RooAbsReal.h>
+#include <RooFit/EvalContext.h>
 
 RooPoly4Var::RooPoly4Var(const char* name, const char* title, RooAbsReal& _xobs, double& _p0, double& _p1, double& _p2,
                          double& _p3, double& _p4)
@@ -22,7 +23,20 @@ RooPoly4Var::~RooPoly4Var() {}
 
 Double_t RooPoly4Var::evaluate() const {
   double x = double(xobs);
-  return p0 + p1 * x + p2 * x * x + p3 * x * x * x + p4 * x * x * x * x;
+  return p0 + x * (p1 + x * (p2 + x * (p3 + x * p4)));
+}
+
+///
+/// Vectorised evaluation, for the batch evaluation backend of RooFit.
+///
+void RooPoly4Var::doEval(RooFit::EvalContext& ctx) const {
+  const std::span<const double> xs = ctx.at(xobs);
+  const std::span<double> out = ctx.output();
+  const size_t sx = xs.size() > 1;
+  for (size_t i = 0; i < out.size(); i++) {
+    const double x = xs[i * sx];
+    out[i] = p0 + x * (p1 + x * (p2 + x * (p3 + x * p4)));
+  }
 }
 
 ClassImp(RooPoly4Var)
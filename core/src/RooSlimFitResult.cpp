@@ -3,11 +3,13 @@
 #include <RooFitResult.h>
 #include <RooRealVar.h>
 
+#include <TBuffer.h>
 #include <TMath.h>
 
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <utility>
 #include <vector>
 
 RooSlimFitResult::RooSlimFitResult(RooFitResult* r, bool storeCorrelation) { init(r, storeCorrelation); }
@@ -25,6 +27,7 @@ RooSlimFitResult::RooSlimFitResult(const RooSlimFitResult& r) : TObject(reinterp
 /// default constructor (needed for TObject serialization)
 ///
 RooSlimFitResult::RooSlimFitResult() : _correlationMatrix(0) {
+  _schema = FitParameterSchema::intern({}, {}, {});
   _edm = std::numeric_limits<double>::quiet_NaN();  // set to nan
   _minNLL = std::numeric_limits<double>::quiet_NaN();
   _covQual = -9;
@@ -36,6 +39,61 @@ RooSlimFitResult::~RooSlimFitResult() {}
 
 RooSlimFitResult* RooSlimFitResult::Clone() { return new RooSlimFitResult(this); }
 
+///
+/// Copy another slim fit result, sharing its schema. Like the
+/// initialization from a RooFitResult, this doesn't copy the correlation
+/// matrix and the confirmed flag.
+///
+void RooSlimFitResult::init(const RooSlimFitResult* r) {
+  assert(r);
+  _schema = r->_schema;
+  _values = r->_values;
+  _covQual = r->_covQual;
+  _edm = r->_edm;
+  _minNLL = r->_minNLL;
+  _status = r->_status;
+  _isConfirmed = false;
+}
+
+///
+/// Read or write a fit result. The file format is the one of the parameter
+/// vectors _parsNames etc., which are filled from the schema and values just
+/// for writing, and converted into them after reading.
+///
+void RooSlimFitResult::Streamer(TBuffer& R__b) {
+  if (R__b.IsReading()) {
+    R__b.ReadClassBuffer(RooSlimFitResult::Class(), this);
+    _values = _parsVal;
+    _values.insert(_values.end(), _parsErr.begin(), _parsErr.end());
+    _schema = FitParameterSchema::intern(std::move(_parsNames), std::move(_parsFloatId), std::move(_parsAngle));
+    clearStreamerVectors();
+  } else {
+    const int nPars = _schema->getNPars();
+    _parsNames = _schema->getNames();
+    for (int i = 0; i < nPars; i++) {
+      _parsFloatId.push_back(_schema->getFloatId(i));
+      _parsAngle.push_back(_schema->isAngle(i));
+      _parsConst.push_back(_schema->isConst(i));
+    }
+    _parsVal.assign(_values.begin(), _values.begin() + nPars);
+    _parsErr.assign(_values.begin() + nPars, _values.end());
+    R__b.WriteClassBuffer(RooSlimFitResult::Class(), this);
+    clearStreamerVectors();
+  }
+}
+
+///
+/// Free the memory of the vectors only used by Streamer().
+///
+void RooSlimFitResult::clearStreamerVectors() {
+  std::vector<std::string>().swap(_parsNames);
+  std::vector<int>().swap(_parsFloatId);
+  std::vector<float>().swap(_parsVal);
+  std::vector<float>().swap(_parsErr);
+  std::vector<bool>().swap(_parsAngle);
+  std::vector<bool>().swap(_parsConst);
+}
+
 ///
 /// Return a RooArgList of RooRealVars that constitute the constant fit parameters.
 ///
@@ -46,13 +104,13 @@ const RooArgList& RooSlimFitResult::constPars() const {
   if (_constParsDummy.getSize() > 0) return _constParsDummy;
   // create a RooArgList out of the content in the map
   _constParsDummy.removeAll();
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (!_parsConst[i]) continue;
-    TString name(_parsNames[i]);
-    float value = _parsVal[i];
+  for (int i = 0; i < _schema->getNPars(); i++) {
+    if (!_schema->isConst(i)) continue;
+    TString name(_schema->getName(i));
+    float value = getParVal(i);
     RooRealVar var(name, name, value);
     var.setConstant(true);
-    var.setUnit(_parsAngle[i] ? "Rad" : "");
+    var.setUnit(_schema->isAngle(i) ? "Rad" : "");
     _constParsDummy.addClone(var);
   }
   return _constParsDummy;
@@ -68,20 +126,28 @@ const RooArgList& RooSlimFitResult::floatParsFinal() const {
   if (!_floatParsFinalDummy.empty()) return _floatParsFinalDummy;
   // create a RooArgList out of the content in the map
   _floatParsFinalDummy.removeAll();
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (_parsConst[i]) continue;
-    TString name(_parsNames[i]);
-    float value = _parsVal[i];
-    float error = _parsErr[i];
+  for (int i = 0; i < _schema->getNPars(); i++) {
+    if (_schema->isConst(i)) continue;
+    TString name(_schema->getName(i));
+    float value = getParVal(i);
+    float error = getParErr(i);
     RooRealVar var(name, name, value);
     var.setError(error);
     var.setConstant(false);
-    var.setUnit(_parsAngle[i] ? "Rad" : "");
+    var.setUnit(_schema->isAngle(i) ? "Rad" : "");
     _floatParsFinalDummy.addClone(var);
   }
   return _floatParsFinalDummy;
 }
 
+///
+/// Return the ID of a parameter, to be used with getParVal(int) and
+/// getParErr(int). It is valid for all fit results with the same schema.
+/// \param name - the parameter name
+/// \return - the ID, -1 if the parameter wasn't found.
+///
+int RooSlimFitResult::getParId(TString name) const { return _schema->getId(name.Data()); }
+
 ///
 /// Return the value of a constant parameter contained in this
 /// fit result.
@@ -89,11 +155,9 @@ const RooArgList& RooSlimFitResult::floatParsFinal() const {
 /// \return - the value, NaN if the parameter wasn't found.
 ///
 float RooSlimFitResult::getConstParVal(TString name) const {
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (!_parsConst[i]) continue;
-    if (TString(_parsNames[i]) == name) return _parsVal[i];
-  }
-  return std::numeric_limits<float>::quiet_NaN();  // return nan
+  const int id = getParId(name);
+  if (id < 0 || !_schema->isConst(id)) return std::numeric_limits<float>::quiet_NaN();  // return nan
+  return getParVal(id);
 }
 
 ///
@@ -103,11 +167,9 @@ float RooSlimFitResult::getConstParVal(TString name) const {
 /// \return - the value, NaN if the parameter wasn't found.
 ///
 float RooSlimFitResult::getFloatParFinalVal(TString name) const {
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (_parsConst[i]) continue;
-    if (TString(_parsNames[i]) == name) return _parsVal[i];
-  }
-  return std::numeric_limits<float>::quiet_NaN();  // return nan
+  const int id = getParId(name);
+  if (id < 0 || _schema->isConst(id)) return std::numeric_limits<float>::quiet_NaN();  // return nan
+  return getParVal(id);
 }
 
 ///
@@ -117,10 +179,9 @@ float RooSlimFitResult::getFloatParFinalVal(TString name) const {
 /// \return - the value, NaN if the parameter wasn't found.
 ///
 float RooSlimFitResult::getParVal(TString name) const {
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (TString(_parsNames[i]) == name) return _parsVal[i];
-  }
-  return std::numeric_limits<double>::quiet_NaN();  // return nan
+  const int id = getParId(name);
+  if (id < 0) return std::numeric_limits<double>::quiet_NaN();  // return nan
+  return getParVal(id);
 }
 
 ///
@@ -130,10 +191,9 @@ float RooSlimFitResult::getParVal(TString name) const {
 /// \return - the value, NaN if the parameter wasn't found.
 ///
 float RooSlimFitResult::getParErr(TString name) const {
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (TString(_parsNames[i]) == name) return _parsErr[i];
-  }
-  return std::numeric_limits<double>::quiet_NaN();  // return nan
+  const int id = getParId(name);
+  if (id < 0) return std::numeric_limits<double>::quiet_NaN();  // return nan
+  return getParErr(id);
 }
 
 ///
@@ -142,12 +202,7 @@ float RooSlimFitResult::getParErr(TString name) const {
 /// \param name - the parameter name
 /// \return - true if the parameter was found
 ///
-bool RooSlimFitResult::hasParameter(TString name) const {
-  for (int i = 0; i < _parsNames.size(); i++) {
-    if (TString(_parsNames[i]) == name) return true;
-  }
-  return false;
-}
+bool RooSlimFitResult::hasParameter(TString name) const { return getParId(name) >= 0; }
 
 void RooSlimFitResult::SaveLatex(std::ofstream& outfile, bool verbose, bool printcor) {
   outfile << "\%  FCN: " << minNll() << ", EDM: " << edm() << std::endl;
@@ -157,26 +212,26 @@ void RooSlimFitResult::SaveLatex(std::ofstream& outfile, bool verbose, bool prin
   outfile << "\\begin{tabular}{ l | l l l }" << std::endl;
   outfile << "  Parameter &  Value & & Uncertainty \\\\" << std::endl;
   std::vector<TString> myParNames;
-  for (int i = 0; i < _parsNames.size(); i++) {
-    TString printName = "\\" + TString(_parsNames[i]).ReplaceAll("_", "");
-    float val = _parsVal[i];
-    float err = _parsErr[i];
-    if (_parsAngle[i]) {
+  for (int i = 0; i < _schema->getNPars(); i++) {
+    TString printName = "\\" + TString(_schema->getName(i)).ReplaceAll("_", "");
+    float val = getParVal(i);
+    float err = getParErr(i);
+    if (_schema->isAngle(i)) {
       val *= 180. / TMath::Pi();
       err *= 180. / TMath::Pi();
     }
     // print constant parameters
-    if (_parsConst[i]) {
-      if (!TString(_parsNames[i]).Contains("obs")) {
+    if (_schema->isConst(i)) {
+      if (!TString(_schema->getName(i)).Contains("obs")) {
         outfile << Form(" %-22s  &  $%5.3f$ & $\\pm$ & $%5.3f$", printName.Data(), val, err);
-        if (_parsAngle[i]) outfile << " (Deg)";
+        if (_schema->isAngle(i)) outfile << " (Deg)";
         outfile << " \\\\" << std::endl;
       }
     }
     // print floating parameters
     else {
       outfile << Form(" %-22s  &  $%5.3f$ & $\\pm$ & $%5.3f$", printName.Data(), val, err);
-      if (_parsAngle[i]) outfile << " (Deg)";
+      if (_schema->isAngle(i)) outfile << " (Deg)";
       outfile << " \\\\" << std::endl;
       myParNames.push_back(printName);
     }
@@ -219,25 +274,25 @@ void RooSlimFitResult::Print(bool verbose, bool printcor) {
   std::cout << "    Parameter                      FinalValue +/- Error " << (_isConfirmed ? "(HESSE)" : "(MIGRAD)")
             << std::endl;
   std::cout << "  ----------------------------   ---------------------------------" << std::endl;
-  for (int i = 0; i < _parsNames.size(); i++) {
-    float val = _parsVal[i];
-    float err = _parsErr[i];
-    if (_parsAngle[i]) {
+  for (int i = 0; i < _schema->getNPars(); i++) {
+    float val = getParVal(i);
+    float err = getParErr(i);
+    if (_schema->isAngle(i)) {
       val *= 180. / TMath::Pi();
       err *= 180. / TMath::Pi();
     }
     // print constant parameters
-    if (_parsConst[i]) {
-      if (!TString(_parsNames[i]).Contains("obs")) {
-        printf("       %22s    %11.6g +/- %10.6g (const)", TString(_parsNames[i]).Data(), val, err);
-        if (_parsAngle[i]) std::cout << " (Deg)";
+    if (_schema->isConst(i)) {
+      if (!TString(_schema->getName(i)).Contains("obs")) {
+        printf("       %22s    %11.6g +/- %10.6g (const)", _schema->getName(i).c_str(), val, err);
+        if (_schema->isAngle(i)) std::cout << " (Deg)";
         std::cout << std::endl;
       }
     }
     // print floating parameters
     else {
-      printf("    %2i %22s    %11.6g +/- %10.6g", _parsFloatId[i], TString(_parsNames[i]).Data(), val, err);
-      if (_parsAngle[i]) std::cout << " (Deg)";
+      printf("    %2i %22s    %11.6g +/- %10.6g", _schema->getFloatId(i), _schema->getName(i).c_str(), val, err);
+      if (_schema->isAngle(i)) std::cout << " (Deg)";
       std::cout << std::endl;
     }
   }
@@ -0,0 +1,265 @@
+#include <TheoryGradient.h>
+
+#include <FormulaParser.h>
+
+#include <RooAbsReal.h>
+#include <RooArgSet.h>
+#include <RooFormulaVar.h>
+#include <RooRealVar.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+using enum FormulaParser::Code;
+
+///
+/// Compile the theory relations, and check the analytic derivatives
+/// against numerical ones at the current parameter values.
+///
+/// \param theory The theory relations, e.g. RooGaussianChi2::getTheory().
+/// \param pars The parameters to differentiate by.
+///
+TheoryGradient::TheoryGradient(const RooArgList& theory, const RooArgList& pars) : _pars(pars) {
+  for (const auto arg : theory) {
+    Relation rel;
+    rel.th = static_cast<RooAbsReal*>(arg);
+    bool analytic = compile(rel);
+    if (analytic) {
+      const int n = rel.deps.size();
+      std::vector<double> dAnalytic(n);
+      std::vector<double> dNumerical(n);
+      const double value = evaluate(rel, dAnalytic.data());
+      numerical(rel, dNumerical.data());
+      analytic = std::abs(value - rel.th->getVal()) <= 1e-9 * std::max(1., std::abs(value));
+      for (int k = 0; k < n; k++) {
+        if (rel.deps[k]->isConstant()) continue;
+        const double scale = 1. + std::abs(dAnalytic[k]) + std::abs(dNumerical[k]);
+        analytic &= std::abs(dAnalytic[k] - dNumerical[k]) <= 1e-5 * scale;
+      }
+    }
+    if (!analytic) {
+      rel.tape.clear();
+      rel.deps.clear();
+      std::unique_ptr<RooArgSet> vars(rel.th->getVariables());
+      for (const auto v : *vars) {
+        const auto var = dynamic_cast<RooRealVar*>(v);
+        if (var && _pars.find(*var)) rel.deps.push_back(var);
+      }
+    }
+    for (const auto dep : rel.deps) rel.index.push_back(_pars.index(dep));
+    _nAnalytic += analytic;
+    _relations.push_back(std::move(rel));
+  }
+}
+
+///
+/// Compile the expression of a RooFormulaVar of RooRealVars.
+///
+/// \return false if the relation can't be compiled.
+///
+bool TheoryGradient::compile(Relation& rel) const {
+  const auto formula = dynamic_cast<const RooFormulaVar*>(rel.th);
+  if (!formula) return false;
+  const RooArgList& deps = formula->dependents();
+  for (const auto dep : deps) {
+    const auto var = dynamic_cast<RooRealVar*>(dep);
+    if (!var) return false;
+    rel.deps.push_back(var);
+  }
+  if (!FormulaParser(formula->expression(), deps).parse(rel.tape)) return false;
+  rel.depth = FormulaParser::depth(rel.tape);
+  return rel.depth > 0;
+}
+
+///
+/// Evaluate a compiled relation together with its derivatives.
+///
+/// \param rel The relation.
+/// \param deriv Filled with the derivatives with respect to rel.deps.
+/// \return The value of the relation.
+///
+double TheoryGradient::evaluate(const Relation& rel, double* deriv) const {
+  // every stack entry is the value followed by the derivatives
+  const int n = rel.deps.size();
+  const int m = n + 1;
+  _stack.resize(size_t(rel.depth) * m);
+  double* a = _stack.data() - m;
+  for (const FormulaParser::Instruction& op : rel.tape) {
+    if (op.code == kConst || op.code == kVar) {
+      a += m;
+      std::fill(a + 1, a + m, 0.);
+      if (op.code == kConst) {
+        a[0] = op.value;
+      } else {
+        a[0] = rel.deps[op.index]->getVal();
+        a[1 + op.index] = 1.;
+      }
+      continue;
+    }
+    if (FormulaParser::isBinary(op.code)) {
+      // binary operation, a = a op b
+      const double* b = a;
+      a -= m;
+      const double a0 = a[0];
+      const double b0 = b[0];
+      switch (op.code) {
+        case kAdd:
+          for (int k = 0; k < m; k++) a[k] += b[k];
+          break;
+        case kSub:
+          for (int k = 0; k < m; k++) a[k] -= b[k];
+          break;
+        case kMul:
+          for (int k = 1; k < m; k++) a[k] = a[k] * b0 + a0 * b[k];
+          a[0] = a0 * b0;
+          break;
+        case kDiv:
+          a[0] = a0 / b0;
+          for (int k = 1; k < m; k++) a[k] = (a[k] - a[0] * b[k]) / b0;
+          break;
+        case kPow: {
+          a[0] = std::pow(a0, b0);
+          const bool constExponent = std::all_of(b + 1, b + m, [](double d) { return d == 0.; });
+          if (constExponent) {
+            const double dfda = b0 * std::pow(a0, b0 - 1.);
+            for (int k = 1; k < m; k++) a[k] *= dfda;
+          } else {
+            for (int k = 1; k < m; k++) a[k] = a[0] * (b[k] * std::log(a0) + b0 * a[k] / a0);
+          }
+          break;
+        }
+        case kAtan2: {
+          const double r2 = a0 * a0 + b0 * b0;
+          for (int k = 1; k < m; k++) a[k] = (b0 * a[k] - a0 * b[k]) / r2;
+          a[0] = std::atan2(a0, b0);
+          break;
+        }
+      }
+      continue;
+    }
+    // unary operation, a = f(a), a' = f'(a) a'
+    const double x = a[0];
+    double f = 0.;
+    double dfdx = 0.;
+    switch (op.code) {
+      case kNeg:
+        f = -x;
+        dfdx = -1.;
+        break;
+      case kSin:
+        f = std::sin(x);
+        dfdx = std::cos(x);
+        break;
+      case kCos:
+        f = std::cos(x);
+        dfdx = -std::sin(x);
+        break;
+      case kTan:
+        f = std::tan(x);
+        dfdx = 1. + f * f;
+        break;
+      case kAsin:
+        f = std::asin(x);
+        dfdx = 1. / std::sqrt(1. - x * x);
+        break;
+      case kAcos:
+        f = std::acos(x);
+        dfdx = -1. / std::sqrt(1. - x * x);
+        break;
+      case kAtan:
+        f = std::atan(x);
+        dfdx = 1. / (1. + x * x);
+        break;
+      case kSinh:
+        f = std::sinh(x);
+        dfdx = std::cosh(x);
+        break;
+      case kCosh:
+        f = std::cosh(x);
+        dfdx = std::sinh(x);
+        break;
+      case kTanh:
+        f = std::tanh(x);
+        dfdx = 1. - f * f;
+        break;
+      case kExp:
+        f = std::exp(x);
+        dfdx = f;
+        break;
+      case kLog:
+        f = std::log(x);
+        dfdx = 1. / x;
+        break;
+      case kLog10:
+        f = std::log10(x);
+        dfdx = 1. / (x * std::log(10.));
+        break;
+      case kSqrt:
+        f = std::sqrt(x);
+        dfdx = 0.5 / f;
+        break;
+      case kAbs:
+        f = std::abs(x);
+        dfdx = x < 0. ? -1. : 1.;
+        break;
+      case kSq:
+        f = x * x;
+        dfdx = 2. * x;
+        break;
+    }
+    a[0] = f;
+    for (int k = 1; k < m; k++) a[k] *= dfdx;
+  }
+  std::copy(a + 1, a + m, deriv);
+  return a[0];
+}
+
+///
+/// Differentiate a relation numerically, by central differences. At the
+/// limits of a parameter, the difference is one-sided.
+///
+/// \param rel The relation.
+/// \param deriv Filled with the derivatives with respect to rel.deps, 0 for constant parameters.
+///
+void TheoryGradient::numerical(const Relation& rel, double* deriv) const {
+  for (int k = 0; k < rel.deps.size(); k++) {
+    RooRealVar* p = rel.deps[k];
+    deriv[k] = 0.;
+    if (p->isConstant()) continue;
+    const double x = p->getVal();
+    const double h = 1e-6 * std::max(std::abs(x), 1.);
+    const double xUp = p->hasMax() && x + h > p->getMax() ? x : x + h;
+    const double xDown = p->hasMin() && x - h < p->getMin() ? x : x - h;
+    if (xUp == xDown) continue;
+    p->setVal(xUp);
+    const double fUp = rel.th->getVal();
+    p->setVal(xDown);
+    const double fDown = rel.th->getVal();
+    p->setVal(x);
+    deriv[k] = (fUp - fDown) / (xUp - xDown);
+  }
+}
+
+///
+/// Chain the derivatives of the chi2 with respect to the theory relations
+/// to the gradient with respect to the parameters, at their current values.
+///
+/// \param dChi2dTh The derivatives of the chi2 with respect to the theory relations.
+/// \param grad Filled with the gradient, in the order of the parameters.
+///
+void TheoryGradient::accumulate(const std::vector<double>& dChi2dTh, std::vector<double>& grad) const {
+  grad.assign(_pars.size(), 0.);
+  for (int i = 0; i < _relations.size(); i++) {
+    const Relation& rel = _relations[i];
+    _deriv.resize(rel.deps.size());
+    if (rel.tape.empty()) {
+      numerical(rel, _deriv.data());
+    } else {
+      evaluate(rel, _deriv.data());
+    }
+    for (int k = 0; k < rel.deps.size(); k++) {
+      if (rel.index[k] >= 0) grad[rel.index[k]] += dChi2dTh[i] * _deriv[k];
+    }
+  }
+}
@@ -0,0 +1,220 @@
+#include <ToyCache.h>
+
+#include <TFile.h>
+#include <TNamed.h>
+#include <TSystem.h>
+#include <TTree.h>
+
+#include <iostream>
+#include <memory>
+#include <utility>
+
+///
+/// Add the statistics of other toys, e.g. of another range of entries of
+/// the same file. The sketches of the test statistics are merged.
+///
+void ToyFileStats::add(const ToyFileStats& other) {
+  nEntries += other.nEntries;
+  nSelected += other.nSelected;
+  nFailed += other.nFailed;
+  nWrongRun += other.nWrongRun;
+  for (const auto& [scanpoint, otherPoint] : other.points) {
+    ToyPointStats& point = points[scanpoint];
+    point.nBetter += otherPoint.nBetter;
+    point.nBetterClb += otherPoint.nBetterClb;
+    point.nAll += otherPoint.nAll;
+    point.nBackground += otherPoint.nBackground;
+    point.nGof += otherPoint.nGof;
+    point.sbTestStat.merge(otherPoint.sbTestStat);
+    point.bTestStat.merge(otherPoint.bTestStat);
+  }
+}
+
+///
+/// Open a toy cache. The cached statistics are read from fileName if it exists
+/// and was written for the same configuration.
+///
+/// \param fileName Name of the cache file.
+/// \param config   String describing everything besides the toy files that the
+///                 statistics depend on, e.g. the test statistic.
+///
+ToyCache::ToyCache(const TString& fileName, const TString& config) : fileName(fileName), config(config) { read(); }
+
+///
+/// Get the modification time and size of a file.
+///
+/// \return false if the file doesn't exist.
+///
+bool ToyCache::getFileInfo(const TString& file, Long64_t& mtime, Long64_t& size) {
+  FileStat_t stat;
+  if (gSystem->GetPathInfo(file, stat) != 0) return false;
+  mtime = stat.fMtime;
+  size = stat.fSize;
+  return true;
+}
+
+void ToyCache::read() {
+  if (gSystem->AccessPathName(fileName)) return;  // sic, true if the file does not exist
+  std::unique_ptr<TFile> f(TFile::Open(fileName));
+  if (!f || f->IsZombie()) {
+    std::cout << "ToyCache::read() : WARNING : could not open " << fileName << ", ignoring the cache." << std::endl;
+    return;
+  }
+  const auto cachedConfig = f->Get<TNamed>("config");
+  if (!cachedConfig || config != cachedConfig->GetTitle()) {
+    std::cout << "ToyCache::read() : configuration has changed, ignoring " << fileName << std::endl;
+    return;
+  }
+  const auto files = f->Get<TTree>("files");
+  const auto points = f->Get<TTree>("points");
+  if (!files || !points) {
+    std::cout << "ToyCache::read() : WARNING : " << fileName << " is incomplete, ignoring the cache." << std::endl;
+    return;
+  }
+
+  std::string* name = nullptr;
+  Entry entry;
+  Long64_t nPoints;
+  files->SetBranchAddress("name", &name);
+  files->SetBranchAddress("mtime", &entry.mtime);
+  files->SetBranchAddress("size", &entry.size);
+  files->SetBranchAddress("nEntries", &entry.stats.nEntries);
+  files->SetBranchAddress("nSelected", &entry.stats.nSelected);
+  files->SetBranchAddress("nFailed", &entry.stats.nFailed);
+  files->SetBranchAddress("nWrongRun", &entry.stats.nWrongRun);
+  files->SetBranchAddress("nPoints", &nPoints);
+
+  float scanpoint;
+  ToyPointStats point;
+  std::vector<double>* sbValues = nullptr;
+  std::vector<int>* sbLevels = nullptr;
+  std::vector<double>* bValues = nullptr;
+  std::vector<int>* bLevels = nullptr;
+  points->SetBranchAddress("scanpoint", &scanpoint);
+  points->SetBranchAddress("nBetter", &point.nBetter);
+  points->SetBranchAddress("nBetterClb", &point.nBetterClb);
+  points->SetBranchAddress("nAll", &point.nAll);
+  points->SetBranchAddress("nBackground", &point.nBackground);
+  points->SetBranchAddress("nGof", &point.nGof);
+  points->SetBranchAddress("sbValues", &sbValues);
+  points->SetBranchAddress("sbLevels", &sbLevels);
+  points->SetBranchAddress("bValues", &bValues);
+  points->SetBranchAddress("bLevels", &bLevels);
+
+  Long64_t iPoint = 0;
+  for (Long64_t i = 0; i < files->GetEntries(); i++) {
+    files->GetEntry(i);
+    Entry& cached = entries[*name];
+    cached.mtime = entry.mtime;
+    cached.size = entry.size;
+    cached.stats = entry.stats;
+    for (Long64_t j = 0; j < nPoints; j++) {
+      points->GetEntry(iPoint++);
+      point.sbTestStat.setState(*sbValues, *sbLevels);
+      point.bTestStat.setState(*bValues, *bLevels);
+      cached.stats.points[scanpoint] = point;
+    }
+  }
+  files->ResetBranchAddresses();
+  points->ResetBranchAddresses();
+  delete name;
+  delete sbValues;
+  delete sbLevels;
+  delete bValues;
+  delete bLevels;
+}
+
+///
+/// Get the cached statistics of a toy file.
+///
+/// \param toyFile Name of the toy file.
+/// \return The statistics, or nullptr if the file is not in the cache,
+///         or was modified since it was cached.
+///
+const ToyFileStats* ToyCache::get(const TString& toyFile) const {
+  const auto it = entries.find(toyFile.Data());
+  if (it == entries.end()) return nullptr;
+  Long64_t mtime, size;
+  if (!getFileInfo(toyFile, mtime, size) || mtime != it->second.mtime || size != it->second.size) return nullptr;
+  return &it->second.stats;
+}
+
+///
+/// Add the statistics of a toy file to the cache, replacing earlier ones.
+///
+/// \param toyFile Name of the toy file.
+/// \param stats   Its statistics.
+/// \return The statistics as stored in the cache.
+///
+const ToyFileStats* ToyCache::put(const TString& toyFile, ToyFileStats&& stats) {
+  Entry& entry = entries[toyFile.Data()];
+  getFileInfo(toyFile, entry.mtime, entry.size);
+  entry.stats = std::move(stats);
+  return &entry.stats;
+}
+
+///
+/// Write the cache. The file is written under a temporary name first,
+/// so that an interrupted job doesn't leave a broken cache behind.
+///
+void ToyCache::write() const {
+  const TString tmpName = fileName + ".tmp";
+  std::unique_ptr<TFile> f(TFile::Open(tmpName, "recreate"));
+  if (!f || f->IsZombie()) {
+    std::cout << "ToyCache::write() : WARNING : could not write " << tmpName << std::endl;
+    return;
+  }
+  TNamed("config", config.Data()).Write();
+
+  std::string name;
+  Entry entry;
+  Long64_t nPoints;
+  const auto files = new TTree("files", "toy files");
+  files->Branch("name", &name);
+  files->Branch("mtime", &entry.mtime);
+  files->Branch("size", &entry.size);
+  files->Branch("nEntries", &entry.stats.nEntries);
+  files->Branch("nSelected", &entry.stats.nSelected);
+  files->Branch("nFailed", &entry.stats.nFailed);
+  files->Branch("nWrongRun", &entry.stats.nWrongRun);
+  files->Branch("nPoints", &nPoints);
+
+  float scanpoint;
+  ToyPointStats point;
+  std::vector<double> sbValues, bValues;
+  std::vector<int> sbLevels, bLevels;
+  const auto points = new TTree("points", "scan points of all toy files");
+  points->Branch("scanpoint", &scanpoint);
+  points->Branch("nBetter", &point.nBetter);
+  points->Branch("nBetterClb", &point.nBetterClb);
+  points->Branch("nAll", &point.nAll);
+  points->Branch("nBackground", &point.nBackground);
+  points->Branch("nGof", &point.nGof);
+  points->Branch("sbValues", &sbValues);
+  points->Branch("sbLevels", &sbLevels);
+  points->Branch("bValues", &bValues);
+  points->Branch("bLevels", &bLevels);
+
+  for (const auto& [toyFile, cached] : entries) {
+    name = toyFile;
+    entry.mtime = cached.mtime;
+    entry.size = cached.size;
+    entry.stats.nEntries = cached.stats.nEntries;
+    entry.stats.nSelected = cached.stats.nSelected;
+    entry.stats.nFailed = cached.stats.nFailed;
+    entry.stats.nWrongRun = cached.stats.nWrongRun;
+    nPoints = cached.stats.points.size();
+    files->Fill();
+    for (const auto& [x, p] : cached.stats.points) {
+      scanpoint = x;
+      point = p;
+      p.sbTestStat.getState(sbValues, sbLevels);
+      p.bTestStat.getState(bValues, bLevels);
+      points->Fill();
+    }
+  }
+  files->Write();
+  points->Write();
+  f->Close();  // also deletes the trees
+  gSystem->Rename(tmpName, fileName);
+}
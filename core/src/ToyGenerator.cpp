@@ -0,0 +1,185 @@
+#include <ToyGenerator.h>
+
+#include <ToyRandom.h>
+
+#include <RooAbsPdf.h>
+#include <RooDataSet.h>
+#include <RooGlobalFunc.h>
+#include <RooMultiVarGaussian.h>
+#include <RooProdPdf.h>
+#include <RooRandom.h>
+#include <RooRealVar.h>
+
+#include <TDecompChol.h>
+#include <TMatrixD.h>
+#include <TRandom.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+///
+/// Split the pdf into its factors. The Cholesky decompositions are computed
+/// by generate(), so that changes of the covariance matrices are picked up.
+///
+/// \param pdf The pdf to generate from, e.g. the one of a Combiner.
+/// \param observables The observables to generate.
+///
+ToyGenerator::ToyGenerator(RooAbsPdf* pdf, const RooAbsCollection& observables) : _pdf(pdf), _obs(observables) {
+  addFactor(pdf);
+
+  // each observable has to be generated by exactly one factor
+  std::vector<int> nFactors(_obs.size(), 0);
+  for (const auto factors : {&_gaussians, &_others}) {
+    for (const Factor& f : *factors) {
+      for (int i : f.index) {
+        if (i >= 0) nFactors[i]++;
+      }
+    }
+  }
+  for (int n : nFactors) {
+    if (n == 1) continue;
+    _gaussians.clear();
+    _others.clear();
+    addFactor(nullptr);
+    break;
+  }
+}
+
+///
+/// Add a factor of the pdf, descending into products.
+///
+/// \param pdf The factor, or nullptr to add the whole pdf as one factor generated by RooFit.
+///
+void ToyGenerator::addFactor(RooAbsPdf* pdf) {
+  if (pdf) {
+    if (const auto prod = dynamic_cast<RooProdPdf*>(pdf)) {
+      for (const auto arg : prod->pdfList()) addFactor(static_cast<RooAbsPdf*>(arg));
+      return;
+    }
+  }
+  Factor f{pdf ? pdf : _pdf};
+  bool isGaussian = pdf && pdf->IsA() == RooMultiVarGaussian::Class();
+  if (isGaussian) {
+    // the observables of a Gaussian, in the order of its covariance matrix
+    for (const auto x : static_cast<RooMultiVarGaussian*>(pdf)->xVec()) {
+      isGaussian &= dynamic_cast<RooRealVar*>(x) != nullptr;
+      f.obs.add(*x);
+      f.index.push_back(_obs.index(x->GetName()));
+    }
+  }
+  if (!isGaussian) {
+    std::unique_ptr<RooArgSet> obs(f.pdf->getObservables(_obs));
+    f.obs.removeAll();
+    f.obs.add(*obs);
+    f.index.clear();
+    for (const auto x : f.obs) f.index.push_back(_obs.index(x->GetName()));
+  }
+  if (f.obs.empty()) return;
+  (isGaussian ? _gaussians : _others).push_back(std::move(f));
+}
+
+///
+/// Generate toys at the current values of the parameters.
+///
+/// \param nToys Number of toys.
+/// \param toyObs Filled with the observables of all toys, toyObs[iObs*nToys+iToy],
+///               observables in the order of getObservables().
+/// \param firstToy Index of the first toy at the current ToyRandom scan point. Every toy
+///                 and factor then gets a stream of its own. Default (-1): draw all toys
+///                 from the current stream.
+///
+void ToyGenerator::generate(int nToys, std::vector<double>& toyObs, int firstToy) const {
+  toyObs.assign(size_t(_obs.size()) * nToys, 0.);
+  int substream = ToyRandom::kFactors;
+  for (const Factor& f : _gaussians) generateGaussian(f, nToys, toyObs, firstToy, substream++);
+  for (const Factor& f : _others) generateRooFit(f, nToys, toyObs, firstToy, substream++);
+}
+
+///
+/// Sample a RooMultiVarGaussian factor directly.
+///
+void ToyGenerator::generateGaussian(const Factor& f, int nToys, std::vector<double>& toyObs, int firstToy,
+                                    int substream) const {
+  const auto g = static_cast<const RooMultiVarGaussian*>(f.pdf);
+  const int n = f.index.size();
+
+  // V = U^T U, so the lower triangle of L = U^T is packed row by row
+  TDecompChol chol(g->covarianceMatrix());
+  if (!chol.Decompose()) {
+    std::cout << "ToyGenerator::generate() : ERROR : covariance matrix of " << g->GetName()
+              << " is not positive definite." << std::endl;
+    std::exit(1);
+  }
+  const TMatrixD& u = chol.GetU();
+  std::vector<double> l;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j <= i; j++) l.push_back(u(j, i));
+  }
+  std::vector<double> mu(n);
+  std::vector<double> lo(n);
+  std::vector<double> hi(n);
+  for (int i = 0; i < n; i++) {
+    mu[i] = static_cast<const RooAbsReal&>(g->muVec()[i]).getVal();
+    const auto x = static_cast<const RooRealVar*>(f.obs.at(i));
+    lo[i] = x->getMin();
+    hi[i] = x->getMax();
+  }
+
+  constexpr int kMaxTries = 100000;
+  TRandom* rnd = RooRandom::randomGenerator();
+  std::vector<double> z(n);
+  std::vector<double> x(n);
+  for (int t = 0; t < nToys; t++) {
+    if (firstToy >= 0) ToyRandom::setToy(firstToy + t, substream);
+    for (int nTries = 0;; nTries++) {
+      if (nTries == kMaxTries) {
+        std::cout << "ToyGenerator::generate() : ERROR : no toy of " << g->GetName() << " inside the ranges of "
+                  << "its observables after " << kMaxTries << " tries." << std::endl;
+        std::exit(1);
+      }
+      for (int i = 0; i < n; i++) z[i] = rnd->Gaus();
+      bool inRange = true;
+      const double* li = l.data();
+      for (int i = 0; i < n; i++) {
+        double sum = mu[i];
+        for (int j = 0; j <= i; j++) sum += li[j] * z[j];
+        x[i] = sum;
+        inRange &= lo[i] <= sum && sum <= hi[i];
+        li += i + 1;
+      }
+      if (inRange) break;
+    }
+    for (int i = 0; i < n; i++) {
+      if (f.index[i] >= 0) toyObs[f.index[i] * nToys + t] = x[i];
+    }
+  }
+}
+
+///
+/// Generate a factor with RooFit, and copy the toys into the flat array.
+///
+void ToyGenerator::generateRooFit(const Factor& f, int nToys, std::vector<double>& toyObs, int firstToy,
+                                  int substream) const {
+  if (firstToy >= 0) ToyRandom::setToy(firstToy, substream);
+  std::unique_ptr<RooDataSet> data(f.pdf->generate(f.obs, nToys, RooFit::AutoBinned(false)));
+  // the row is the same object for all toys, only its values change
+  const RooArgSet* row = data->get(0);
+  std::vector<const RooRealVar*> vars;
+  for (const auto x : f.obs) vars.push_back(static_cast<const RooRealVar*>(row->find(x->GetName())));
+  for (int t = 0; t < nToys; t++) {
+    data->get(t);
+    for (int i = 0; i < vars.size(); i++) toyObs[f.index[i] * nToys + t] = vars[i]->getVal();
+  }
+}
+
+///
+/// Set the observables to the values of one toy.
+///
+/// \param toyObs Toys, as filled by generate().
+/// \param nToys Number of toys in toyObs.
+/// \param iToy The toy.
+///
+void ToyGenerator::setObservables(const std::vector<double>& toyObs, int nToys, int iToy) const {
+  for (int i = 0; i < _obs.size(); i++) static_cast<RooRealVar*>(_obs.at(i))->setVal(toyObs[i * nToys + iToy]);
+}
@@ -0,0 +1,160 @@
+#include <ToyRandom.h>
+
+#include <RooRandom.h>
+
+#include <iostream>
+#include <random>
+
+namespace {
+  constexpr UInt_t kPhiloxM0 = 0xD2511F53;
+  constexpr UInt_t kPhiloxM1 = 0xCD9E8D57;
+  constexpr UInt_t kPhiloxW0 = 0x9E3779B9;
+  constexpr UInt_t kPhiloxW1 = 0xBB67AE85;
+
+  ///
+  /// Encrypt the counter c with the key (k0, k1), Philox4x32 with 10 rounds.
+  ///
+  void philox4x32(UInt_t c[4], UInt_t k0, UInt_t k1) {
+    for (int r = 0; r < 10; r++) {
+      if (r > 0) {
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+      }
+      const ULong64_t p0 = ULong64_t(kPhiloxM0) * c[0];
+      const ULong64_t p1 = ULong64_t(kPhiloxM1) * c[2];
+      const UInt_t c1 = c[1];
+      const UInt_t c3 = c[3];
+      c[0] = UInt_t(p1 >> 32) ^ c1 ^ k0;
+      c[1] = UInt_t(p1);
+      c[2] = UInt_t(p0 >> 32) ^ c3 ^ k1;
+      c[3] = UInt_t(p0);
+    }
+  }
+}  // namespace
+
+///
+/// \param seed The campaign seed. If 0, a seed is drawn from the system.
+/// \param nrun The toy run, e.g. --nrun.
+///
+ToyRandom::ToyRandom(ULong64_t seed, int nrun) : TRandom(), _nrun(nrun) {
+  SetName("ToyRandom");
+  SetTitle("Counter-based random number generator Philox4x32-10");
+  SetSeed(seed);
+}
+
+///
+/// Install a ToyRandom as the RooRandom generator. If the seed is drawn
+/// from the system, it is printed, so that the toys can be reproduced.
+///
+/// \param seed The campaign seed, e.g. --seed. If 0, a seed is drawn from the system.
+/// \param nrun The toy run, e.g. --nrun.
+///
+void ToyRandom::install(ULong64_t seed, int nrun) {
+  const auto rnd = new ToyRandom(seed, nrun);
+  if (seed == 0) {
+    std::cout << "ToyRandom::install() : random seed: " << rnd->getSeed() << " (reproduce with --seed "
+              << rnd->getSeed() << ")" << std::endl;
+  }
+  // RooRandom takes ownership
+  RooRandom::setRandomGenerator(rnd);
+}
+
+///
+/// \return The RooRandom generator, if it is a ToyRandom, else nullptr.
+///
+ToyRandom* ToyRandom::current() { return dynamic_cast<ToyRandom*>(RooRandom::randomGenerator()); }
+
+///
+/// Select the stream of a toy in the RooRandom generator. Does nothing if
+/// the RooRandom generator isn't a ToyRandom.
+///
+/// \param point The scan point.
+/// \param toy The toy, or the first toy of a work unit.
+/// \param substream The substream, see Substream.
+///
+void ToyRandom::setStream(int point, int toy, int substream) {
+  if (ToyRandom* rnd = current()) rnd->selectStream(point, toy, substream);
+}
+
+///
+/// Select the stream of another toy at the current scan point of the
+/// RooRandom generator. Does nothing if it isn't a ToyRandom.
+///
+/// \param toy The toy.
+/// \param substream The substream, see Substream.
+///
+void ToyRandom::setToy(int toy, int substream) {
+  if (ToyRandom* rnd = current()) rnd->selectStream(rnd->_point, toy, substream);
+}
+
+///
+/// Select a stream and rewind it.
+///
+void ToyRandom::selectStream(int point, int toy, int substream) {
+  _point = point;
+  _toy = toy;
+  _substream = substream;
+  _block = 0;
+  _iWord = 4;
+}
+
+///
+/// Set the key and rewind the current stream.
+///
+/// \param seed The key. If 0, a key is drawn from the system.
+///
+void ToyRandom::SetSeed(ULong_t seed) {
+  _seed = seed;
+  if (_seed == 0) {
+    std::random_device device;
+    while (_seed == 0) {
+      const ULong64_t hi = device();
+      _seed = (hi << 32) | device();
+    }
+  }
+  fSeed = UInt_t(_seed);
+  _block = 0;
+  _iWord = 4;
+}
+
+///
+/// \return The lower 32 bits of the key.
+///
+UInt_t ToyRandom::GetSeed() const { return UInt_t(_seed); }
+
+///
+/// \return The next 32 random bits of the current stream.
+///
+UInt_t ToyRandom::nextWord() {
+  if (_iWord == 4) {
+    _words[0] = _block++;
+    _words[1] = _toy;
+    _words[2] = _point;
+    _words[3] = (_nrun << 8) | (_substream & 0xff);
+    philox4x32(_words, UInt_t(_seed), UInt_t(_seed >> 32));
+    _iWord = 0;
+  }
+  return _words[_iWord++];
+}
+
+///
+/// \return A uniform random number in ]0,1[, with 53 random bits.
+///
+Double_t ToyRandom::Rndm() {
+  const ULong64_t hi = nextWord();
+  const ULong64_t bits = (hi << 32) | nextWord();
+  return (double(bits >> 11) + 0.5) / 9007199254740992.;
+}
+
+void ToyRandom::RndmArray(Int_t n, Float_t* array) {
+  for (int i = 0; i < n; i++) {
+    // rounding to float may give 1
+    do {
+      array[i] = Rndm();
+    } while (array[i] >= 1.f);
+  }
+}
+
+void ToyRandom::RndmArray(Int_t n, Double_t* array) {
+  for (int i = 0; i < n; i++) array[i] = Rndm();
+}
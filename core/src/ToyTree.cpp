@@ -10,18 +10,43 @@
 #include <RooRealVar.h>
 #include <RooWorkspace.h>
 
+#include <Compression.h>
+#include <TBranch.h>
 #include <TChain.h>
+#include <TDataType.h>
 #include <TFile.h>
+#include <TLeaf.h>
 #include <TMath.h>
 #include <TTree.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iostream>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <utility>
 #include <vector>
 
+namespace {
+  /// The branches needed to analyse the toys, see ToyTree::activateCoreBranchesOnly().
+  const std::vector<TString> coreBranches = {
+      "BergerBoos_id", "chi2min", "chi2minToy", "chi2minGlobal", "chi2minGlobalToy", "chi2minGlobalBkgToy",
+      "chi2minBkgBkgToy", "chi2minBkg", "chi2minBkgToy", "genericProbPValue", "id", "nBergerBoos", "scanpoint",
+      "scanpointy", "statusFree", "statusScan", "statusScanData", "chi2minGlobalToyPDF", "chi2minBkgToyPDF",
+      "chi2minToyPDF", "covQualFree", "covQualScan", "covQualScanData", "statusFreePDF", "statusScanPDF"};
+
+  /// The leaf type code of a branch holding a T, see TTree::Branch().
+  template <typename T>
+  constexpr char leafType() {
+    if constexpr (std::is_same_v<T, double>) return 'D';
+    if constexpr (std::is_same_v<T, int>) return 'I';
+    if constexpr (std::is_same_v<T, short>) return 'S';
+    return 'F';
+  }
+}  // namespace
+
 ToyTree::ToyTree(Combiner* c, TChain* t, bool _quiet) : quiet(_quiet) {
   setCombiner(c);  // load properties from the combiner
   this->t = t;
@@ -45,6 +70,7 @@ ToyTree::ToyTree(PDF_Datasets* p, const OptParser* opt, TChain* t, bool _quiet)
   this->storeObs = false;
   this->storeTh = false;
   this->storeGlob = true;
+  bindSets();
 };
 
 ///
@@ -67,6 +93,19 @@ void ToyTree::setCombiner(Combiner* c) {
   obsName = "obs_" + c->getPdfName();
   parsName = "par_" + c->getPdfName();
   thName = "th_" + c->getPdfName();
+  bindSets();
+}
+
+///
+/// Resolve the sets of parameters, observables, theory parameters and global
+/// observables once, so that the store functions, called for every toy, copy
+/// their values by index.
+///
+void ToyTree::bindSets() {
+  boundPars = ParameterBinding(w, parsName);
+  boundObs = ParameterBinding(w, obsName);
+  boundTheory = ParameterBinding(w, thName);
+  boundGlobalObs = ParameterBinding(w, globName);
 }
 
 ///
@@ -74,6 +113,7 @@ void ToyTree::setCombiner(Combiner* c) {
 /// into the TTree.
 ///
 void ToyTree::fill() {
+  for (auto& [value, copy] : chi2Floats) copy = *value;
   if (t) t->Fill();
 }
 
@@ -85,7 +125,17 @@ void ToyTree::writeToFile(TString fName) {
   if (arg->debug) std::cout << "ToyTree::writeToFile() : ";
   std::cout << "saving toys to: " << fName << std::endl;
   TFile* f = new TFile(fName, "recreate");
-  t->Write();
+  if (t->GetCurrentFile()) {
+    t->Write();
+  } else {
+    // A tree filled in memory is written as a single object that holds all its
+    // baskets. Copy it into the file instead, so that each branch gets its own
+    // compressed baskets, and reading a few branches doesn't read the others.
+    TTree* out = t->CloneTree(0);
+    setCompression(out);
+    out->CopyEntries(t);
+    out->Write();
+  }
   f->Close();
 }
 
@@ -99,133 +149,225 @@ void ToyTree::writeToFile() {
   t->Write();
 }
 
+///
+/// Book a branch of the type of its data member. The chi2 values are
+/// stored as float, unless --toyprecision double is given.
+///
+template <typename T>
+void ToyTree::branch(const char* bName, T* address) {
+  if constexpr (std::is_same_v<T, double>) {
+    if (arg->toyprecision != "double") {
+      float* copy = &chi2Floats[address];
+      t->Branch(bName, copy, TString(bName) + "/F");
+      return;
+    }
+  }
+  t->Branch(bName, address, TString(bName) + "/" + leafType<T>());
+}
+
 ///
 /// Initialize a new TTree, set up all its leaves, connect
 /// them to the proxy variables.
 ///
 void ToyTree::init() {
   t = new TTree("plugin", "plugin");
-  t->Branch("BergerBoos_id", &BergerBoos_id, "BergerBoos_id/F");
-  t->Branch("chi2min", &chi2min, "chi2min/F");
-  t->Branch("chi2minToy", &chi2minToy, "chi2minToy/F");
-  t->Branch("chi2minGlobal", &chi2minGlobal, "chi2minGlobal/F");
-  t->Branch("chi2minGlobalToy", &chi2minGlobalToy, "chi2minGlobalToy/F");
-  t->Branch("chi2minGlobalBkgToy", &chi2minGlobalBkgToy, "chi2minGlobalBkgToy/F");
-  t->Branch("chi2minBkgBkgToy", &chi2minBkgBkgToy, "chi2minBkgBkgToy/F");
-  t->Branch("chi2minBkg", &chi2minBkg, "chi2minBkg/F");
-  t->Branch("chi2minBkgToy", &chi2minBkgToy, "chi2minBkgToy/F");
-  t->Branch("covQualFree", &covQualFree, "covQualFree/F");
-  t->Branch("covQualScan", &covQualScan, "covQualScan/F");
-  t->Branch("covQualFreeBkg", &covQualFreeBkg, "covQualFreeBkg/F");
-  t->Branch("covQualScanBkg", &covQualScanBkg, "covQualScanBkg/F");
-  t->Branch("covQualBkgBkg", &covQualBkgBkg, "covQualBkgBkg/F");
-  t->Branch("covQualScanData", &covQualScanData, "covQualScanData/F");
-  t->Branch("genericProbPValue", &genericProbPValue, "genericProbPValue/F");
-  t->Branch("id", &id, "id/F");
-  t->Branch("nBergerBoos", &nBergerBoos, "nBergerBoos/F");
-  t->Branch("nrun", &nrun, "nrun/F");
-  t->Branch("ntoy", &ntoy, "ntoy/F");
-  t->Branch("npoint", &npoint, "npoint/F");
-  t->Branch("scanbest", &scanbest, "scanbest/F");
-  t->Branch("scanbesty", &scanbesty, "scanbesty/F");
-  t->Branch("scanbestBkg", &scanbestBkg, "scanbestBkg/F");
-  t->Branch("scanbestBkgfitBkg", &scanbestBkgfitBkg, "scanbestBkgfitBkg/F");
-  t->Branch("scanpoint", &scanpoint, "scanpoint/F");
-  t->Branch("scanpointy", &scanpointy, "scanpointy/F");
-  t->Branch("statusFree", &statusFree, "statusFree/F");
-  t->Branch("statusScan", &statusScan, "statusScan/F");
-  t->Branch("statusScanData", &statusScanData, "statusScanData/F");
-  t->Branch("statusFreeBkg", &statusFreeBkg, "statusFreeBkg/F");
-  t->Branch("statusScanBkg", &statusScanBkg, "statusScanBkg/F");
-  t->Branch("statusBkgBkg", &statusBkgBkg, "statusBkgBkg/F");
-  t->Branch("bestIndexScanData", &bestIndexScanData, "bestIndexScanData/I");
+  chi2Floats.clear();
+  extraBranches.clear();
+  branch("BergerBoos_id", &BergerBoos_id);
+  branch("chi2min", &chi2min);
+  branch("chi2minToy", &chi2minToy);
+  branch("chi2minGlobal", &chi2minGlobal);
+  branch("chi2minGlobalToy", &chi2minGlobalToy);
+  branch("chi2minGlobalBkgToy", &chi2minGlobalBkgToy);
+  branch("chi2minBkgBkgToy", &chi2minBkgBkgToy);
+  branch("chi2minBkg", &chi2minBkg);
+  branch("chi2minBkgToy", &chi2minBkgToy);
+  branch("covQualFree", &covQualFree);
+  branch("covQualScan", &covQualScan);
+  branch("covQualFreeBkg", &covQualFreeBkg);
+  branch("covQualScanBkg", &covQualScanBkg);
+  branch("covQualBkgBkg", &covQualBkgBkg);
+  branch("covQualScanData", &covQualScanData);
+  branch("genericProbPValue", &genericProbPValue);
+  branch("id", &id);
+  branch("nBergerBoos", &nBergerBoos);
+  branch("nrun", &nrun);
+  branch("ntoy", &ntoy);
+  branch("npoint", &npoint);
+  branch("scanbest", &scanbest);
+  branch("scanbesty", &scanbesty);
+  branch("scanbestBkg", &scanbestBkg);
+  branch("scanbestBkgfitBkg", &scanbestBkgfitBkg);
+  branch("scanpoint", &scanpoint);
+  branch("scanpointy", &scanpointy);
+  branch("statusFree", &statusFree);
+  branch("statusScan", &statusScan);
+  branch("statusScanData", &statusScanData);
+  branch("statusFreeBkg", &statusFreeBkg);
+  branch("statusScanBkg", &statusScanBkg);
+  branch("statusBkgBkg", &statusBkgBkg);
+  branch("bestIndexScanData", &bestIndexScanData);
+  if (arg->adaptivetoys > 0) {
+    branch("adaptiveStop", &adaptiveStop);
+    branch("adaptivePvalue", &adaptivePvalue);
+    branch("adaptivePvalueErr", &adaptivePvalueErr);
+  }
+  // the buffers of the remaining branches are sized here, once, so that their addresses stay valid
+  bindSets();
+  storeValues(boundPars, parametersScan);
+  storeValues(boundPars, parametersFree);
+  storeValues(boundPars, parametersPll);
   if (!arg->lightfiles) {
-    for (const auto& pAbs : *w->set(parsName)) {
-      const auto p = static_cast<RooRealVar*>(pAbs);
-      parametersScan.insert(std::pair<std::string, float>(p->GetName(), p->getVal()));
-      t->Branch(TString(p->GetName()) + "_scan", &parametersScan[p->GetName()], TString(p->GetName()) + "_scan/F");
-      parametersFree.insert(std::pair<std::string, float>(p->GetName(), p->getVal()));
-      t->Branch(TString(p->GetName()) + "_free", &parametersFree[p->GetName()], TString(p->GetName()) + "_free/F");
-      parametersPll.insert(std::pair<std::string, float>(p->GetName(), p->getVal()));
-      t->Branch(TString(p->GetName()) + "_start", &parametersPll[p->GetName()], TString(p->GetName()) + "_start/F");
+    auto extraBranch = [&](const TString& bName, float* address) {
+      t->Branch(bName, address, bName + "/F");
+      extraBranches.push_back(bName);
+    };
+    for (int i = 0; i < boundPars.size(); i++) {
+      const TString pName = boundPars.getReals()[i]->GetName();
+      extraBranch(pName + "_scan", &parametersScan[i]);
+      extraBranch(pName + "_free", &parametersFree[i]);
+      extraBranch(pName + "_start", &parametersPll[i]);
     }
     // observables
     if (this->storeObs) {
-      for (const auto& pAbs : *w->set(obsName)) {
-        const auto p = static_cast<RooRealVar*>(pAbs);
-        observables.insert(std::pair<std::string, float>(p->GetName(), p->getVal()));
-        t->Branch(TString(p->GetName()), &observables[p->GetName()], TString(p->GetName()) + "/F");
-      }
+      storeValues(boundObs, observables);
+      for (int i = 0; i < boundObs.size(); i++) extraBranch(boundObs.getReals()[i]->GetName(), &observables[i]);
     }
     // theory
     if (this->storeTh) {
-      for (const auto& pAbs : *w->set(thName)) {
-        const auto p = static_cast<RooRealVar*>(pAbs);
-        theory.insert(std::pair<std::string, float>(p->GetName(), p->getVal()));
-        t->Branch(TString(p->GetName()), &theory[p->GetName()], TString(p->GetName()) + "/F");
-      }
+      storeValues(boundTheory, theory);
+      for (int i = 0; i < boundTheory.size(); i++) extraBranch(boundTheory.getReals()[i]->GetName(), &theory[i]);
     }
     // global observables
     if (this->storeGlob) {
-      if (w->set(globName) == nullptr) {
+      if (!boundGlobalObs.isValid()) {
         std::cerr << "Unable to store parameters of global constraints because no set called " + globName
                   << " is defined in the workspace. " << std::endl;
         //\todo Implement init function in PDF_Datasets to enabe the user to set the name of this set in the workspace.
         std::exit(EXIT_FAILURE);
       }
-      for (const auto& pAbs : *w->set(globName)) {
-        const auto p = static_cast<RooRealVar*>(pAbs);
-        constraintMeans.insert(std::pair<TString, float>(p->GetName(), p->getVal()));
-        t->Branch(TString(p->GetName()), &constraintMeans[p->GetName()], TString(p->GetName()) + "/F");
+      storeValues(boundGlobalObs, constraintMeans);
+      for (int i = 0; i < boundGlobalObs.size(); i++) {
+        extraBranch(boundGlobalObs.getReals()[i]->GetName(), &constraintMeans[i]);
       }
     }
   }
+  // trees created inside a file write their baskets directly, so set their compression now
+  setCompression(t);
+}
+
+///
+/// Translate a setting of --toycompression, ALG[:LEVEL], into a ROOT
+/// compression setting (100*algorithm+level).
+///
+/// \param setting One of zlib, lzma, lz4, zstd, optionally followed by the level.
+/// \return The compression setting.
+///
+int ToyTree::parseCompression(TString setting) {
+  setting.ToLower();
+  TString algorithm = setting;
+  int level = -1;
+  const int colon = setting.First(':');
+  if (colon >= 0) {
+    algorithm = setting(0, colon);
+    const TString levelStr = setting(colon + 1, setting.Length());
+    if (!levelStr.IsDigit()) {
+      std::cout << "ToyTree::parseCompression() : ERROR : no valid compression level: " << setting << std::endl;
+      std::exit(1);
+    }
+    level = levelStr.Atoi();
+  }
+  using Algorithm = ROOT::RCompressionSetting::EAlgorithm;
+  using Level = ROOT::RCompressionSetting::ELevel;
+  if (algorithm == "zlib") return ROOT::CompressionSettings(Algorithm::kZLIB, level < 0 ? Level::kDefaultZLIB : level);
+  if (algorithm == "lzma") return ROOT::CompressionSettings(Algorithm::kLZMA, level < 0 ? Level::kDefaultLZMA : level);
+  if (algorithm == "lz4") return ROOT::CompressionSettings(Algorithm::kLZ4, level < 0 ? Level::kDefaultLZ4 : level);
+  if (algorithm == "zstd") return ROOT::CompressionSettings(Algorithm::kZSTD, level < 0 ? Level::kDefaultZSTD : level);
+  std::cout << "ToyTree::parseCompression() : ERROR : unknown compression algorithm: " << algorithm << std::endl;
+  std::exit(1);
+}
+
+///
+/// Apply the compression of --toycompression to the branches of a tree.
+/// The branches of parameters, observables and theory can have a separate
+/// setting, as analysing the toys doesn't read them.
+///
+void ToyTree::setCompression(TTree* tree) const {
+  if (arg->toycompression == "") return;
+  const TString setting = arg->toycompression;
+  const int comma = setting.First(',');
+  const int core = parseCompression(comma < 0 ? setting : TString(setting(0, comma)));
+  const int extra = comma < 0 ? core : parseCompression(setting(comma + 1, setting.Length()));
+  for (const auto bAbs : *tree->GetListOfBranches()) {
+    const auto b = static_cast<TBranch*>(bAbs);
+    const bool isExtra = std::find(extraBranches.begin(), extraBranches.end(), b->GetName()) != extraBranches.end();
+    b->SetCompressionSettings(isExtra ? extra : core);
+  }
+}
+
+///
+/// Connect a branch of an external tree to its data member. Branches of a different
+/// type than the data member, e.g. of toy files written before the IDs and status
+/// codes were stored as integers, are converted when reading an entry.
+///
+template <typename T>
+void ToyTree::connectBranch(const char* bName, T* address) {
+  TBranch* b = t->GetBranch(bName);
+  if (!b) return;
+  TClass* expectedClass = nullptr;
+  EDataType expectedType = kOther_t;
+  b->GetExpectedType(expectedClass, expectedType);
+  if (expectedType == TDataType::GetType(typeid(T))) {
+    t->SetBranchAddress(bName, address);
+    return;
+  }
+  convertedBranches.push_back({bName, [address](double value) { *address = static_cast<T>(value); }});
 }
 
 ///
 /// Provide the interface to read an external TChain.
 ///
 void ToyTree::open() {
-  TObjArray* branches = t->GetListOfBranches();
-  if (branches->FindObject("BergerBoos_id")) t->SetBranchAddress("BergerBoos_id", &BergerBoos_id);
-  if (branches->FindObject("chi2min")) t->SetBranchAddress("chi2min", &chi2min);
-  if (branches->FindObject("chi2minToy")) t->SetBranchAddress("chi2minToy", &chi2minToy);
-  if (branches->FindObject("chi2minGlobal")) t->SetBranchAddress("chi2minGlobal", &chi2minGlobal);
-  if (branches->FindObject("chi2minGlobalToy")) t->SetBranchAddress("chi2minGlobalToy", &chi2minGlobalToy);
-  if (branches->FindObject("chi2minGlobalBkgToy")) t->SetBranchAddress("chi2minGlobalBkgToy", &chi2minGlobalBkgToy);
-  if (branches->FindObject("chi2minBkgBkgToy")) t->SetBranchAddress("chi2minBkgBkgToy", &chi2minBkgBkgToy);
-  if (branches->FindObject("chi2minBkg")) t->SetBranchAddress("chi2minBkg", &chi2minBkg);
-  if (branches->FindObject("chi2minBkgToy")) t->SetBranchAddress("chi2minBkgToy", &chi2minBkgToy);
-  if (branches->FindObject("covQualFree")) t->SetBranchAddress("covQualFree", &covQualFree);
-  if (branches->FindObject("covQualScan")) t->SetBranchAddress("covQualScan", &covQualScan);
-  if (branches->FindObject("covQualScanData")) t->SetBranchAddress("covQualScanData", &covQualScanData);
-  if (branches->FindObject("covQualFreeBkg")) t->SetBranchAddress("covQualFreeBkg", &covQualFreeBkg);
-  if (branches->FindObject("covQualScanBkg")) t->SetBranchAddress("covQualScanBkg", &covQualScanBkg);
-  if (branches->FindObject("covQualBkgBkg")) t->SetBranchAddress("covQualBkgBkg", &covQualBkgBkg);
-  if (branches->FindObject("genericProbPValue")) t->SetBranchAddress("genericProbPValue", &genericProbPValue);
-  if (branches->FindObject("nBergerBoos")) t->SetBranchAddress("nBergerBoos", &nBergerBoos);
-  if (branches->FindObject("scanbest")) t->SetBranchAddress("scanbest", &scanbest);
-  if (branches->FindObject("scanbesty")) t->SetBranchAddress("scanbesty", &scanbesty);
-  if (branches->FindObject("scanbestBkg")) t->SetBranchAddress("scanbestBkg", &scanbestBkg);
-  if (branches->FindObject("scanbestBkgfitBkg")) t->SetBranchAddress("scanbestBkgfitBkg", &scanbestBkgfitBkg);
-  if (branches->FindObject("scanpoint")) t->SetBranchAddress("scanpoint", &scanpoint);
-  if (branches->FindObject("scanpointy")) t->SetBranchAddress("scanpointy", &scanpointy);
-  if (branches->FindObject("statusFree")) t->SetBranchAddress("statusFree", &statusFree);
-  if (branches->FindObject("statusScan")) t->SetBranchAddress("statusScan", &statusScan);
-  if (branches->FindObject("statusScanData")) t->SetBranchAddress("statusScanData", &statusScanData);
-  if (branches->FindObject("statusFreeBkg")) t->SetBranchAddress("statusFreeBkg", &statusFreeBkg);
-  if (branches->FindObject("statusScanBkg")) t->SetBranchAddress("statusScanBkg", &statusScanBkg);
-  if (branches->FindObject("statusBkgBkg")) t->SetBranchAddress("statusBkgBkg", &statusBkgBkg);
-  if (branches->FindObject("chi2minGlobalToyPDF")) t->SetBranchAddress("chi2minGlobalToyPDF", &chi2minGlobalToyPDF);
-  if (branches->FindObject("chi2minBkgToyPDF")) t->SetBranchAddress("chi2minBkgToyPDF", &chi2minBkgToyPDF);
-  if (branches->FindObject("chi2minToyPDF")) t->SetBranchAddress("chi2minToyPDF", &chi2minToyPDF);
-  // if(branches->FindObject("covQualFree"        )) t->SetBranchAddress("covQualFree",        &covQualFree);
-  // if(branches->FindObject("covQualScan"        )) t->SetBranchAddress("covQualScan",        &covQualScan);
-  // if(branches->FindObject("covQualScanData"    )) t->SetBranchAddress("covQualScanData",    &covQualScanData);
-  if (branches->FindObject("statusFreePDF")) t->SetBranchAddress("statusFreePDF", &statusFreePDF);
-  // if(branches->FindObject("statusScanData"     )) t->SetBranchAddress("statusScanData",     &statusScanData);
-  if (branches->FindObject("statusScanPDF")) t->SetBranchAddress("statusScanPDF", &statusScanPDF);
-  if (branches->FindObject("bestIndexScanData")) t->SetBranchAddress("bestIndexScanData", &bestIndexScanData);
+  convertedBranches.clear();
+  convertedTreeNumber = -1;
+  connectBranch("BergerBoos_id", &BergerBoos_id);
+  connectBranch("chi2min", &chi2min);
+  connectBranch("chi2minToy", &chi2minToy);
+  connectBranch("chi2minGlobal", &chi2minGlobal);
+  connectBranch("chi2minGlobalToy", &chi2minGlobalToy);
+  connectBranch("chi2minGlobalBkgToy", &chi2minGlobalBkgToy);
+  connectBranch("chi2minBkgBkgToy", &chi2minBkgBkgToy);
+  connectBranch("chi2minBkg", &chi2minBkg);
+  connectBranch("chi2minBkgToy", &chi2minBkgToy);
+  connectBranch("covQualFree", &covQualFree);
+  connectBranch("covQualScan", &covQualScan);
+  connectBranch("covQualScanData", &covQualScanData);
+  connectBranch("covQualFreeBkg", &covQualFreeBkg);
+  connectBranch("covQualScanBkg", &covQualScanBkg);
+  connectBranch("covQualBkgBkg", &covQualBkgBkg);
+  connectBranch("genericProbPValue", &genericProbPValue);
+  connectBranch("nBergerBoos", &nBergerBoos);
+  connectBranch("scanbest", &scanbest);
+  connectBranch("scanbesty", &scanbesty);
+  connectBranch("scanbestBkg", &scanbestBkg);
+  connectBranch("scanbestBkgfitBkg", &scanbestBkgfitBkg);
+  connectBranch("scanpoint", &scanpoint);
+  connectBranch("scanpointy", &scanpointy);
+  connectBranch("statusFree", &statusFree);
+  connectBranch("statusScan", &statusScan);
+  connectBranch("statusScanData", &statusScanData);
+  connectBranch("statusFreeBkg", &statusFreeBkg);
+  connectBranch("statusScanBkg", &statusScanBkg);
+  connectBranch("statusBkgBkg", &statusBkgBkg);
+  connectBranch("chi2minGlobalToyPDF", &chi2minGlobalToyPDF);
+  connectBranch("chi2minBkgToyPDF", &chi2minBkgToyPDF);
+  connectBranch("chi2minToyPDF", &chi2minToyPDF);
+  connectBranch("statusFreePDF", &statusFreePDF);
+  connectBranch("statusScanPDF", &statusScanPDF);
+  connectBranch("bestIndexScanData", &bestIndexScanData);
+  connectBranch("adaptiveStop", &adaptiveStop);
+  connectBranch("adaptivePvalue", &adaptivePvalue);
+  connectBranch("adaptivePvalueErr", &adaptivePvalueErr);
 }
 
 ///
@@ -234,32 +376,9 @@ void ToyTree::open() {
 void ToyTree::activateCoreBranchesOnly() {
   TObjArray* branches = t->GetListOfBranches();
   t->SetBranchStatus("*", 0);  // perhaps we need ".*" in certain root versions?
-  if (branches->FindObject("BergerBoos_id")) t->SetBranchStatus("BergerBoos_id", 1);
-  if (branches->FindObject("chi2min")) t->SetBranchStatus("chi2min", 1);
-  if (branches->FindObject("chi2minToy")) t->SetBranchStatus("chi2minToy", 1);
-  if (branches->FindObject("chi2minGlobal")) t->SetBranchStatus("chi2minGlobal", 1);
-  if (branches->FindObject("chi2minGlobalToy")) t->SetBranchStatus("chi2minGlobalToy", 1);
-  if (branches->FindObject("chi2minGlobalBkgToy")) t->SetBranchStatus("chi2minGlobalBkgToy", 1);
-  if (branches->FindObject("chi2minBkgBkgToy")) t->SetBranchStatus("chi2minBkgBkgToy", 1);
-  if (branches->FindObject("chi2minBkg")) t->SetBranchStatus("chi2minBkg", 1);
-  if (branches->FindObject("chi2minBkgToy")) t->SetBranchStatus("chi2minBkgToy", 1);
-  if (branches->FindObject("genericProbPValue")) t->SetBranchStatus("genericProbPValue", 1);
-  if (branches->FindObject("id")) t->SetBranchStatus("id", 1);
-  if (branches->FindObject("nBergerBoos")) t->SetBranchStatus("nBergerBoos", 1);
-  if (branches->FindObject("scanpoint")) t->SetBranchStatus("scanpoint", 1);
-  if (branches->FindObject("scanpointy")) t->SetBranchStatus("scanpointy", 1);
-  if (branches->FindObject("statusFree")) t->SetBranchStatus("statusFree", 1);
-  if (branches->FindObject("statusScan")) t->SetBranchStatus("statusScan", 1);
-  if (branches->FindObject("statusScanData")) t->SetBranchStatus("statusScanData", 1);
-  if (branches->FindObject("chi2minGlobalToyPDF")) t->SetBranchStatus("chi2minGlobalToyPDF", 1);
-  if (branches->FindObject("chi2minBkgToyPDF")) t->SetBranchStatus("chi2minBkgToyPDF", 1);
-  if (branches->FindObject("chi2minToyPDF")) t->SetBranchStatus("chi2minToyPDF", 1);
-  if (branches->FindObject("covQualFree")) t->SetBranchStatus("covQualFree", 1);
-  if (branches->FindObject("covQualScan")) t->SetBranchStatus("covQualScan", 1);
-  if (branches->FindObject("covQualScanData")) t->SetBranchStatus("covQualScanData", 1);
-  if (branches->FindObject("statusFreePDF")) t->SetBranchStatus("statusFreePDF", 1);
-  if (branches->FindObject("statusScanData")) t->SetBranchStatus("statusScanData", 1);
-  if (branches->FindObject("statusScanPDF")) t->SetBranchStatus("statusScanPDF", 1);
+  for (const auto& bName : coreBranches) {
+    if (branches->FindObject(bName)) t->SetBranchStatus(bName, 1);
+  }
 }
 
 ///
@@ -272,33 +391,34 @@ void ToyTree::activateBranch(const TString& bName) { t->SetBranchStatus(bName, 1
 ///
 void ToyTree::activateAllBranches() { t->SetBranchStatus("*", 1); }
 
+///
+/// Copy the values of a set of variables into the buffer of their branches,
+/// in the order of the set.
+///
+void ToyTree::storeValues(const ParameterBinding& vars, std::vector<float>& values) {
+  values.resize(vars.size());
+  vars.getValues(values.data());
+}
+
 ///
 /// Store the current workspace fit parameters as the
 /// profile likelihood parameters.
 ///
 void ToyTree::storeParsPll() {
-  if (!w->set(parsName)) {
+  if (!boundPars.isValid()) {
     std::cout << "ToyTree::storeParsPll() : ERROR : not found in workspace: " << parsName << std::endl;
     std::cout << "ToyTree::storeParsPll() :         Workspace printout follows: " << std::endl;
     w->Print("v");
     assert(0);
   }
-  for (const auto& pAbs : *w->set(parsName)) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    parametersPll[p->GetName()] = p->getVal();
-  }
+  storeValues(boundPars, parametersPll);
 }
 
 ///
 /// Store the current workspace fit parameters as the
 /// free fit result.
 ///
-void ToyTree::storeParsFree() {
-  for (const auto& pAbs : *w->set(parsName)) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    parametersFree[p->GetName()] = p->getVal();
-  }
-}
+void ToyTree::storeParsFree() { storeValues(boundPars, parametersFree); }
 
 ///
 /// Store the current workspace fit parameters as the
@@ -307,7 +427,8 @@ void ToyTree::storeParsFree() {
 void ToyTree::storeParsGau(RooArgSet globalConstraintMeans) {
   for (const auto& meanAbs : globalConstraintMeans) {
     const auto mean = static_cast<RooRealVar*>(meanAbs);
-    constraintMeans[mean->GetName()] = mean->getVal();
+    const int i = boundGlobalObs.getIndex(mean->GetName());
+    if (i >= 0 && i < static_cast<int>(constraintMeans.size())) constraintMeans[i] = mean->getVal();
   }
 }
 
@@ -315,12 +436,7 @@ void ToyTree::storeParsGau(RooArgSet globalConstraintMeans) {
 /// Store the current workspace fit parameters as the
 /// scan fit result.
 ///
-void ToyTree::storeParsScan() {
-  for (const auto& pAbs : *w->set(parsName)) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    parametersScan[p->GetName()] = p->getVal();
-  }
-}
+void ToyTree::storeParsScan() { storeValues(boundPars, parametersScan); }
 
 ///
 /// Store the fit result parameters as the
@@ -329,31 +445,24 @@ void ToyTree::storeParsScan() {
 void ToyTree::storeParsScan(RooFitResult* values) {
   RooArgList list = values->floatParsFinal();
   list.add(values->constPars());
+  const std::vector<int>& index = boundPars.map(list, scanResultMapping);
+  int i = 0;
   for (const auto& pAbs : list) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    parametersScan[p->GetName()] = p->getVal();
+    const int k = index[i++];
+    if (k < 0 || k >= static_cast<int>(parametersScan.size())) continue;
+    parametersScan[k] = static_cast<RooRealVar*>(pAbs)->getVal();
   }
 }
 
 ///
 /// Store the current workspace theory parameters.
 ///
-void ToyTree::storeTheory() {
-  for (const auto& pAbs : *w->set(thName)) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    theory[p->GetName()] = p->getVal();
-  }
-}
+void ToyTree::storeTheory() { storeValues(boundTheory, theory); }
 
 ///
 /// Store the current workspace observables.
 ///
-void ToyTree::storeObservables() {
-  for (const auto& pAbs : *w->set(obsName)) {
-    const auto p = static_cast<RooRealVar*>(pAbs);
-    observables[p->GetName()] = p->getVal();
-  }
-}
+void ToyTree::storeObservables() { storeValues(boundObs, observables); }
 
 Long64_t ToyTree::GetEntries() const {
   assert(t);
@@ -363,6 +472,15 @@ Long64_t ToyTree::GetEntries() const {
 void ToyTree::GetEntry(Long64_t i) {
   assert(t);
   t->GetEntry(i);
+  if (convertedBranches.empty()) return;
+  // the leaves change whenever the chain moves on to the next file
+  if (t->GetTreeNumber() != convertedTreeNumber) {
+    convertedTreeNumber = t->GetTreeNumber();
+    for (auto& b : convertedBranches) b.leaf = t->GetLeaf(b.name);
+  }
+  for (const auto& b : convertedBranches) {
+    if (b.leaf) b.set(b.leaf->GetValue());
+  }
 }
 
 ///
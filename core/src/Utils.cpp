@@ -7,8 +7,10 @@
 
 #include <Utils.h>
 
+#include <FitParameterSchema.h>
+#include <NllMinimizer.h>
+#include <RooMinusTwoLogL.h>
 #include <RooSlimFitResult.h>
-#include <rdtsc.h>
 
 #include <RooFitResult.h>
 #include <RooFormulaVar.h>
@@ -21,6 +23,7 @@
 #include <TCanvas.h>
 #include <TColor.h>
 #include <TError.h>
+#include <TFileMerger.h>
 #include <TGraph.h>
 #include <TGraphErrors.h>
 #include <TGraphSmooth.h>
@@ -32,19 +35,32 @@
 #include <TObjArray.h>
 #include <TPaveText.h>
 #include <TROOT.h>
+#include <TRandom3.h>
+#include <TSystem.h>
 #include <TTree.h>
 #include <TVectorD.h>
 
 #include <boost/algorithm/string.hpp>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
+#include <exception>
 #include <format>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <new>
+#include <numeric>
 #include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
@@ -66,8 +82,8 @@ namespace {
   }
 }  // namespace
 
-int Utils::countFitBringBackAngle;     ///< counts how many times an angle needed to be brought back
-int Utils::countAllFitBringBackAngle;  ///< counts how many times fitBringBackAngle() was called
+std::atomic<int> Utils::countFitBringBackAngle;     ///< counts how many times an angle needed to be brought back
+std::atomic<int> Utils::countAllFitBringBackAngle;  ///< counts how many times fitBringBackAngle() was called
 
 void Utils::errBase(const std::string& prefix, const std::string& msg, bool exit) {
   const std::string endStringSeparator = msg.ends_with('\n') ? "" : ". ";
@@ -81,69 +97,6 @@ void Utils::msgBase(const std::string& prefix, const std::string& msg, std::ostr
   stream << prefix << msgOut << std::endl;
 };
 
-///
-/// Fit PDF to minimum.
-/// \param pdf The PDF.
-/// \param thorough Activate Hesse and Minos
-/// \param printLevel -1 = no output, 1 verbose output
-///
-RooFitResult* Utils::fitToMin(RooAbsPdf* pdf, bool thorough, int printLevel) {
-  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
-
-  // pdf->Print("v");
-  // const RooProdPdf *prod = (RooProdPdf*)pdf;
-  // const RooArgList& pdflist = prod->pdfList();
-  // double chi2=0;
-  // for (int i=0; i<pdflist.getSize(); i++){
-  // const RooAbsPdf *ipdf = (RooAbsPdf*)pdflist.at(i);
-  // chi2 += -2*TMath::Log(ipdf->getVal());
-  // std::cout << ipdf->GetName() << " " << -2*TMath::Log(ipdf->getVal()) << " " << chi2 << std::endl;
-  //////ipdf->Print("v");
-  //}
-  // std::cout << chi2 << std::endl;
-
-  RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*pdf));
-  // std::cout << ll.getVal() << std::endl;
-  // std::string a;
-  // cin >> a;
-  bool quiet = printLevel < 0;
-  RooMinimizer m(ll);
-  if (quiet) {
-    m.setPrintLevel(-2);
-  } else
-    m.setPrintLevel(1);
-  // if (quiet) m.setLogFile();
-  m.setErrorLevel(1.0);
-  m.setStrategy(2);
-  m.setProfile(0);  // 1 enables migrad timer
-  unsigned long long start = rdtsc();
-  int status = m.migrad();
-  // m.simplex();
-  // m.migrad();
-  // m.simplex();
-  if (thorough) {
-    m.hesse();
-    // MINOS seems to fail in more complicated scenarios
-    // Can't just use m.minos() because there's a std::cout that cannot be turned off (root 5-34-03).
-    // It's not there when we run minos only on selected parameters- so select them all!
-    // //m.minos();
-    // RooArgSet floatingPars;
-    // for (const auto& p : pdf->getVariables()) {
-    //   if ( !p->isConstant() ) floatingPars.add(*p);
-    // }
-    // delete it;
-    // m.minos(floatingPars);
-    // IMPROVE doesn't really improve much
-    // //m.improve();
-  }
-  unsigned long long stop = rdtsc();
-  if (!quiet) std::printf("Fit took %llu clock cycles.\n", stop - start);
-  RooFitResult* r = m.save();
-  // if (!quiet) r->Print("v");
-  RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
-  return r;
-}
-
 ///
 /// Return an equivalent angle between 0 and 2pi.
 /// \param angle Angle that is possibly smaller than 0 or larger than 2pi.
@@ -176,15 +129,19 @@ double Utils::angularDifference(double angle1, double angle2) {
 /// interval, add multiples of 2pi to bring it back. Then, refit.
 /// All variables that have unit 'rad' are taken to be angles.
 ///
-RooFitResult* Utils::fitToMinBringBackAngles(RooAbsPdf* pdf, bool thorough, int printLevel) {
+/// \param nll The persistent minimizer of the pdf, e.g. Combiner::getNllMinimizer().
+/// \param thorough Activate Hesse
+/// \param printLevel -1 = no output, 1 verbose output
+///
+RooFitResult* Utils::fitToMinBringBackAngles(NllMinimizer* nll, bool thorough, int printLevel) {
   countAllFitBringBackAngle++;
-  RooFitResult* r = fitToMin(pdf, thorough, printLevel);
+  RooFitResult* r = nll->fit(thorough, printLevel);
   bool refit = false;
   for (const auto& pAbs : r->floatParsFinal()) {
     const auto p = static_cast<RooRealVar*>(pAbs);
     if (!isAngle(p)) continue;
     if (p->getVal() < 0.0 || p->getVal() > 2. * TMath::Pi()) {
-      RooArgSet* pdfPars = pdf->getParameters(RooArgSet());
+      RooArgSet* pdfPars = nll->getPdf()->getParameters(RooArgSet());
       RooRealVar* pdfPar = (RooRealVar*)pdfPars->find(p->GetName());
       pdfPar->setVal(bringBackAngle(p->getVal()));
       refit = true;
@@ -194,27 +151,38 @@ RooFitResult* Utils::fitToMinBringBackAngles(RooAbsPdf* pdf, bool thorough, int
   if (refit) {
     countFitBringBackAngle++;
     delete r;
-    r = fitToMin(pdf, thorough, printLevel);
+    r = nll->fit(thorough, printLevel);
   }
   return r;
 }
 
 ///
 /// Find the global minimum in a more thorough way.
-/// First fit with external start parameters, then
-/// for each parameter that starts with "d" or "r" (typically angles and ratios):
-///   - at upper scan range, rest at start parameters
-///   - at lower scan range, rest at start parameters
-/// This amounts to a maximum of 1+2^n fits, where n is the number
-/// of parameters to be varied.
+/// First fit with external start parameters, then refit from a set of
+/// start points of the parameters to be varied. By default (kCorners), these
+/// are all corners of the "force" ranges of the varied parameters, i.e.
+/// each parameter at the upper or lower end of its range, rest at start
+/// parameters. This amounts to a maximum of 1+2^n fits, where n is the number
+/// of parameters to be varied. The sampled designs (kSobol, kLatinHypercube)
+/// place config.budget start points inside the force ranges instead, which
+/// scales linearly with n.
+///
+/// All fits use the given minimizer, usually the persistent one of the
+/// combination, so that nothing is rebuilt per call. If config.nConfirm is
+/// set, the remaining start points are skipped once the best minimum was
+/// found again nConfirm times.
 ///
 /// \param w Workspace holding the pdf.
+/// \param nll Minimizer of the pdf.
 /// \param name Name of the pdf without leading "pdf_".
 /// \param forceVariables Apply the force method for these variables only. Format
 /// "var1,var2,var3," (list must end with comma). Default is to apply for all angles,
 /// all ratios except rD_k3pi and rD_kpi, and the k3pi coherence factor.
+/// \param debug Print progress.
+/// \param config Start point design.
 ///
-RooFitResult* Utils::fitToMinForce(RooWorkspace* w, TString name, TString forceVariables, bool debug) {
+RooFitResult* Utils::fitToMinForce(RooWorkspace* w, NllMinimizer* nll, TString name, TString forceVariables,
+                                   bool debug, const ForceConfig& config) {
   TString parsName = "par_" + name;
   TString obsName = "obs_" + name;
   TString pdfName = "pdf_" + name;
@@ -227,91 +195,137 @@ RooFitResult* Utils::fitToMinForce(RooWorkspace* w, TString name, TString forceV
     std::cout << "MethodProbScan::scan2d() : ERROR : parsName not found: " << parsName << std::endl;
     std::exit(1);
   }
-  RooDataSet* startPars = new RooDataSet("startParsForce", "startParsForce", *w->set(parsName));
-  startPars->add(*w->set(parsName));
+  std::unique_ptr<RooArgSet> startPars(static_cast<RooArgSet*>(w->set(parsName)->snapshot()));
 
   // set up parameters and ranges
-  RooArgList* varyPars = new RooArgList();
-  for (const auto& p : *w->set(parsName)) {
+  std::vector<TString> varyPars;
+  std::vector<std::pair<double, double>> forceRanges;
+  for (const auto& pAbs : *w->set(parsName)) {
+    const auto p = static_cast<RooRealVar*>(pAbs);
     if (p->isConstant()) continue;
-    if (forceVariables == "" &&
-        (false ||
-         TString(p->GetName()).BeginsWith("d")  ///< use these variables
-         // || TString(p->GetName()).BeginsWith("r")
-         || TString(p->GetName()).BeginsWith("k") || TString(p->GetName()) == "g") &&
-        !(TString(p->GetName()) == "rD_k3pi"  ///< don't use these
-          || TString(p->GetName()) == "rD_kpi"
-          // || TString(p->GetName()) == "dD_kpi"
-          || TString(p->GetName()) == "d_dk" || TString(p->GetName()) == "d_dsk")) {
-      varyPars->add(*p);
-    } else if (forceVariables.Contains(TString(p->GetName()) + ",")) {
-      varyPars->add(*p);
-    }
+    if (!(forceVariables == "" &&
+          (false ||
+           TString(p->GetName()).BeginsWith("d")  ///< use these variables
+           // || TString(p->GetName()).BeginsWith("r")
+           || TString(p->GetName()).BeginsWith("k") || TString(p->GetName()) == "g") &&
+          !(TString(p->GetName()) == "rD_k3pi"  ///< don't use these
+            || TString(p->GetName()) == "rD_kpi"
+            // || TString(p->GetName()) == "dD_kpi"
+            || TString(p->GetName()) == "d_dk" || TString(p->GetName()) == "d_dsk")) &&
+        !forceVariables.Contains(TString(p->GetName()) + ","))
+      continue;
+    const auto oldMin = p->getMin();
+    const auto oldMax = p->getMax();
+    setLimit(w, p->GetName(), "force");
+    varyPars.push_back(p->GetName());
+    forceRanges.emplace_back(p->getMin(), p->getMax());
+    p->setRange(oldMin, oldMax);
+  }
+  const int nPars = varyPars.size();
+
+  // start points in units of the force ranges
+  forceDesign design = config.design;
+  if (design == kSobol && nPars > 21) {
+    std::cout << "Utils::fitToMinForce() : WARNING : Sobol design available for up to 21 parameters, "
+                 "using a Latin hypercube."
+              << std::endl;
+    design = kLatinHypercube;
+  }
+  if (design == kCorners && nPars > 30) {
+    std::cout << "Utils::fitToMinForce() : ERROR : too many parameters to vary for the corners design: " << nPars
+              << ". Use a sampled design." << std::endl;
+    std::exit(1);
+  }
+  const int budget = config.budget > 0 ? config.budget : 4 * nPars;
+  std::vector<std::vector<double>> design01;
+  if (design == kSobol) design01 = sobolSequence(nPars, budget);
+  if (design == kLatinHypercube) design01 = latinHypercube(nPars, budget, config.seed);
+  const int nStarts = design == kCorners ? 1 << nPars : static_cast<int>(design01.size());
+  auto startPoint = [&](int i, int ip) {
+    if (design == kCorners) return double((i >> ip) & 1);
+    return design01[i][ip];
+  };
+
+  if (debug) std::cout << "Utils::fitToMinForce() : nPars = " << nPars << " => " << nStarts << " fits" << std::endl;
+  if (debug) {
+    std::cout << "Utils::fitToMinForce() : varying ";
+    for (const auto& p : varyPars) std::cout << p << " ";
+    std::cout << std::endl;
   }
-  int nPars = varyPars->getSize();
-  if (debug)
-    std::cout << "Utils::fitToMinForce() : nPars = " << nPars << " => " << pow(2., nPars) << " fits" << std::endl;
-  if (debug) std::cout << "Utils::fitToMinForce() : varying ";
-  if (debug) varyPars->Print();
 
   //////////
 
-  r = fitToMinBringBackAngles(w->pdf(pdfName), false, printlevel);
+  r = fitToMinBringBackAngles(nll, false, printlevel);
 
   //////////
 
+  // Keep the lowest good minimum, and the last failed fit in case no fit succeeds.
+  auto isGood = [](const RooFitResult* res) { return res->edm() < 1 && res->covQual() == 3; };
+  RooFitResult* rBest = isGood(r) ? r : nullptr;
+  RooFitResult* rLastFailed = isGood(r) ? nullptr : r;
+  int nConfirmed = 0;
   int nErrors = 0;
+  int nFits = 0;
+  bool confirmed = false;
 
-  // We define a binary mask where each bit corresponds
-  // to parameter at max or at min.
-  for (int i = 0; i < pow(2., nPars); i++) {
-    if (debug) std::cout << "Utils::fitToMinForce() : fit " << i << "        \r" << std::flush;
-    setParameters(w, parsName, startPars->get(0));
-
+  for (int i = 0; i < nStarts && !confirmed; i++) {
+    resetParameters(w, *startPars);
     for (int ip = 0; ip < nPars; ip++) {
-      RooRealVar* p = (RooRealVar*)varyPars->at(ip);
-      const auto oldMin = p->getMin();
-      const auto oldMax = p->getMax();
-      setLimit(w, p->GetName(), "force");
-      if (i / (int)pow(2., ip) % 2 == 0) { p->setVal(p->getMin()); }
-      if (i / (int)pow(2., ip) % 2 == 1) { p->setVal(p->getMax()); }
-      p->setRange(oldMin, oldMax);
+      const auto& [min, max] = forceRanges[ip];
+      w->var(varyPars[ip])->setVal(min + startPoint(i, ip) * (max - min));
     }
 
     // check if start parameters are sensible, skip if they're not
-    double startParChi2 = getChi2(w->pdf(pdfName));
+    double startParChi2 = nll->getVal();
     if (startParChi2 > 2000) {
       nErrors += 1;
       continue;
     }
 
     // refit
-    RooFitResult* r2 = fitToMinBringBackAngles(w->pdf(pdfName), false, printlevel);
-
-    // In case the initial fit failed, accept the second one.
-    // If both failed, still select the second one and hope the
-    // next fit succeeds.
-    if (!(r->edm() < 1 && r->covQual() == 3)) {
-      delete r;
-      r = r2;
-    } else if (r2->edm() < 1 && r2->covQual() == 3 && r2->minNll() < r->minNll()) {
-      // better minimum found!
-      delete r;
-      r = r2;
+    RooFitResult* r2 = fitToMinBringBackAngles(nll, false, printlevel);
+    if (debug) std::cout << "Utils::fitToMinForce() : fit " << nFits << "        \r" << std::flush;
+    nFits++;
+
+    if (isGood(r2)) {
+      if (rBest && std::abs(r2->minNll() - rBest->minNll()) < config.confirmTolerance) nConfirmed++;
+      else if (!rBest || r2->minNll() < rBest->minNll()) nConfirmed = 0;
+      if (!rBest || r2->minNll() < rBest->minNll()) {
+        // better minimum found!
+        std::swap(r2, rBest);
+      }
+      delete r2;
+      if (config.nConfirm > 0 && nConfirmed >= config.nConfirm) confirmed = true;
+    } else if (!rBest) {
+      // In case no fit succeeded so far, keep the last one and hope
+      // a following fit succeeds.
+      delete rLastFailed;
+      rLastFailed = r2;
     } else {
       delete r2;
     }
   }
 
+  if (rBest) {
+    delete rLastFailed;
+    r = rBest;
+  } else {
+    r = rLastFailed;
+  }
+
   if (debug) std::cout << std::endl;
   if (debug) std::cout << "Utils::fitToMinForce() : nErrors = " << nErrors << std::endl;
+  if (debug && confirmed)
+    std::cout << "Utils::fitToMinForce() : minimum confirmed " << nConfirmed << " times after " << nFits << " fits"
+              << std::endl;
 
   RooMsgService::instance().setGlobalKillBelow(RooFit::INFO);
 
-  // (re)set to best parameters
-  setParameters(w, parsName, r);
+  // (re)set to best parameters, including their errors, so that
+  // following fits don't depend on which fit was done last
+  resetParameters(w, *startPars);
+  resetParameters(w, r->floatParsFinal());
 
-  delete startPars;
   return r;
 }
 
@@ -462,10 +476,294 @@ RooFitResult* Utils::fitToMinImprove(RooWorkspace* w, TString name) {
 }
 
 double Utils::getChi2(RooAbsPdf* pdf) {
-  RooFormulaVar ll("ll", "ll", "-2*log(@0)", RooArgSet(*pdf));
+  RooMinusTwoLogL ll("ll", "ll", *pdf);
   return ll.getVal();
 }
 
+///
+/// Points of the Sobol low-discrepancy sequence in the unit hypercube,
+/// using the primitive polynomials and direction numbers of Joe and Kuo
+/// (new-joe-kuo-6.21201). The first point, which is the origin, is skipped.
+///
+/// \param nDim Number of dimensions, at most 21.
+/// \param nPoints Number of points.
+/// \return One vector of nDim coordinates in [0,1) per point.
+///
+std::vector<std::vector<double>> Utils::sobolSequence(int nDim, int nPoints) {
+  struct Direction {
+    int degree;
+    unsigned int a;
+    std::vector<unsigned int> m;
+  };
+  static const std::vector<Direction> directions = {
+      {1, 0, {1}},
+      {2, 1, {1, 3}},
+      {3, 1, {1, 3, 1}},
+      {3, 2, {1, 1, 1}},
+      {4, 1, {1, 1, 3, 3}},
+      {4, 4, {1, 3, 5, 13}},
+      {5, 2, {1, 1, 5, 5, 17}},
+      {5, 4, {1, 1, 5, 5, 5}},
+      {5, 7, {1, 1, 7, 11, 19}},
+      {5, 11, {1, 1, 5, 1, 1}},
+      {5, 13, {1, 1, 1, 3, 11}},
+      {5, 14, {1, 3, 5, 5, 31}},
+      {6, 1, {1, 3, 3, 9, 7, 49}},
+      {6, 13, {1, 1, 1, 15, 21, 21}},
+      {6, 16, {1, 3, 1, 13, 27, 49}},
+      {6, 19, {1, 1, 1, 15, 7, 5}},
+      {6, 22, {1, 3, 1, 15, 13, 25}},
+      {6, 25, {1, 1, 5, 5, 19, 61}},
+      {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+      {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+  };
+  const int nBits = 32;
+  assert(nDim <= (int)directions.size() + 1);
+
+  // direction numbers v[d][k], scaled by 2^32
+  std::vector<std::vector<unsigned int>> v(nDim, std::vector<unsigned int>(nBits));
+  for (int k = 0; k < nBits; k++) v[0][k] = 1u << (nBits - 1 - k);
+  for (int d = 1; d < nDim; d++) {
+    const Direction& dir = directions[d - 1];
+    const int s = dir.degree;
+    for (int k = 0; k < nBits; k++) {
+      if (k < s) {
+        v[d][k] = dir.m[k] << (nBits - 1 - k);
+        continue;
+      }
+      v[d][k] = v[d][k - s] ^ (v[d][k - s] >> s);
+      for (int i = 1; i < s; i++) {
+        if ((dir.a >> (s - 1 - i)) & 1) v[d][k] ^= v[d][k - i];
+      }
+    }
+  }
+
+  // Gray code construction: point n differs from point n-1 by the
+  // direction number of the lowest zero bit of n-1
+  std::vector<std::vector<double>> points(nPoints, std::vector<double>(nDim));
+  std::vector<unsigned int> x(nDim, 0);
+  for (int n = 1; n <= nPoints; n++) {
+    int c = 0;
+    for (unsigned int m = n - 1; m & 1; m >>= 1) c++;
+    for (int d = 0; d < nDim; d++) {
+      x[d] ^= v[d][c];
+      points[n - 1][d] = std::ldexp(double(x[d]), -nBits);
+    }
+  }
+  return points;
+}
+
+///
+/// Points of a Latin hypercube design in the unit hypercube: along each
+/// dimension, every one of nPoints equal intervals holds exactly one point.
+///
+/// \param nDim Number of dimensions.
+/// \param nPoints Number of points.
+/// \param seed Seed of the random number generator.
+/// \return One vector of nDim coordinates in [0,1) per point.
+///
+std::vector<std::vector<double>> Utils::latinHypercube(int nDim, int nPoints, unsigned int seed) {
+  TRandom3 rnd(seed);
+  std::vector<std::vector<double>> points(nPoints, std::vector<double>(nDim));
+  std::vector<int> interval(nPoints);
+  for (int d = 0; d < nDim; d++) {
+    std::iota(interval.begin(), interval.end(), 0);
+    for (int i = nPoints - 1; i > 0; i--) std::swap(interval[i], interval[rnd.Integer(i + 1)]);
+    for (int i = 0; i < nPoints; i++) points[i][d] = (interval[i] + rnd.Rndm()) / nPoints;
+  }
+  return points;
+}
+
+///
+/// Run a number of independent tasks on a pool of worker threads.
+/// Tasks are handed out in order of their index to whichever worker
+/// becomes free first. Each call receives the index of the worker it
+/// runs on, so that callers can keep per-worker state, such as a reader
+/// of a TChain. Don't fit in these tasks: RooFit keeps global state that
+/// is not thread-safe, e.g. its memory pools and message service. Use
+/// forkFor() to fit on several cores instead. With less than two workers,
+/// all tasks are run in order on the calling thread.
+///
+/// \param nWorkers Number of worker threads.
+/// \param nTasks Number of tasks.
+/// \param task Function called as task(iWorker, iTask).
+///
+void Utils::parallelFor(int nWorkers, int nTasks, const std::function<void(int iWorker, int iTask)>& task) {
+  if (nWorkers < 2) {
+    for (int iTask = 0; iTask < nTasks; iTask++) task(0, iTask);
+    return;
+  }
+  ROOT::EnableThreadSafety();
+  std::atomic<int> nextTask = 0;
+  std::vector<std::jthread> workers;
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+    workers.emplace_back([&, iWorker] {
+      for (int iTask = nextTask++; iTask < nTasks; iTask = nextTask++) task(iWorker, iTask);
+    });
+  }
+  // the std::jthread destructors join all workers
+}
+
+///
+/// Run a number of independent tasks on a pool of forked worker processes.
+/// Tasks are handed out through a counter in shared memory to whichever
+/// worker becomes free first. Each worker starts as a copy of the calling
+/// process, so it sees everything set up before, but none of its changes
+/// make it back: after its last task, each worker calls finish(), which
+/// has to save the results, e.g. to a file. Don't use this while other
+/// threads are running, they are not copied into the workers.
+///
+/// Tasks are handed out in order of their index, so a task may wait for
+/// results of tasks with a smaller index, passed on through SharedMemory.
+///
+/// A worker in which a task or finish() throws, or calls std::exit(), ends
+/// with _exit(1), so that it neither continues in the code of the calling
+/// process nor runs the teardown of the static objects copied from it.
+/// The calling process then sees it as failed, and stops the other workers.
+///
+/// \param nWorkers Number of worker processes.
+/// \param nTasks Number of tasks.
+/// \param task Function called in the workers as task(iWorker, iTask).
+/// \param finish Function called in the workers as finish(iWorker) after their last task.
+/// \param progress Function called in the calling process once per finished task.
+/// \return True if all workers finished successfully.
+///
+bool Utils::forkFor(int nWorkers, int nTasks, const std::function<void(int iWorker, int iTask)>& task,
+                    const std::function<void(int iWorker)>& finish, const std::function<void()>& progress) {
+  struct Counters {
+    std::atomic<int> nextTask = 0;
+    std::atomic<int> nDone = 0;
+  };
+  SharedMemory shared(sizeof(Counters));
+  if (!shared.get()) return false;
+  Counters* counters = new (shared.get()) Counters();
+
+  // don't let the workers inherit buffered output
+  std::cout << std::flush;
+  std::fflush(nullptr);
+
+  std::vector<pid_t> workers;
+  for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+    const pid_t pid = fork();
+    if (pid < 0) {
+      std::cout << "Utils::forkFor() : WARNING : could not start worker " << iWorker << std::endl;
+      continue;
+    }
+    if (pid == 0) {
+      // A worker must never return into the code of the calling process, nor tear
+      // down the static objects copied from it, e.g. those of ROOT. So std::exit()
+      // called by a task ends the worker right away, as a failure.
+      std::atexit([] {
+        std::cout << std::flush;
+        std::fflush(nullptr);
+        _exit(1);
+      });
+      try {
+        for (int iTask = counters->nextTask++; iTask < nTasks; iTask = counters->nextTask++) {
+          task(iWorker, iTask);
+          counters->nDone++;
+        }
+        finish(iWorker);
+      } catch (const std::exception& e) {
+        std::cout << "Utils::forkFor() : ERROR : worker " << iWorker << " failed: " << e.what() << std::endl;
+        std::fflush(nullptr);
+        _exit(1);
+      } catch (...) {
+        std::cout << "Utils::forkFor() : ERROR : worker " << iWorker << " failed." << std::endl;
+        std::fflush(nullptr);
+        _exit(1);
+      }
+      std::cout << std::flush;
+      std::fflush(nullptr);
+      // skip the destructors of the objects copied from the calling process
+      _exit(0);
+    }
+    workers.push_back(pid);
+  }
+
+  // wait for the workers, reporting progress
+  bool success = !workers.empty();
+  int nRunning = workers.size();
+  int nReported = 0;
+  while (nRunning > 0) {
+    for (auto& pid : workers) {
+      int status = 0;
+      if (pid <= 0 || waitpid(pid, &status, WNOHANG) != pid) continue;
+      pid = 0;
+      nRunning--;
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0) continue;
+      // the results are incomplete, and other workers may wait for the tasks
+      // of this one, so stop them all
+      if (success) {
+        for (const auto other : workers) {
+          if (other > 0) kill(other, SIGKILL);
+        }
+      }
+      success = false;
+    }
+    for (; nReported < counters->nDone; nReported++) {
+      if (progress) progress();
+    }
+    if (nRunning > 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  if (counters->nDone < nTasks) success = false;
+
+  counters->~Counters();
+  return success;
+}
+
+///
+/// Name of the file a worker of forkFor() writes its part of the results to,
+/// before they are merged into fileName by mergeForkParts().
+///
+/// \param fileName Name of the merged file, ending in .root.
+/// \param iPart Index of the part, usually that of the worker.
+///
+TString Utils::forkPartFileName(const TString& fileName, int iPart) {
+  TString partName = fileName;
+  partName.ReplaceAll(".root", Form("_part%i.root", iPart));
+  return partName;
+}
+
+///
+/// Merge the files written by the workers of forkFor() into one, and delete
+/// them. The parts are kept if the merge fails.
+///
+/// \param fileName Name of the merged file, recreated.
+/// \param parts Names of the parts, see forkPartFileName().
+/// \return False if the parts could not be merged.
+///
+bool Utils::mergeForkParts(const TString& fileName, const std::vector<TString>& parts) {
+  TFileMerger merger(false);
+  merger.SetPrintLevel(0);
+  merger.OutputFile(fileName, "RECREATE");
+  for (const auto& part : parts) merger.AddFile(part, false);
+  if (!merger.Merge()) return false;
+  for (const auto& part : parts) gSystem->Unlink(part);
+  return true;
+}
+
+///
+/// Map memory that is shared with the worker processes started by forkFor()
+/// afterwards, e.g. to pass results from one task to the next. The memory is
+/// zero-initialized.
+///
+/// \param size Size in bytes.
+///
+Utils::SharedMemory::SharedMemory(size_t size) : _size(size) {
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    std::cout << "Utils::SharedMemory::SharedMemory() : ERROR : could not map " << size << " bytes of shared memory."
+              << std::endl;
+    return;
+  }
+  _memory = memory;
+}
+
+Utils::SharedMemory::~SharedMemory() {
+  if (_memory) munmap(_memory, _size);
+}
+
 //
 // Randomize all parameters of a set defined in a given
 // workspace.
@@ -547,6 +845,22 @@ void Utils::setParameters(RooWorkspace* w, RooFitResult* values) {
   return;
 };
 
+///
+/// Set values and errors of the workspace parameters to those in the given set.
+/// Setting the errors as well makes a following fit independent of the fits done
+/// before, as Minuit derives its initial step sizes from them.
+/// Parameters not found in the workspace are skipped.
+///
+void Utils::resetParameters(RooWorkspace* w, const RooAbsCollection& values) {
+  for (const auto& pAbs : values) {
+    const auto p = static_cast<RooRealVar*>(pAbs);
+    RooRealVar* pw = w->var(p->GetName());
+    if (!pw) continue;
+    pw->setVal(p->getVal());
+    pw->setError(p->getError());
+  }
+}
+
 ///
 /// Set each parameter in setMe to the value found in values.
 /// Do nothing if parameter is not found in values.
@@ -625,10 +939,10 @@ void Utils::setParameters(RooWorkspace* w, TString parname, RooFitResult* r, boo
 
 void Utils::setParameters(RooWorkspace* w, TString parname, RooSlimFitResult* r, bool constAndFloat) {
   // avoid calls to floatParsFinal on a RooSlimFitResult - errgh!
-  std::vector<std::string>& names = r->_parsNames;
-  for (int i = 0; i < names.size(); i++) {
-    RooRealVar* var = (RooRealVar*)w->var(names[i].c_str());
-    if (var) var->setVal(r->_parsVal[i]);
+  const FitParameterSchema* schema = r->getSchema();
+  for (int i = 0; i < schema->getNPars(); i++) {
+    RooRealVar* var = (RooRealVar*)w->var(schema->getName(i).c_str());
+    if (var) var->setVal(r->getParVal(i));
   }
 }
 